@@ -133,6 +133,9 @@ int linux_set_if_mac(const char *ifname, const unsigned char mac[ETH_ALEN]);
 int linux_hw_mc_add(const char *ifname, const uint8_t hwma[ETH_ALEN]);
 int linux_hw_mc_del(const char *ifname, const uint8_t hwma[ETH_ALEN]);
 
+/* fill "n" bytes with kernel random data, 0 on success */
+int get_random_bytes(void *buf, size_t n);
+
 /* read "n" bytes from a descriptor */
 ssize_t readn(int fd, void *vptr, size_t n);
 
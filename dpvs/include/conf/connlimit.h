@@ -0,0 +1,71 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * per-client limits of services: new connections per second and
+ * concurrent connections of one client address or prefix.
+ */
+#ifndef __DPVS_CONNLIMIT_CONF_H__
+#define __DPVS_CONNLIMIT_CONF_H__
+
+#include <stdint.h>
+#include "conf/service.h"
+
+enum {
+    /* set */
+    SOCKOPT_SET_CONNLIMIT = 6900,
+
+    /* get */
+    SOCKOPT_GET_CONNLIMIT = 6900,
+};
+
+/* what to do with a new connection of a client over @conns */
+enum {
+    DPVS_CONNLIMIT_DROP         = 0,
+    DPVS_CONNLIMIT_RST,         /* answer the SYN with a RST */
+    DPVS_CONNLIMIT_SYNPROXY,    /* RST it once syn-proxy saw a handshake */
+};
+
+struct dp_vs_connlimit_conf {
+    /* which service, as for dp_vs_get_dests */
+    int              af;
+    uint16_t         proto;
+    union inet_addr  addr;
+    uint16_t         port;
+    uint32_t         fwmark;
+    char             srange[256];
+    char             drange[256];
+    char             iifname[IFNAMSIZ];
+    char             oifname[IFNAMSIZ];
+
+    /* new connections per second of one client prefix, 0 for no limit */
+    uint32_t         rate;
+    uint32_t         burst;     /* 0 for @rate */
+    uint8_t          plen;      /* client prefix, 0 for the whole address */
+    uint32_t         conns;     /* concurrent connections, 0 for no limit */
+    uint8_t          policy;    /* DPVS_CONNLIMIT_XXX over @conns */
+
+    /* get: lcore index as ipvsadm --cpu, 0 sums up all lcores */
+    lcoreid_t        cid;
+
+    /* filled in by dpvs on get */
+    uint64_t         passed;    /* new connections checked and let in */
+    uint64_t         rate_drops;
+    uint64_t         conn_drops; /* refused (or reset) over @conns */
+};
+
+#endif /* __DPVS_CONNLIMIT_CONF_H__ */
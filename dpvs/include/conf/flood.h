@@ -0,0 +1,63 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * per-VIP packet budgets against ICMP and UDP floods, shared by dpvs
+ * and dpip.
+ */
+#ifndef __DPVS_FLOOD_CONF_H__
+#define __DPVS_FLOOD_CONF_H__
+#include <stdint.h>
+#include "inet.h"
+
+enum {
+    /* get */
+    SOCKOPT_GET_FLOOD_STATS = 7200,
+};
+
+enum {
+    DP_VS_FLOOD_ICMP_ECHO = 0,  /* echo requests to a local address */
+    DP_VS_FLOOD_ICMP_ERROR,     /* errors looked up for a connection */
+    DP_VS_FLOOD_UDP_NEW,        /* UDP packets creating a connection */
+    DP_VS_FLOOD_MAX,
+};
+
+#define DP_VS_FLOOD_TOP     16          /* buckets listed per type */
+
+/*
+ * a bucket with drops. VIPs hashing to the same bucket share its budget
+ * and its counter, @vaddr is the VIP of the last drop.
+ */
+struct dp_vs_flood_vip {
+    uint8_t             type;
+    uint8_t             af;
+    union inet_addr     vaddr;
+    uint64_t            dropped;
+} __attribute__((__packed__));
+
+/* counters are summed over lcores */
+struct dp_vs_flood_stats {
+    uint32_t    rate[DP_VS_FLOOD_MAX];      /* pkts/s per VIP and lcore */
+    uint32_t    burst[DP_VS_FLOOD_MAX];
+    uint64_t    passed[DP_VS_FLOOD_MAX];
+    uint64_t    dropped[DP_VS_FLOOD_MAX];
+
+    uint32_t    nvips;                      /* by type, most dropped first */
+    struct dp_vs_flood_vip vips[0];
+} __attribute__((__packed__));
+
+#endif /* __DPVS_FLOOD_CONF_H__ */
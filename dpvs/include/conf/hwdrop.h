@@ -0,0 +1,62 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * sources dropped by NIC rules (rte_flow), shared by dpvs and dpip.
+ */
+#ifndef __DPVS_HWDROP_CONF_H__
+#define __DPVS_HWDROP_CONF_H__
+#include <stdint.h>
+#include "inet.h"
+
+enum {
+    /* set */
+    SOCKOPT_SET_HWDROP_FLUSH = 7100,
+
+    /* get */
+    SOCKOPT_GET_HWDROP_SHOW = 7100,
+};
+
+/* a source reported by the lcores for a VIP, with rules or not yet */
+struct dp_vs_hwdrop_entry {
+    int                 af;
+    union inet_addr     addr;
+    union inet_addr     vaddr;
+    uint32_t            rate;       /* packets/s, of the last second */
+    uint32_t            ttl;        /* seconds before the rules go */
+    uint16_t            nports;     /* ports having a rule, 0 for candidates */
+} __attribute__((__packed__));
+
+struct dp_vs_hwdrop_show {
+    /* config */
+    uint32_t            rate;       /* packets/s installing rules, 0 off */
+    uint32_t            ttl;
+    uint32_t            max_flows;  /* rules per port */
+
+    uint16_t            nports;     /* ports with rte_flow */
+    uint16_t            nports_nosupp;  /* ports skipped, no rte_flow */
+    uint32_t            nflows;     /* sources having rules */
+    uint64_t            installs;
+    uint64_t            evicts;     /* removed for sources of higher rates */
+    uint64_t            expires;
+    uint64_t            fails;      /* rules the NIC refused */
+
+    uint32_t            nentries;
+    struct dp_vs_hwdrop_entry entries[0];
+} __attribute__((__packed__));
+
+#endif /* __DPVS_HWDROP_CONF_H__ */
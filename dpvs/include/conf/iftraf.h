@@ -30,15 +30,38 @@ enum {
     SOCKOPT_GET_IFTRAF_SHOW,
 };
 
+/* what the heavy hitters are keyed by */
+enum {
+    IFTRAF_VIEW_FLOW = 0,       /* proto, addresses and ports, client first */
+    IFTRAF_VIEW_SRC,            /* client address and device */
+    IFTRAF_VIEW_VIP,            /* proto, server address, port and device */
+    IFTRAF_VIEW_MAX,
+};
+
+enum {
+    IFTRAF_SORT_BYTES = 0,
+    IFTRAF_SORT_PKTS,
+    IFTRAF_SORT_MAX,
+};
+
+#define IFTRAF_TOPN_DEF     20
+#define IFTRAF_TOPN_MAX     256
+
+/* counts cover a sliding window of this length */
+#define IFTRAF_WINDOW_SEC   10
+
 struct dp_vs_iftraf_conf {
-    char ifname[IFNAMSIZ];
+    char ifname[IFNAMSIZ];      /* empty or "all" for every device */
+    uint8_t view;
+    uint8_t sort;
+    uint16_t topn;              /* 0 for IFTRAF_TOPN_DEF */
 } __attribute__((__packed__));
 
 
 struct iftraf_param {
     uint8_t af;
     uint8_t proto;
-    uint8_t cid;
+    uint8_t cid;                /* one of the lcores that saw it */
     uint16_t devid;
     char ifname[IFNAMSIZ];
     union inet_addr saddr;
@@ -46,8 +69,11 @@ struct iftraf_param {
     uint16_t sport;
     uint16_t dport;
 
-    uint32_t total_recv;
-    uint32_t total_sent;
+    /* sketch estimates over the window */
+    uint64_t total_recv;        /* bytes */
+    uint64_t total_sent;
+    uint64_t pkts_recv;
+    uint64_t pkts_sent;
 
 } __attribute__((__packed__));
 
@@ -57,4 +83,3 @@ struct iftraf_param_array {
 };
 
 #endif /* __DPVS_INETADDR_CONF_H__ */
-
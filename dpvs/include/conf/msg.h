@@ -0,0 +1,54 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * inter-lcore msg latency stats, shared by dpvs and dpip.
+ */
+#ifndef __DPVS_MSG_CONF_H__
+#define __DPVS_MSG_CONF_H__
+#include <stdint.h>
+
+/* bucket 0 counts latencies below 1us, bucket i those in [2^(i-1), 2^i) us,
+ * the last bucket everything above */
+#define DPVS_MSG_LAT_BUCKETS        24
+
+enum {
+    /* get */
+    SOCKOPT_GET_MSG_STATS = 6700,
+};
+
+/*
+ * per msg type, summed over lcores. a unicast msg is measured from
+ * enqueue to the end of its callback on the target lcore; a multicast
+ * msg on slaves likewise, and on master from send until every slave
+ * replied and the multicast callback finished.
+ */
+struct dp_vs_msg_lat {
+    uint32_t    type;
+    uint32_t    timeouts;   /* synchronous senders gave up waiting */
+    uint64_t    count;
+    uint64_t    sum_us;
+    uint64_t    max_us;
+    uint64_t    hist[DPVS_MSG_LAT_BUCKETS];
+} __attribute__((__packed__));
+
+struct dp_vs_msg_stats {
+    uint32_t    ntypes;
+    struct dp_vs_msg_lat lats[0];
+} __attribute__((__packed__));
+
+#endif /* __DPVS_MSG_CONF_H__ */
@@ -117,6 +117,7 @@ enum{
     DPVS_SO_SET_EDITDEST,
     DPVS_SO_SET_DELDEST,
     DPVS_SO_SET_GRATARP,
+    DPVS_SO_SET_BATCH,
 };
 
 enum{
@@ -129,7 +130,7 @@ enum{
 
 
 #define SOCKOPT_SVC_BASE         DPVS_SO_SET_FLUSH
-#define SOCKOPT_SVC_SET_CMD_MAX  DPVS_SO_SET_GRATARP
+#define SOCKOPT_SVC_SET_CMD_MAX  DPVS_SO_SET_BATCH
 #define SOCKOPT_SVC_GET_CMD_MAX  DPVS_SO_GET_DESTS
 #define SOCKOPT_SVC_MAX          299
 
@@ -0,0 +1,49 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * startup timeline, shared by dpvs and dpip.
+ */
+#ifndef __DPVS_STARTUP_CONF_H__
+#define __DPVS_STARTUP_CONF_H__
+#include <stdint.h>
+
+#define DPVS_STARTUP_NAME_LEN       32
+#define DPVS_STARTUP_MAX_STAGES     64
+
+enum {
+    /* get */
+    SOCKOPT_GET_STARTUP_SHOW = 6500,
+};
+
+struct dp_vs_startup_stage {
+    char        name[DPVS_STARTUP_NAME_LEN];
+    uint8_t     depth;      /* nested stages have depth > 0 */
+    int32_t     err;        /* return value of the stage */
+    uint64_t    start_us;   /* offset from the first stage */
+    uint64_t    cost_us;
+    int64_t     mem_bytes;  /* rte_malloc heap growth (memzones included) */
+} __attribute__((__packed__));
+
+struct dp_vs_startup_timeline {
+    uint64_t    total_us;
+    uint64_t    total_mem_bytes;
+    uint32_t    nstages;
+    struct dp_vs_startup_stage stages[0];
+} __attribute__((__packed__));
+
+#endif /* __DPVS_STARTUP_CONF_H__ */
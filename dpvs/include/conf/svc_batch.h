@@ -0,0 +1,49 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#ifndef __DPVS_SVC_BATCH_CONF_H__
+#define __DPVS_SVC_BATCH_CONF_H__
+
+#include <stdint.h>
+#include "conf/service.h"
+#include "conf/dest.h"
+
+/*
+ * DPVS_SO_SET_BATCH carries DPVS_SO_SET_FLUSH..DPVS_SO_SET_DELDEST ops,
+ * each with the argument its own sockopt would take. Ops are applied in
+ * order and stop at the first failure; every lcore applies the same ops
+ * within one msg callback.
+ */
+#define DP_VS_SVC_BATCH_MAX         1024
+
+/* ADD/ADDDEST of existing and DEL/DELDEST of missing entries succeed,
+ * EDITDEST of a missing dest adds it, as keepalived expects */
+#define DP_VS_SVC_BATCH_F_IDEMPOTENT    0x1
+
+struct dp_vs_svc_batch_op {
+    uint32_t            opt;
+    uint32_t            len;        /* of arg in use */
+    unsigned char       arg[MAX_ARG_LEN];
+};
+
+struct dp_vs_svc_batch {
+    uint32_t            flags;
+    uint32_t            nops;
+    struct dp_vs_svc_batch_op ops[0];
+};
+
+#endif /* __DPVS_SVC_BATCH_CONF_H__ */
@@ -0,0 +1,46 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#ifndef __DPVS_SYNC_CONF_H__
+#define __DPVS_SYNC_CONF_H__
+#include <net/if.h>
+
+enum {
+    /* set */
+    SOCKOPT_SET_SYNC_START = 6600,
+    SOCKOPT_SET_SYNC_STOP,
+
+    /* get */
+    SOCKOPT_GET_SYNC_DAEMON = 6600,
+};
+
+/* same values as the kernel IP_VS_STATE_XXX */
+#define DP_VS_SYNC_S_NONE       0x0000
+#define DP_VS_SYNC_S_MASTER     0x0001
+#define DP_VS_SYNC_S_BACKUP     0x0002
+
+/*
+ * argument of SOCKOPT_SET_SYNC_START/STOP, and the element of
+ * SOCKOPT_GET_SYNC_DAEMON's reply, which is [0] master and [1] backup.
+ */
+struct dp_vs_sync_daemon_conf {
+    int         state;
+    char        mcast_ifn[IFNAMSIZ];
+    int         syncid;
+} __attribute__((__packed__));
+
+#endif /* __DPVS_SYNC_CONF_H__ */
@@ -56,6 +56,9 @@ typedef enum msg_priority {
 /* msg timeout */
 #define DPVS_MSG_F_TIMEOUT          128
 
+/* either of these ends a msg for its sender */
+#define DPVS_MSG_F_DONE             (DPVS_MSG_F_STATE_FIN | DPVS_MSG_F_STATE_DROP)
+
 struct dpvs_msg_reply {
     uint32_t len;
     void *data;
@@ -71,6 +74,9 @@ struct dpvs_msg {
     uint32_t flags;         /* msg flags */
     rte_atomic16_t refcnt;  /* reference count */
     rte_spinlock_t lock;    /* msg lock */
+    volatile uint16_t done; /* completion counter, bumped once F_DONE is set,
+                               synchronous senders poll it without the lock */
+    uint64_t stamp;         /* cycles when sent, for latency stats */
     struct dpvs_msg_reply reply;
     /* response data, created with rte_malloc... and filled by callback */
     uint32_t len;           /* msg data length */
@@ -98,6 +104,8 @@ static inline bool test_msg_flags(struct dpvs_msg *msg, uint32_t flags)
 static inline void set_msg_flags(struct dpvs_msg *msg, uint32_t flags)
 {
     rte_spinlock_lock(&msg->lock);
+    if ((flags & DPVS_MSG_F_DONE) && !(msg->flags & DPVS_MSG_F_DONE))
+        msg->done++;
     msg->flags = flags;
     rte_spinlock_unlock(&msg->lock);
 }
@@ -105,6 +113,8 @@ static inline void set_msg_flags(struct dpvs_msg *msg, uint32_t flags)
 static inline void add_msg_flags(struct dpvs_msg *msg, uint32_t flags)
 {
     rte_spinlock_lock(&msg->lock);
+    if ((flags & DPVS_MSG_F_DONE) && !(msg->flags & DPVS_MSG_F_DONE))
+        msg->done++;
     msg->flags |= flags;
     rte_spinlock_unlock(&msg->lock);
 }
@@ -192,13 +202,21 @@ int msg_dump(const struct dpvs_msg *msg, char *buf, int len);
 #define MSG_TYPE_ROUTE_ADD                  6
 #define MSG_TYPE_ROUTE_DEL                  7
 #define MSG_TYPE_NETIF_LCORE_STATS          8
-#define MSG_TYPE_BLKLST_ADD                 9
-#define MSG_TYPE_BLKLST_DEL                 10
+#define MSG_TYPE_BLKLST_SWAP                9
+#define MSG_TYPE_CONNLIMIT_SET              10
 #define MSG_TYPE_STATS_GET                  11
+#define MSG_TYPE_CONNLIMIT_GET              12
 #define MSG_TYPE_TC_STATS                   13
 #define MSG_TYPE_CONN_GET                   14
 #define MSG_TYPE_CONN_GET_ALL               15
 #define MSG_TYPE_IPV6_STATS                 16
+#define MSG_TYPE_CONN_HANDOFF               17
+#define MSG_TYPE_SVC_SET_BATCH              42
+#define MSG_TYPE_SVC_GET_RTT                43
+#define MSG_TYPE_SYNPROXY_AUTO_REPORT       44
+#define MSG_TYPE_SYNPROXY_AUTO_SET          45
+#define MSG_TYPE_SVC_GET_ATTACK             46
+#define MSG_TYPE_HWDROP_REPORT              47
 #define MSG_TYPE_ROUTE6                     50
 #define MSG_TYPE_ROUTE6_SLAAC               18
 #define MSG_TYPE_SLAAC                      26
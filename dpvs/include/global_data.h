@@ -19,6 +19,9 @@
 #ifndef __GLOBAL_DATA_H__
 #define __GLOBAL_DATA_H__
 
+#include <rte_per_lcore.h>
+#include <rte_cycles.h>
+#include <rte_lcore.h>
 #include "conf/common.h"
 
 typedef enum dpvs_lcore_role_type {
@@ -51,6 +54,33 @@ extern dpvs_lcore_role_t g_lcore_role[DPVS_MAX_LCORE];
  * */
 extern int g_lcore_index[DPVS_MAX_LCORE];
 
+/*
+ * per-lcore xorshift64* generator for the packet path, where libc
+ * rand()/random() would take a lock. not for anything secret.
+ */
+RTE_DECLARE_PER_LCORE(uint64_t, g_rand_state);
+
+static inline uint32_t dpvs_rand(void)
+{
+    uint64_t x = RTE_PER_LCORE(g_rand_state);
+
+    if (unlikely(!x))
+        x = rte_rdtsc() ^ ((uint64_t)(rte_lcore_id() + 1) * 0x9e3779b97f4a7c15ULL);
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    RTE_PER_LCORE(g_rand_state) = x;
+
+    return (uint32_t)((x * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+/* uniform in [0, n) without a division */
+static inline uint32_t dpvs_rand_range(uint32_t n)
+{
+    return (uint32_t)(((uint64_t)dpvs_rand() * n) >> 32);
+}
+
 int global_data_init(void);
 int global_data_term(void);
 
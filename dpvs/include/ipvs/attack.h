@@ -0,0 +1,51 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#ifndef __DPVS_ATTACK_H__
+#define __DPVS_ATTACK_H__
+#include "dpdk.h"
+#include "conf/common.h"
+#include "conf/attack.h"
+
+/* anomaly counters of a service on one lcore, svc->attack */
+struct dp_vs_attack {
+    uint64_t            tick;       /* TSC the current second ends at */
+    uint32_t            slot;       /* of the current second in st.hist */
+    struct dp_vs_attack_stats st;
+};
+
+struct dp_vs_iphdr;
+
+void __dp_vs_attack_tick(struct dp_vs_attack *atk);
+
+/* count a packet of anomaly @type, a TSC read and two increments */
+static inline void dp_vs_attack_inc(struct dp_vs_attack *atk, int type)
+{
+    if (unlikely(rte_get_timer_cycles() >= atk->tick))
+        __dp_vs_attack_tick(atk);
+
+    atk->st.total[type]++;
+    atk->st.hist[atk->slot][type]++;
+}
+
+/* count a packet of a blacklisted client to the service it is sent to */
+void dp_vs_attack_blklst(const struct dp_vs_iphdr *iph, uint16_t vport);
+
+int dp_vs_attack_init(void);
+int dp_vs_attack_term(void);
+
+#endif /* __DPVS_ATTACK_H__ */
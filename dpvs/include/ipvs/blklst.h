@@ -18,22 +18,79 @@
 #ifndef __DPVS_BLKLST_H__
 #define __DPVS_BLKLST_H__
 #include "conf/common.h"
+#include "conf/blklst.h"
 #include "ipvs/service.h"
 #include "timer.h"
 
-struct blklst_entry {
-    struct list_head    list;
+/*
+ * classification key of a packet. for IPv4 only the first 4 bytes of
+ * the addresses are used. fields are in network byte order.
+ */
+struct dp_vs_blklst_key {
+    uint8_t             proto;
+    uint8_t             pad[3];
     union inet_addr     vaddr;
+    union inet_addr     saddr;
     uint16_t            vport;
-    uint8_t             proto;
-    union inet_addr     blklst;
+    uint8_t             tcp_flags;  /* 0 but for TCP */
+    uint8_t             zero;
 };
 
-struct blklst_entry *dp_vs_blklst_lookup(uint8_t proto, const union inet_addr *vaddr,
-                                         uint16_t vport, const union inet_addr *blklst);
+/*
+ * verdict of the rx stage on a packet it classified, kept in mbuf->ol_flags
+ * bits DPDK leaves free. packets it did not classify carry neither.
+ */
+#define PKT_RX_BLKLST_PASS      (1ULL << 38)
+#define PKT_RX_BLKLST_DENY      (1ULL << 39)
+
+/* true if the packet from @saddr to vaddr:vport is to be dropped */
+bool dp_vs_blklst_lookup(int af, uint8_t proto, const union inet_addr *vaddr,
+                         uint16_t vport, const union inet_addr *saddr,
+                         uint8_t tcp_flags);
+
+/*
+ * true if @mbuf, the first packet of a new flow, is to be dropped: the
+ * verdict of the rx stage when it classified @mbuf, else a lookup.
+ */
+static inline bool dp_vs_blklst_deny(const struct rte_mbuf *mbuf, int af,
+                                     uint8_t proto, const union inet_addr *vaddr,
+                                     uint16_t vport, const union inet_addr *saddr,
+                                     uint8_t tcp_flags)
+{
+    if (mbuf->ol_flags & PKT_RX_BLKLST_DENY)
+        return true;
+    if (mbuf->ol_flags & PKT_RX_BLKLST_PASS)
+        return false;
+    return dp_vs_blklst_lookup(af, proto, vaddr, vport, saddr, tcp_flags);
+}
+
+/*
+ * classify @n keys of family @af at once, @drop[i] is set to whether
+ * keys[i] is to be dropped. cheaper per packet than one by one.
+ */
+void dp_vs_blklst_lookup_burst(int af, const struct dp_vs_blklst_key **keys,
+                               bool *drop, unsigned int n);
+
+/*
+ * classify a received burst (at ether header) before L3, marking each
+ * packet classified with its verdict: the bare SYNs, or every TCP and UDP
+ * packet with early_drop, which also drops the denied ones. returns the
+ * number left, packed at the front.
+ */
+uint16_t dp_vs_blklst_rx_burst(struct rte_mbuf **mbufs, uint16_t count);
+
 void dp_vs_blklst_flush(struct dp_vs_service *svc);
 
+/* compile @n rules of family @af into a new ACL context */
+struct rte_acl_ctx *dp_vs_blklst_acl_build(int af, const char *name,
+                                           const struct dp_vs_blklst_conf *rules,
+                                           unsigned int n);
+
 int dp_vs_blklst_init(void);
 int dp_vs_blklst_term(void);
 
+/* configuration file support */
+void blklst_keyword_value_init(void);
+void install_blklst_keywords(void);
+
 #endif /* __DPVS_BLKLST_H__ */
@@ -69,19 +69,58 @@ struct conn_tuple_hash {
     uint16_t            dport;
 } __rte_cache_aligned;
 
+/* written by the owner lcore only */
 struct dp_vs_conn_stats {
-    rte_atomic64_t      inpkts;
-    rte_atomic64_t      inbytes;
-    rte_atomic64_t      outpkts;
-    rte_atomic64_t      outbytes;
-} __rte_cache_aligned;
+    uint64_t            inpkts;
+    uint64_t            inbytes;
+    uint64_t            outpkts;
+    uint64_t            outbytes;
+};
 
 struct dp_vs_fdir_filt;
 struct dp_vs_proto;
 
+/*
+ * cold part of dp_vs_conn{}, allocated on demand only for synproxy,
+ * template/controlled and TCP timestamp (RTT) tracking connections.
+ */
+struct dp_vs_conn_ext {
+    struct rte_mempool      *extpool;
+
+    /* synproxy related members */
+    struct list_head ack_mbuf;          /* ack mbuf saved in step2 */
+    uint32_t ack_num;                   /* ack mbuf number stored */
+    struct rte_mbuf *syn_mbuf;          /* saved rs syn packet for retransmition */
+    rte_atomic32_t syn_retry_max;       /* syn retransmition max packets */
+
+    /* add for stopping ack storm */
+    uint32_t last_seq;                  /* seq of the last ack packet */
+    uint32_t last_ack_seq;              /* ack seq of the last ack packet */
+    rte_atomic32_t dup_ack_cnt;         /* count of repeated ack packets */
+
+    /* controll members */
+    struct dp_vs_conn *control;         /* master who controlls me */
+    rte_atomic32_t n_control;           /* number of connections controlled by me*/
+
+    /* TCP timestamp based RTT tracking (FNAT) */
+    uint32_t                tsval;
+    uint32_t                tsecr;
+    uint32_t                tsval_dpvs;
+    uint32_t                tscent;
+    uint32_t                clienttsval;
+    uint32_t                timestamp;
+    uint32_t                timestamp_all;
+    int                     ack_count;
+    uint32_t                timestamp_avg;
+} __rte_cache_aligned;
+
 struct dp_vs_conn {
+    /* hot members, touched per packet */
+    struct conn_tuple_hash  tuplehash[DPVS_CONN_DIR_MAX];
+
     int                     af;
-    uint8_t                 proto;  
+    uint8_t                 proto;
+    volatile uint16_t       flags;
     union inet_addr         caddr;  /* Client address */
     union inet_addr         vaddr;  /* Virtual address */
     union inet_addr         laddr;  /* director Local address */
@@ -91,43 +130,32 @@ struct dp_vs_conn {
     uint16_t                lport;
     uint16_t                dport;
 
-    struct rte_mempool      *connpool;
-    struct conn_tuple_hash  tuplehash[DPVS_CONN_DIR_MAX];
-    rte_atomic32_t          refcnt;
-    struct dpvs_timer       timer;
-    struct timeval          timeout;
+    /* state transition */
+    volatile uint16_t       state;
+    volatile uint16_t       old_state;  /* old state, to be used for state transition
+                                           triggered synchronization */
     lcoreid_t               lcore;
+    uint8_t                 act;        /* timestamp weight when active */
+    uint8_t                 inact;      /* timestamp weight when inactive */
+    rte_atomic32_t          refcnt;
     struct dp_vs_dest       *dest;  /* real server */
     void                    *prot_data;  /* protocol specific data */
 
+    int (*packet_xmit)(struct dp_vs_proto *prot,
+                        struct dp_vs_conn *conn,
+                        struct rte_mbuf *mbuf);
+    int (*packet_out_xmit)(struct dp_vs_proto *prot,
+                        struct dp_vs_conn *conn,
+                        struct rte_mbuf *mbuf);
+
     /* for FNAT */
     struct dp_vs_laddr      *local; /* local address */
     struct dp_vs_seq        fnat_seq;
+    struct dp_vs_seq        syn_proxy_seq;  /* seq used in synproxy */
 
     /* save last SEQ/ACK from RS for RST when conn expire*/
     uint32_t                rs_end_seq;
     uint32_t                rs_end_ack;
-    uint32_t                tsval;
-    uint32_t                tsecr;
-    uint32_t                tsval_dpvs;
-    uint32_t                tscent;
-    uint32_t                clienttsval;
-    uint32_t                timestamp;
-    uint32_t                timestamp_all;
-    int                     ack_count;
-    int                     timestamp_weight;
-    int                     act; 
-    int                     inact;
-
-    uint32_t                timestamp_avg;
-
-
-    int (*packet_xmit)(struct dp_vs_proto *prot,
-                        struct dp_vs_conn *conn,
-                        struct rte_mbuf *mbuf);
-    int (*packet_out_xmit)(struct dp_vs_proto *prot,
-                        struct dp_vs_conn *conn,
-                        struct rte_mbuf *mbuf);
 
     /* L2 fast xmit */
     struct ether_addr       in_smac;
@@ -141,37 +169,27 @@ struct dp_vs_conn {
     union inet_addr         in_nexthop;  /* to rs*/
     union inet_addr         out_nexthop; /* to client*/
 
-    /* statistics */
-    struct dp_vs_conn_stats stats;
-
-    /* synproxy related members */
-    struct dp_vs_seq syn_proxy_seq;     /* seq used in synproxy */
-    struct list_head ack_mbuf;          /* ack mbuf saved in step2 */
-    uint32_t ack_num;                   /* ack mbuf number stored */
-    struct rte_mbuf *syn_mbuf;          /* saved rs syn packet for retransmition */
-    rte_atomic32_t syn_retry_max;       /* syn retransmition max packets */
-
-    /* add for stopping ack storm */
-    uint32_t last_seq;                  /* seq of the last ack packet */
-    uint32_t last_ack_seq;              /* ack seq of the last ack packet */
-    rte_atomic32_t dup_ack_cnt;         /* count of repeated ack packets */
-
-    /* flags and state transition */
-    volatile uint16_t       flags;
-    volatile uint16_t       state;
-    volatile uint16_t       old_state;  /* old state, to be used for state transition
-                                           triggered synchronization */
-    /* controll members */
-    struct dp_vs_conn *control;         /* master who controlls me */
-    rte_atomic32_t n_control;           /* number of connections controlled by me*/
+    /* less frequently used members */
+    struct rte_mempool      *connpool;
+    struct dpvs_timer       timer;
+    struct timeval          timeout;
     uint64_t ctime;                     /* create time */
 
     /* connection redirect in fnat/snat/nat modes */
     struct dp_vs_redirect  *redirect;
 
+    /* cold extension, NULL unless needed */
+    struct dp_vs_conn_ext   *ext;
+
     /* flag for gfwip */
     bool outwall;
 
+    /* slot counting it to its client (ipvs/connlimit.h), tag 0 if none */
+    uint32_t                climit_slot;
+    uint32_t                climit_tag;
+
+    /* statistics */
+    struct dp_vs_conn_stats stats;
 } __rte_cache_aligned;
 
 /* for syn-proxy to save all ack packet in conn before rs's syn-ack arrives */
@@ -212,6 +230,17 @@ void dp_vs_conn_put(struct dp_vs_conn *conn);
 /* put conn without reset the timer */
 void dp_vs_conn_put_no_reset(struct dp_vs_conn *conn);
 
+/* hot restart and conn sync, see ipvs/handoff.h and ipvs/sync.h */
+struct dp_vs_handoff_conn;
+void dp_vs_conn_handoff_fill(const struct dp_vs_conn *conn,
+                             struct dp_vs_handoff_conn *hc);
+int dp_vs_conn_handoff_export(struct dp_vs_handoff_conn *hcs, uint32_t max,
+                              uint32_t *skipped);
+int dp_vs_conn_handoff_import(const struct dp_vs_handoff_conn *hc,
+                              uint32_t timeout);
+void dp_vs_conn_walk(uint32_t *cursor, uint32_t nbuckets,
+                     void (*fn)(struct dp_vs_conn *conn, void *arg), void *arg);
+
 void ipvs_conn_keyword_value_init(void);
 void install_ipvs_conn_keywords(void);
 
@@ -232,9 +261,22 @@ static inline void dp_vs_conn_fill_param(int af, uint8_t proto,
 
 int dp_vs_check_template(struct dp_vs_conn *ct);
 
+/* attach the cold extension to conn if not yet */
+int dp_vs_conn_ext_alloc(struct dp_vs_conn *conn);
+
+static inline struct dp_vs_conn *dp_vs_conn_control(const struct dp_vs_conn *conn)
+{
+    return conn->ext ? conn->ext->control : NULL;
+}
+
+static inline uint32_t dp_vs_conn_rtt_avg(const struct dp_vs_conn *conn)
+{
+    return conn->ext ? conn->ext->timestamp_avg : 0;
+}
+
 static inline void dp_vs_control_del(struct dp_vs_conn *conn)
 {
-    struct dp_vs_conn *ctl_conn = conn->control;
+    struct dp_vs_conn *ctl_conn = dp_vs_conn_control(conn);
     char cbuf[64], vbuf[64];
 
     if (!ctl_conn) {
@@ -257,8 +299,8 @@ static inline void dp_vs_control_del(struct dp_vs_conn *conn)
             inet_ntop(conn->af, &ctl_conn->vaddr, cbuf, sizeof(cbuf)),
             ntohs(conn->vport));
 #endif
-    conn->control = NULL;
-    if (rte_atomic32_read(&ctl_conn->n_control) == 0) {
+    conn->ext->control = NULL;
+    if (rte_atomic32_read(&ctl_conn->ext->n_control) == 0) {
         RTE_LOG(ERR, IPVS, "%s: BUG control DEL with zero n_control: "
                 "%s:%u to %s:%u\n", __func__,
                 inet_ntop(conn->af, &conn->caddr, cbuf, sizeof(cbuf)),
@@ -267,14 +309,21 @@ static inline void dp_vs_control_del(struct dp_vs_conn *conn)
                 ntohs(conn->vport));
         return;
     }
-    rte_atomic32_dec(&ctl_conn->n_control);
+    rte_atomic32_dec(&ctl_conn->ext->n_control);
 }
 
-static inline void dp_vs_control_add(struct dp_vs_conn *conn, struct dp_vs_conn *ctl_conn)
+static inline int dp_vs_control_add(struct dp_vs_conn *conn, struct dp_vs_conn *ctl_conn)
 {
     char cbuf[64], vbuf[64];
+    int err;
+
+    /* template always owns an extension, the controlled conn may not */
+    if (unlikely(!ctl_conn->ext))
+        return EDPVS_INVAL;
+    if ((err = dp_vs_conn_ext_alloc(conn)) != EDPVS_OK)
+        return err;
 
-    if (unlikely(conn->control != NULL)) {
+    if (unlikely(conn->ext->control != NULL)) {
         RTE_LOG(ERR, IPVS, "%s: request control ADD for already controlled conn: "
                 "%s:%u to %s:%u\n", __func__,
                 inet_ntop(conn->af, &conn->caddr, cbuf, sizeof(cbuf)) ? cbuf : "::",
@@ -291,8 +340,10 @@ static inline void dp_vs_control_add(struct dp_vs_conn *conn, struct dp_vs_conn
             inet_ntop(conn->af, &ctl_conn->caddr, vbuf, sizeof(cbuf)) ? cbuf : "::",
             ntohs(ctl_conn->cport));
 #endif
-    conn->control = ctl_conn;
-    rte_atomic32_inc(&ctl_conn->n_control);
+    conn->ext->control = ctl_conn;
+    rte_atomic32_inc(&ctl_conn->ext->n_control);
+
+    return EDPVS_OK;
 }
 
 static inline bool
@@ -348,7 +399,9 @@ inline uint32_t dp_vs_conn_hashkey(int af,
     const union inet_addr *daddr, uint16_t dport,
     uint32_t mask);
 int dp_vs_conn_pool_size(void);
+int dp_vs_conn_tbl_size(void);
 int dp_vs_conn_pool_cache_size(void);
+lcoreid_t dp_vs_conn_pool_lcore(int socket);
 
 extern bool dp_vs_redirect_disable;
 
@@ -0,0 +1,102 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#ifndef __DPVS_CONNLIMIT_H__
+#define __DPVS_CONNLIMIT_H__
+#include <stdbool.h>
+#include "dpdk.h"
+#include "conf/common.h"
+#include "conf/connlimit.h"
+#include "inet.h"
+
+struct dp_vs_conn;
+
+/* limits of a service on one lcore, svc->climit */
+struct dp_vs_connlimit {
+    uint32_t            rate;       /* token units per ms, 0 for no limit */
+    uint32_t            burst;      /* token units */
+    uint8_t             plen;
+    uint8_t             policy;     /* DPVS_CONNLIMIT_XXX */
+    uint32_t            conns;      /* 0 for no limit */
+    uint32_t            svc_hash;   /* the service, alike on all lcores */
+
+    /* as configured, for get */
+    uint32_t            conf_rate;
+    uint32_t            conf_burst;
+
+    /* this lcore only */
+    uint64_t            passed;
+    uint64_t            rate_drops;
+    uint64_t            conn_drops;
+};
+
+bool __dp_vs_connlimit_rate_check(struct dp_vs_connlimit *cl, int af,
+                                  const union inet_addr *saddr);
+
+/* false if the client @saddr used up its new connections of the service */
+static inline bool dp_vs_connlimit_rate_check(struct dp_vs_connlimit *cl,
+                                              int af,
+                                              const union inet_addr *saddr)
+{
+    if (likely(!cl->rate))
+        return true;
+    return __dp_vs_connlimit_rate_check(cl, af, saddr);
+}
+
+/* whether the client @saddr holds @cl->conns, counting no drop */
+bool __dp_vs_connlimit_conn_over(struct dp_vs_connlimit *cl, int af,
+                                 const union inet_addr *saddr);
+
+bool __dp_vs_connlimit_conn_check(struct dp_vs_connlimit *cl, int af,
+                                  const union inet_addr *saddr);
+
+/* false if the client @saddr holds as many connections as allowed */
+static inline bool dp_vs_connlimit_conn_check(struct dp_vs_connlimit *cl,
+                                              int af,
+                                              const union inet_addr *saddr)
+{
+    if (likely(!cl->conns))
+        return true;
+    return __dp_vs_connlimit_conn_check(cl, af, saddr);
+}
+
+/*
+ * true if a SYN of client @saddr is over the limit and goes to syn-proxy.
+ * it is answered with a cookie, not dropped: the drop is counted when
+ * the handshake completes and the client is refused.
+ */
+static inline bool dp_vs_connlimit_synproxy(struct dp_vs_connlimit *cl,
+                                            int af,
+                                            const union inet_addr *saddr)
+{
+    if (likely(!cl->conns || cl->policy != DPVS_CONNLIMIT_SYNPROXY))
+        return false;
+    return __dp_vs_connlimit_conn_over(cl, af, saddr);
+}
+
+/* count @conn to its client, and uncount it when it goes */
+void dp_vs_connlimit_conn_hold(struct dp_vs_connlimit *cl,
+                               struct dp_vs_conn *conn);
+void dp_vs_connlimit_conn_put(struct dp_vs_conn *conn);
+
+void connlimit_keyword_value_init(void);
+void install_connlimit_keywords(void);
+
+int dp_vs_connlimit_init(void);
+int dp_vs_connlimit_term(void);
+
+#endif /* __DPVS_CONNLIMIT_H__ */
@@ -43,6 +43,7 @@ struct dp_vs_dest {
 
     rte_atomic32_t      refcnt;     /* reference counter */
     struct dp_vs_stats  stats;      /* Use per-cpu statistics for destination server */
+    struct dp_vs_estimator est;     /* rate estimator of stats */
 
     enum dpvs_fwd_mode  fwdmode;
 
@@ -63,6 +64,9 @@ struct dp_vs_dest {
     union inet_addr     vaddr;      /* virtual IP address */
     unsigned            conn_timeout; /* conn timeout copied from svc*/
     unsigned            limit_proportion; /* limit copied from svc*/
+
+    /* kept last, clear of the fields schedulers read per new conn */
+    struct dp_vs_rtt_hist rtt;      /* backend RTT, this lcore only */
 } __rte_cache_aligned;
 
 static inline bool
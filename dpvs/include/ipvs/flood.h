@@ -0,0 +1,49 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#ifndef __DPVS_FLOOD_H__
+#define __DPVS_FLOOD_H__
+#include "dpdk.h"
+#include "conf/common.h"
+#include "conf/inet.h"
+#include "conf/flood.h"
+
+/* pkts/s of a VIP on a lcore, per DP_VS_FLOOD_XXX, 0 for no limit */
+extern uint32_t dp_vs_flood_rate[DP_VS_FLOOD_MAX];
+
+bool __dp_vs_flood_check(int type, int af, const union inet_addr *vaddr);
+
+/*
+ * take a packet of @type to @vaddr from the budget of the VIP,
+ * false if it is spent and the packet is to be dropped.
+ */
+static inline bool dp_vs_flood_check(int type, int af,
+                                     const union inet_addr *vaddr)
+{
+    if (likely(!dp_vs_flood_rate[type]))
+        return true;
+    return __dp_vs_flood_check(type, af, vaddr);
+}
+
+int dp_vs_flood_init(void);
+int dp_vs_flood_term(void);
+
+/* configuration file support */
+void flood_keyword_value_init(void);
+void install_flood_keywords(void);
+
+#endif /* __DPVS_FLOOD_H__ */
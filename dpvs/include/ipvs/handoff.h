@@ -0,0 +1,106 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * connection hand-off for hot restart.
+ *
+ * on SIGUSR2 the running dpvs asks every worker to serialize its conn
+ * table into a shared file (tmpfs by default), then quits. a new dpvs
+ * started afterwards maps the file and its workers rebuild the
+ * connections as soon as the matching services/dests are configured.
+ *
+ * the file is mapped before the NIC ports start, but the connections can
+ * only be rebuilt once keepalived (or ipvsadm) has configured their
+ * services, which needs a running dpvs. packets of a flow arriving
+ * before its service exists are handled as without hand-off.
+ *
+ * file layout (all fields in host order, the file never leaves the box):
+ *
+ *   +--------------------+---------------+---------------+-----
+ *   | dp_vs_handoff_hdr  | section lcore | section lcore | ...
+ *   | (sects[] index)    | conn records  | conn records  |
+ *   +--------------------+---------------+---------------+-----
+ */
+#ifndef __DPVS_HANDOFF_H__
+#define __DPVS_HANDOFF_H__
+#include "conf/common.h"
+#include "inet.h"
+#include "ipvs/ipvs.h"
+
+#define DPVS_HANDOFF_MAGIC          0x46484456  /* "VDHF" */
+#define DPVS_HANDOFF_VERSION        2
+
+/* one connection, laid out without holes so no packing is needed */
+struct dp_vs_handoff_conn {
+    uint8_t             af;         /* client side af */
+    uint8_t             daf;        /* RS side af */
+    uint8_t             proto;
+    uint8_t             state;
+    uint16_t            flags;      /* DPVS_CONN_F_XXX */
+    uint8_t             act;
+    uint8_t             inact;
+
+    union inet_addr     caddr;
+    union inet_addr     vaddr;
+    union inet_addr     laddr;
+    union inet_addr     daddr;
+    uint16_t            cport;
+    uint16_t            vport;
+    uint16_t            lport;
+    uint16_t            dport;
+
+    uint32_t            timeout;    /* seconds, at the time of export */
+    struct dp_vs_seq    fnat_seq;
+    struct dp_vs_seq    syn_proxy_seq;
+    uint32_t            rs_end_seq;
+    uint32_t            rs_end_ack;
+
+    /* timestamp rewrite state, valid if has_ext (see tcp_in_change_ts) */
+    uint32_t            has_ext;
+    uint32_t            tsval;
+    uint32_t            tsecr;
+    uint32_t            tscent;
+    uint32_t            clienttsval;
+    uint32_t            reserved;
+};
+
+struct dp_vs_handoff_sect {
+    uint64_t            offset;     /* from start of file */
+    uint32_t            capacity;   /* in records */
+    uint32_t            nconns;
+    volatile uint32_t   done;       /* set by the exporting lcore */
+    uint32_t            skipped;    /* not exportable, e.g., synproxy in handshake */
+} __attribute__((__packed__));
+
+struct dp_vs_handoff_hdr {
+    uint32_t            magic;
+    uint16_t            version;
+    uint16_t            conn_size;  /* sizeof(struct dp_vs_handoff_conn) */
+    uint64_t            size;       /* total file size */
+    uint64_t            timestamp;  /* export time, seconds since epoch */
+    uint32_t            nsects;     /* always DPVS_MAX_LCORE */
+    uint32_t            reserved;
+    struct dp_vs_handoff_sect sects[DPVS_MAX_LCORE];
+} __attribute__((__packed__));
+
+int dp_vs_handoff_init(void);
+int dp_vs_handoff_term(void);
+
+void handoff_keyword_value_init(void);
+void install_handoff_keywords(void);
+
+#endif /* __DPVS_HANDOFF_H__ */
@@ -0,0 +1,48 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#ifndef __DPVS_HWDROP_H__
+#define __DPVS_HWDROP_H__
+#include "dpdk.h"
+#include "conf/common.h"
+#include "conf/hwdrop.h"
+
+/* packets/s of a source installing NIC drop rules, 0 for off */
+extern uint32_t dp_vs_hwdrop_rate;
+
+void __dp_vs_hwdrop_count(int af, const union inet_addr *saddr,
+                          const union inet_addr *vaddr);
+
+/* count a packet from @saddr to VIP @vaddr dropped for an attack. only
+ * for drops a spoofed @saddr cannot cause: the rules it installs drop
+ * all of @saddr to @vaddr on the NICs */
+static inline void dp_vs_hwdrop_count(int af, const union inet_addr *saddr,
+                                      const union inet_addr *vaddr)
+{
+    if (likely(!dp_vs_hwdrop_rate))
+        return;
+    __dp_vs_hwdrop_count(af, saddr, vaddr);
+}
+
+int dp_vs_hwdrop_init(void);
+int dp_vs_hwdrop_term(void);
+
+/* configuration file support */
+void hwdrop_keyword_value_init(void);
+void install_hwdrop_keywords(void);
+
+#endif /* __DPVS_HWDROP_H__ */
@@ -46,6 +46,8 @@ enum {
 #define TCP_OPT_TIMESTAMP(tm_spec) \
     (((tm_spec).tv_sec % 1000) * 1000000 + \
      ((tm_spec).tv_nsec / 1000))
+/* TCP_OPT_TIMESTAMP() counts us and wraps every 1000s */
+#define TCP_OPT_TIMESTAMP_WRAP      1000000000U
 
 struct tcpopt_ip4_addr {
     uint8_t opcode;
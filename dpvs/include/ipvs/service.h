@@ -28,6 +28,8 @@
 #include "netif.h"
 #include "ipvs/ipvs.h"
 #include "ipvs/sched.h"
+#include "ipvs/connlimit.h"
+#include "ipvs/attack.h"
 #include "conf/match.h"
 #include "conf/service.h"
 
@@ -35,12 +37,30 @@
 #define DP_VS_SVC_F_PERSISTENT      0x0001      /* peristent port */
 #define DP_VS_SVC_F_HASHED          0x0002      /* hashed entry */
 #define DP_VS_SVC_F_SYNPROXY        0x8000      /* synrpoxy flag */
+#define DP_VS_SVC_F_SYNPROXY_AUTO   0x4000      /* synproxy under SYN flood only */
+#define DP_VS_SVC_F_SYNPROXY_ON     0x0800      /* get only, auto synproxy is on */
 
 #define DP_VS_SVC_F_SIP_HASH        0x0100      /* sip hash target */
 #define DP_VS_SVC_F_QID_HASH        0x0200      /* quic cid hash target */
 
 #define DP_VS_SVC_F_MATCH           0x0400      /* snat match */
 
+/* adaptive synproxy of a service, see ip_vs_synproxy.c */
+struct dp_vs_synproxy_auto {
+    /* this lcore, reported to master every second */
+    uint32_t            syns;       /* SYNs received */
+    uint32_t            acks;       /* handshakes completed */
+    uint64_t            stamp;      /* cycles of last report */
+
+    /* master only, all lcores */
+    uint64_t            sum_syns;
+    uint64_t            sum_acks;
+    uint32_t            calm;       /* ms under the thresholds */
+    uint32_t            switches;   /* times switched on */
+
+    uint8_t             active;     /* set by master on all lcores */
+};
+
 /* virtual service */
 struct dp_vs_service {
     struct list_head    s_list;     /* node for normal service table */
@@ -76,7 +96,8 @@ struct dp_vs_service {
     struct dp_vs_scheduler  *scheduler;
     void                *sched_data;
 
-    struct dp_vs_stats  stats;
+    struct dp_vs_stats  stats;      /* rates are the sum of its dests' */
+    struct list_head    est_list;   /* on the rate estimator list of the lcore */
 
     /* FNAT only */
     uint32_t            t;
@@ -85,6 +106,12 @@ struct dp_vs_service {
     uint32_t            num_laddrs;
 
     /* ... flags, timer ... */
+
+    /* kept last, clear of the FNAT fields read per new conn */
+    struct dp_vs_rtt_hist rtt;      /* backend RTT, this lcore only */
+    struct dp_vs_connlimit climit;  /* per-client limits */
+    struct dp_vs_synproxy_auto sp_auto;
+    struct dp_vs_attack attack;     /* anomaly counters, this lcore only */
 } __rte_cache_aligned;
 
 
@@ -109,10 +136,17 @@ void dp_vs_unbind_svc(struct dp_vs_dest *dest);
 
 void dp_vs_svc_put(struct dp_vs_service *svc);
 
+struct dp_vs_service *
+dp_vs_get_service_lcore(const struct dp_vs_service_entry *entry, lcoreid_t cid);
+
 struct dp_vs_service *dp_vs_lookup_vip(int af, uint16_t protocol,
                                        const union inet_addr *vaddr,
                                        lcoreid_t cid);
 
+/* whether @addr is a real server or a local address of a service */
+bool dp_vs_service_addr_used(int af, const union inet_addr *addr,
+                             lcoreid_t cid);
+
 unsigned dp_vs_get_conn_timeout(struct dp_vs_conn *conn);
 
 #endif /* __DPVS_SVC_H__ */
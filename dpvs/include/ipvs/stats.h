@@ -21,9 +21,33 @@
 #include <stdint.h>
 #include "dpdk.h"
 #include "conf/stats.h"
+#include "conf/rtt.h"
 #include "ipvs/service.h"
 
 struct dp_vs_conn;
+struct dp_vs_service;
+struct dp_vs_dest;
+
+/*
+ * EWMA rate estimator of a dest, like the kernel's ip_vs_est. rates are
+ * refreshed every DP_VS_EST_INTERVAL seconds by a slow job of the lcore
+ * owning the dest and published in the rate fields of dp_vs_stats{}.
+ */
+#define DP_VS_EST_INTERVAL          2
+
+struct dp_vs_estimator {
+    uint64_t    last_conns;
+    uint64_t    last_inpkts;
+    uint64_t    last_outpkts;
+    uint64_t    last_inbytes;
+    uint64_t    last_outbytes;
+
+    double      cps;
+    double      inpps;
+    double      outpps;
+    double      inbps;
+    double      outbps;
+};
 
 /* statistics for FULLNAT and SYNPROXY */
 enum  dp_vs_estats_type {
@@ -74,6 +98,13 @@ enum  dp_vs_estats_type {
     CONN_SCHED_UNREACH,
     SYNPROXY_NO_DEST,
     CONN_EXCEEDED,
+    SYNPROXY_TFO_COOKIE,
+    SYNPROXY_TFO_BAD_COOKIE,
+    SYNPROXY_TFO_DATA,
+    SYNPROXY_AUTO_ON,
+    SYNPROXY_AUTO_OFF,
+    CONN_EXT_NOMEM,
+    SYNPROXY_TFO_RETRANS,
     DP_VS_EXT_STAT_LAST
 };
 
@@ -89,6 +120,7 @@ void dp_vs_stats_clear(struct dp_vs_stats *stats);
 int dp_vs_stats_in(struct dp_vs_conn *conn, struct rte_mbuf *mbuf);
 int dp_vs_stats_out(struct dp_vs_conn *conn, struct rte_mbuf *mbuf);
 void dp_vs_stats_conn(struct dp_vs_conn *conn);
+void dp_vs_stats_rtt(struct dp_vs_conn *conn, uint32_t rtt_us);
 
 void dp_vs_estats_inc(enum dp_vs_estats_type field);
 void dp_vs_estats_clear(void);
@@ -97,4 +129,12 @@ int dp_vs_add_stats(struct dp_vs_stats* dst, struct dp_vs_stats* src);
 
 int dp_vs_copy_stats(struct dp_vs_stats* dst, struct dp_vs_stats* src);
 
+void dp_vs_rtt_add(struct dp_vs_rtt_hist *dst, const struct dp_vs_rtt_hist *src);
+
+void dp_vs_estimator_start(struct dp_vs_service *svc);
+void dp_vs_estimator_stop(struct dp_vs_service *svc);
+void dp_vs_estimator_zero(struct dp_vs_estimator *est);
+/* one estimation of @dest, @secs after the last */
+void dp_vs_estimate(struct dp_vs_dest *dest, double secs);
+
 #endif /* __DPVS_STATS_H__ */
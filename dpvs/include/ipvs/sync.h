@@ -0,0 +1,83 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * connection state synchronization between active/standby directors.
+ *
+ * on the master director, workers push create/state/expire records of
+ * their conns into per-lcore rings. the master lcore drains the rings,
+ * packs records into UDP datagrams and sends them to a multicast group
+ * (or a unicast peer) through a kernel socket, normally on a KNI device.
+ *
+ * the backup director receives the datagrams on its master lcore and
+ * dispatches each record to the ring of the lcore that owned the conn
+ * on the sender, where it's installed into that lcore's conn table.
+ * FNAT lports are re-reserved in the local sa_pool, so records whose
+ * lport is not owned by the same lcore here are refused.
+ */
+#ifndef __DPVS_SYNC_H__
+#define __DPVS_SYNC_H__
+#include "conf/common.h"
+#include "conf/sync.h"
+#include "ipvs/conn.h"
+#include "ipvs/handoff.h"
+
+#define DP_VS_SYNC_MAGIC        0x53564450  /* "PDVS" */
+#define DP_VS_SYNC_VERSION      2
+
+enum {
+    DP_VS_SYNC_CONN_CREATE = 1,
+    DP_VS_SYNC_CONN_UPDATE,
+    DP_VS_SYNC_CONN_EXPIRE,
+};
+
+/* datagram: header followed by @nrecs records, host byte order */
+struct dp_vs_sync_hdr {
+    uint32_t            magic;
+    uint8_t             version;
+    uint8_t             syncid;
+    uint16_t            nrecs;
+    uint16_t            rec_size;   /* sizeof(struct dp_vs_sync_rec) */
+    uint16_t            reserved;
+};
+
+struct dp_vs_sync_rec {
+    uint8_t             type;       /* DP_VS_SYNC_CONN_XXX */
+    uint8_t             cid;        /* owner lcore on the sender */
+    uint16_t            reserved;
+    uint32_t            reserved2;
+    struct dp_vs_handoff_conn conn;
+};
+
+extern volatile int dp_vs_sync_state;
+
+void __dp_vs_sync_conn(struct dp_vs_conn *conn, int type);
+
+/* called by workers on conn creation, state transition and expiration */
+static inline void dp_vs_sync_conn(struct dp_vs_conn *conn, int type)
+{
+    if (unlikely(dp_vs_sync_state & DP_VS_SYNC_S_MASTER))
+        __dp_vs_sync_conn(conn, type);
+}
+
+int dp_vs_sync_init(void);
+int dp_vs_sync_term(void);
+
+void ipvs_sync_keyword_value_init(void);
+void install_ipvs_sync_keywords(void);
+
+#endif /* __DPVS_SYNC_H__ */
@@ -26,6 +26,7 @@
 #define __DPVS_SYNPROXY_H__
 
 #include "dpdk.h"
+#include "siphash.h"
 #include "ipvs/ipvs.h"
 #include "ipvs/conn.h"
 #include "ipvs/dest.h"
@@ -54,6 +55,147 @@
 #define DP_VS_SYNPROXY_SND_WSCALE_MASK  ((uint32_t)0xf << DP_VS_SYNPROXY_SND_WSCALE_BITS)
 #define DP_VS_SYNPROXY_WSCALE_MAX       14
 
+/* TCP Fast Open option (RFC 7413), dpvs cookies are 8 bytes */
+#ifndef TCPOPT_FASTOPEN
+#define TCPOPT_FASTOPEN                 34
+#endif
+#define TCPOLEN_FASTOPEN_BASE           2
+#define DP_VS_SYNPROXY_TFO_COOKIE_LEN   8
+#define DP_VS_SYNPROXY_TFO_OPT_ALIGNED  (TCPOLEN_FASTOPEN_BASE + 2 \
+                                         + DP_VS_SYNPROXY_TFO_COOKIE_LEN)
+
+/*
+ * SYN cookies, keyed by @secret[2]: the hash of the tuple under the first
+ * key, under the second with the minute @count, and the count itself.
+ */
+#define DP_VS_SYNPROXY_COOKIE_BITS  24 /* Upper bits store count */
+#define DP_VS_SYNPROXY_COOKIE_MASK  (((uint32_t)1 << DP_VS_SYNPROXY_COOKIE_BITS) - 1)
+
+static inline uint32_t
+dp_vs_synproxy_cookie_hash(const struct siphash_key *secret,
+                           uint32_t saddr, uint32_t daddr,
+                           uint16_t sport, uint16_t dport,
+                           uint32_t count, int c)
+{
+    uint64_t data[2];
+
+    data[0] = ((uint64_t)daddr << 32) | saddr;
+    data[1] = ((uint64_t)count << 32) | ((uint32_t)sport << 16 | dport);
+
+    return (uint32_t)siphash(data, 2, &secret[c]);
+}
+
+static inline uint32_t
+dp_vs_synproxy_cookie(const struct siphash_key *secret,
+                      uint32_t saddr, uint32_t daddr,
+                      uint16_t sport, uint16_t dport,
+                      uint32_t sseq, uint32_t count,
+                      uint32_t data)
+{
+    /*
+     * Compute the secure sequence number.
+     * The output should be:
+     * HASH(sec1, saddr, sport, daddr, dport, sec1) + sseq + (count * 2^24)
+     *      + (HASH(sec2, saddr, sport, daddr, dport, count, sec2) % 2^24).
+     * Where sseq is their sequence number and count increases every minute by 1.
+     * As an extra hack, we add a small "data" value that encodes the MSS into
+     * the second hash value.
+     */
+    return (dp_vs_synproxy_cookie_hash(secret, saddr, daddr, sport, dport, 0, 0) +
+        sseq + (count << DP_VS_SYNPROXY_COOKIE_BITS) +
+        ((dp_vs_synproxy_cookie_hash(secret, saddr, daddr, sport, dport, count, 1)
+          + data) & DP_VS_SYNPROXY_COOKIE_MASK));
+}
+
+static inline uint32_t
+dp_vs_synproxy_cookie_check(const struct siphash_key *secret,
+                            uint32_t cookie,
+                            uint32_t saddr, uint32_t daddr,
+                            uint16_t sport, uint16_t dport,
+                            uint32_t sseq, uint32_t count,
+                            uint32_t maxdiff)
+{
+    /*
+     * This retrieves the small "data" value from the syncookie.
+     * If the syncookie is bad, the data returned will be out of range.
+     * This must be checked by the caller.
+     *
+     * The count value used to generate the cookie must be within "maxdiff"
+     * if the current (passed-in) "count". The return value is (uint32_t) -1
+     * if this test fails.
+     */
+    uint32_t diff;
+
+    /* Strip away the layers from the cookie */
+    cookie -= dp_vs_synproxy_cookie_hash(secret, saddr, daddr, sport, dport, 0, 0)
+              + sseq;
+
+    /* Cookie is now reduced to (count * 2^24) ^ (hash % 2^24) */
+    diff = (count - (cookie >> DP_VS_SYNPROXY_COOKIE_BITS))
+           & ((uint32_t) -1 >> DP_VS_SYNPROXY_COOKIE_BITS);
+    if (diff >= maxdiff)
+        return (uint32_t) -1;
+
+    return (cookie - dp_vs_synproxy_cookie_hash(secret, saddr, daddr, sport, dport,
+                                                count - diff, 1))
+        & DP_VS_SYNPROXY_COOKIE_MASK; /* Leaving the data behind */
+}
+
+static inline uint32_t
+dp_vs_synproxy_cookie_hash_v6(const struct siphash_key *secret,
+                              const struct in6_addr *saddr,
+                              const struct in6_addr *daddr,
+                              uint16_t sport, uint16_t dport,
+                              uint32_t count, int c)
+{
+    uint64_t data[5];
+
+    memcpy(&data[0], saddr, sizeof(*saddr));
+    memcpy(&data[2], daddr, sizeof(*daddr));
+    data[4] = ((uint64_t)count << 32) | ((uint32_t)sport << 16 | dport);
+
+    return (uint32_t)siphash(data, 5, &secret[c]);
+}
+
+static inline uint32_t
+dp_vs_synproxy_cookie_v6(const struct siphash_key *secret,
+                         const struct in6_addr *saddr,
+                         const struct in6_addr *daddr,
+                         uint16_t sport, uint16_t dport,
+                         uint32_t sseq, uint32_t count,
+                         uint32_t data)
+{
+    return (dp_vs_synproxy_cookie_hash_v6(secret, saddr, daddr, sport, dport, 0, 0)
+            + sseq + (count << DP_VS_SYNPROXY_COOKIE_BITS)
+            + ((dp_vs_synproxy_cookie_hash_v6(secret, saddr, daddr, sport, dport,
+                                              count, 1)
+                    + data) & DP_VS_SYNPROXY_COOKIE_MASK));
+}
+
+static inline uint32_t
+dp_vs_synproxy_cookie_check_v6(const struct siphash_key *secret,
+                               uint32_t cookie,
+                               const struct in6_addr *saddr,
+                               const struct in6_addr *daddr,
+                               uint16_t sport, uint16_t dport,
+                               uint32_t sseq, uint32_t count,
+                               uint32_t maxdiff)
+{
+    uint32_t diff;
+
+    cookie -= dp_vs_synproxy_cookie_hash_v6(secret, saddr, daddr, sport, dport, 0, 0)
+              + sseq;
+
+    diff = (count - (cookie >> DP_VS_SYNPROXY_COOKIE_BITS))
+           & ((uint32_t) -1 >> DP_VS_SYNPROXY_COOKIE_BITS);
+    if (diff >= maxdiff)
+        return (uint32_t) -1;
+
+    return (cookie - dp_vs_synproxy_cookie_hash_v6(secret, saddr, daddr, sport,
+                                                   dport, count - diff, 1))
+        & DP_VS_SYNPROXY_COOKIE_MASK;
+}
+
 extern struct rte_mempool *dp_vs_synproxy_ack_mbufpool[DPVS_MAX_SOCKET];
 #define this_ack_mbufpool (dp_vs_synproxy_ack_mbufpool[rte_socket_id()])
 
@@ -86,6 +228,80 @@ struct dp_vs_synproxy_opt {
     uint16_t mss_clamp;     /* Max mss, negotiated at connectons setup */
 } __rte_cache_aligned;
 
+/* thresholds of adaptive synproxy, per service, 0 to disable one */
+struct dp_vs_synproxy_auto_conf {
+    uint32_t syn_rate;      /* SYNs per second */
+    uint32_t half_open;     /* SYNs per second without handshake completed */
+    uint32_t cool_down;     /* seconds under both before switching off */
+};
+
+/*
+ * Adaptive synproxy: on when the sums of the last @ms cross a threshold,
+ * off after cool_down calm seconds. The sums are reset.
+ * @return true if @sa->active changed.
+ */
+static inline bool
+dp_vs_synproxy_auto_next(const struct dp_vs_synproxy_auto_conf *conf,
+                         struct dp_vs_synproxy_auto *sa, uint32_t ms)
+{
+    uint64_t syn_rate, half_open;
+    bool flood;
+
+    if (!ms)
+        return false;
+
+    syn_rate = sa->sum_syns * 1000 / ms;
+    half_open = sa->sum_syns > sa->sum_acks ?
+                (sa->sum_syns - sa->sum_acks) * 1000 / ms : 0;
+    sa->sum_syns = sa->sum_acks = 0;
+
+    flood = (conf->syn_rate && syn_rate >= conf->syn_rate) ||
+            (conf->half_open && half_open >= conf->half_open);
+    if (flood) {
+        sa->calm = 0;
+        if (sa->active)
+            return false;
+        sa->active = 1;
+        sa->switches++;
+        return true;
+    }
+
+    if (!sa->active)
+        return false;
+    sa->calm += ms;
+    if (sa->calm < conf->cool_down * 1000)
+        return false;
+    sa->calm = 0;
+    sa->active = 0;
+    return true;
+}
+
+/* synproxy is on for the SYNs of @svc */
+static inline bool dp_vs_synproxy_svc_on(const struct dp_vs_service *svc)
+{
+    return (svc->flags & DP_VS_SVC_F_SYNPROXY) ||
+           ((svc->flags & DP_VS_SVC_F_SYNPROXY_AUTO) && svc->sp_auto.active);
+}
+
+void __dp_vs_synproxy_auto_report(struct dp_vs_service *svc);
+
+/* count a SYN (@syn) or a handshake completed of adaptive synproxy @svc */
+static inline void dp_vs_synproxy_auto_count(struct dp_vs_service *svc,
+                                             bool syn)
+{
+    if (likely(!(svc->flags & DP_VS_SVC_F_SYNPROXY_AUTO)))
+        return;
+
+    if (syn)
+        svc->sp_auto.syns++;
+    else
+        svc->sp_auto.acks++;
+
+    if (unlikely(rte_get_timer_cycles() - svc->sp_auto.stamp >=
+                 rte_get_timer_hz()))
+        __dp_vs_synproxy_auto_report(svc);
+}
+
 /* synproxy(syncookies and one-minute-timer) init & cleanup */
 int dp_vs_synproxy_init(void);
 int dp_vs_synproxy_term(void);
@@ -94,6 +310,14 @@ int dp_vs_synproxy_term(void);
 int dp_vs_synproxy_syn_rcv(int af, struct rte_mbuf *mbuf,
         const struct dp_vs_iphdr *iph, int *verdict);
 
+/* Syn-proxy step 1 for the bare SYNs of a burst, returns mbufs left */
+uint16_t dp_vs_synproxy_syn_burst(struct rte_mbuf **mbufs, uint16_t count,
+                                  uint32_t *nbytes);
+
+/* Answer a client's SYN or ACK with a RST */
+void dp_vs_synproxy_send_rst(int af, struct rte_mbuf *mbuf,
+        const struct dp_vs_iphdr *iph, int *verdict);
+
 /* Syn-proxy step 2 logic: receive client's Ack */
 int dp_vs_synproxy_ack_rcv(int af, struct rte_mbuf *mbuf,
         struct tcphdr *th, struct dp_vs_proto *pp,
@@ -271,6 +271,12 @@ struct netif_ops {
     int (*op_filter_supported)(struct netif_port *dev, enum rte_filter_type fltype);
     int (*op_set_fdir_filt)(struct netif_port *dev, enum rte_filter_op op,
                             const struct rte_eth_fdir_filter *filt);
+    int (*op_flow_create)(struct netif_port *dev,
+                          const struct rte_flow_attr *attr,
+                          const struct rte_flow_item pattern[],
+                          const struct rte_flow_action actions[],
+                          struct rte_flow **flow);
+    int (*op_flow_destroy)(struct netif_port *dev, struct rte_flow *flow);
     int (*op_get_queue)(struct netif_port *dev, lcoreid_t cid, queueid_t *qid);
     int (*op_get_link)(struct netif_port *dev, struct rte_eth_link *link);
     int (*op_get_promisc)(struct netif_port *dev, bool *promisc);
@@ -337,6 +343,8 @@ struct netif_port {
 /**************************** lcore API *******************************/
 int netif_xmit(struct rte_mbuf *mbuf, struct netif_port *dev);
 int netif_hard_xmit(struct rte_mbuf *mbuf, struct netif_port *dev);
+int netif_hard_xmit_burst(struct rte_mbuf **mbufs, uint16_t count,
+                          struct netif_port *dev);
 int netif_rcv(struct netif_port *dev, __be16 eth_type, struct rte_mbuf *mbuf);
 int netif_print_lcore_conf(char *buf, int *len, bool is_all, portid_t pid);
 int netif_print_lcore_queue_conf(lcoreid_t cid, char *buf, int *len, bool title);
@@ -358,6 +366,12 @@ int netif_unregister_pkt(struct pkt_type *pt);
 /**************************** port API ******************************/
 int netif_fdir_filter_set(struct netif_port *port, enum rte_filter_op opcode,
                           const struct rte_eth_fdir_filter *fdir_flt);
+/* rte_flow rules, EDPVS_NOTSUPP if the port (PMD) has none */
+int netif_flow_create(struct netif_port *port, const struct rte_flow_attr *attr,
+                      const struct rte_flow_item pattern[],
+                      const struct rte_flow_action actions[],
+                      struct rte_flow **flow);
+int netif_flow_destroy(struct netif_port *port, struct rte_flow *flow);
 void netif_mask_fdir_filter(int af, const struct netif_port *port,
                             struct rte_eth_fdir_filter *filt);
 struct netif_port* netif_port_get(portid_t id);
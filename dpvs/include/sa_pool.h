@@ -66,6 +66,14 @@ int sa_release(const struct netif_port *dev,
                const struct sockaddr_storage *daddr,
                const struct sockaddr_storage *saddr);
 
+/**
+ * take the exact <@saddr, port> from this lcore's pool, fails if it is in
+ * use or the port is not owned by this lcore (see sa_fdirs).
+ */
+int sa_reserve(const struct netif_port *dev,
+               const struct sockaddr_storage *daddr,
+               const struct sockaddr_storage *saddr);
+
 int get_sa_pool_stats(const struct inet_ifaddr *ifa,
                        struct sa_pool_stats *stats);
 
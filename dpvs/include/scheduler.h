@@ -55,6 +55,7 @@ const char *dpvs_lcore_role_str(dpvs_lcore_role_t role);
 int dpvs_lcore_job_register(struct dpvs_lcore_job *lcore_job, dpvs_lcore_role_t role);
 int dpvs_lcore_job_unregister(struct dpvs_lcore_job *lcore_job, dpvs_lcore_role_t role);
 int dpvs_lcore_start(int is_master);
+void dpvs_lcore_stop(void);
 
 int dpvs_scheduler_init(void);
 int dpvs_scheduler_term(void);
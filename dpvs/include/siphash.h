@@ -0,0 +1,75 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * SipHash-2-4 (Aumasson & Bernstein), a keyed hash fast on short inputs,
+ * for messages made of whole 64-bit words.
+ */
+#ifndef __SIPHASH_H__
+#define __SIPHASH_H__
+
+#include <stdint.h>
+
+struct siphash_key {
+    uint64_t    key[2];
+};
+
+#define SIP_ROTL(x, b)  (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND(v0, v1, v2, v3) do { \
+    v0 += v1; v1 = SIP_ROTL(v1, 13); v1 ^= v0; v0 = SIP_ROTL(v0, 32); \
+    v2 += v3; v3 = SIP_ROTL(v3, 16); v3 ^= v2; \
+    v0 += v3; v3 = SIP_ROTL(v3, 21); v3 ^= v0; \
+    v2 += v1; v1 = SIP_ROTL(v1, 17); v1 ^= v2; v2 = SIP_ROTL(v2, 32); \
+} while (0)
+
+/* hash @nwords little-endian 64-bit words of @data */
+static inline uint64_t siphash(const uint64_t *data, unsigned int nwords,
+                               const struct siphash_key *key)
+{
+    uint64_t v0 = 0x736f6d6570736575ULL ^ key->key[0];
+    uint64_t v1 = 0x646f72616e646f6dULL ^ key->key[1];
+    uint64_t v2 = 0x6c7967656e657261ULL ^ key->key[0];
+    uint64_t v3 = 0x7465646279746573ULL ^ key->key[1];
+    uint64_t m;
+    unsigned int i;
+
+    for (i = 0; i < nwords; i++) {
+        m = data[i];
+        v3 ^= m;
+        SIPROUND(v0, v1, v2, v3);
+        SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    /* last block: message length in bytes, no tail */
+    m = (uint64_t)(nwords * 8) << 56;
+    v3 ^= m;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    v0 ^= m;
+
+    v2 ^= 0xff;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+#endif
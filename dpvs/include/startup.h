@@ -0,0 +1,45 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * startup profiler: every init stage in main() records its wall time and
+ * the hugepage memory it allocated, the timeline is printed once dpvs is
+ * up and can be queried later with "dpip startup show".
+ */
+#ifndef __DPVS_STARTUP_H__
+#define __DPVS_STARTUP_H__
+#include "conf/common.h"
+#include "conf/startup.h"
+
+void dpvs_startup_stage_begin(const char *name);
+void dpvs_startup_stage_end(int err);
+void dpvs_startup_dump(void);
+
+int dpvs_startup_ctrl_init(void);
+int dpvs_startup_ctrl_term(void);
+
+/* run @call as a profiled startup stage, evaluates to its return value.
+ * stages may nest, e.g., ipvs sub-modules inside the "ipvs" stage. */
+#define DPVS_INIT_STAGE(name, call) ({                                  \
+    int __err;                                                          \
+    dpvs_startup_stage_begin(name);                                     \
+    __err = (call);                                                     \
+    dpvs_startup_stage_end(__err);                                      \
+    __err;                                                              \
+})
+
+#endif /* __DPVS_STARTUP_H__ */
@@ -33,6 +33,10 @@
 #include "ipvs/proto_tcp.h"
 #include "ipvs/proto_udp.h"
 #include "ipvs/synproxy.h"
+#include "ipvs/sync.h"
+#include "ipvs/blklst.h"
+#include "ipvs/hwdrop.h"
+#include "ipvs/flood.h"
 #include "scheduler.h"
 
 typedef void (*sighandler_t)(int);
@@ -53,6 +57,10 @@ static void keyword_value_init(void)
     udp_keyword_value_init();
     tcp_keyword_value_init();
     synproxy_keyword_value_init();
+    ipvs_sync_keyword_value_init();
+    blklst_keyword_value_init();
+    hwdrop_keyword_value_init();
+    flood_keyword_value_init();
 
     ipv6_keyword_value_init();
 }
@@ -88,6 +96,26 @@ static vector_t install_keywords(void)
     install_proto_udp_keywords();
     install_sublevel_end();
 
+    install_keyword("sync", NULL, KW_TYPE_NORMAL);
+    install_sublevel();
+    install_ipvs_sync_keywords();
+    install_sublevel_end();
+
+    install_keyword("blklst", NULL, KW_TYPE_NORMAL);
+    install_sublevel();
+    install_blklst_keywords();
+    install_sublevel_end();
+
+    install_keyword("hwdrop", NULL, KW_TYPE_NORMAL);
+    install_sublevel();
+    install_hwdrop_keywords();
+    install_sublevel_end();
+
+    install_keyword("flood", NULL, KW_TYPE_NORMAL);
+    install_sublevel();
+    install_flood_keywords();
+    install_sublevel_end();
+
     install_ipv6_keywords();
 
     return g_keywords;
@@ -22,8 +22,10 @@
 #include <unistd.h>
 #include <stdbool.h>
 #include <numa.h>
+#include <fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/syscall.h>
 #include <net/if.h>
 #include <netinet/in.h>
 #include <net/ethernet.h>
@@ -197,6 +199,27 @@ int linux_hw_mc_del(const char *ifname, const uint8_t hwma[ETH_ALEN])
     return linux_hw_mc_mod(ifname, hwma, false);
 }
 
+/* fill @buf from the kernel CSPRNG, for keys and secrets */
+int get_random_bytes(void *buf, size_t n)
+{
+    int fd;
+    ssize_t len;
+
+#ifdef SYS_getrandom
+    len = syscall(SYS_getrandom, buf, n, 0);
+    if (len == n)
+        return 0;
+#endif
+
+    fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0)
+        return -1;
+    len = readn(fd, buf, n);
+    close(fd);
+
+    return len == n ? 0 : -1;
+}
+
 ssize_t readn(int fd, void *vptr, size_t n)
 {
     size_t nleft;
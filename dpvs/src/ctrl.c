@@ -16,6 +16,7 @@
  *
  */
 #include <sys/socket.h>
+#include <sys/epoll.h>
 #include <fcntl.h>
 #include <sys/un.h>
 #include <unistd.h>
@@ -24,6 +25,7 @@
 #include <assert.h>
 #include "ctrl.h"
 #include "netif.h"
+#include "conf/msg.h"
 #include "mempool.h"
 #include "parser/parser.h"
 #include "scheduler.h"
@@ -68,6 +70,26 @@ struct list_head mc_wait_hlist[DPVS_MC_HLIST_LEN];
 /* per-lcore msg queue */
 struct rte_ring *msg_ring[DPVS_MAX_LCORE];
 
+/* msgs are dequeued in bursts into a per-lcore stash and handed out one by
+ * one, so a callback that polls its own ring (blockable send) keeps order */
+#define DPVS_MSG_BURST 32
+
+struct msg_stash {
+    struct dpvs_msg *msgs[DPVS_MSG_BURST];
+    unsigned int head;
+    unsigned int cnt;
+} __rte_cache_aligned;
+
+static struct msg_stash msg_stashes[DPVS_MAX_LCORE];
+
+/* registered prio + 1 of msg types below DPVS_MT_LEN, 0 if not registered,
+ * lets msg_send check the target without locks and refcnts */
+static uint8_t mt_prio[DPVS_MAX_LCORE][DPVS_MT_LEN];
+
+/* per-lcore latency stats, indexed by msg type below DPVS_MT_LEN,
+ * written by the owner lcore only */
+static struct dp_vs_msg_lat *msg_lats[DPVS_MAX_LCORE];
+
 #ifdef CONFIG_MSG_DEBUG
 rte_atomic64_t n_msg_allc;
 rte_atomic64_t n_msg_free;
@@ -195,6 +217,24 @@ static inline void msg_type_put(struct dpvs_msg_type *mt)
     rte_atomic32_dec(&mt->refcnt);
 }
 
+/* prio of msg type on lcore cid, or -1 if not registered there */
+static inline int msg_type_prio(msgid_t type, lcoreid_t cid)
+{
+    struct dpvs_msg_type *mt;
+    int prio;
+
+    if (likely(type < DPVS_MT_LEN))
+        return (int)mt_prio[cid][type] - 1;
+
+    mt = msg_type_get(type, cid);
+    if (!mt)
+        return -1;
+    prio = mt->prio;
+    msg_type_put(mt);
+
+    return prio;
+}
+
 int msg_type_register(const struct dpvs_msg_type *msg_type)
 {
     int hashkey;
@@ -224,6 +264,8 @@ int msg_type_register(const struct dpvs_msg_type *msg_type)
     rte_atomic32_set(&mt->refcnt, 0);
     rte_rwlock_write_lock(&mt_lock[msg_type->cid][hashkey]);
     list_add_tail(&mt->list, &mt_array[msg_type->cid][hashkey]);
+    if (mt->type < DPVS_MT_LEN)
+        mt_prio[mt->cid][mt->type] = mt->prio + 1;
     rte_rwlock_write_unlock(&mt_lock[msg_type->cid][hashkey]);
 
     return EDPVS_OK;
@@ -248,6 +290,8 @@ int msg_type_unregister(const struct dpvs_msg_type *msg_type)
     }
 
     rte_rwlock_write_lock(&mt_lock[msg_type->cid][hashkey]);
+    if (mt->type < DPVS_MT_LEN)
+        mt_prio[mt->cid][mt->type] = 0;
     list_del_init(&mt->list);
     rte_rwlock_write_unlock(&mt_lock[msg_type->cid][hashkey]);
 
@@ -362,10 +406,10 @@ struct dpvs_msg* msg_make(msgid_t type, uint32_t seq,
     struct dpvs_msg *msg;
 
     total_len = sizeof(struct dpvs_msg) + len;
+    /* zeroed by dpvs_mempool_get */
     msg = dpvs_mempool_get(msg_pool, total_len);
     if (unlikely(NULL == msg))
         return NULL;
-    memset(msg, 0, total_len);
 
     rte_spinlock_init(&msg->lock);
 
@@ -441,43 +485,114 @@ int msg_destroy(struct dpvs_msg **pmsg)
     return EDPVS_OK;
 }
 
+static inline struct dpvs_msg *msg_dequeue(lcoreid_t cid)
+{
+    struct msg_stash *stash = &msg_stashes[cid];
+
+    if (stash->head == stash->cnt) {
+        stash->cnt = rte_ring_dequeue_burst(msg_ring[cid], (void **)stash->msgs,
+                                            DPVS_MSG_BURST, NULL);
+        stash->head = 0;
+        if (!stash->cnt)
+            return NULL;
+    }
+
+    return stash->msgs[stash->head++];
+}
+
+static void msg_lat_account(const struct dpvs_msg *msg, lcoreid_t cid)
+{
+    struct dp_vs_msg_lat *lat;
+    uint64_t us;
+    int idx;
+
+    if (unlikely(!msg_lats[cid] || msg->type >= DPVS_MT_LEN || !msg->stamp))
+        return;
+
+    lat = &msg_lats[cid][msg->type];
+    us = (rte_get_timer_cycles() - msg->stamp) * 1000000 / g_cycles_per_sec;
+    idx = us ? 64 - __builtin_clzll(us) : 0;
+    if (idx >= DPVS_MSG_LAT_BUCKETS)
+        idx = DPVS_MSG_LAT_BUCKETS - 1;
+
+    lat->count++;
+    lat->sum_us += us;
+    if (us > lat->max_us)
+        lat->max_us = us;
+    lat->hist[idx]++;
+}
+
+static inline void msg_lat_timeout(const struct dpvs_msg *msg, lcoreid_t cid)
+{
+    if (likely(msg_lats[cid] != NULL) && msg->type < DPVS_MT_LEN)
+        msg_lats[cid][msg->type].timeouts++;
+}
+
 static int msg_master_process(int step);
+
+/* slaves leave their job loop for good once dpvs is finishing */
+static inline bool msg_slaves_stopped(void)
+{
+    return dpvs_state_get() == DPVS_STATE_FINISH;
+}
+
+/* all replies expected arrived, run the part of master */
+static void mc_queue_finish(struct dpvs_multicast_queue *mcq,
+                            struct dpvs_msg_type *msg_type)
+{
+    if (msg_type->multicast_msg_cb(mcq) < 0) {
+        add_msg_flags(mcq->org_msg, DPVS_MSG_F_CALLBACK_FAIL);/* callback on master failed */
+#ifdef CONFIG_MSG_DEBUG
+        RTE_LOG(INFO, MSGMGR, "%s:msg@%p, mc msg_type %d callback failed on master\n",
+                __func__, mcq->org_msg, mcq->type);
+#endif
+    }
+    msg_lat_account(mcq->org_msg, master_lcore);
+    add_msg_flags(mcq->org_msg, DPVS_MSG_F_STATE_FIN);
+    msg_destroy(&mcq->org_msg);
+}
+
 /* "msg" must be produced by "msg_make" */
 int msg_send(struct dpvs_msg *msg, lcoreid_t cid, uint32_t flags, struct dpvs_msg_reply **reply)
 {
-    struct dpvs_msg_type *mt;
-    int res;
-    int step = 1;
+    int res, prio;
     uint32_t tflags;
     uint64_t start, delay;
+    lcoreid_t self = rte_lcore_id();
 
     if (unlikely(msg == NULL))
         return EDPVS_INVAL;
     add_msg_flags(msg, flags);
 
-    if (unlikely(!((cid == master_lcore) || (slave_lcore_mask & (1L << cid))))) {
+    if (unlikely(cid >= DPVS_MAX_LCORE ||
+                 !((cid == master_lcore) || (slave_lcore_mask & (1L << cid))))) {
         RTE_LOG(WARNING, MSGMGR, "%s:msg@%p, invalid args\n", __func__, msg);
         add_msg_flags(msg, DPVS_MSG_F_STATE_DROP);
         return EDPVS_INVAL;
     }
 
-    mt = msg_type_get(msg->type, cid);
-    if (unlikely(!mt)) {
+    /* a stopped slave never dequeues, do not wait for it */
+    if (unlikely(cid != master_lcore && msg_slaves_stopped())) {
+        add_msg_flags(msg, DPVS_MSG_F_STATE_DROP);
+        return EDPVS_DISABLED;
+    }
+
+    prio = msg_type_prio(msg->type, cid);
+    if (unlikely(prio < 0)) {
         RTE_LOG(WARNING, MSGMGR, "%s:msg@%p, msg type %d not registered\n",
                 __func__, msg, msg->type);
         add_msg_flags(msg, DPVS_MSG_F_STATE_DROP);
         return EDPVS_NOTEXIST;
     }
 
-    if (mt->prio > g_msg_prio) {
+    if (prio > g_msg_prio) {
         add_msg_flags(msg, DPVS_MSG_F_STATE_DROP);
-        msg_type_put(mt);
         return EDPVS_DISABLED;
     }
-    msg_type_put(mt);
 
     /* two lcores will be using the msg now, increase its refcnt */
     rte_atomic16_inc(&msg->refcnt);
+    msg->stamp = rte_get_timer_cycles();
     res = rte_ring_enqueue(msg_ring[cid], msg);
     if (unlikely(-EDQUOT == res)) {
         RTE_LOG(WARNING, MSGMGR, "%s:msg@%p, msg ring of lcore %d quota exceeded\n",
@@ -500,22 +615,23 @@ int msg_send(struct dpvs_msg *msg, lcoreid_t cid, uint32_t flags, struct dpvs_ms
 
     /* blockable msg, wait here until done or timeout */
     add_msg_flags(msg, DPVS_MSG_F_STATE_SEND);
-    start = rte_get_timer_cycles();
+    start = msg->stamp;
     delay = (uint64_t)g_msg_timeout * g_cycles_per_sec / 1000000;
-    while(!(test_msg_flags(msg, (DPVS_MSG_F_STATE_FIN | DPVS_MSG_F_STATE_DROP)))) {
+    while (!msg->done) {
         if (start + delay < rte_get_timer_cycles()) {
             RTE_LOG(WARNING, MSGMGR, "%s:msg@%p, uc_msg(type:%d, cid:%d->%d, flags=%d) timeout"
                     "(%d us), drop...\n", __func__, msg, msg->type, msg->cid, cid,
                     get_msg_flags(msg), g_msg_timeout);
             add_msg_flags(msg, DPVS_MSG_F_TIMEOUT);
+            msg_lat_timeout(msg, self);
             return EDPVS_MSG_DROP;
         }
         /* to avoid dead lock when one send a blockable msg to itself */
-        if (rte_lcore_id() == master_lcore)
-            msg_master_process(step);
+        if (self == master_lcore)
+            msg_master_process(DPVS_MSG_BURST);
         else
-            msg_slave_process(step);
-        step *= 2;
+            msg_slave_process(DPVS_MSG_BURST);
+        rte_pause();
     }
     if (reply)
         *reply = &msg->reply;
@@ -534,9 +650,10 @@ int multicast_msg_send(struct dpvs_msg *msg, uint32_t flags, struct dpvs_multica
 {
     struct dpvs_msg *new_msg;
     struct dpvs_multicast_queue *mcq;
+    struct dpvs_msg_type *msg_type;
     uint32_t tflags;
-    uint64_t start, delay;
-    int ii, ret;
+    uint64_t start, delay, mask;
+    int ii, ret, prio;
 
     if (unlikely(msg == NULL))
         return EDPVS_INVAL;
@@ -558,10 +675,30 @@ int multicast_msg_send(struct dpvs_msg *msg, uint32_t flags, struct dpvs_multica
         return EDPVS_BUSY;
     }
 
+    /* once slaves are stopped at shutdown, only master's part is left */
+    mask = msg_slaves_stopped() ? 0 : slave_lcore_mask;
+
+    /* check every slave before making any copy, so that a type not
+     * registered or disabled somewhere fails without partial delivery */
+    for (ii = 0; ii < DPVS_MAX_LCORE; ii++) {
+        if (!(mask & (1UL << ii)))
+            continue;
+        prio = msg_type_prio(msg->type, ii);
+        if (unlikely(prio < 0 || prio > g_msg_prio)) {
+            if (prio < 0)
+                RTE_LOG(WARNING, MSGMGR, "%s:msg@%p, msg type %d not registered on lcore %d\n",
+                        __func__, msg, msg->type, ii);
+            add_msg_flags(msg, DPVS_MSG_F_STATE_DROP);
+            msg->mode = DPVS_MSG_UNICAST; /* do not free msg queue */
+            return prio < 0 ? EDPVS_NOTEXIST : EDPVS_DISABLED;
+        }
+    }
+
     /* send unicast msgs from master to all alive slaves */
     rte_atomic16_inc(&msg->refcnt);
+    msg->stamp = rte_get_timer_cycles();
     for (ii = 0; ii < DPVS_MAX_LCORE; ii++) {
-        if (slave_lcore_mask & (1UL << ii)) {
+        if (mask & (1UL << ii)) {
             new_msg = msg_make(msg->type, msg->seq, DPVS_MSG_UNICAST, msg->cid, msg->len, msg->data);
             if (unlikely(!new_msg)) {
                 RTE_LOG(ERR, MSGMGR, "%s:msg@%p, msg make fail\n", __func__, msg);
@@ -595,32 +732,46 @@ int multicast_msg_send(struct dpvs_msg *msg, uint32_t flags, struct dpvs_multica
 
     mcq->type = msg->type;
     mcq->seq = msg->seq;
-    mcq->mask = slave_lcore_mask;
+    mcq->mask = mask;
     mcq->org_msg = msg; /* save original msg */
     INIT_LIST_HEAD(&mcq->mq);
 
     /* hash mcq so that reply msg can be collected in msg_master_process */
     mc_queue_hash(mcq);
 
+    /* no slave to reply, finish right away */
+    if (unlikely(!mcq->mask)) {
+        msg_type = msg_type_get(msg->type, master_lcore);
+        if (likely(msg_type != NULL)) {
+            mc_queue_finish(mcq, msg_type);
+            msg_type_put(msg_type);
+        } else {
+            add_msg_flags(msg, DPVS_MSG_F_STATE_DROP);
+            msg_destroy(&mcq->org_msg);
+        }
+    }
+
     if (flags & DPVS_MSG_F_ASYNC)
         return EDPVS_OK;
 
     /* blockable msg wait here until done or timeout */
     add_msg_flags(msg, DPVS_MSG_F_STATE_SEND);
-    start = rte_get_timer_cycles();
+    start = msg->stamp;
     delay = (uint64_t)g_msg_timeout * g_cycles_per_sec / 1000000;
-    while(!(test_msg_flags(msg, (DPVS_MSG_F_STATE_FIN | DPVS_MSG_F_STATE_DROP)))) {
+    while (!msg->done) {
         if (start + delay < rte_get_timer_cycles()) {
             RTE_LOG(WARNING, MSGMGR, "%s:msg@%p, mcq(type:%d, cid:%d->slaves) timeout"
                     "(%d us), drop...\n", __func__, msg,
                     msg->type, msg->cid, g_msg_timeout);
             add_msg_flags(msg, DPVS_MSG_F_TIMEOUT);
+            msg_lat_timeout(msg, master_lcore);
             /* just in case slave send reply fail.
              * it's safe here, because msg is used on master lcore only. */
             msg_destroy(&msg);
             return EDPVS_MSG_DROP;
         }
-        msg_master_process(slave_lcore_nb * 1.5); /* to avoid dead lock if send msg to myself */
+        msg_master_process(DPVS_MSG_BURST); /* to avoid dead lock if send msg to myself */
+        rte_pause();
     }
     if (reply)
         *reply = mcq; /* here, mcq store all slave's reply msg */
@@ -644,7 +795,7 @@ static int msg_master_process(int step)
 
     /* dequeue msg from ring on the master lcore and process it */
     while (((step <= 0) || ((step > 0) && (++n <= step))) &&
-            (0 == rte_ring_dequeue(msg_ring[master_lcore], (void **)&msg))) {
+            (msg = msg_dequeue(master_lcore)) != NULL) {
         add_msg_flags(msg, DPVS_MSG_F_STATE_RECV);
         msg_type = msg_type_get(msg->type, master_lcore);
         if (!msg_type) {
@@ -664,6 +815,7 @@ static int msg_master_process(int step)
 #endif
                 }
             }
+            msg_lat_account(msg, master_lcore);
             add_msg_flags(msg, DPVS_MSG_F_STATE_FIN);
             msg_destroy(&msg);
         } else { /* multicast msg */
@@ -685,17 +837,8 @@ static int msg_master_process(int step)
                 if (test_msg_flags(msg, DPVS_MSG_F_CALLBACK_FAIL)) /* callback on slave failed */
                     add_msg_flags(mcq->org_msg, DPVS_MSG_F_CALLBACK_FAIL);
 
-                if (unlikely(0 == mcq->mask)) { /* okay, all slave reply msg arrived */
-                    if (msg_type->multicast_msg_cb(mcq) < 0) {
-                        add_msg_flags(mcq->org_msg, DPVS_MSG_F_CALLBACK_FAIL);/* callback on master failed */
-#ifdef CONFIG_MSG_DEBUG
-                        RTE_LOG(INFO, MSGMGR, "%s:msg@%p, mc msg_type %d callback failed on master\n",
-                                __func__, mcq->org_msg, msg->type);
-#endif
-                    }
-                    add_msg_flags(mcq->org_msg, DPVS_MSG_F_STATE_FIN);
-                    msg_destroy(&mcq->org_msg);
-                }
+                if (unlikely(0 == mcq->mask)) /* okay, all slave reply msg arrived */
+                    mc_queue_finish(mcq, msg_type);
                 msg_type_put(msg_type);
                 continue;
             }
@@ -727,7 +870,7 @@ int msg_slave_process(int step)
     }
 
     /* dequeue msg from ring on the lcore and process it */
-    while (0 == rte_ring_dequeue(msg_ring[cid], (void **)&msg)) {
+    while ((msg = msg_dequeue(cid)) != NULL) {
         add_msg_flags(msg, DPVS_MSG_F_STATE_RECV);
         msg_type = NULL;
 
@@ -755,6 +898,7 @@ int msg_slave_process(int step)
 #endif
             }
         }
+        msg_lat_account(msg, cid);
         /* send reply msg to master for multicast msg */
         if (DPVS_MSG_MULTICAST == msg_type->mode) {
             /* FIXME:
@@ -1085,6 +1229,16 @@ static inline int msg_init(void)
     for (ii = 0; ii < DPVS_MC_HLIST_LEN; ii++)
         INIT_LIST_HEAD(&mc_wait_hlist[ii]);
 
+    /* per-lcore latency stats, not fatal if missing */
+    for (ii = 0; ii < DPVS_MAX_LCORE; ii++) {
+        if (ii != master_lcore && !(slave_lcore_mask & (1UL << ii)))
+            continue;
+        msg_lats[ii] = rte_zmalloc("msg_lats", DPVS_MT_LEN * sizeof(struct dp_vs_msg_lat),
+                                   RTE_CACHE_LINE_SIZE);
+        if (!msg_lats[ii])
+            RTE_LOG(WARNING, MSGMGR, "%s: no memory for lcore %d msg stats\n", __func__, ii);
+    }
+
     /* per-lcore msg queue */
     for (ii = 0; ii < DPVS_MAX_LCORE; ii++) {
         snprintf(ring_name, sizeof(ring_name), "msg_ring_%d", ii);
@@ -1117,6 +1271,59 @@ static inline int msg_init(void)
     return EDPVS_OK;
 }
 
+/* latency stats of every msg type seen, summed over lcores */
+static int msg_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
+                           void **out, size_t *outsize)
+{
+    struct dp_vs_msg_stats *stats;
+    struct dp_vs_msg_lat *dst;
+    const struct dp_vs_msg_lat *src;
+    int type, cid, i;
+    size_t len;
+
+    if (opt != SOCKOPT_GET_MSG_STATS)
+        return EDPVS_NOTSUPP;
+
+    len = sizeof(*stats) + DPVS_MT_LEN * sizeof(struct dp_vs_msg_lat);
+    stats = rte_zmalloc("msg_stats", len, 0);
+    if (!stats)
+        return EDPVS_NOMEM;
+
+    for (type = 0; type < DPVS_MT_LEN; type++) {
+        dst = &stats->lats[stats->ntypes];
+        for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+            if (!msg_lats[cid])
+                continue;
+            src = &msg_lats[cid][type];
+            dst->timeouts += src->timeouts;
+            dst->count += src->count;
+            dst->sum_us += src->sum_us;
+            if (src->max_us > dst->max_us)
+                dst->max_us = src->max_us;
+            for (i = 0; i < DPVS_MSG_LAT_BUCKETS; i++)
+                dst->hist[i] += src->hist[i];
+        }
+        if (dst->count || dst->timeouts) {
+            dst->type = type;
+            stats->ntypes++;
+        }
+    }
+
+    *out = stats;
+    *outsize = sizeof(*stats) + stats->ntypes * sizeof(struct dp_vs_msg_lat);
+    return EDPVS_OK;
+}
+
+static struct dpvs_sockopts msg_sockopts = {
+    .version        = SOCKOPT_VERSION,
+    .set_opt_min    = 0,
+    .set_opt_max    = 0,
+    .set            = NULL,
+    .get_opt_min    = SOCKOPT_GET_MSG_STATS,
+    .get_opt_max    = SOCKOPT_GET_MSG_STATS,
+    .get            = msg_sockopt_get,
+};
+
 static inline int msg_term(void)
 {
     int ii;
@@ -1132,6 +1339,11 @@ static inline int msg_term(void)
         rte_ring_free(msg_ring[ii]);
     dpvs_mempool_destroy(msg_pool);
 
+    for (ii = 0; ii < DPVS_MAX_LCORE; ii++) {
+        rte_free(msg_lats[ii]);
+        msg_lats[ii] = NULL;
+    }
+
     return EDPVS_OK;
 }
 
@@ -1142,9 +1354,47 @@ static inline int msg_term(void)
 #define UNIX_DOMAIN_DEF "/var/run/dpvs_ctrl"
 char ipc_unix_domain[256];
 
+/*
+ * Clients keep their connection open and may pipeline requests. The server
+ * lives in master's loop, so nothing here may block: sockets are nonblocking,
+ * requests are assembled across loops, and replies are queued per client and
+ * written out as the socket drains. Each loop serves a bounded number of
+ * events, requests and reply bytes per client.
+ */
+#define SOCKOPT_CLIENTS_DEF     256
+#define SOCKOPT_CLIENTS_MAX     4096
+#define SOCKOPT_EVENTS_BURST    32
+#define SOCKOPT_REQS_PER_LOOP   16
+#define SOCKOPT_TXQ_MAX         16
+#define SOCKOPT_TX_BUDGET       (1UL << 20)
+#define SOCKOPT_MSG_LEN_MAX     (1UL << 26)
+
+struct sockopt_reply {
+    struct list_head list;
+    size_t len;                         /* header + data */
+    size_t off;                         /* bytes sent */
+    struct dpvs_sock_msg_reply hdr;
+    void *data;
+};
+
+struct sockopt_client {
+    struct list_head list;
+    int fd;
+    uint32_t events;                    /* epoll interests */
+    struct dpvs_sock_msg hdr;           /* request header being received */
+    size_t rx_off;
+    struct dpvs_sock_msg *msg;          /* request body being received */
+    struct list_head txq;
+    int txq_len;
+};
+
 static struct list_head sockopt_list;
 
 static int srv_fd;
+static int sockopt_epfd = -1;
+static int sockopt_max_clients = SOCKOPT_CLIENTS_DEF;
+static int sockopt_nb_clients;
+static struct list_head sockopt_clients;
 
 static inline int judge_id_betw(sockoptid_t num, sockoptid_t min, sockoptid_t max)
 {
@@ -1160,7 +1410,8 @@ static struct dpvs_sockopts* sockopts_get(struct dpvs_sock_msg *msg)
     switch (msg->type) {
         case SOCKOPT_GET:
             list_for_each_entry(skopt, &sockopt_list, list) {
-                if (judge_id_betw(msg->id, skopt->get_opt_min, skopt->get_opt_max)) {
+                if (skopt->get &&
+                        judge_id_betw(msg->id, skopt->get_opt_min, skopt->get_opt_max)) {
                     if (unlikely(skopt->version != msg->version)) {
                         RTE_LOG(WARNING, MSGMGR, "%s: socket msg version not match\n", __func__);
                         return NULL;
@@ -1172,7 +1423,8 @@ static struct dpvs_sockopts* sockopts_get(struct dpvs_sock_msg *msg)
             break;
         case SOCKOPT_SET:
             list_for_each_entry(skopt, &sockopt_list, list) {
-                if (judge_id_betw(msg->id, skopt->set_opt_min, skopt->set_opt_max)) {
+                if (skopt->set &&
+                        judge_id_betw(msg->id, skopt->set_opt_min, skopt->set_opt_max)) {
                     if (unlikely(skopt->version != msg->version)) {
                         RTE_LOG(WARNING, MSGMGR, "%s: socket msg version not match\n", __func__);
                         return NULL;
@@ -1194,13 +1446,16 @@ static inline int sockopts_exist(struct dpvs_sockopts *sockopts)
     if (unlikely(NULL == sockopts))
         return 0;
 
+    /* a range without handler (get-only or set-only modules) is empty */
     list_for_each_entry(skopt, &sockopt_list, list) {
-        if (judge_id_betw(sockopts->set_opt_min, skopt->set_opt_min, skopt->set_opt_max) ||
-                judge_id_betw(sockopts->set_opt_max, skopt->set_opt_min, skopt->set_opt_max)) {
+        if (sockopts->set && skopt->set &&
+                (judge_id_betw(sockopts->set_opt_min, skopt->set_opt_min, skopt->set_opt_max) ||
+                 judge_id_betw(sockopts->set_opt_max, skopt->set_opt_min, skopt->set_opt_max))) {
             return 1;
         }
-        if (judge_id_betw(sockopts->get_opt_min, skopt->get_opt_min, skopt->get_opt_max) ||
-                judge_id_betw(sockopts->get_opt_max, skopt->get_opt_min, skopt->get_opt_max)) {
+        if (sockopts->get && skopt->get &&
+                (judge_id_betw(sockopts->get_opt_min, skopt->get_opt_min, skopt->get_opt_max) ||
+                 judge_id_betw(sockopts->get_opt_max, skopt->get_opt_min, skopt->get_opt_max))) {
             return 1;
         }
     }
@@ -1246,163 +1501,320 @@ int sockopt_unregister(struct dpvs_sockopts *sockopts)
     return EDPVS_NOTEXIST;
 }
 
-static inline int sockopt_msg_recv(int clt_fd, struct dpvs_sock_msg **pmsg)
+/* free recieved msg */
+static inline void sockopt_msg_free(struct dpvs_sock_msg *msg)
 {
-    struct dpvs_sock_msg msg_hdr;
-    struct dpvs_sock_msg *msg;
-    int len, res;
-
-    if (unlikely(!pmsg))
-        return EDPVS_INVAL;
-    *pmsg = NULL;
+    rte_free(msg);
+}
 
-    len = sizeof(msg_hdr);
-    memset(&msg_hdr, 0, len);
-    res = readn(clt_fd, &msg_hdr, len);
-    if (sizeof(msg_hdr) != res) {
-        RTE_LOG(WARNING, MSGMGR, "%s: sockopt msg header recv fail -- %d/%d recieved\n",
-                __func__, res, len);
-        return EDPVS_IO;
-    }
+static void sockopt_client_close(struct sockopt_client *clt)
+{
+    struct sockopt_reply *reply, *next;
 
-    *pmsg = rte_malloc("sockopt_msg",
-            sizeof(struct dpvs_sock_msg) + msg_hdr.len, RTE_CACHE_LINE_SIZE);
-    if (unlikely(NULL == *pmsg)) {
-        RTE_LOG(ERR, MSGMGR, "%s: no memory\n", __func__);
-        return EDPVS_NOMEM;
-    }
+    epoll_ctl(sockopt_epfd, EPOLL_CTL_DEL, clt->fd, NULL);
+    close(clt->fd);
 
-    msg = *pmsg;
-    msg->version = msg_hdr.version;
-    msg->id = msg_hdr.id;
-    msg->type = msg_hdr.type;
-    msg->len = msg_hdr.len;
-
-    if (msg_hdr.len > 0) {
-        res = readn(clt_fd, msg->data, msg->len);
-        if (res != msg->len) {
-            RTE_LOG(WARNING, MSGMGR, "%s: sockopt msg body recv fail -- "
-                    "%d/%d recieved\n", __func__, res, (int)msg->len);
-            rte_free(msg);
-            *pmsg = NULL;
-            return EDPVS_IO;
-        }
+    list_for_each_entry_safe(reply, next, &clt->txq, list) {
+        list_del(&reply->list);
+        if (reply->data)
+            rte_free(reply->data);
+        rte_free(reply);
     }
+    if (clt->msg)
+        sockopt_msg_free(clt->msg);
 
-    return EDPVS_OK;
+    list_del(&clt->list);
+    rte_free(clt);
+    sockopt_nb_clients--;
 }
 
-/* free recieved msg */
-static inline void sockopt_msg_free(struct dpvs_sock_msg *msg)
+static int sockopt_client_update_events(struct sockopt_client *clt)
 {
-    rte_free(msg);
+    struct epoll_event ev;
+    uint32_t events = 0;
+
+    /* stop reading requests of a client that does not read its replies */
+    if (clt->txq_len < SOCKOPT_TXQ_MAX)
+        events |= EPOLLIN;
+    if (clt->txq_len > 0)
+        events |= EPOLLOUT;
+
+    if (events == clt->events)
+        return EDPVS_OK;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = clt;
+    if (epoll_ctl(sockopt_epfd, EPOLL_CTL_MOD, clt->fd, &ev) < 0) {
+        RTE_LOG(WARNING, MSGMGR, "%s: fail to update events of client %d -- %s\n",
+                __func__, clt->fd, strerror(errno));
+        return EDPVS_IO;
+    }
+    clt->events = events;
+
+    return EDPVS_OK;
 }
 
 /* Note:
  * 1. data is created by user using rte_malloc, rte_zmalloc, etc.
  * 2. msg data not sent when errcode is set in reply header */
-static int sockopt_msg_send(int clt_fd,
-        const struct dpvs_sock_msg_reply *hdr,
-        const char *data, int data_len)
+static int sockopt_msg_reply(struct sockopt_client *clt,
+        const struct dpvs_sock_msg *msg, int errcode,
+        void *data, size_t data_len)
 {
-    int len, res;
+    struct sockopt_reply *reply;
 
-    len = sizeof(struct dpvs_sock_msg_reply);
-    res = sendn(clt_fd, hdr, len, MSG_NOSIGNAL);
-    if (len != res) {
-        RTE_LOG(WARNING, MSGMGR, "[%s:msg#%d] sockopt reply msg header send error"
-                " -- %d/%d sent\n", __func__, hdr->id, res, len);
-        return EDPVS_IO;
+    reply = rte_zmalloc("sockopt_reply", sizeof(*reply), 0);
+    if (unlikely(!reply)) {
+        if (data)
+            rte_free(data);
+        return EDPVS_NOMEM;
     }
 
-    if (hdr->errcode) {
+    reply->hdr.version = SOCKOPT_VERSION;
+    reply->hdr.id = msg->id;
+    reply->hdr.type = msg->type;
+    reply->hdr.errcode = errcode;
+    strncpy(reply->hdr.errstr, dpvs_strerror(errcode), SOCKOPT_ERRSTR_LEN - 1);
+    reply->hdr.len = data_len;
+
+    if (errcode) {
         RTE_LOG(DEBUG, MSGMGR, "[%s:msg#%d] errcode set in sockopt msg reply: %s\n",
-                __func__, hdr->id, dpvs_strerror(hdr->errcode));
-        return hdr->errcode;
+                __func__, msg->id, dpvs_strerror(errcode));
+        if (data)
+            rte_free(data);
+        data = NULL;
+        data_len = 0;
     }
+    reply->data = data;
+    reply->len = sizeof(reply->hdr) + data_len;
 
-    if (data_len) {
-        res = sendn(clt_fd, data, data_len, MSG_NOSIGNAL);
-        if (data_len != res) {
-            RTE_LOG(WARNING, MSGMGR, "[%s:msg#%d] sockopt reply msg body send error"
-                    " -- %d/%d sent\n", __func__, hdr->id, res, data_len);
-            return EDPVS_IO;
-        }
-    }
+    list_add_tail(&reply->list, &clt->txq);
+    clt->txq_len++;
 
     return EDPVS_OK;
 }
 
-static int sockopt_ctl(__rte_unused void *arg)
+static int sockopt_msg_process(struct sockopt_client *clt, struct dpvs_sock_msg *msg)
 {
-    int clt_fd;
-    int ret;
-    socklen_t clt_len;
-    struct sockaddr_un clt_addr;
+    int ret = EDPVS_NOTSUPP;
     struct dpvs_sockopts *skopt;
-    struct dpvs_sock_msg *msg;
-    struct dpvs_sock_msg_reply reply_hdr;
     void *reply_data = NULL;
     size_t reply_data_len = 0;
 
-    memset(&clt_addr, 0, sizeof(struct sockaddr_un));
-    clt_len = sizeof(clt_addr);
+    skopt = sockopts_get(msg);
+    if (!skopt) /* the old server silently dropped such msg, reply instead */
+        return sockopt_msg_reply(clt, msg, EDPVS_NOTSUPP, NULL, 0);
 
-    /* Note: srv_fd is nonblock */
-    clt_fd = accept(srv_fd, (struct sockaddr*)&clt_addr, &clt_len);
-    if (clt_fd < 0) {
-        if (EWOULDBLOCK != errno) {
-            RTE_LOG(WARNING, MSGMGR, "%s: Fail to accept client request\n", __func__);
-        }
-        return EDPVS_IO;
+    if (msg->type == SOCKOPT_GET)
+        ret = skopt->get(msg->id, msg->data, msg->len, &reply_data, &reply_data_len);
+    else if (msg->type == SOCKOPT_SET)
+        ret = skopt->set(msg->id, msg->data, msg->len);
+    if (ret < 0) {
+        /* assume that reply_data is freed by user when callback fails */
+        reply_data = NULL;
+        reply_data_len = 0;
+#ifdef CONFIG_MSG_DEBUG
+        RTE_LOG(INFO, MSGMGR, "%s: socket msg<type=%s, id=%d> callback failed\n",
+                __func__, msg->type == SOCKOPT_GET ? "GET" : "SET", msg->id);
+#endif
     }
 
-    /* Note: clt_fd is block */
-    ret = sockopt_msg_recv(clt_fd, &msg);
-    if (unlikely(EDPVS_OK != ret)) {
-        close(clt_fd);
-        return ret;
+    return sockopt_msg_reply(clt, msg, ret, reply_data, reply_data_len);
+}
+
+/* read and serve pipelined requests, EDPVS_IO if the client is gone */
+static int sockopt_client_recv(struct sockopt_client *clt)
+{
+    int nreq = 0, ret;
+    ssize_t res;
+    size_t want;
+    char *buf;
+
+    while (nreq < SOCKOPT_REQS_PER_LOOP && clt->txq_len < SOCKOPT_TXQ_MAX) {
+        if (clt->rx_off < sizeof(clt->hdr)) {
+            buf = (char *)&clt->hdr + clt->rx_off;
+            want = sizeof(clt->hdr) - clt->rx_off;
+        } else if (clt->msg) {
+            buf = clt->msg->data + (clt->rx_off - sizeof(clt->hdr));
+            want = sizeof(clt->hdr) + clt->hdr.len - clt->rx_off;
+        } else {
+            buf = NULL;
+            want = 0;
+        }
+
+        if (want > 0) {
+            res = recv(clt->fd, buf, want, MSG_DONTWAIT);
+            if (res == 0)
+                return EDPVS_IO;
+            if (res < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                return EDPVS_IO;
+            }
+            clt->rx_off += res;
+            if ((size_t)res < want)
+                continue;
+        }
+
+        if (!clt->msg) { /* header done */
+            if (clt->hdr.len > SOCKOPT_MSG_LEN_MAX) {
+                RTE_LOG(WARNING, MSGMGR, "%s: sockopt msg#%d too large -- %zu\n",
+                        __func__, clt->hdr.id, clt->hdr.len);
+                return EDPVS_IO;
+            }
+            clt->msg = rte_malloc("sockopt_msg",
+                    sizeof(struct dpvs_sock_msg) + clt->hdr.len, RTE_CACHE_LINE_SIZE);
+            if (unlikely(!clt->msg)) {
+                RTE_LOG(ERR, MSGMGR, "%s: no memory\n", __func__);
+                return EDPVS_IO;
+            }
+            memcpy(clt->msg, &clt->hdr, sizeof(clt->hdr));
+            if (clt->hdr.len > 0)
+                continue;
+        }
+
+        /* request complete */
+        ret = sockopt_msg_process(clt, clt->msg);
+        sockopt_msg_free(clt->msg);
+        clt->msg = NULL;
+        clt->rx_off = 0;
+        if (ret != EDPVS_OK)
+            return EDPVS_IO;
+        nreq++;
     }
 
-    skopt = sockopts_get(msg);
-    if (skopt) {
-        if (msg->type == SOCKOPT_GET)
-            ret = skopt->get(msg->id, msg->data, msg->len, &reply_data, &reply_data_len);
-        else if (msg->type == SOCKOPT_SET)
-            ret = skopt->set(msg->id, msg->data, msg->len);
-        if (ret < 0) {
-            /* assume that reply_data is freed by user when callback fails */
-            reply_data = NULL;
-            reply_data_len = 0;
-#ifdef CONFIG_MSG_DEBUG
-            RTE_LOG(INFO, MSGMGR, "%s: socket msg<type=%s, id=%d> callback failed\n",
-                    __func__, msg->type == SOCKOPT_GET ? "GET" : "SET", msg->id);
-#endif
+    return EDPVS_OK;
+}
+
+/* write queued replies in order, EDPVS_IO if the client is gone */
+static int sockopt_client_send(struct sockopt_client *clt)
+{
+    struct sockopt_reply *reply;
+    size_t budget = SOCKOPT_TX_BUDGET;
+    const char *buf;
+    size_t want;
+    ssize_t res;
+
+    while (!list_empty(&clt->txq) && budget > 0) {
+        reply = list_first_entry(&clt->txq, struct sockopt_reply, list);
+        if (reply->off < sizeof(reply->hdr)) {
+            buf = (const char *)&reply->hdr + reply->off;
+            want = sizeof(reply->hdr) - reply->off;
+        } else {
+            buf = (const char *)reply->data + (reply->off - sizeof(reply->hdr));
+            want = reply->len - reply->off;
         }
+        want = RTE_MIN(want, budget);
 
-        memset(&reply_hdr, 0, sizeof(reply_hdr));
-        reply_hdr.version = SOCKOPT_VERSION;
-        reply_hdr.id = msg->id;
-        reply_hdr.type = msg->type;
-        reply_hdr.errcode = ret;
-        strncpy(reply_hdr.errstr, dpvs_strerror(ret), SOCKOPT_ERRSTR_LEN - 1);
-        reply_hdr.len = reply_data_len;
+        res = send(clt->fd, buf, want, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (res < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            RTE_LOG(WARNING, MSGMGR, "[%s:msg#%d] sockopt reply send error -- %s\n",
+                    __func__, reply->hdr.id, strerror(errno));
+            return EDPVS_IO;
+        }
+        reply->off += res;
+        budget -= res;
+
+        if (reply->off == reply->len) {
+            list_del(&reply->list);
+            clt->txq_len--;
+            if (reply->data)
+                rte_free(reply->data);
+            rte_free(reply);
+        }
+    }
 
-        /* send response */
-        ret = sockopt_msg_send(clt_fd, &reply_hdr, reply_data, reply_data_len);
+    return EDPVS_OK;
+}
 
-        if (reply_data)
-            rte_free(reply_data);
+static void sockopt_accept(void)
+{
+    int clt_fd, i;
+    struct sockopt_client *clt;
+    struct epoll_event ev;
+
+    for (i = 0; i < SOCKOPT_EVENTS_BURST; i++) {
+        if (sockopt_nb_clients >= sockopt_max_clients)
+            return; /* leave the rest in listen backlog */
+
+        /* Note: srv_fd is nonblock */
+        clt_fd = accept(srv_fd, NULL, NULL);
+        if (clt_fd < 0) {
+            if (EWOULDBLOCK != errno && EAGAIN != errno)
+                RTE_LOG(WARNING, MSGMGR, "%s: Fail to accept client request\n", __func__);
+            return;
+        }
+        if (-1 == fcntl(clt_fd, F_SETFL, fcntl(clt_fd, F_GETFL, 0) | O_NONBLOCK)) {
+            RTE_LOG(WARNING, MSGMGR, "%s: Fail to set client socket NONBLOCK\n", __func__);
+            close(clt_fd);
+            continue;
+        }
 
-        if (EDPVS_OK != ret) {
-            sockopt_msg_free(msg);
+        clt = rte_zmalloc("sockopt_client", sizeof(*clt), 0);
+        if (unlikely(!clt)) {
+            RTE_LOG(ERR, MSGMGR, "%s: no memory\n", __func__);
             close(clt_fd);
-            return ret;
+            return;
         }
+        clt->fd = clt_fd;
+        clt->events = EPOLLIN;
+        INIT_LIST_HEAD(&clt->txq);
+
+        memset(&ev, 0, sizeof(ev));
+        ev.events = clt->events;
+        ev.data.ptr = clt;
+        if (epoll_ctl(sockopt_epfd, EPOLL_CTL_ADD, clt_fd, &ev) < 0) {
+            RTE_LOG(WARNING, MSGMGR, "%s: fail to watch client -- %s\n",
+                    __func__, strerror(errno));
+            close(clt_fd);
+            rte_free(clt);
+            return;
+        }
+
+        list_add_tail(&clt->list, &sockopt_clients);
+        sockopt_nb_clients++;
     }
+}
 
-    sockopt_msg_free(msg);
-    close(clt_fd);
+static int sockopt_ctl(__rte_unused void *arg)
+{
+    int i, nev;
+    struct epoll_event evs[SOCKOPT_EVENTS_BURST];
+    struct sockopt_client *clt;
+
+    nev = epoll_wait(sockopt_epfd, evs, SOCKOPT_EVENTS_BURST, 0);
+    if (nev <= 0)
+        return nev < 0 && errno != EINTR ? EDPVS_IO : EDPVS_OK;
+
+    for (i = 0; i < nev; i++) {
+        clt = evs[i].data.ptr;
+        if (!clt) { /* listening socket */
+            sockopt_accept();
+            continue;
+        }
+
+        if ((evs[i].events & EPOLLIN) && sockopt_client_recv(clt) != EDPVS_OK) {
+            sockopt_client_close(clt);
+            continue;
+        }
+
+        if ((evs[i].events & (EPOLLERR | EPOLLHUP)) && !(evs[i].events & EPOLLIN)) {
+            sockopt_client_close(clt);
+            continue;
+        }
+
+        /* replies of new requests are tried at once */
+        if (sockopt_client_send(clt) != EDPVS_OK ||
+                sockopt_client_update_events(clt) != EDPVS_OK)
+            sockopt_client_close(clt);
+    }
 
     return EDPVS_OK;
 }
@@ -1421,10 +1833,13 @@ static struct dpvs_lcore_job sockopt_job = {
 static inline int sockopt_init(void)
 {
     struct sockaddr_un srv_addr;
+    struct epoll_event ev;
     int srv_fd_flags = 0;
     int err;
 
     INIT_LIST_HEAD(&sockopt_list);
+    INIT_LIST_HEAD(&sockopt_clients);
+    sockopt_nb_clients = 0;
 
     memset(ipc_unix_domain, 0, sizeof(ipc_unix_domain));
     strncpy(ipc_unix_domain, UNIX_DOMAIN_DEF, sizeof(ipc_unix_domain) - 1);
@@ -1454,16 +1869,36 @@ static inline int sockopt_init(void)
         return EDPVS_IO;
     }
 
-    if (-1 == listen(srv_fd, 1)) {
+    if (-1 == listen(srv_fd, SOCKOPT_EVENTS_BURST)) {
         RTE_LOG(ERR, MSGMGR, "%s: Server socket listen failed\n", __func__);
         close(srv_fd);
         unlink(ipc_unix_domain);
         return EDPVS_IO;
     }
 
+    sockopt_epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (sockopt_epfd < 0) {
+        RTE_LOG(ERR, MSGMGR, "%s: Fail to create epoll fd\n", __func__);
+        close(srv_fd);
+        unlink(ipc_unix_domain);
+        return EDPVS_IO;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(sockopt_epfd, EPOLL_CTL_ADD, srv_fd, &ev) < 0) {
+        RTE_LOG(ERR, MSGMGR, "%s: Fail to watch server socket\n", __func__);
+        close(sockopt_epfd);
+        close(srv_fd);
+        unlink(ipc_unix_domain);
+        return EDPVS_IO;
+    }
+
     snprintf(sockopt_job.name, sizeof(sockopt_job.name), "%s", "sockopt_job");
     if ((err = dpvs_lcore_job_register(&sockopt_job, LCORE_ROLE_MASTER)) != EDPVS_OK) {
         RTE_LOG(ERR, MSGMGR, "%s: Fail to register sockopt_job into master\n", __func__);
+        close(sockopt_epfd);
         close(srv_fd);
         unlink(ipc_unix_domain);
         return err;
@@ -1474,9 +1909,16 @@ static inline int sockopt_init(void)
 
 static inline int sockopt_term(void)
 {
+    struct sockopt_client *clt, *next;
+
+    dpvs_lcore_job_unregister(&sockopt_job, LCORE_ROLE_MASTER);
+
+    list_for_each_entry_safe(clt, next, &sockopt_clients, list)
+        sockopt_client_close(clt);
+
+    close(sockopt_epfd);
     close(srv_fd);
     unlink(ipc_unix_domain);
-    dpvs_lcore_job_unregister(&sockopt_job, LCORE_ROLE_MASTER);
 
     return EDPVS_OK;
 }
@@ -1498,12 +1940,18 @@ int ctrl_init(void)
         RTE_LOG(ERR, MSGMGR, "%s: sockopt module initialization failed!\n", __func__);
         return ret;
     }
+    ret = sockopt_register(&msg_sockopts);
+    if (unlikely(ret < 0)) {
+        RTE_LOG(ERR, MSGMGR, "%s: fail to register msg sockopts!\n", __func__);
+        return ret;
+    }
     return EDPVS_OK;
 }
 
 int ctrl_term(void)
 {
     int ret;
+    sockopt_unregister(&msg_sockopts);
     ret = msg_term();
     if (unlikely(ret < 0)) {
         RTE_LOG(ERR, MSGMGR, "%s: msg module initialization failed!\n", __func__);
@@ -1608,12 +2056,32 @@ static void ipc_unix_domain_handler(vector_t tokens)
     FREE_PTR(str);
 }
 
+static void ipc_max_clients_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int max_clients;
+
+    assert(str);
+    max_clients = atoi(str);
+    if (max_clients >= 1 && max_clients <= SOCKOPT_CLIENTS_MAX) {
+        RTE_LOG(INFO, MSGMGR, "ipc_max_clients = %d\n", max_clients);
+        sockopt_max_clients = max_clients;
+    } else {
+        RTE_LOG(WARNING, MSGMGR, "invalid ipc_max_clients %s, using default %d\n",
+                str, SOCKOPT_CLIENTS_DEF);
+        sockopt_max_clients = SOCKOPT_CLIENTS_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
 void control_keyword_value_init(void)
 {
     if (dpvs_state_get() == DPVS_STATE_INIT) {
         /* KW_TYPE_INIT keyword */
         msg_ring_size = DPVS_MSG_RING_SIZE_DEF;
         strncpy(ipc_unix_domain, UNIX_DOMAIN_DEF, sizeof(ipc_unix_domain) - 1);
+        sockopt_max_clients = SOCKOPT_CLIENTS_DEF;
     }
     /* KW_TYPE_NORMAL keyword */
     g_msg_timeout = MSG_TIMEOUT_US;
@@ -1632,5 +2100,6 @@ void install_control_keywords(void)
     install_keyword("ipc_msg", NULL, KW_TYPE_INIT);
     install_sublevel();
     install_keyword("unix_domain", ipc_unix_domain_handler, KW_TYPE_INIT);
+    install_keyword("max_clients", ipc_max_clients_handler, KW_TYPE_INIT);
     install_sublevel_end();
 }
@@ -23,6 +23,7 @@
 uint64_t g_cycles_per_sec;
 dpvs_lcore_role_t g_lcore_role[DPVS_MAX_LCORE];
 int g_lcore_index[DPVS_MAX_LCORE];
+RTE_DEFINE_PER_LCORE(uint64_t, g_rand_state);
 
 int global_data_init(void)
 {
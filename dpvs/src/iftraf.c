@@ -18,6 +18,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include "inet.h"
 #include "ipv4.h"
 #include "ipv6.h"
@@ -31,1054 +32,541 @@
 #define RTE_LOGTYPE_IFTRAF    RTE_LOGTYPE_USER1
 #endif
 
-#define IFTRAF_TOPN 20
-
-#define IFTRAF_RING_SIZE  1024
-#define IFTRAF_INTERVAL   1024
+/*
+ * every forwarded packet updates Count-Min sketches of its own lcore in
+ * place, one per view, and offers its key to small Space-Saving style
+ * candidate tables ranked by the sketch estimate. master merges the
+ * candidates of all lcores on demand and re-estimates each of them from
+ * the summed sketches.
+ *
+ * time is split into epochs of IFTRAF_WINDOW_SEC, each lcore keeps the
+ * current and the previous one. a query weights the previous epoch by
+ * the part of it still inside the sliding window.
+ */
+#define IFTRAF_CM_ROWS          4
+#define IFTRAF_CM_COLS          512     /* power of 2 */
+#define IFTRAF_CM_MASK          (IFTRAF_CM_COLS - 1)
+#define IFTRAF_CANDS            32
 
 #define IFTRAF_PKT_DIR_IN 0
 #define IFTRAF_PKT_DIR_OUT 1
 
-#define IFTRAF_TBL_BITS          12
-#define IFTRAF_TBL_SIZE          (1 << IFTRAF_TBL_BITS)
-#define IFTRAF_TBL_MASK          (IFTRAF_TBL_SIZE - 1)
-
-#define IFTRAF_IFTBL_BITS          10
-#define IFTRAF_IFTBL_SIZE          (1 << IFTRAF_IFTBL_BITS)
-#define IFTRAF_IFTBL_MASK          (IFTRAF_IFTBL_SIZE - 1)
-
-#define IFTRAF_HISTORY_LENGTH  30
-#define IFTRAF_TIME_INTERVAL 0x100000
-
-static int history_pos = 0;
-static int iftraf_ticket = 0;
 bool iftraf_disable = true;
 
-typedef struct sorted_list_node_tag {
-    struct sorted_list_node_tag* next;
-    void* data;
-} sorted_list_node;
-
-typedef struct {
-    sorted_list_node root;
-    int (*compare)(void*, void*);
-    int sorted_list_num;
-} sorted_list_type;
-
-sorted_list_type iftraf_sorted_list;
-sorted_list_type sorted_list[NETIF_MAX_PORTS];
-
-static struct list_head *iftraf_tbl;
-static struct list_head *iftraf_iftbl;
-
-static struct rte_ring *iftraf_ring[DPVS_MAX_LCORE];
-
-#define this_inpkts_count   (RTE_PER_LCORE(inpkts_count))
-#define this_outpkts_count  (RTE_PER_LCORE(outpkts_count))
-
-static RTE_DEFINE_PER_LCORE(uint32_t, inpkts_count);
-static RTE_DEFINE_PER_LCORE(uint32_t, outpkts_count);
-
-static uint32_t iftraf_tlb_rnd; /* hash random */
-
-typedef enum {
-    HASH_STATUS_OK,
-    HASH_STATUS_KEY_NOT_FOUND
-} hash_status_enum;
-
-struct iftraf_pkt {
-    uint8_t af;
-    uint8_t proto;
-    uint8_t dir;
-    lcoreid_t cid;
-    uint32_t pkt_len;
+struct iftraf_key {
     union inet_addr saddr;
     union inet_addr daddr;
-    uint16_t src_port;
-    uint16_t dst_port;
-    portid_t  devid;
-    char ifname[IFNAMSIZ];
-} __rte_cache_aligned;
-
-struct iftraf_entry {
-    struct list_head list;
-
+    uint16_t sport;
+    uint16_t dport;
     uint8_t af;
     uint8_t proto;
-    lcoreid_t cid;
-    portid_t devid;
-    char ifname[IFNAMSIZ];
+    portid_t devid;             /* real device, in the key of every view */
+} __attribute__((__packed__));
 
-    union inet_addr saddr;
-    union inet_addr daddr;
-    uint16_t sport;
-    uint16_t dport;
+struct iftraf_cell {
+    uint64_t bytes[2];          /* in, out */
+    uint32_t pkts[2];
+};
+
+/* heavy hitter candidates of one view, ranked by one metric */
+struct iftraf_cands {
+    uint32_t n;
+    uint32_t min;               /* index of the smallest estimate */
+    uint64_t hash[IFTRAF_CANDS];
+    uint64_t est[IFTRAF_CANDS];
+    struct iftraf_key keys[IFTRAF_CANDS];
+};
 
-    uint32_t recv[IFTRAF_HISTORY_LENGTH];
-    uint32_t sent[IFTRAF_HISTORY_LENGTH];
+struct iftraf_sketch {
+    struct iftraf_cell cm[IFTRAF_CM_ROWS][IFTRAF_CM_COLS];
+    struct iftraf_cands top[IFTRAF_SORT_MAX];
+};
 
-    uint32_t total_recv;
-    uint32_t total_sent;
-    int last_write;
+struct iftraf_epoch {
+    uint32_t epoch;
+    struct iftraf_sketch views[IFTRAF_VIEW_MAX];
+};
 
+/* written only by its lcore, read by master without locks */
+struct iftraf_lcore {
+    struct iftraf_epoch slots[2];   /* indexed by epoch & 1 */
 } __rte_cache_aligned;
 
+static struct iftraf_lcore *iftraf_lcores[DPVS_MAX_LCORE];
 
-static inline uint32_t iftraf_tlb_hashkey(int af,
-    const union inet_addr *saddr, uint16_t sport,
-    const union inet_addr *daddr, uint16_t dport)
-{
-    switch (af) {
-    case AF_INET:
-        return rte_jhash_3words((uint32_t)saddr->in.s_addr,
-                (uint32_t)daddr->in.s_addr,
-                ((uint32_t)sport) << 16 | (uint32_t)dport,
-                iftraf_tlb_rnd) & IFTRAF_TBL_MASK;
-
-    case AF_INET6:
-        {
-            uint32_t vect[9];
-
-            vect[0] = ((uint32_t)sport) << 16 | (uint32_t)dport;
-            memcpy(&vect[1], &saddr->in6, 16);
-            memcpy(&vect[5], &daddr->in6, 16);
-
-            return rte_jhash_32b(vect, 9, iftraf_tlb_rnd) & IFTRAF_TBL_MASK;
-        }
+/* advanced by master, epoch 0 is never used so zeroed slots are stale */
+static volatile uint32_t iftraf_epoch = 1;
+static uint64_t iftraf_epoch_start;
+static uint64_t iftraf_epoch_cycles;
 
-    default:
-        RTE_LOG(DEBUG, IFTRAF, "%s: hashing unsupported protocol %d\n", __func__, af);
-        return 0;
-    }
-}
+/* a merged candidate */
+struct iftraf_hitter {
+    struct iftraf_key key;
+    uint64_t hash;
+    portid_t devid;
+    lcoreid_t cid;
+    uint64_t bytes[2];
+    uint64_t pkts[2];
+};
 
-static hash_status_enum iftraf_entry_get(uint32_t hash, struct iftraf_pkt *param, struct iftraf_entry **out_entry)
+static inline void iftraf_cands_min(struct iftraf_cands *c)
 {
-    struct iftraf_entry *entry;
-
-    list_for_each_entry(entry, &iftraf_tbl[hash], list) {
-        if (entry->sport == param->src_port && entry->dport == param->dst_port
-            && inet_addr_equal(param->af, &entry->saddr, &param->saddr)
-            && inet_addr_equal(param->af, &entry->daddr, &param->daddr)
-            && entry->proto == param->proto
-            && entry->af == param->af) {
-            /* hit */
-            *out_entry = entry;
-            RTE_LOG(DEBUG, IFTRAF,
-                "%s: [hit]\n", __func__);
-            return HASH_STATUS_OK;
-        }
-    }
-    RTE_LOG(DEBUG, IFTRAF,
-        "%s: [not found]\n", __func__);
+    uint32_t i;
 
-    return HASH_STATUS_KEY_NOT_FOUND;
+    c->min = 0;
+    for (i = 1; i < c->n; i++) {
+        if (c->est[i] < c->est[c->min])
+            c->min = i;
+    }
 }
 
-
-static void history_rotate(void)
+static inline void iftraf_cands_offer(struct iftraf_cands *c,
+                                      const struct iftraf_key *key,
+                                      uint64_t hash, uint64_t est)
 {
-    uint32_t hash = 0;
-    struct iftraf_entry *entry, *nxt;
-    struct iftraf_entry *ifentry, *ifnxt;
-    history_pos = (history_pos + 1) % IFTRAF_HISTORY_LENGTH;
-
-    for(hash = 0; hash < IFTRAF_TBL_SIZE; hash++) {
-
-        list_for_each_entry_safe(entry, nxt, &iftraf_tbl[hash], list) {
-            /* no data in the last 20s */
-            if (entry->last_write == history_pos) {
-                list_del(&entry->list);
-                if (entry->af == AF_INET) {
-                    RTE_LOG(DEBUG, IFTRAF,
-                        "%s:[v4] [history_pos : %d, cid:%d, proto:%u, src:%08X, dst:%08X, sp:%u, dp:%u]\n",
-                        __func__, history_pos, entry->cid, entry->proto, entry->saddr.in.s_addr, entry->daddr.in.s_addr, entry->sport, entry->dport);
-                }
-                rte_free(entry);
-            } else {
-                entry->total_recv -= entry->recv[history_pos];
-                entry->total_sent -= entry->sent[history_pos];
-                entry->recv[history_pos] = 0;
-                entry->sent[history_pos] = 0;
-            }
-        }
-    }
-
-    for(hash = 0; hash < IFTRAF_IFTBL_SIZE; hash++) {
+    uint32_t i;
 
-        list_for_each_entry_safe(ifentry, ifnxt, &iftraf_iftbl[hash], list) {
+    if (c->n == IFTRAF_CANDS && est <= c->est[c->min])
+        return;
 
-            /* no data in the last 20s */
-            if (ifentry->last_write == history_pos) {
-                list_del(&ifentry->list);
-                if (ifentry->af == AF_INET) {
-                    RTE_LOG(DEBUG, IFTRAF,
-                        "%s:[v4] [history_pos : %d, cid:%d, proto:%u, src:%08X, dst:%08X, sp:%u, dp:%u]\n",
-                        __func__, history_pos, ifentry->cid, ifentry->proto, ifentry->saddr.in.s_addr, entry->daddr.in.s_addr, entry->sport, entry->dport);
-                }
-                rte_free(ifentry);
-            } else {
-                ifentry->total_recv -= ifentry->recv[history_pos];
-                ifentry->total_sent -= ifentry->sent[history_pos];
-                ifentry->recv[history_pos] = 0;
-                ifentry->sent[history_pos] = 0;
-            }
+    for (i = 0; i < c->n; i++) {
+        if (c->hash[i] == hash && !memcmp(&c->keys[i], key, sizeof(*key))) {
+            c->est[i] = est;
+            if (i == c->min)
+                iftraf_cands_min(c);
+            return;
         }
     }
-}
-
-static int iftraf_entry_compare(void* aa, void* bb)
-{
-    struct iftraf_entry * a = (struct iftraf_entry *)aa;
-    struct iftraf_entry * b = (struct iftraf_entry *)bb;
 
-    return (a->total_recv + a->total_sent) > (b->total_recv + b->total_sent);
+    /* evict the smallest, it can come back once it outgrows the others */
+    i = c->n < IFTRAF_CANDS ? c->n++ : c->min;
+    c->keys[i] = *key;
+    c->hash[i] = hash;
+    c->est[i] = est;
+    iftraf_cands_min(c);
 }
 
-static void sorted_list_initialise(sorted_list_type* list)
+static inline void iftraf_sketch_update(struct iftraf_sketch *sk,
+                                        const struct iftraf_key *key,
+                                        int dir, uint32_t len)
 {
-    list->root.next = NULL;
-    list->sorted_list_num = 0;
-    list->compare = &iftraf_entry_compare;
+    struct iftraf_cell *cell;
+    uint32_t h1 = 0, h2 = 0, r;
+    uint64_t bytes, est_bytes = UINT64_MAX;
+    uint32_t pkts, est_pkts = UINT32_MAX;
+
+    rte_jhash_2hashes(key, sizeof(*key), &h1, &h2);
+    h2 |= 1;
+
+    for (r = 0; r < IFTRAF_CM_ROWS; r++) {
+        cell = &sk->cm[r][(h1 + r * h2) & IFTRAF_CM_MASK];
+        cell->bytes[dir] += len;
+        cell->pkts[dir]++;
+
+        bytes = cell->bytes[0] + cell->bytes[1];
+        pkts = cell->pkts[0] + cell->pkts[1];
+        if (bytes < est_bytes)
+            est_bytes = bytes;
+        if (pkts < est_pkts)
+            est_pkts = pkts;
+    }
+
+    iftraf_cands_offer(&sk->top[IFTRAF_SORT_BYTES], key,
+                       (uint64_t)h1 << 32 | h2, est_bytes);
+    iftraf_cands_offer(&sk->top[IFTRAF_SORT_PKTS], key,
+                       (uint64_t)h1 << 32 | h2, est_pkts);
 }
 
-static void insert_top_list(struct iftraf_entry *entry, sorted_list_type *p_iftraf_sorted_list)
+static void iftraf_update(lcoreid_t cid, const struct iftraf_key *flow,
+                          int dir, uint32_t len)
 {
-    sorted_list_node *node, *p, *first;
-    struct iftraf_entry *data;
-
-    p = &(p_iftraf_sorted_list->root);
-
-    if (p_iftraf_sorted_list->sorted_list_num == IFTRAF_TOPN && p_iftraf_sorted_list->compare(p->next->data, entry)) {
-        struct iftraf_entry *firstentry = (struct iftraf_entry *)p->next->data;
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s: no need to insert[%u: %u, %u: %u]\n",
-             __func__, firstentry->total_recv, firstentry->total_sent, entry->total_recv, entry->total_sent);
+    struct iftraf_lcore *il = iftraf_lcores[cid];
+    struct iftraf_epoch *slot;
+    struct iftraf_key key;
+    uint32_t epoch = iftraf_epoch;
 
+    if (unlikely(!il))
         return;
-    }
 
-    while (p->next != NULL && p_iftraf_sorted_list->compare(entry, p->next->data) > 0) {
-        p = p->next;
+    slot = &il->slots[epoch & 1];
+    if (unlikely(slot->epoch != epoch)) {
+        memset(slot->views, 0, sizeof(slot->views));
+        rte_wmb();
+        slot->epoch = epoch;
     }
 
-    node = rte_zmalloc(NULL, sizeof(*node), RTE_CACHE_LINE_SIZE);
-    if (node == NULL) {
-        RTE_LOG(ERR, IFTRAF,
-            "%s: no memory\n", __func__);
-        return;
-    }
+    iftraf_sketch_update(&slot->views[IFTRAF_VIEW_FLOW], flow, dir, len);
 
-    node->next = p->next;
-    node->data = entry;
-    p->next = node;
-    RTE_LOG(DEBUG, IFTRAF,
-        "%s: [insert list]cid : %d, sp : %u, dp : %u, recv : %u, sent : %u\n",
-        __func__, entry->cid, ntohs(entry->sport), ntohs(entry->dport), entry->total_recv, entry->total_sent);
-    if(p_iftraf_sorted_list->sorted_list_num < IFTRAF_TOPN)
-        p_iftraf_sorted_list->sorted_list_num++;
-    else {
-        /* free the first node */
-        p = &(p_iftraf_sorted_list->root);
-        first = p->next;
-
-        data = (struct iftraf_entry *)first->data;
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s: [free first entry]cid : %d, sp : %u, dp : %u, recv : %u, sent : %u\n",
-             __func__, data->cid, ntohs(data->sport), ntohs(data->dport), data->total_recv, data->total_sent);
-        p->next = first->next;
+    memset(&key, 0, sizeof(key));
+    key.af = flow->af;
+    key.saddr = flow->saddr;
+    key.devid = flow->devid;
+    iftraf_sketch_update(&slot->views[IFTRAF_VIEW_SRC], &key, dir, len);
 
-        rte_free(first);
-    }
-}
-
-static void list_merge(void)
-{
-    sorted_list_type *list;
-    portid_t devid = 0;
-    sorted_list_node *node, *p, *pp;
-    uint32_t num = 0;
-
-    pp = &(iftraf_sorted_list.root);
-    for (devid = 0; devid < NETIF_MAX_PORTS; devid++) {
-
-        list = &sorted_list[devid];
-        p = &(list->root);
-        while (p->next != NULL && num < list->sorted_list_num) {
-            node = p->next;
-            p->next = node->next;
-
-            /*insert*/
-            node->next = pp->next;
-            pp->next = node;
-            iftraf_sorted_list.sorted_list_num++;
-
-            num++;
-        }
-        num = 0;
-        list->sorted_list_num = 0;
-    }
+    memset(&key, 0, sizeof(key));
+    key.af = flow->af;
+    key.proto = flow->proto;
+    key.daddr = flow->daddr;
+    key.dport = flow->dport;
+    key.devid = flow->devid;
+    iftraf_sketch_update(&slot->views[IFTRAF_VIEW_VIP], &key, dir, len);
 }
 
-static void iftraf_sort_top(portid_t port_id)
+static int iftraf_pkt_deliver(int af, struct rte_mbuf *mbuf, struct netif_port *dev, uint8_t dir)
 {
-    uint32_t hash = 0;
-    struct iftraf_entry *entry, *nxt;
-    struct iftraf_entry *ifentry, *ifnxt;
-
-    if (port_id == NETIF_MAX_PORTS) {
-        for (hash = 0; hash < IFTRAF_IFTBL_SIZE; hash++) {
-            list_for_each_entry_safe(ifentry, ifnxt, &iftraf_iftbl[hash], list) {
-                insert_top_list(ifentry, &sorted_list[ifentry->devid]);
-            }
-        }
+    struct iftraf_key flow;
+    __be16 _ports[2], *ports = NULL;
+    lcoreid_t cid = rte_lcore_id();
+    uint8_t proto;
+    int hdrlen;
 
-        list_merge();
+    memset(&flow, 0, sizeof(flow));
 
-    } else if (port_id < NETIF_MAX_PORTS) {
-        for (hash = 0; hash < IFTRAF_IFTBL_SIZE; hash++) {
-            list_for_each_entry_safe(ifentry, ifnxt, &iftraf_iftbl[hash], list) {
-                if (ifentry->devid == port_id) {
-                    RTE_LOG(DEBUG, IFTRAF,
-                        "%s: [devid : %u\n",
-                         __func__, port_id);
-                    insert_top_list(ifentry, &iftraf_sorted_list);
-                }
-            }
-        }
+    if (af == AF_INET) {
+        struct ipv4_hdr *ip4h = ip4_hdr(mbuf);
 
-    } else {
-        for(hash = 0; hash < IFTRAF_TBL_SIZE; hash++) {
-            list_for_each_entry_safe(entry, nxt, &iftraf_tbl[hash], list) {
-                insert_top_list(entry, &iftraf_sorted_list);
-            }
+        proto = ip4h->next_proto_id;
+        hdrlen = ip4_hdrlen(mbuf);
+        if (dir == IFTRAF_PKT_DIR_IN) {
+            flow.saddr.in.s_addr = ip4h->src_addr;
+            flow.daddr.in.s_addr = ip4h->dst_addr;
+        } else {
+            flow.saddr.in.s_addr = ip4h->dst_addr;
+            flow.daddr.in.s_addr = ip4h->src_addr;
         }
-    }
-}
-
-static void iftraf_addr_cpy(int af, union inet_addr *daddr, union inet_addr *saddr)
-{
-    if (af == AF_INET) {
-        daddr->in.s_addr = saddr->in.s_addr;
     } else if (af == AF_INET6) {
-        memcpy(daddr->in6.s6_addr, saddr->in6.s6_addr, 16);
-    } else {
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s: unsupported\n", __func__);
-    }
-}
-
-int iftraf_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
-                             void **out, size_t *outsize)
-{
-    struct iftraf_param_array *array;
-    sorted_list_node *node, *p;
-    struct iftraf_entry *entry;
-    uint32_t off;
-    struct netif_port *port = NULL;
-    const struct dp_vs_iftraf_conf *cf;
-    portid_t port_id = UINT16_MAX;
-
-    if (iftraf_disable) {
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s: iftraf disable\n",  __func__);
-        return EDPVS_OK;
-    }
-
-    if (!conf || size < sizeof(struct dp_vs_iftraf_conf) || !out || !outsize)
-        return EDPVS_INVAL;
-	cf = conf;
-
-    if (cf && strlen(cf->ifname)) {
-        port = netif_port_get_by_name(cf->ifname);
-        port_id = (port != NULL ) ? port->id : NETIF_MAX_PORTS;
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s: ifname : %s, id = %d\n", __func__, cf->ifname, port_id);
-    }
-
-    /* sort iftraf */
-    iftraf_sort_top(port_id);
-
-    RTE_LOG(DEBUG, IFTRAF,
-        "%s: sorted_list_num = %d\n", __func__, iftraf_sorted_list.sorted_list_num);
-
-    *outsize = sizeof(struct iftraf_param_array) + \
-               iftraf_sorted_list.sorted_list_num * sizeof(struct iftraf_param);
-    *out = rte_calloc(NULL, 1, *outsize, RTE_CACHE_LINE_SIZE);
-    if (!(*out)) {
-	RTE_LOG(ERR, IFTRAF, "%s: no memory \n", __func__);
-        return EDPVS_NOMEM;
-    }
+        struct ip6_hdr *ip6h = ip6_hdr(mbuf);
 
-    array = *out;
-    array->ntrafs = iftraf_sorted_list.sorted_list_num;
-    off = 0;
-
-    p = &(iftraf_sorted_list.root);
-    while (p->next != NULL && off < iftraf_sorted_list.sorted_list_num) {
-        node = p->next;
-        p->next = node->next;
-
-        entry = (struct iftraf_entry *)node->data;
-        array->iftraf[off].af = entry->af;
-        array->iftraf[off].proto = entry->proto;
-        array->iftraf[off].cid = entry->cid;
-        iftraf_addr_cpy(entry->af, &array->iftraf[off].saddr, &entry->saddr);
-        iftraf_addr_cpy(entry->af, &array->iftraf[off].daddr, &entry->daddr);
-        array->iftraf[off].sport = entry->sport;
-        array->iftraf[off].dport = entry->dport;
-        array->iftraf[off].total_recv = entry->total_recv;
-        array->iftraf[off].total_sent = entry->total_sent;
-        strcpy(array->iftraf[off].ifname, entry->ifname);
-
-        if (AF_INET == entry->af) {
-            RTE_LOG(DEBUG, IFTRAF,"%s: sip = %s, sport = %u, dip = %s, dport = %u\n",
-                __func__, inet_ntoa(array->iftraf[off].saddr.in), ntohs(entry->sport), inet_ntoa(array->iftraf[off].daddr.in), ntohs(entry->dport));
-        } else if (AF_INET6 == entry->af) {
-            char src_addr[INET6_ADDRSTRLEN];
-            char dst_addr[INET6_ADDRSTRLEN];
-
-            inet_ntop(AF_INET6, &entry->saddr.in6, src_addr, INET6_ADDRSTRLEN);
-            inet_ntop(AF_INET6, &entry->daddr.in6, dst_addr, INET6_ADDRSTRLEN);
-
-            RTE_LOG(DEBUG, IFTRAF,"%s: sip = %s sport = %u, dip = %s, dport = %u\n",
-                __func__, src_addr, ntohs(entry->sport), dst_addr, ntohs(entry->dport));
+        proto = ip6h->ip6_nxt;
+        hdrlen = ip6_hdrlen(mbuf);
+        if (dir == IFTRAF_PKT_DIR_IN) {
+            flow.saddr.in6 = ip6h->ip6_src;
+            flow.daddr.in6 = ip6h->ip6_dst;
         } else {
-            RTE_LOG(DEBUG, IFTRAF, "%s: unsupported\n", __func__);
+            flow.saddr.in6 = ip6h->ip6_dst;
+            flow.daddr.in6 = ip6h->ip6_src;
         }
-
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s: off : %u, cid : %d, proto: %u, total_recv: %u,  total_sent : %u\n",
-            __func__, off, entry->cid, entry->proto, array->iftraf[off].total_recv, array->iftraf[off].total_sent);
-
-        rte_free(node);
-
-        off++;
+    } else {
+        return EDPVS_INVPKT;
     }
 
-    iftraf_sorted_list.sorted_list_num = 0;
-    return EDPVS_OK;
-}
-
-static void inline iftraf_tlb_add(struct iftraf_pkt *param)
-{
-    uint32_t hash;
-    struct iftraf_entry *entry = NULL;
-
-    hash = iftraf_tlb_hashkey(param->af, &param->saddr, param->src_port, &param->daddr,
-               param->dst_port);
-
-    if (iftraf_entry_get(hash, param, &entry) == HASH_STATUS_KEY_NOT_FOUND) {
-
-        entry = rte_zmalloc(NULL, sizeof(struct iftraf_entry), RTE_CACHE_LINE_SIZE);
-        if (entry == NULL) {
-            RTE_LOG(ERR, IFTRAF,
-                "%s: no memory\n", __func__);
-            return;
-        }
-
-        memset(entry, 0, sizeof(struct iftraf_entry));
-        entry->af = param->af;
-        entry->cid = param->cid;
-        entry->devid = param->devid;
-        entry->proto = param->proto;
-        iftraf_addr_cpy(param->af, &entry->saddr, &param->saddr);
-        iftraf_addr_cpy(param->af, &entry->daddr, &param->daddr);
-        entry->sport = param->src_port;
-        entry->dport = param->dst_port;
-        strcpy(entry->ifname, param->ifname);
-
-        list_add(&entry->list, &iftraf_tbl[hash]);
+    /* other protocols are counted with zero ports */
+    if (proto == IPPROTO_TCP || proto == IPPROTO_UDP) {
+        ports = mbuf_header_pointer(mbuf, hdrlen, sizeof(_ports), _ports);
+        if (unlikely(!ports))
+            return EDPVS_INVPKT;
+        flow.sport = dir == IFTRAF_PKT_DIR_IN ? ports[0] : ports[1];
+        flow.dport = dir == IFTRAF_PKT_DIR_IN ? ports[1] : ports[0];
     }
 
-    if (param->af == AF_INET) {
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s:[v4] dequeue iftraf_ring[cid:%d, proto:%u, src:%08X, dst:%08X, sp:%u, dp:%u, len:%u]\n",
-            __func__, entry->cid, entry->proto, entry->saddr.in.s_addr,
-            entry->daddr.in.s_addr, ntohs(entry->sport), ntohs(entry->dport), param->pkt_len);
+    flow.af = af;
+    flow.proto = proto;
+    if (dev->type == PORT_TYPE_VLAN) {
+        struct vlan_dev_priv *vlan = netif_priv(dev);
+        flow.devid = vlan->real_dev->id;
     } else {
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s:[v6] dequeue iftraf_ring[cid:%d, dir:%d, proto:%u, src:%08X %08X %08X %08X, dst:%08X %08X %08X %08X, sp:%u, dp:%u, len:%u]\n",
-            __func__, entry->cid, param->dir, entry->proto,
-            entry->saddr.in6.s6_addr32[0], entry->saddr.in6.s6_addr32[1],
-            entry->saddr.in6.s6_addr32[2], entry->saddr.in6.s6_addr32[3],
-            entry->daddr.in6.s6_addr32[0],entry->daddr.in6.s6_addr32[1],
-            entry->daddr.in6.s6_addr32[2],entry->daddr.in6.s6_addr32[3],
-            ntohs(entry->sport), ntohs(entry->dport), param->pkt_len);
-	}
-
-    /* Update record */
-    entry->last_write = history_pos;
-    if (param->dir == IFTRAF_PKT_DIR_IN) {
-        entry->recv[history_pos] += param->pkt_len;
-        entry->total_recv += param->pkt_len;
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s: history_pos: %d, recv : %u, total_recv : %u\n", __func__, history_pos, entry->recv[history_pos], entry->total_recv);
+        flow.devid = mbuf->port;
+    }
 
-    } else {
-        entry->sent[history_pos] += param->pkt_len;
-        entry->total_sent += param->pkt_len;
+    iftraf_update(cid, &flow, dir, mbuf->pkt_len);
 
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s: history_pos: %d: sent : %u, total_sent: %u\n", __func__, history_pos, entry->sent[history_pos], entry->total_sent);
-    }
+    return EDPVS_OK;
 }
 
-static inline unsigned iftraf_byif_hashkey(int af,
-					const union inet_addr *addr,
-					portid_t  devid)
+int iftraf_pkt_in(int af, struct rte_mbuf *mbuf, struct netif_port *dev)
 {
-    uint32_t addr_fold;
-
-    addr_fold = inet_addr_fold(af, addr);
-
-    if (!addr_fold) {
-        RTE_LOG(DEBUG, IFTRAF, "%s: IP proto not support.\n", __func__);
-        return 0;
+    if (likely(iftraf_disable)) {
+        return EDPVS_OK;
     }
 
-    return (ntohl(addr_fold) ^ (devid >> IFTRAF_IFTBL_BITS) ^ devid)
-        & IFTRAF_IFTBL_MASK;
+    return iftraf_pkt_deliver(af, mbuf, dev, IFTRAF_PKT_DIR_IN);
 }
 
-static hash_status_enum iftraf_ifentry_get(uint32_t hash, struct iftraf_pkt *param, struct iftraf_entry **out_entry)
+int iftraf_pkt_out(int af, struct rte_mbuf *mbuf, struct netif_port *dev)
 {
-    struct iftraf_entry *entry;
-
-    list_for_each_entry(entry, &iftraf_iftbl[hash], list) {
-        if (inet_addr_equal(param->af, &entry->saddr, &param->saddr)
-            && entry->devid == param->devid
-            && entry->af == param->af) {
-            /* hit */
-            *out_entry = entry;
-            RTE_LOG(DEBUG, IFTRAF,
-                "%s: [hit]\n", __func__);
-            return HASH_STATUS_OK;
-        }
+    if (likely(iftraf_disable)) {
+        return EDPVS_OK;
     }
-    RTE_LOG(DEBUG, IFTRAF,
-        "%s: [not found]\n", __func__);
 
-    return HASH_STATUS_KEY_NOT_FOUND;
+    return iftraf_pkt_deliver(af, mbuf, dev, IFTRAF_PKT_DIR_OUT);
 }
 
-static void inline iftraf_iftlb_add(struct iftraf_pkt *param)
+static void iftraf_epoch_rotate(void *dummy)
 {
-    uint32_t hash;
-    struct iftraf_entry *entry = NULL;
-
-    hash = iftraf_byif_hashkey(param->af, &param->saddr, param->devid);
+    uint64_t now;
 
-    if (iftraf_ifentry_get(hash, param, &entry) == HASH_STATUS_KEY_NOT_FOUND) {
-
-        entry = rte_zmalloc(NULL, sizeof(struct iftraf_entry), RTE_CACHE_LINE_SIZE);
-        if (entry == NULL) {
-            RTE_LOG(ERR, IFTRAF,
-                "%s: no memory\n", __func__);
-            return;
-        }
-
-        memset(entry, 0, sizeof(struct iftraf_entry));
-        entry->af = param->af;
-        entry->cid = param->cid;
-        entry->devid = param->devid;
-        entry->proto = 0;//param->proto;
-        iftraf_addr_cpy(param->af, &entry->saddr, &param->saddr);
-        iftraf_addr_cpy(param->af, &entry->daddr, &param->daddr);
-        entry->sport = 0;//param->src_port;
-        entry->dport = 0;//param->dst_port;
-        strcpy(entry->ifname, param->ifname);
-
-        list_add(&entry->list, &iftraf_iftbl[hash]);
-    }
-
-    if (param->af == AF_INET) {
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s:[v4] dequeue iftraf_ring[cid:%d, proto:%u, devid:%u, ifname:%s,src:%08X, dst:%08X, sp:%u, dp:%u, len:%u]\n",
-            __func__, entry->cid, entry->proto, entry->devid, entry->ifname, entry->saddr.in.s_addr,
-            entry->daddr.in.s_addr, ntohs(entry->sport), ntohs(entry->dport), param->pkt_len);
-    } else {
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s:[v6] dequeue iftraf_ring[cid:%d, dir:%d, proto:%u, devid:%u,  src:%08X %08X %08X %08X, dst:%08X %08X %08X %08X, sp:%u, dp:%u, len:%u]\n",
-            __func__, entry->cid, param->dir, entry->proto, entry->devid,
-            entry->saddr.in6.s6_addr32[0], entry->saddr.in6.s6_addr32[1],
-            entry->saddr.in6.s6_addr32[2], entry->saddr.in6.s6_addr32[3],
-            entry->daddr.in6.s6_addr32[0],entry->daddr.in6.s6_addr32[1],
-            entry->daddr.in6.s6_addr32[2],entry->daddr.in6.s6_addr32[3],
-            ntohs(entry->sport), ntohs(entry->dport), param->pkt_len);
-    }
-
-    /* Update record */
-    entry->last_write = history_pos;
-    if (param->dir == IFTRAF_PKT_DIR_IN) {
-        entry->recv[history_pos] += param->pkt_len;
-        entry->total_recv += param->pkt_len;
-        RTE_LOG(DEBUG, IFTRAF,
-        "%s: history_pos: %d, recv : %u, total_recv : %u\n", __func__, history_pos, entry->recv[history_pos], entry->total_recv);
-
-    } else {
-        entry->sent[history_pos] += param->pkt_len;
-        entry->total_sent += param->pkt_len;
+    if (likely(iftraf_disable))
+        return;
 
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s: history_pos: %d: sent : %u, total_sent: %u\n", __func__, history_pos, entry->sent[history_pos], entry->total_sent);
+    now = rte_get_timer_cycles();
+    if (now - iftraf_epoch_start >= iftraf_epoch_cycles) {
+        iftraf_epoch_start = now;
+        iftraf_epoch++;
+        if (unlikely(!iftraf_epoch))
+            iftraf_epoch = 1;
     }
 }
 
-
-static void iftraf_process_ring(void *dummy)
+/* sum the Count-Min estimate of a key over all lcores and both epochs */
+static void iftraf_estimate(struct iftraf_hitter *hit, int view,
+                            uint32_t epoch, double prev_weight)
 {
-    int i;
-    uint16_t nb_rb;
+    const struct iftraf_epoch *slot;
+    const struct iftraf_cell *cell;
+    uint64_t bytes[2], pkts[2];
+    uint32_t h1 = hit->hash >> 32, h2 = (uint32_t)hit->hash;
+    double weight;
     lcoreid_t cid;
-    struct iftraf_pkt *param;
-    struct iftraf_pkt *params[NETIF_MAX_PKT_BURST];
-
-    if (likely(iftraf_disable)) {
-        return;
-    }
-
-    iftraf_ticket++;
-    if(iftraf_ticket % IFTRAF_TIME_INTERVAL == 0) {
-        history_rotate();
-        iftraf_ticket = 0;
-    }
+    int e, r, d;
 
     for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
-        if (!rte_lcore_is_enabled(cid)) {
+        if (!iftraf_lcores[cid])
             continue;
-        }
-
-        nb_rb = rte_ring_dequeue_burst(iftraf_ring[cid], (void **)params,
-                    NETIF_MAX_PKT_BURST, NULL);
-
-        if (nb_rb > 0) {
-            for (i = 0; i < nb_rb; i++) {
-                param = params[i];
 
-                /* insert into iftraf table */
-                iftraf_tlb_add(param);
+        for (e = 0; e < 2; e++) {
+            slot = &iftraf_lcores[cid]->slots[(epoch - e) & 1];
+            if (slot->epoch != epoch - e)
+                continue;
+            weight = e ? prev_weight : 1.0;
+
+            bytes[0] = bytes[1] = UINT64_MAX;
+            pkts[0] = pkts[1] = UINT64_MAX;
+            for (r = 0; r < IFTRAF_CM_ROWS; r++) {
+                cell = &slot->views[view].cm[r][(h1 + r * h2) & IFTRAF_CM_MASK];
+                for (d = 0; d < 2; d++) {
+                    bytes[d] = RTE_MIN(bytes[d], cell->bytes[d]);
+                    pkts[d] = RTE_MIN(pkts[d], (uint64_t)cell->pkts[d]);
+                }
+            }
 
-                /* insert into iftraf table by if && source ip */
-                iftraf_iftlb_add(param);
-           }
+            for (d = 0; d < 2; d++) {
+                hit->bytes[d] += (uint64_t)(bytes[d] * weight);
+                hit->pkts[d] += (uint64_t)(pkts[d] * weight);
+            }
         }
     }
 }
 
-static int iftraf_pkt_deliver(int af, struct rte_mbuf *mbuf, struct netif_port *dev, uint8_t dir)
+static int iftraf_hitter_cmp_key(const void *a, const void *b)
 {
-    int ret;
-    struct iftraf_pkt *pkt;
-    __be16 _ports[2], *ports;
-    lcoreid_t cid = rte_lcore_id();
-    portid_t devid;
-
-    if (af == AF_INET) {
-        struct ipv4_hdr *ip4h = ip4_hdr(mbuf);
-
-        if (unlikely(ip4h->next_proto_id != IPPROTO_TCP &&
-            ip4h->next_proto_id != IPPROTO_UDP)) {
-            RTE_LOG(DEBUG, IFTRAF,
-                "%s: unspported proto[core: %d, proto: %d]\n",
-                __func__, cid, ip4h->next_proto_id);
-            return EDPVS_NOPROT;
-        }
-
-        ports = mbuf_header_pointer(mbuf, ip4_hdrlen(mbuf), sizeof(_ports), _ports);
-        if (!ports) {
-            RTE_LOG(ERR, IFTRAF,
-                "%s: invalid pkt[%d, %d]\n",
-                __func__, cid, dir);
-            return EDPVS_INVPKT;
-        }
-
-        pkt = rte_zmalloc("iftraf_inpkt", sizeof(struct iftraf_pkt), RTE_CACHE_LINE_SIZE);
-        if (pkt == NULL) {
-            RTE_LOG(ERR, IFTRAF,
-                "%s: no memory[%d, %d]\n",
-                __func__, cid, dir);
-            return EDPVS_NOMEM;
-        }
-
-        if (dev->type == PORT_TYPE_VLAN) {
-            struct vlan_dev_priv *vlan = netif_priv(dev);
-            struct netif_port *real_dev = vlan->real_dev;
-            RTE_LOG(DEBUG, IFTRAF, "%s: id = %u, ifname = %s, type=%d\n",
-                __func__, real_dev->id,real_dev->name,real_dev->type);
-            devid = real_dev->id;
-            strcpy(pkt->ifname, real_dev->name);
-        } else {
-            devid = mbuf->port;
-            strcpy(pkt->ifname, dev->name);
-        }
-
-        pkt->devid = devid;
-        pkt->af = AF_INET;
-        pkt->cid = cid;
-        pkt->dir = dir;
-        pkt->proto = ip4h->next_proto_id;
-        if (dir == IFTRAF_PKT_DIR_IN) {
-            pkt->saddr.in.s_addr = ip4h->src_addr;
-            pkt->daddr.in.s_addr = ip4h->dst_addr;
-            pkt->src_port = ports[0];
-            pkt->dst_port = ports[1];
-        } else {
-            pkt->saddr.in.s_addr = ip4h->dst_addr;
-            pkt->daddr.in.s_addr = ip4h->src_addr;
-            pkt->src_port = ports[1];
-            pkt->dst_port = ports[0];
-        }
-
-        pkt->pkt_len = mbuf->pkt_len;
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s:[v4] enqueued to iftraf_ring[cid:%d, dir:%d, devid:%u, ifname:%s, proto:%u, src:%08X, dst:%08X, sp:%u, dp:%u, len:%u]\n",
-            __func__, cid, dir, pkt->devid, pkt->ifname, pkt->proto, ip4h->src_addr, ip4h->dst_addr, ntohs(pkt->src_port), ntohs(pkt->dst_port), pkt->pkt_len);
-
-    } else if (af == AF_INET6) {
-        struct ip6_hdr *ip6h = ip6_hdr(mbuf);
-        uint8_t ip6nxt = ip6h->ip6_nxt;
-
-        if (unlikely(ip6nxt != IPPROTO_TCP &&
-            ip6nxt != IPPROTO_UDP)) {
-            RTE_LOG(DEBUG, IFTRAF,
-                "%s: unspported proto[core: %d, proto: %d]\n",
-                __func__, cid, ip6nxt);
-            return EDPVS_NOPROT;
-        }
-
-        ports = mbuf_header_pointer(mbuf, ip6_hdrlen(mbuf), sizeof(_ports), _ports);
-        if (!ports) {
-            RTE_LOG(ERR, IFTRAF,
-                "%s: invalid pkt[%d, %d]\n",
-                __func__, cid, dir);
-            return EDPVS_INVPKT;
-        }
-
-        pkt = rte_zmalloc("iftraf_inpkt", sizeof(struct iftraf_pkt), RTE_CACHE_LINE_SIZE);
-        if (pkt == NULL) {
-            RTE_LOG(ERR, IFTRAF,
-                "%s: no memory[%d, %d]\n",
-                __func__, cid, dir);
-            return EDPVS_NOMEM;
-        }
-
-        if (dev->type == PORT_TYPE_VLAN) {
-            struct vlan_dev_priv *vlan = netif_priv(dev);
-            struct netif_port *real_dev = vlan->real_dev;
-            RTE_LOG(DEBUG, IFTRAF, "%s: id = %u, ifname = %s, type=%d\n",
-                __func__, real_dev->id,real_dev->name,real_dev->type);
-            devid = real_dev->id;
-            strcpy(pkt->ifname, real_dev->name);
-        } else {
-            devid = mbuf->port;
-            strcpy(pkt->ifname, dev->name);
-        }
+    const struct iftraf_hitter *ha = a, *hb = b;
 
-        pkt->af = AF_INET6;
-        pkt->devid = devid;
-        pkt->cid = cid;
-        pkt->dir = dir;
-        pkt->proto = ip6nxt;
-        if (dir == IFTRAF_PKT_DIR_IN) {
-            pkt->saddr.in6 = ip6h->ip6_src;
-            pkt->daddr.in6 = ip6h->ip6_dst;
-            pkt->src_port = ports[0];
-            pkt->dst_port = ports[1];
-        } else {
-            pkt->saddr.in6 = ip6h->ip6_dst;
-            pkt->daddr.in6 = ip6h->ip6_src;
-            pkt->src_port = ports[1];
-            pkt->dst_port = ports[0];
-        }
-        pkt->pkt_len = mbuf->pkt_len;
-
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s:[v6] enqueued to iftraf_ring[cid:%d, dir:%d, devid:%u,  proto:%u, src:%08X %08X %08X %08X, dst:%08X %08X %08X %08X, sp:%u, dp:%u, len:%u]\n",
-            __func__, cid, dir, pkt->devid, pkt->proto,
-            pkt->saddr.in6.s6_addr32[0], pkt->saddr.in6.s6_addr32[1],
-            pkt->saddr.in6.s6_addr32[2], pkt->saddr.in6.s6_addr32[3],
-            pkt->daddr.in6.s6_addr32[0],pkt->daddr.in6.s6_addr32[1],
-            pkt->daddr.in6.s6_addr32[2],pkt->daddr.in6.s6_addr32[3],
-            ntohs(pkt->src_port), ntohs(pkt->dst_port), pkt->pkt_len);
-    } else {
-        return EDPVS_INVPKT;
-    }
-
-    ret = rte_ring_enqueue(iftraf_ring[cid], pkt);
-    if (ret < 0) {
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s: failed to enqueue iftraf_ring[%d]\n",
-            __func__, cid);
-        rte_free(pkt);
-        return EDPVS_DROP;
-    }
-
-    return EDPVS_OK;
+    if (ha->hash != hb->hash)
+        return ha->hash < hb->hash ? -1 : 1;
+    return memcmp(&ha->key, &hb->key, sizeof(ha->key));
 }
 
-int iftraf_pkt_in(int af, struct rte_mbuf *mbuf, struct netif_port *dev)
+static int iftraf_hitter_cmp_bytes(const void *a, const void *b)
 {
-    if (likely(iftraf_disable)) {
-        return EDPVS_OK;
-    }
+    const struct iftraf_hitter *ha = a, *hb = b;
+    uint64_t va = ha->bytes[0] + ha->bytes[1];
+    uint64_t vb = hb->bytes[0] + hb->bytes[1];
 
-    this_inpkts_count++;
-    if (this_inpkts_count % IFTRAF_INTERVAL == 0) {
-        iftraf_pkt_deliver(af, mbuf, dev, IFTRAF_PKT_DIR_IN);
-    }
-
-    return EDPVS_OK;
+    return va == vb ? 0 : (va < vb ? 1 : -1);
 }
 
-int iftraf_pkt_out(int af, struct rte_mbuf *mbuf, struct netif_port *dev)
+static int iftraf_hitter_cmp_pkts(const void *a, const void *b)
 {
-    if (likely(iftraf_disable)) {
-        return EDPVS_OK;
-    }
-
-    this_outpkts_count++;
-    if (this_outpkts_count % IFTRAF_INTERVAL == 0) {
-        iftraf_pkt_deliver(af, mbuf, dev, IFTRAF_PKT_DIR_OUT);
-    }
+    const struct iftraf_hitter *ha = a, *hb = b;
+    uint64_t va = ha->pkts[0] + ha->pkts[1];
+    uint64_t vb = hb->pkts[0] + hb->pkts[1];
 
-    return EDPVS_OK;
+    return va == vb ? 0 : (va < vb ? 1 : -1);
 }
 
-
 /*
- * master core allocates iftraf rings with the other lcores espectively.
+ * union of the candidates of all lcores, deduplicated. every key holds
+ * its device, so the estimates of a hitter kept for @port_id are of that
+ * device only.
  */
-static int iftraf_ring_create(void)
+static int iftraf_collect(struct iftraf_hitter *hits, int view, int sort,
+                          uint32_t epoch, portid_t port_id)
 {
-    char name_buf[RTE_RING_NAMESIZE];
-    int socket_id;
-    lcoreid_t cid, ccid;
-
-    socket_id = rte_socket_id();
+    const struct iftraf_epoch *slot;
+    const struct iftraf_cands *c;
+    lcoreid_t cid;
+    uint32_t i;
+    int e, n = 0, m;
 
     for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
-        if (!rte_lcore_is_enabled(cid)) {
+        if (!iftraf_lcores[cid])
             continue;
-        }
-
-        snprintf(name_buf, RTE_RING_NAMESIZE,
-            "iftraf_ring[%d]", cid);
 
-        iftraf_ring[cid] =
-            rte_ring_create(name_buf, IFTRAF_RING_SIZE, socket_id,
-                            RING_F_SP_ENQ | RING_F_SC_DEQ);
-
-        if (!iftraf_ring[cid]) {
-            RTE_LOG(ERR, IFTRAF,
-                "%s: failed to create iftraf_ring[%d]\n",
-                 __func__, cid);
-            for (ccid = 0; ccid < cid; ccid++) {
-                if (iftraf_ring[ccid])
-                    rte_ring_free(iftraf_ring[ccid]);
+        for (e = 0; e < 2; e++) {
+            slot = &iftraf_lcores[cid]->slots[(epoch - e) & 1];
+            if (slot->epoch != epoch - e)
+                continue;
+
+            c = &slot->views[view].top[sort];
+            for (i = 0; i < c->n && i < IFTRAF_CANDS; i++) {
+                if (port_id < NETIF_MAX_PORTS && c->keys[i].devid != port_id)
+                    continue;
+                memset(&hits[n], 0, sizeof(hits[n]));
+                hits[n].key = c->keys[i];
+                hits[n].hash = c->hash[i];
+                hits[n].devid = c->keys[i].devid;
+                hits[n].cid = cid;
+                n++;
             }
-            return EDPVS_NOMEM;
         }
+    }
 
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s: success to create iftraf_ring[%d]\n",
-            __func__, cid);
+    if (n <= 1)
+        return n;
+
+    qsort(hits, n, sizeof(*hits), iftraf_hitter_cmp_key);
+    for (m = 0, e = 1; e < n; e++) {
+        if (iftraf_hitter_cmp_key(&hits[m], &hits[e]))
+            hits[++m] = hits[e];
     }
 
-    return EDPVS_OK;
+    return m + 1;
 }
 
-static int iftraf_enable_func(void)
+int iftraf_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
+                             void **out, size_t *outsize)
 {
-    int i;
-    int err;
-    lcoreid_t cid;
+    struct iftraf_param_array *array;
+    struct iftraf_param *param;
+    struct iftraf_hitter *hits;
+    struct netif_port *port;
+    const struct dp_vs_iftraf_conf *cf;
+    portid_t port_id = NETIF_MAX_PORTS;
+    uint32_t epoch;
+    uint64_t elapsed;
+    double prev_weight;
+    int i, n, topn, max_hits;
 
-    if (iftraf_disable == false) {
+    if (iftraf_disable) {
+        RTE_LOG(DEBUG, IFTRAF,
+            "%s: iftraf disable\n",  __func__);
         return EDPVS_OK;
     }
 
-    err = iftraf_ring_create();
-    if (err != EDPVS_OK) {
-        return err;
-    }
+    if (!conf || size < sizeof(struct dp_vs_iftraf_conf) || !out || !outsize)
+        return EDPVS_INVAL;
+    cf = conf;
 
-    iftraf_tbl = rte_malloc_socket(NULL, sizeof(struct list_head) * IFTRAF_TBL_SIZE,
-                    RTE_CACHE_LINE_SIZE, rte_socket_id());
+    if (cf->view >= IFTRAF_VIEW_MAX || cf->sort >= IFTRAF_SORT_MAX ||
+            cf->topn > IFTRAF_TOPN_MAX)
+        return EDPVS_INVAL;
+    topn = cf->topn ? cf->topn : IFTRAF_TOPN_DEF;
 
-    if (!iftraf_tbl) {
-        RTE_LOG(ERR, IFTRAF,
-            "%s: rte_malloc_socket null\n",
-            __func__);
-        goto tbl_fail;
+    if (strlen(cf->ifname) && strcmp(cf->ifname, "all")) {
+        port = netif_port_get_by_name(cf->ifname);
+        if (!port)
+            return EDPVS_NOTEXIST;
+        if (port->type == PORT_TYPE_VLAN)
+            port = ((struct vlan_dev_priv *)netif_priv(port))->real_dev;
+        port_id = port->id;
     }
 
-    for (i = 0; i < IFTRAF_TBL_SIZE; i++)
-        INIT_LIST_HEAD(&iftraf_tbl[i]);
-
-    iftraf_iftbl = rte_malloc_socket(NULL, sizeof(struct list_head) * IFTRAF_IFTBL_SIZE,
-                      RTE_CACHE_LINE_SIZE, rte_socket_id());
+    epoch = iftraf_epoch;
+    elapsed = rte_get_timer_cycles() - iftraf_epoch_start;
+    prev_weight = elapsed >= iftraf_epoch_cycles ? 0.0 :
+                  1.0 - (double)elapsed / iftraf_epoch_cycles;
 
-    if (!iftraf_iftbl) {
-        RTE_LOG(ERR, IFTRAF,
-            "%s: rte_malloc_socket null\n",
-            __func__);
-        goto iftbl_fail;
-    }
+    max_hits = rte_lcore_count() * 2 * IFTRAF_CANDS;
+    hits = rte_malloc(NULL, max_hits * sizeof(*hits), 0);
+    if (!hits)
+        return EDPVS_NOMEM;
 
-    for (i = 0; i < IFTRAF_IFTBL_SIZE; i++)
-        INIT_LIST_HEAD(&iftraf_iftbl[i]);
+    n = iftraf_collect(hits, cf->view, cf->sort, epoch, port_id);
+    for (i = 0; i < n; i++)
+        iftraf_estimate(&hits[i], cf->view, epoch, prev_weight);
+    qsort(hits, n, sizeof(*hits), cf->sort == IFTRAF_SORT_PKTS ?
+          iftraf_hitter_cmp_pkts : iftraf_hitter_cmp_bytes);
+    if (n > topn)
+        n = topn;
 
-    iftraf_disable = false;
-    RTE_LOG(INFO, IFTRAF,
-        "%s: %s\n", __func__, "iftraf enabled");
+    *outsize = sizeof(struct iftraf_param_array) + n * sizeof(struct iftraf_param);
+    *out = rte_calloc(NULL, 1, *outsize, RTE_CACHE_LINE_SIZE);
+    if (!(*out)) {
+        RTE_LOG(ERR, IFTRAF, "%s: no memory \n", __func__);
+        rte_free(hits);
+        return EDPVS_NOMEM;
+    }
 
+    array = *out;
+    array->ntrafs = n;
+    for (i = 0; i < n; i++) {
+        param = &array->iftraf[i];
+        param->af = hits[i].key.af;
+        param->proto = hits[i].key.proto;
+        param->cid = hits[i].cid;
+        param->devid = hits[i].devid;
+        port = netif_port_get(hits[i].devid);
+        if (port)
+            snprintf(param->ifname, sizeof(param->ifname), "%s", port->name);
+        param->saddr = hits[i].key.saddr;
+        param->daddr = hits[i].key.daddr;
+        param->sport = hits[i].key.sport;
+        param->dport = hits[i].key.dport;
+        param->total_recv = hits[i].bytes[IFTRAF_PKT_DIR_IN];
+        param->total_sent = hits[i].bytes[IFTRAF_PKT_DIR_OUT];
+        param->pkts_recv = hits[i].pkts[IFTRAF_PKT_DIR_IN];
+        param->pkts_sent = hits[i].pkts[IFTRAF_PKT_DIR_OUT];
+    }
+
+    rte_free(hits);
     return EDPVS_OK;
-
-iftbl_fail:
-    if (iftraf_tbl)
-        rte_free(iftraf_tbl);
-
-tbl_fail:
-    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
-        if (!rte_lcore_is_enabled(cid)) {
-            continue;
-        }
-        if (iftraf_ring[cid])
-            rte_ring_free(iftraf_ring[cid]);
-        }
-
-    return EDPVS_NOMEM;
 }
 
-static void iftraf_variable_reset(void)
-{
-    history_pos = 0;
-    this_inpkts_count = 0;
-    this_outpkts_count = 0;
-}
-
-static void iftraf_ring_free(void)
-{
-    lcoreid_t cid;
-
-    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
-        if (!rte_lcore_is_enabled(cid)) {
-             continue;
-        }
-        if (iftraf_ring[cid]) {
-            rte_ring_free(iftraf_ring[cid]);
-        }
-
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s: iftraf_ring free[%d]\n",
-            __func__, cid);
-    }
-}
-
-
-static int iftraf_disable_func(void)
+/*
+ * sketches stay allocated until iftraf_term once enabled, so that
+ * workers still inside iftraf_update never touch freed memory. nor are
+ * they cleared here under those workers: the epoch skips two values, so
+ * both slots of every lcore are stale and get reset by their own lcore.
+ */
+static int iftraf_enable_func(void)
 {
-    uint32_t hash;
-    int i;
-    uint16_t nb_rb;
     lcoreid_t cid;
-    struct iftraf_pkt *param;
-    struct iftraf_pkt *params[NETIF_MAX_PKT_BURST];
-    struct iftraf_entry *entry, *nxt;
-    int count = 0;
 
-    if (iftraf_disable == true) {
+    if (iftraf_disable == false) {
         return EDPVS_OK;
     }
 
-    iftraf_disable = true;
-
-    /* dequeue iftraf ring and free elements */
     for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
-        if (!rte_lcore_is_enabled(cid)) {
+        if (!rte_lcore_is_enabled(cid) || iftraf_lcores[cid])
             continue;
-        }
-
-        nb_rb = rte_ring_dequeue_burst(iftraf_ring[cid], (void **)params,
-                    NETIF_MAX_PKT_BURST, NULL);
-
-        while (nb_rb > 0) {
-            count += nb_rb;
-            for (i = 0; i < nb_rb; i++) {
-                param = params[i];
-                rte_free(param);
-            }
 
-            nb_rb = rte_ring_dequeue_burst(iftraf_ring[cid], (void **)params,
-                        NETIF_MAX_PKT_BURST, NULL);
+        iftraf_lcores[cid] = rte_zmalloc_socket("iftraf_lcore",
+                                sizeof(struct iftraf_lcore), RTE_CACHE_LINE_SIZE,
+                                rte_lcore_to_socket_id(cid));
+        if (!iftraf_lcores[cid]) {
+            RTE_LOG(ERR, IFTRAF,
+                "%s: no memory for lcore %d sketches\n", __func__, cid);
+            return EDPVS_NOMEM;
         }
-
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s: iftraf ring[%d] free [%d] pkts\n",
-            __func__, cid, count);
-
-        count = 0;
-
     }
 
-    /* free iftraf ring */
-    iftraf_ring_free();
-
-    /* free tlb */
-    if (iftraf_tbl) {
-        count = 0;
-        /* delete and free all entry added to iftraf_tbl */
-        for(hash = 0; hash < IFTRAF_TBL_SIZE; hash++) {
-            list_for_each_entry_safe(entry, nxt, &iftraf_tbl[hash], list) {
-                list_del(&entry->list);
-                rte_free(entry);
-                count++;
-            }
-        }
+    iftraf_epoch_cycles = IFTRAF_WINDOW_SEC * rte_get_timer_hz();
+    iftraf_epoch_start = rte_get_timer_cycles();
+    iftraf_epoch += 2;
+    if (unlikely(iftraf_epoch < 2))
+        iftraf_epoch = 2;
+    rte_wmb();
 
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s: iftraf_tbl free [%d]\n",
-            __func__, count);
-
-        rte_free(iftraf_tbl);
-    }
-
-    /* free tlb */
-    if (iftraf_iftbl) {
-        count = 0;
-        /* delete and free all entry added to iftraf_tbl */
-        for(hash = 0; hash < IFTRAF_IFTBL_SIZE; hash++) {
-            list_for_each_entry_safe(entry, nxt, &iftraf_iftbl[hash], list) {
-                list_del(&entry->list);
-                rte_free(entry);
-                count++;
-            }
-        }
+    iftraf_disable = false;
+    RTE_LOG(INFO, IFTRAF,
+        "%s: %s\n", __func__, "iftraf enabled");
 
-        RTE_LOG(DEBUG, IFTRAF,
-            "%s: iftraf_iftbl free [%d]\n",
-            __func__, count);
+    return EDPVS_OK;
+}
 
-        rte_free(iftraf_iftbl);
+static int iftraf_disable_func(void)
+{
+    if (iftraf_disable == true) {
+        return EDPVS_OK;
     }
 
-    iftraf_variable_reset();
+    iftraf_disable = true;
     RTE_LOG(INFO, IFTRAF,
         "%s: %s\n", __func__, "iftraf disabled");
 
     return EDPVS_OK;
 }
 
-static void iftraf_sorted_list_init(void) {
-    portid_t devid = 0;
-    sorted_list_initialise(&iftraf_sorted_list);
-
-    for (devid = 0; devid < NETIF_MAX_PORTS; devid++) {
-        sorted_list_initialise(&sorted_list[devid]);
-    }
-}
-
 static int iftraf_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
 {
      switch (opt) {
@@ -1104,7 +592,7 @@ static struct dpvs_sockopts iftraf_sockopts = {
 };
 
 static struct dpvs_lcore_job iftraf_job = {
-    .func = iftraf_process_ring,
+    .func = iftraf_epoch_rotate,
     .data = NULL,
     .type = LCORE_JOB_LOOP,
 };
@@ -1115,11 +603,7 @@ int iftraf_init(void)
 
     iftraf_disable = true;
 
-    iftraf_tlb_rnd = (uint32_t)random();
-
-    iftraf_sorted_list_init();
-
-    snprintf(iftraf_job.name, sizeof(iftraf_job.name), "%s", "iftraf_ring_proc");
+    snprintf(iftraf_job.name, sizeof(iftraf_job.name), "%s", "iftraf_epoch");
     if ((err = dpvs_lcore_job_register(&iftraf_job, LCORE_ROLE_MASTER)) != EDPVS_OK)
         return err;
 
@@ -1134,6 +618,7 @@ int iftraf_init(void)
 int iftraf_term(void)
 {
     int err;
+    lcoreid_t cid;
 
     err = sockopt_unregister(&iftraf_sockopts);
     if (err != EDPVS_OK)
@@ -1145,5 +630,10 @@ int iftraf_term(void)
 
     dpvs_lcore_job_unregister(&iftraf_job, LCORE_ROLE_MASTER);
 
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        rte_free(iftraf_lcores[cid]);
+        iftraf_lcores[cid] = NULL;
+    }
+
     return EDPVS_OK;
 }
@@ -0,0 +1,246 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/*
+ * per-service anomaly counters, see ipvs/attack.h.
+ *
+ * every lcore counts into its own copy of the service, the history is a
+ * ring of per-second slots indexed by the second of the TSC, so copies
+ * of all lcores line up when merged by the sockopt on master.
+ */
+#include <assert.h>
+#include "dpdk.h"
+#include "conf/common.h"
+#include "global_data.h"
+#include "ctrl.h"
+#include "ipvs/ipvs.h"
+#include "ipvs/service.h"
+#include "ipvs/attack.h"
+
+void __dp_vs_attack_tick(struct dp_vs_attack *atk)
+{
+    uint64_t hz = rte_get_timer_hz();
+    uint32_t sec = rte_get_timer_cycles() / hz;
+    uint32_t i, n;
+
+    /* clear the slots of the seconds passed by, all on first use */
+    n = atk->tick ? sec - atk->st.sec : DP_VS_ATTACK_HIST;
+    if (n > DP_VS_ATTACK_HIST)
+        n = DP_VS_ATTACK_HIST;
+    for (i = 0; i < n; i++)
+        memset(atk->st.hist[(sec - i) % DP_VS_ATTACK_HIST], 0,
+               sizeof(atk->st.hist[0]));
+
+    atk->st.sec = sec;
+    atk->slot = sec % DP_VS_ATTACK_HIST;
+    atk->tick = (uint64_t)(sec + 1) * hz;
+}
+
+void dp_vs_attack_blklst(const struct dp_vs_iphdr *iph, uint16_t vport)
+{
+    struct dp_vs_service *svc;
+
+    svc = dp_vs_service_lookup(iph->af, iph->proto, &iph->daddr, vport,
+                               0, NULL, NULL, NULL, rte_lcore_id());
+    if (svc)
+        dp_vs_attack_inc(&svc->attack, DP_VS_ATTACK_BLKLST);
+}
+
+static struct dp_vs_service *
+attack_service(const struct dp_vs_get_attack *get, lcoreid_t cid)
+{
+    struct dp_vs_service_entry entry;
+
+    memset(&entry, 0, sizeof(entry));
+    entry.af      = get->af;
+    entry.proto   = get->proto;
+    entry.addr    = get->addr;
+    entry.port    = get->port;
+    entry.fwmark  = get->fwmark;
+    rte_memcpy(entry.srange, get->srange, sizeof(get->srange));
+    rte_memcpy(entry.drange, get->drange, sizeof(get->drange));
+    rte_memcpy(entry.iifname, get->iifname, sizeof(get->iifname));
+    rte_memcpy(entry.oifname, get->oifname, sizeof(get->oifname));
+
+    return dp_vs_get_service_lcore(&entry, cid);
+}
+
+static int attack_get_msg_cb(struct dpvs_msg *msg)
+{
+    struct dp_vs_get_attack *get, *output;
+    struct dp_vs_service *svc;
+    lcoreid_t cid = rte_lcore_id();
+
+    assert(msg);
+
+    if (msg->len != sizeof(*get))
+        return EDPVS_INVAL;
+    get = (struct dp_vs_get_attack *)msg->data;
+
+    svc = attack_service(get, cid);
+    if (!svc)
+        return EDPVS_NOTEXIST;
+
+    /* slots of an idle service are stale until the next packet */
+    if (rte_get_timer_cycles() >= svc->attack.tick)
+        __dp_vs_attack_tick(&svc->attack);
+
+    output = msg_reply_alloc(sizeof(*output));
+    if (!output)
+        return EDPVS_NOMEM;
+
+    rte_memcpy(output, get, sizeof(*get));
+    output->cid = cid;
+    rte_memcpy(&output->stats, &svc->attack.st, sizeof(output->stats));
+
+    msg->reply.len = sizeof(*output);
+    msg->reply.data = (void *)output;
+    return EDPVS_OK;
+}
+
+/* add @src to @dst, slots of seconds @dst has not got are left out */
+static void attack_stats_add(struct dp_vs_attack_stats *dst,
+                             const struct dp_vs_attack_stats *src)
+{
+    uint32_t i, s;
+    int k;
+
+    for (k = 0; k < DP_VS_ATTACK_MAX; k++)
+        dst->total[k] += src->total[k];
+
+    for (i = 0; i < DP_VS_ATTACK_HIST; i++) {
+        s = src->sec - i;
+        if (dst->sec - s >= DP_VS_ATTACK_HIST)
+            break;
+        for (k = 0; k < DP_VS_ATTACK_MAX; k++)
+            dst->hist[s % DP_VS_ATTACK_HIST][k] +=
+                src->hist[s % DP_VS_ATTACK_HIST][k];
+    }
+}
+
+static int attack_sockopt_get(sockoptid_t opt, const void *conf,
+                              size_t size, void **out, size_t *outsize)
+{
+    const struct dp_vs_get_attack *get = conf;
+    struct dp_vs_get_attack *get_msg, *output;
+    struct dpvs_msg *msg, *cur;
+    struct dpvs_multicast_queue *reply = NULL;
+    bool found = false;
+    lcoreid_t cid;
+    uint32_t sec = 0;
+    int err;
+
+    if (!conf || size != sizeof(*get) || !out || !outsize)
+        return EDPVS_INVAL;
+    if (get->cid >= DPVS_MAX_LCORE)
+        return EDPVS_INVAL;
+    cid = g_lcore_index[get->cid];
+
+    msg = msg_make(MSG_TYPE_SVC_GET_ATTACK, 0, DPVS_MSG_MULTICAST,
+                   rte_lcore_id(), sizeof(*get), get);
+    if (!msg)
+        return EDPVS_NOMEM;
+
+    err = multicast_msg_send(msg, 0, &reply);
+    if (err != EDPVS_OK) {
+        msg_destroy(&msg);
+        RTE_LOG(ERR, SERVICE, "%s: send message fail.\n", __func__);
+        return err == EDPVS_MSG_FAIL ? EDPVS_NOTEXIST : err;
+    }
+
+    /* lcores may be a second apart, line them up on the latest */
+    list_for_each_entry(cur, &reply->mq, mq_node) {
+        get_msg = (struct dp_vs_get_attack *)cur->data;
+        /* master forwards nothing, a single lcore or all slaves */
+        if (cid != rte_get_master_lcore() && get_msg->cid != cid)
+            continue;
+        if (!found || (int32_t)(get_msg->stats.sec - sec) > 0)
+            sec = get_msg->stats.sec;
+        found = true;
+    }
+    if (!found) {
+        msg_destroy(&msg);
+        return EDPVS_NOTEXIST;
+    }
+
+    output = rte_zmalloc("get_attack", sizeof(*output), 0);
+    if (!output) {
+        msg_destroy(&msg);
+        return EDPVS_NOMEM;
+    }
+    rte_memcpy(output, get, sizeof(*get));
+    output->stats.sec = sec;
+
+    list_for_each_entry(cur, &reply->mq, mq_node) {
+        get_msg = (struct dp_vs_get_attack *)cur->data;
+        if (cid != rte_get_master_lcore() && get_msg->cid != cid)
+            continue;
+        attack_stats_add(&output->stats, &get_msg->stats);
+    }
+    msg_destroy(&msg);
+
+    output->cid = get->cid;
+    *out = output;
+    *outsize = sizeof(*output);
+    return EDPVS_OK;
+}
+
+static struct dpvs_sockopts attack_sockopts = {
+    .version            = SOCKOPT_VERSION,
+    .set_opt_min        = 0,
+    .set_opt_max        = 0,
+    .set                = NULL,
+    .get_opt_min        = SOCKOPT_GET_SVC_ATTACK,
+    .get_opt_max        = SOCKOPT_GET_SVC_ATTACK,
+    .get                = attack_sockopt_get,
+};
+
+static struct dpvs_msg_type attack_msg_type;
+
+int dp_vs_attack_init(void)
+{
+    int err;
+
+    memset(&attack_msg_type, 0, sizeof(struct dpvs_msg_type));
+    attack_msg_type.type   = MSG_TYPE_SVC_GET_ATTACK;
+    attack_msg_type.mode   = DPVS_MSG_MULTICAST;
+    attack_msg_type.prio   = MSG_PRIO_LOW;
+    attack_msg_type.cid    = rte_lcore_id();
+    attack_msg_type.unicast_msg_cb = attack_get_msg_cb;
+    err = msg_type_mc_register(&attack_msg_type);
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, SERVICE, "%s: fail to register msg.\n", __func__);
+        return err;
+    }
+
+    err = sockopt_register(&attack_sockopts);
+    if (err != EDPVS_OK) {
+        msg_type_mc_unregister(&attack_msg_type);
+        return err;
+    }
+
+    return EDPVS_OK;
+}
+
+int dp_vs_attack_term(void)
+{
+    int err;
+
+    err = sockopt_unregister(&attack_sockopts);
+    msg_type_mc_unregister(&attack_msg_type);
+    return err;
+}
@@ -17,199 +17,864 @@
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <netinet/in.h>
+#include <netinet/ip6.h>
+#include <rte_acl.h>
 #include "dpdk.h"
 #include "list.h"
 #include "conf/common.h"
 #include "netif.h"
 #include "inet.h"
 #include "ctrl.h"
+#include "scheduler.h"
 #include "ipvs/ipvs.h"
 #include "ipvs/service.h"
 #include "ipvs/blklst.h"
+#include "ipvs/hwdrop.h"
 #include "conf/blklst.h"
+#include "parser/parser.h"
 
 /**
- *  * per-lcore config for blklst ip
- *   */
-
+ * rules are kept on master only. they are compiled into librte_acl
+ * contexts off the data path, by a master job once changes settle, and
+ * the new contexts are handed to every lcore with a multicast msg. the
+ * old ones are freed after all lcores switched.
+ *
+ * denies are counted per rule and per lcore in the compiled set, and
+ * added to the rules listed when the set is retired.
+ */
 
 #define DPVS_BLKLST_TAB_BITS      16
 #define DPVS_BLKLST_TAB_SIZE      (1 << DPVS_BLKLST_TAB_BITS)
 #define DPVS_BLKLST_TAB_MASK      (DPVS_BLKLST_TAB_SIZE - 1)
 
-#define this_blklst_tab           (RTE_PER_LCORE(dp_vs_blklst_tab))
-#define this_num_blklsts         (RTE_PER_LCORE(num_blklsts))
+/* rebuild once rules stay unchanged for BUILD_DELAY, or at the latest
+ * BUILD_MAX after the first change, so bulk loads compile once */
+#define DPVS_BLKLST_BUILD_DELAY_MS  50
+#define DPVS_BLKLST_BUILD_MAX_MS    1000
+
+/* userdata of ACL rules, classification gives 0 if nothing matches.
+ * above the action bits is the rule index + 1, for the hit counters,
+ * 0 for the implicit deny of services with allow rules */
+#define BLKLST_ACL_ALLOW          1
+#define BLKLST_ACL_DENY           2
+#define BLKLST_ACL_RULE_SHIFT     2
+
+/* early drops skip the service lookup, so the attack counters of
+ * services miss them (DP_VS_ATTACK_BLKLST) */
+#define DPVS_BLKLST_EARLY_DROP_DEF  false
+
+#define BLKLST_BURST              64
+
+struct blklst_entry {
+    struct list_head    list;
+    int                 af;
+    union inet_addr     vaddr;
+    uint16_t            vport;
+    uint8_t             proto;
+    union inet_addr     blklst;     /* masked to plen */
+    uint8_t             plen;
+    uint8_t             action;
+    uint8_t             tcp_flags;  /* masked to tcp_flags_mask */
+    uint8_t             tcp_flags_mask;
+    uint64_t            hits;       /* of the sets retired */
+    uint32_t            acl_gen;    /* set compiled in, 0 for none yet */
+    uint32_t            acl_idx;    /* and index there */
+};
+
+struct blklst_acl {
+    struct rte_acl_ctx  *ctx4;
+    struct rte_acl_ctx  *ctx6;
+    uint32_t            gen;
+    uint32_t            nrules;
+    uint32_t            n4;         /* IPv4 rules first */
+    struct dp_vs_blklst_conf *rules;
+    uint64_t            *hits[DPVS_MAX_LCORE];  /* per lcore, per rule */
+    struct list_head    list;       /* on blklst_acl_retired */
+};
+
+enum {
+    BLKLST_FIELD_PROTO,
+    BLKLST_FIELD_VADDR,
+    BLKLST_FIELD_SADDR = BLKLST_FIELD_VADDR + 4,
+    BLKLST_FIELD_VPORT = BLKLST_FIELD_SADDR + 4,
+    BLKLST_FIELD_FLAGS,
+    BLKLST_FIELDS_V6,
+    BLKLST_FIELDS_V4 = BLKLST_FIELDS_V6 - 6,
+};
+
+RTE_ACL_RULE_DEF(blklst_acl_rule, BLKLST_FIELDS_V6);
+
+#define BLKLST_KEY_OFF(f)   offsetof(struct dp_vs_blklst_key, f)
+
+/* an input group is 4 bytes, vport is paired with the TCP flags and
+ * the zero byte after them */
+static const struct rte_acl_field_def blklst_defs_v4[BLKLST_FIELDS_V4] = {
+    { RTE_ACL_FIELD_TYPE_BITMASK, 1, 0, 0, BLKLST_KEY_OFF(proto) },
+    { RTE_ACL_FIELD_TYPE_MASK,    4, 1, 1, BLKLST_KEY_OFF(vaddr) },
+    { RTE_ACL_FIELD_TYPE_MASK,    4, 2, 2, BLKLST_KEY_OFF(saddr) },
+    { RTE_ACL_FIELD_TYPE_RANGE,   2, 3, 3, BLKLST_KEY_OFF(vport) },
+    { RTE_ACL_FIELD_TYPE_BITMASK, 2, 4, 3, BLKLST_KEY_OFF(tcp_flags) },
+};
+
+static const struct rte_acl_field_def blklst_defs_v6[BLKLST_FIELDS_V6] = {
+    { RTE_ACL_FIELD_TYPE_BITMASK, 1, 0,  0, BLKLST_KEY_OFF(proto) },
+    { RTE_ACL_FIELD_TYPE_MASK,    4, 1,  1, BLKLST_KEY_OFF(vaddr) },
+    { RTE_ACL_FIELD_TYPE_MASK,    4, 2,  2, BLKLST_KEY_OFF(vaddr) + 4 },
+    { RTE_ACL_FIELD_TYPE_MASK,    4, 3,  3, BLKLST_KEY_OFF(vaddr) + 8 },
+    { RTE_ACL_FIELD_TYPE_MASK,    4, 4,  4, BLKLST_KEY_OFF(vaddr) + 12 },
+    { RTE_ACL_FIELD_TYPE_MASK,    4, 5,  5, BLKLST_KEY_OFF(saddr) },
+    { RTE_ACL_FIELD_TYPE_MASK,    4, 6,  6, BLKLST_KEY_OFF(saddr) + 4 },
+    { RTE_ACL_FIELD_TYPE_MASK,    4, 7,  7, BLKLST_KEY_OFF(saddr) + 8 },
+    { RTE_ACL_FIELD_TYPE_MASK,    4, 8,  8, BLKLST_KEY_OFF(saddr) + 12 },
+    { RTE_ACL_FIELD_TYPE_RANGE,   2, 9,  9, BLKLST_KEY_OFF(vport) },
+    { RTE_ACL_FIELD_TYPE_BITMASK, 2, 10, 9, BLKLST_KEY_OFF(tcp_flags) },
+};
+
+#define this_blklst_acl           (RTE_PER_LCORE(dp_vs_blklst_acl))
+
+static RTE_DEFINE_PER_LCORE(struct blklst_acl *, dp_vs_blklst_acl);
+
+static bool dp_vs_blklst_ctrl_early_drop = DPVS_BLKLST_EARLY_DROP_DEF;
 
-static RTE_DEFINE_PER_LCORE(struct list_head *, dp_vs_blklst_tab);
-static RTE_DEFINE_PER_LCORE(rte_atomic32_t, num_blklsts);
+/* master only */
+static struct list_head *dp_vs_blklst_tab;
 
+/* ACLs some slave may still classify with, see blklst_acl_swap() */
+static LIST_HEAD(blklst_acl_retired);
+static uint32_t dp_vs_num_blklsts;
 static uint32_t dp_vs_blklst_rnd;
+static uint32_t dp_vs_blklst_gen;
+static bool dp_vs_blklst_dirty;
+static uint64_t dp_vs_blklst_dirty_since;
+static uint64_t dp_vs_blklst_changed;
 
-static inline uint32_t blklst_hashkey(const union inet_addr *vaddr,
-                                     const union inet_addr *blklst)
+static inline uint8_t blklst_host_plen(int af)
 {
-    /* jhash hurts performance, we do not use rte_jhash_2words here */
-    return ((rte_be_to_cpu_32(vaddr->in.s_addr) * 31
-                + rte_be_to_cpu_32(blklst->in.s_addr)) * 31
+    return af == AF_INET6 ? 128 : 32;
+}
+
+static inline uint32_t blklst_addr_fold(int af, const union inet_addr *addr)
+{
+    if (af == AF_INET6)
+        return addr->in6.s6_addr32[0] ^ addr->in6.s6_addr32[1] ^
+               addr->in6.s6_addr32[2] ^ addr->in6.s6_addr32[3];
+    return addr->in.s_addr;
+}
+
+static inline uint32_t blklst_hashkey(int af, const union inet_addr *vaddr,
+                                      const union inet_addr *blklst)
+{
+    return ((rte_be_to_cpu_32(blklst_addr_fold(af, vaddr)) * 31
+                + rte_be_to_cpu_32(blklst_addr_fold(af, blklst))) * 31
                 + dp_vs_blklst_rnd) & DPVS_BLKLST_TAB_MASK;
 }
 
-struct blklst_entry *dp_vs_blklst_lookup(uint8_t proto, const union inet_addr *vaddr,
-                                         uint16_t vport, const union inet_addr *blklst)
+static inline void blklst_key_fill(struct dp_vs_blklst_key *key, int af,
+                                   uint8_t proto, const union inet_addr *vaddr,
+                                   uint16_t vport, const union inet_addr *saddr,
+                                   uint8_t tcp_flags)
 {
-    unsigned hashkey;
-    struct blklst_entry *blklst_node;
+    memset(key, 0, sizeof(*key));
+    key->proto = proto;
+    key->vport = vport;
+    key->tcp_flags = proto == IPPROTO_TCP ? tcp_flags : 0;
+    if (af == AF_INET6) {
+        key->vaddr.in6 = vaddr->in6;
+        key->saddr.in6 = saddr->in6;
+    } else {
+        key->vaddr.in = vaddr->in;
+        key->saddr.in = saddr->in;
+    }
+}
+
+/* whether classification result @res of @key denies, counting the
+ * rule's hit and the packet for hwdrop */
+static inline bool blklst_acl_deny(const struct blklst_acl *acl, int af,
+                                   const struct dp_vs_blklst_key *key,
+                                   uint32_t res)
+{
+    uint32_t rule = res >> BLKLST_ACL_RULE_SHIFT;
+    uint64_t *hits;
+
+    if (!(res & BLKLST_ACL_DENY))
+        return false;
+
+    hits = acl->hits[rte_lcore_id()];
+    if (rule && hits)
+        hits[(af == AF_INET6 ? acl->n4 : 0) + rule - 1]++;
+    dp_vs_hwdrop_count(af, &key->saddr, &key->vaddr);
+    return true;
+}
+
+bool dp_vs_blklst_lookup(int af, uint8_t proto, const union inet_addr *vaddr,
+                         uint16_t vport, const union inet_addr *saddr,
+                         uint8_t tcp_flags)
+{
+    struct blklst_acl *acl = this_blklst_acl;
+    struct rte_acl_ctx *ctx;
+    struct dp_vs_blklst_key key;
+    const uint8_t *data[1];
+    uint32_t res = 0;
+
+    if (likely(!acl))
+        return false;
+    ctx = af == AF_INET6 ? acl->ctx6 : acl->ctx4;
+    if (!ctx)
+        return false;
+
+    blklst_key_fill(&key, af, proto, vaddr, vport, saddr, tcp_flags);
+    data[0] = (const uint8_t *)&key;
+    rte_acl_classify(ctx, data, &res, 1, 1);
+
+    return blklst_acl_deny(acl, af, &key, res);
+}
 
-    hashkey = blklst_hashkey(vaddr, blklst);
-    list_for_each_entry(blklst_node, &this_blklst_tab[hashkey], list){
-        if (blklst_node->vaddr.in.s_addr == vaddr->in.s_addr &&
-            blklst_node->blklst.in.s_addr == blklst->in.s_addr &&
-            blklst_node->proto == proto &&
-            blklst_node->vport == vport)
-            return blklst_node;
+void dp_vs_blklst_lookup_burst(int af, const struct dp_vs_blklst_key **keys,
+                               bool *drop, unsigned int n)
+{
+    struct blklst_acl *acl = this_blklst_acl;
+    struct rte_acl_ctx *ctx = NULL;
+    uint32_t res[BLKLST_BURST];
+    unsigned int i, cnt;
+
+    if (acl)
+        ctx = af == AF_INET6 ? acl->ctx6 : acl->ctx4;
+    if (!ctx) {
+        memset(drop, 0, n * sizeof(*drop));
+        return;
+    }
+
+    while (n > 0) {
+        cnt = RTE_MIN(n, (unsigned int)BLKLST_BURST);
+        rte_acl_classify(ctx, (const uint8_t **)keys, res, cnt, 1);
+        for (i = 0; i < cnt; i++)
+            drop[i] = blklst_acl_deny(acl, af, keys[i], res[i]);
+        keys += cnt;
+        drop += cnt;
+        n -= cnt;
     }
-    return NULL;
 }
 
-static int dp_vs_blklst_add_lcore(uint8_t proto, const union inet_addr *vaddr,
-                                  uint16_t vport, const union inet_addr *blklst)
+/* key of a TCP or UDP packet @mbuf (at ether header), its af or 0 */
+static inline int blklst_rx_parse(struct rte_mbuf *mbuf,
+                                  struct dp_vs_blklst_key *key)
 {
-    unsigned hashkey;
-    struct blklst_entry *new, *blklst_node;
-    blklst_node = dp_vs_blklst_lookup(proto, vaddr, vport, blklst);
-    if (blklst_node) {
-        return EDPVS_EXIST;
+    struct ether_hdr *eth = rte_pktmbuf_mtod(mbuf, struct ether_hdr *);
+    uint8_t *l4;
+    int af;
+
+    if (eth->ether_type == htons(ETHER_TYPE_IPv4)) {
+        struct ipv4_hdr *ip4h = (struct ipv4_hdr *)(eth + 1);
+
+        /* later fragments have no ports, they are for reassembly */
+        if (mbuf->data_len < sizeof(*eth) + sizeof(*ip4h) ||
+                (ip4h->version_ihl >> 4) != 4 ||
+                (ip4h->version_ihl & 0xf) < 5 ||
+                (ip4h->fragment_offset & htons(IPV4_HDR_OFFSET_MASK)))
+            return 0;
+
+        af = AF_INET;
+        key->proto = ip4h->next_proto_id;
+        key->vaddr.in.s_addr = ip4h->dst_addr;
+        key->saddr.in.s_addr = ip4h->src_addr;
+        l4 = (uint8_t *)ip4h + ((ip4h->version_ihl & 0xf) << 2);
+    } else if (eth->ether_type == htons(ETHER_TYPE_IPv6)) {
+        struct ip6_hdr *ip6h = (struct ip6_hdr *)(eth + 1);
+
+        /* extension headers are left to ipv6_rcv */
+        if (mbuf->data_len < sizeof(*eth) + sizeof(*ip6h))
+            return 0;
+
+        af = AF_INET6;
+        key->proto = ip6h->ip6_nxt;
+        key->vaddr.in6 = ip6h->ip6_dst;
+        key->saddr.in6 = ip6h->ip6_src;
+        l4 = (uint8_t *)(ip6h + 1);
+    } else {
+        return 0;
     }
 
-    hashkey = blklst_hashkey(vaddr, blklst);
+    /* ports, and the TCP flags at byte 13 */
+    if (key->proto == IPPROTO_TCP) {
+        if (l4 + 14 > rte_pktmbuf_mtod(mbuf, uint8_t *) + mbuf->data_len)
+            return 0;
+        key->tcp_flags = l4[13];
+    } else if (key->proto == IPPROTO_UDP) {
+        if (l4 + sizeof(struct udp_hdr) >
+                rte_pktmbuf_mtod(mbuf, uint8_t *) + mbuf->data_len)
+            return 0;
+    } else {
+        return 0;
+    }
+    key->vport = ((struct udp_hdr *)l4)->dst_port;
 
-    new = rte_zmalloc("new_blklst_entry", sizeof(struct blklst_entry), 0);
-    if (new == NULL)
-        return EDPVS_NOMEM;
+    return af;
+}
 
-    memcpy(&new->vaddr, vaddr,sizeof(union inet_addr));
-    new->vport   = vport;
-    new->proto  = proto;
-    memcpy(&new->blklst, blklst,sizeof(union inet_addr));
-    list_add(&new->list, &this_blklst_tab[hashkey]);
-    rte_atomic32_inc(&this_num_blklsts);
+uint16_t dp_vs_blklst_rx_burst(struct rte_mbuf **mbufs, uint16_t count)
+{
+    struct dp_vs_blklst_key keys[NETIF_MAX_PKT_BURST];
+    const struct dp_vs_blklst_key *kptr[2][NETIF_MAX_PKT_BURST];
+    uint16_t idx[2][NETIF_MAX_PKT_BURST];
+    bool res[NETIF_MAX_PKT_BURST];
+    bool drop[NETIF_MAX_PKT_BURST];
+    bool early_drop = dp_vs_blklst_ctrl_early_drop;
+    uint16_t i, j, n[2] = { 0, 0 }, left = 0;
+    int af, a;
+
+    if (likely(!this_blklst_acl) || count > NETIF_MAX_PKT_BURST)
+        return count;
+
+    for (i = 0; i < count; i++)
+        rte_prefetch0(rte_pktmbuf_mtod(mbufs[i], void *));
+
+    /* 1. keys of IPv4 and IPv6 packets apart. without early_drop only the
+     * bare SYNs, other new flows are checked on their conn miss */
+    for (i = 0; i < count; i++) {
+        drop[i] = false;
+        memset(&keys[i], 0, sizeof(keys[i]));
+        af = blklst_rx_parse(mbufs[i], &keys[i]);
+        if (!af || (!early_drop && (keys[i].proto != IPPROTO_TCP ||
+                                    (keys[i].tcp_flags & 0x17) != 0x02)))
+            continue;
+        a = (af == AF_INET6);
+        kptr[a][n[a]] = &keys[i];
+        idx[a][n[a]++] = i;
+    }
 
-    return EDPVS_OK;
+    /* 2. classify each family at once, the verdict goes with the packet */
+    for (a = 0; a < 2; a++) {
+        if (!n[a])
+            continue;
+        dp_vs_blklst_lookup_burst(a ? AF_INET6 : AF_INET, kptr[a], res, n[a]);
+        for (j = 0; j < n[a]; j++) {
+            i = idx[a][j];
+            drop[i] = res[j];
+            mbufs[i]->ol_flags |= res[j] ? PKT_RX_BLKLST_DENY :
+                                           PKT_RX_BLKLST_PASS;
+        }
+    }
+
+    if (!early_drop)
+        return count;
+
+    /* 3. drop, the rest is packed */
+    for (i = 0; i < count; i++) {
+        if (drop[i])
+            rte_pktmbuf_free(mbufs[i]);
+        else
+            mbufs[left++] = mbufs[i];
+    }
+
+    return left;
 }
 
-static int dp_vs_blklst_del_lcore(uint8_t proto, const union inet_addr *vaddr,
-                                  uint16_t vport, const union inet_addr *blklst)
+static void blklst_acl_rule_fill(struct blklst_acl_rule *rule, int af,
+                                 uint8_t proto, const union inet_addr *vaddr,
+                                 uint16_t vport, const union inet_addr *saddr,
+                                 uint8_t plen, uint8_t tcp_flags,
+                                 uint8_t tcp_flags_mask, uint32_t priority,
+                                 uint32_t userdata)
 {
-    struct blklst_entry *blklst_node;
+    int i, w;
 
-    blklst_node = dp_vs_blklst_lookup(proto, vaddr, vport, blklst);
-    if (blklst_node != NULL) {
-        list_del(&blklst_node->list);
-        rte_free(blklst_node);
-        rte_atomic32_dec(&this_num_blklsts);
-        return EDPVS_OK;
+    memset(rule, 0, sizeof(*rule));
+    rule->data.category_mask = 1;
+    rule->data.priority = priority;
+    rule->data.userdata = userdata;
+
+    rule->field[BLKLST_FIELD_PROTO].value.u8 = proto;
+    rule->field[BLKLST_FIELD_PROTO].mask_range.u8 = 0xff;
+
+    if (af == AF_INET6) {
+        for (w = 0; w < 4; w++) {
+            i = BLKLST_FIELD_VADDR + w;
+            rule->field[i].value.u32 = rte_be_to_cpu_32(vaddr->in6.s6_addr32[w]);
+            rule->field[i].mask_range.u32 = 32;
+
+            i = BLKLST_FIELD_SADDR + w;
+            rule->field[i].value.u32 = rte_be_to_cpu_32(saddr->in6.s6_addr32[w]);
+            rule->field[i].mask_range.u32 = RTE_MAX(RTE_MIN((int)plen - 32 * w, 32), 0);
+        }
+        i = BLKLST_FIELD_VPORT;
+    } else {
+        rule->field[BLKLST_FIELD_VADDR].value.u32 = rte_be_to_cpu_32(vaddr->in.s_addr);
+        rule->field[BLKLST_FIELD_VADDR].mask_range.u32 = 32;
+        rule->field[BLKLST_FIELD_VADDR + 1].value.u32 = rte_be_to_cpu_32(saddr->in.s_addr);
+        rule->field[BLKLST_FIELD_VADDR + 1].mask_range.u32 = plen;
+        i = BLKLST_FIELD_VADDR + 2;
     }
-    return EDPVS_NOTEXIST;
+
+    rule->field[i].value.u16 = rte_be_to_cpu_16(vport);
+    rule->field[i].mask_range.u16 = rte_be_to_cpu_16(vport);
+
+    /* the flags are the high byte of field i + 1, zero byte is not matched */
+    rule->field[i + 1].value.u16 = (uint16_t)tcp_flags << 8;
+    rule->field[i + 1].mask_range.u16 = (uint16_t)tcp_flags_mask << 8;
+}
+
+/* the longest prefix wins, then the most TCP flags matched */
+static inline uint32_t blklst_rule_priority(uint8_t plen, uint8_t tcp_flags_mask)
+{
+    return RTE_ACL_MIN_PRIORITY + 1 + plen * 9 +
+           __builtin_popcount(tcp_flags_mask);
 }
 
-static int dp_vs_blklst_add(uint8_t proto, const union inet_addr *vaddr,
-                            uint16_t vport, const union inet_addr *blklst)
+struct blklst_svc_key {
+    union inet_addr     vaddr;
+    uint16_t            vport;
+    uint8_t             proto;
+};
+
+static int blklst_svc_key_cmp(const void *a, const void *b)
 {
-    lcoreid_t cid = rte_lcore_id();
+    return memcmp(a, b, sizeof(struct blklst_svc_key));
+}
+
+struct rte_acl_ctx *dp_vs_blklst_acl_build(int af, const char *name,
+                                           const struct dp_vs_blklst_conf *rules,
+                                           unsigned int n)
+{
+    struct rte_acl_param param;
+    struct rte_acl_config cfg;
+    struct rte_acl_ctx *ctx;
+    struct blklst_acl_rule rule;
+    struct blklst_svc_key *svcs = NULL;
+    unsigned int i, j, nsvc = 0;
+    uint8_t plen;
     int err;
-    struct dpvs_msg *msg;
-    struct dp_vs_blklst_conf cf;
 
-    if (cid != rte_get_master_lcore()) {
-        RTE_LOG(INFO, SERVICE, "[%s] must set from master lcore\n", __func__);
-        return EDPVS_NOTSUPP;
+    /* services with allow rules deny everything else */
+    for (i = 0; i < n; i++) {
+        if (rules[i].action != DPVS_BLKLST_ALLOW)
+            continue;
+        if (!svcs) {
+            svcs = calloc(n, sizeof(*svcs));
+            if (!svcs)
+                return NULL;
+        }
+        svcs[nsvc].vaddr = rules[i].vaddr;
+        svcs[nsvc].vport = rules[i].vport;
+        svcs[nsvc].proto = rules[i].proto;
+        nsvc++;
+    }
+    if (nsvc > 1) {
+        qsort(svcs, nsvc, sizeof(*svcs), blklst_svc_key_cmp);
+        for (i = 1, j = 0; i < nsvc; i++) {
+            if (blklst_svc_key_cmp(&svcs[j], &svcs[i]))
+                svcs[++j] = svcs[i];
+        }
+        nsvc = j + 1;
     }
 
-    memset(&cf, 0, sizeof(struct dp_vs_blklst_conf));
-    memcpy(&(cf.vaddr), vaddr,sizeof(union inet_addr));
-    memcpy(&(cf.blklst), blklst, sizeof(union inet_addr));
-    cf.vport = vport;
-    cf.proto = proto;
+    memset(&param, 0, sizeof(param));
+    param.name = name;
+    param.socket_id = rte_socket_id();
+    param.rule_size = RTE_ACL_RULE_SZ(af == AF_INET6 ?
+                                      BLKLST_FIELDS_V6 : BLKLST_FIELDS_V4);
+    param.max_rule_num = n + nsvc;
+
+    ctx = rte_acl_create(&param);
+    if (!ctx) {
+        free(svcs);
+        return NULL;
+    }
 
-    /*set blklst ip on master lcore*/
-    err = dp_vs_blklst_add_lcore(proto, vaddr, vport, blklst);
-    if (err) {
-        RTE_LOG(INFO, SERVICE, "[%s] fail to set blklst ip\n", __func__);
-        return err;
+    for (i = 0; i < n; i++) {
+        plen = rules[i].plen ? rules[i].plen : blklst_host_plen(af);
+        blklst_acl_rule_fill(&rule, af, rules[i].proto, &rules[i].vaddr,
+                             rules[i].vport, &rules[i].blklst, plen,
+                             rules[i].tcp_flags, rules[i].tcp_flags_mask,
+                             blklst_rule_priority(plen, rules[i].tcp_flags_mask),
+                             ((i + 1) << BLKLST_ACL_RULE_SHIFT) |
+                             (rules[i].action == DPVS_BLKLST_ALLOW ?
+                              BLKLST_ACL_ALLOW : BLKLST_ACL_DENY));
+        if ((err = rte_acl_add_rules(ctx, (struct rte_acl_rule *)&rule, 1)) != 0)
+            goto errout;
     }
 
-    /*set blklst ip on all slave lcores*/
-    msg = msg_make(MSG_TYPE_BLKLST_ADD, 0, DPVS_MSG_MULTICAST,
-                   cid, sizeof(struct dp_vs_blklst_conf), &cf);
-    if (!msg)
+    for (i = 0; i < nsvc; i++) {
+        blklst_acl_rule_fill(&rule, af, svcs[i].proto, &svcs[i].vaddr,
+                             svcs[i].vport, &svcs[i].vaddr, 0, 0, 0,
+                             RTE_ACL_MIN_PRIORITY, BLKLST_ACL_DENY);
+        if ((err = rte_acl_add_rules(ctx, (struct rte_acl_rule *)&rule, 1)) != 0)
+            goto errout;
+    }
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.num_categories = 1;
+    if (af == AF_INET6) {
+        cfg.num_fields = BLKLST_FIELDS_V6;
+        memcpy(cfg.defs, blklst_defs_v6, sizeof(blklst_defs_v6));
+    } else {
+        cfg.num_fields = BLKLST_FIELDS_V4;
+        memcpy(cfg.defs, blklst_defs_v4, sizeof(blklst_defs_v4));
+    }
+
+    if ((err = rte_acl_build(ctx, &cfg)) != 0)
+        goto errout;
+
+    free(svcs);
+    return ctx;
+
+errout:
+    RTE_LOG(ERR, SERVICE, "%s: fail to build %s: %s\n",
+            __func__, name, strerror(-err));
+    rte_acl_free(ctx);
+    free(svcs);
+    return NULL;
+}
+
+static void blklst_acl_free(struct blklst_acl *acl)
+{
+    unsigned int cid;
+
+    if (!acl)
+        return;
+    rte_acl_free(acl->ctx4);
+    rte_acl_free(acl->ctx6);
+    rte_free(acl->rules);
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++)
+        rte_free(acl->hits[cid]);
+    rte_free(acl);
+}
+
+static struct blklst_entry *blklst_find(const struct dp_vs_blklst_conf *cf)
+{
+    struct blklst_entry *entry;
+    unsigned hashkey;
+
+    hashkey = blklst_hashkey(cf->af, &cf->vaddr, &cf->blklst);
+    list_for_each_entry(entry, &dp_vs_blklst_tab[hashkey], list) {
+        if (entry->af == cf->af &&
+            entry->proto == cf->proto &&
+            entry->vport == cf->vport &&
+            entry->plen == cf->plen &&
+            entry->tcp_flags == cf->tcp_flags &&
+            entry->tcp_flags_mask == cf->tcp_flags_mask &&
+            inet_addr_equal(cf->af, &entry->vaddr, &cf->vaddr) &&
+            inet_addr_equal(cf->af, &entry->blklst, &cf->blklst))
+            return entry;
+    }
+    return NULL;
+}
+
+/* the lcores count without locking, a read may miss the latest hits */
+static uint64_t blklst_acl_hits(const struct blklst_acl *acl, uint32_t idx)
+{
+    uint64_t hits = 0;
+    unsigned int cid;
+
+    RTE_LCORE_FOREACH(cid) {
+        if (acl->hits[cid])
+            hits += acl->hits[cid][idx];
+    }
+    return hits;
+}
+
+static uint64_t blklst_entry_hits(const struct blklst_entry *entry)
+{
+    const struct blklst_acl *acl = this_blklst_acl;
+
+    if (acl && acl->gen == entry->acl_gen && entry->acl_idx < acl->nrules)
+        return entry->hits + blklst_acl_hits(acl, entry->acl_idx);
+    return entry->hits;
+}
+
+/* keep the hits of retired @acl with the rules still listed */
+static void blklst_acl_fold_hits(const struct blklst_acl *acl)
+{
+    struct blklst_entry *entry;
+    uint64_t hits;
+    uint32_t i;
+
+    for (i = 0; i < acl->nrules; i++) {
+        hits = blklst_acl_hits(acl, i);
+        if (hits && (entry = blklst_find(&acl->rules[i])) != NULL)
+            entry->hits += hits;
+    }
+}
+
+static void blklst_fill_conf(struct dp_vs_blklst_conf *cf,
+                             const struct blklst_entry *entry)
+{
+    memset(cf, 0 ,sizeof(*cf));
+    cf->af = entry->af;
+    cf->vaddr = entry->vaddr;
+    cf->blklst = entry->blklst;
+    cf->proto = entry->proto;
+    cf->vport = entry->vport;
+    cf->plen = entry->plen;
+    cf->action = entry->action;
+    cf->tcp_flags = entry->tcp_flags;
+    cf->tcp_flags_mask = entry->tcp_flags_mask;
+}
+
+static void blklst_acl_retire(struct blklst_acl *acl)
+{
+    blklst_acl_fold_hits(acl);
+    blklst_acl_free(acl);
+}
+
+/*
+ * install @acl on all slaves, then on master, and free the one replaced.
+ * @acl is consumed either way. if the multicast fails, some slaves may
+ * have taken @acl and others not, so neither it nor the one in use can
+ * be freed: @acl is parked on the retired list, master keeps the old one
+ * and both go once a later swap reached every slave.
+ */
+static int blklst_acl_swap(struct blklst_acl *acl)
+{
+    struct blklst_acl *old = this_blklst_acl, *ret, *next;
+    struct dpvs_msg *msg;
+    int err;
+
+    msg = msg_make(MSG_TYPE_BLKLST_SWAP, 0, DPVS_MSG_MULTICAST,
+                   rte_lcore_id(), sizeof(acl), &acl);
+    if (!msg) {
+        blklst_acl_free(acl);
         return EDPVS_NOMEM;
-    err = multicast_msg_send(msg, DPVS_MSG_F_ASYNC, NULL);
+    }
+
+    err = multicast_msg_send(msg, 0, NULL);
+    msg_destroy(&msg);
     if (err != EDPVS_OK) {
-        msg_destroy(&msg);
-        RTE_LOG(INFO, SERVICE, "[%s] fail to send multicast message\n", __func__);
+        RTE_LOG(ERR, SERVICE, "%s: fail to send multicast message: %s\n",
+                __func__, dpvs_strerror(err));
+        if (acl)
+            list_add_tail(&acl->list, &blklst_acl_retired);
         return err;
     }
-    msg_destroy(&msg);
 
+    this_blklst_acl = acl;
+
+    list_for_each_entry_safe(ret, next, &blklst_acl_retired, list) {
+        list_del(&ret->list);
+        blklst_acl_retire(ret);
+    }
+    if (old)
+        blklst_acl_retire(old);
     return EDPVS_OK;
 }
 
-static int dp_vs_blklst_del(uint8_t proto, const union inet_addr *vaddr,
-                            uint16_t vport, const union inet_addr *blklst)
+static int blklst_acl_update(void)
 {
-    lcoreid_t cid = rte_lcore_id();
+    struct dp_vs_blklst_conf *rules = NULL;
+    struct blklst_entry *entry;
+    struct blklst_acl *acl = NULL;
+    unsigned int n4 = 0, n6 = 0, hash, idx, cid;
+    char name[RTE_ACL_NAMESIZE];
     int err;
-    struct dpvs_msg *msg;
-    struct dp_vs_blklst_conf cf;
 
-    if (cid != rte_get_master_lcore()) {
-        RTE_LOG(INFO, SERVICE, "[%s] must set from master lcore\n", __func__);
-        return EDPVS_NOTSUPP;
-    }
+    dp_vs_blklst_dirty = false;
 
-    memset(&cf, 0, sizeof(struct dp_vs_blklst_conf));
-    memcpy(&(cf.vaddr), vaddr,sizeof(union inet_addr));
-    memcpy(&(cf.blklst), blklst, sizeof(union inet_addr));
-    cf.vport = vport;
-    cf.proto = proto;
+    if (dp_vs_num_blklsts) {
+        rules = rte_malloc(NULL, dp_vs_num_blklsts * sizeof(*rules), 0);
+        acl = rte_zmalloc(NULL, sizeof(*acl), RTE_CACHE_LINE_SIZE);
+        if (!rules || !acl) {
+            err = EDPVS_NOMEM;
+            goto errout;
+        }
 
-    /*del blklst ip on master lcores*/
-    err = dp_vs_blklst_del_lcore(proto, vaddr, vport, blklst);
-    if (err) {
-        RTE_LOG(INFO, SERVICE, "[%s] fail to del blklst ip\n", __func__);
-        return err;
+        dp_vs_blklst_gen++;
+        acl->gen = dp_vs_blklst_gen;
+        acl->nrules = dp_vs_num_blklsts;
+
+        /* IPv4 rules from the front, IPv6 ones from the back */
+        for (hash = 0; hash < DPVS_BLKLST_TAB_SIZE; hash++) {
+            list_for_each_entry(entry, &dp_vs_blklst_tab[hash], list) {
+                if (entry->af == AF_INET6)
+                    idx = dp_vs_num_blklsts - ++n6;
+                else
+                    idx = n4++;
+                blklst_fill_conf(&rules[idx], entry);
+                entry->acl_gen = acl->gen;
+                entry->acl_idx = idx;
+            }
+        }
+        acl->n4 = n4;
+
+        RTE_LCORE_FOREACH(cid) {
+            acl->hits[cid] = rte_zmalloc_socket(NULL,
+                                    acl->nrules * sizeof(uint64_t),
+                                    RTE_CACHE_LINE_SIZE,
+                                    rte_lcore_to_socket_id(cid));
+            if (!acl->hits[cid]) {
+                err = EDPVS_NOMEM;
+                goto errout;
+            }
+        }
+
+        if (n4) {
+            snprintf(name, sizeof(name), "blklst4_%u", dp_vs_blklst_gen);
+            acl->ctx4 = dp_vs_blklst_acl_build(AF_INET, name, rules, n4);
+            if (!acl->ctx4) {
+                err = EDPVS_NOMEM;
+                goto errout;
+            }
+        }
+        if (n6) {
+            snprintf(name, sizeof(name), "blklst6_%u", dp_vs_blklst_gen);
+            acl->ctx6 = dp_vs_blklst_acl_build(AF_INET6, name,
+                                               &rules[n4], n6);
+            if (!acl->ctx6) {
+                err = EDPVS_NOMEM;
+                goto errout;
+            }
+        }
+        acl->rules = rules;
+        rules = NULL;
     }
 
-    /*del blklst ip on all slave lcores*/
-    msg = msg_make(MSG_TYPE_BLKLST_DEL, 0, DPVS_MSG_MULTICAST,
-                   cid, sizeof(struct dp_vs_blklst_conf), &cf);
-    if (!msg)
-        return EDPVS_NOMEM;
-    err = multicast_msg_send(msg, DPVS_MSG_F_ASYNC, NULL);
+    err = blklst_acl_swap(acl);
     if (err != EDPVS_OK) {
-        RTE_LOG(INFO, SERVICE, "[%s] fail to send multicast message\n", __func__);
+        /* retry later, the swap keeps whatever slaves might use */
+        dp_vs_blklst_dirty = true;
+        dp_vs_blklst_dirty_since = dp_vs_blklst_changed = rte_get_timer_cycles();
         return err;
     }
-    msg_destroy(&msg);
+
+    RTE_LOG(INFO, SERVICE, "%s: %u IPv4 and %u IPv6 rules in use\n",
+            __func__, n4, n6);
+    return EDPVS_OK;
+
+errout:
+    /* the rules in use stay until the next change */
+    RTE_LOG(ERR, SERVICE, "%s: fail to compile rules: %s\n",
+            __func__, dpvs_strerror(err));
+    rte_free(rules);
+    blklst_acl_free(acl);
+    return err;
+}
+
+static void blklst_changed(void)
+{
+    uint64_t now = rte_get_timer_cycles();
+
+    if (!dp_vs_blklst_dirty) {
+        dp_vs_blklst_dirty = true;
+        dp_vs_blklst_dirty_since = now;
+    }
+    dp_vs_blklst_changed = now;
+}
+
+static void blklst_acl_job_func(void *arg)
+{
+    uint64_t now;
+
+    if (likely(!dp_vs_blklst_dirty))
+        return;
+
+    now = rte_get_timer_cycles();
+    if (now - dp_vs_blklst_changed < DPVS_BLKLST_BUILD_DELAY_MS * g_cycles_per_sec / 1000
+            && now - dp_vs_blklst_dirty_since < DPVS_BLKLST_BUILD_MAX_MS * g_cycles_per_sec / 1000)
+        return;
+
+    blklst_acl_update();
+}
+
+/* af defaults to IPv4, plen 0 to a host, the source is masked to plen */
+static int blklst_conf_normalize(const struct dp_vs_blklst_conf *cf,
+                                 struct dp_vs_blklst_conf *ncf)
+{
+    union inet_addr mask;
+
+    *ncf = *cf;
+    if (!ncf->af)
+        ncf->af = AF_INET;
+    if (ncf->af != AF_INET && ncf->af != AF_INET6)
+        return EDPVS_INVAL;
+    if (!ncf->plen)
+        ncf->plen = blklst_host_plen(ncf->af);
+    if (ncf->plen > blklst_host_plen(ncf->af) || ncf->action > DPVS_BLKLST_ALLOW)
+        return EDPVS_INVAL;
+    if (ncf->tcp_flags_mask && ncf->proto != IPPROTO_TCP)
+        return EDPVS_INVAL;
+    ncf->tcp_flags &= ncf->tcp_flags_mask;
+    ncf->hits = 0;
+
+    inet_plen_to_mask(ncf->af, ncf->plen, &mask);
+    inet_addr_net(ncf->af, &cf->blklst, &mask, &ncf->blklst);
+    return EDPVS_OK;
+}
+
+static int dp_vs_blklst_add(const struct dp_vs_blklst_conf *cf)
+{
+    struct dp_vs_blklst_conf ncf;
+    struct blklst_entry *new;
+    int err;
+
+    if ((err = blklst_conf_normalize(cf, &ncf)) != EDPVS_OK)
+        return err;
+    if (blklst_find(&ncf))
+        return EDPVS_EXIST;
+
+    new = rte_zmalloc("new_blklst_entry", sizeof(struct blklst_entry), 0);
+    if (new == NULL)
+        return EDPVS_NOMEM;
+
+    new->af     = ncf.af;
+    new->vaddr  = ncf.vaddr;
+    new->vport  = ncf.vport;
+    new->proto  = ncf.proto;
+    new->blklst = ncf.blklst;
+    new->plen   = ncf.plen;
+    new->action = ncf.action;
+    new->tcp_flags      = ncf.tcp_flags;
+    new->tcp_flags_mask = ncf.tcp_flags_mask;
+    list_add(&new->list, &dp_vs_blklst_tab[blklst_hashkey(ncf.af,
+                                           &ncf.vaddr, &ncf.blklst)]);
+    dp_vs_num_blklsts++;
+    blklst_changed();
 
     return EDPVS_OK;
 }
 
-void  dp_vs_blklst_flush(struct dp_vs_service *svc)
+static void blklst_entry_del(struct blklst_entry *entry)
+{
+    list_del(&entry->list);
+    rte_free(entry);
+    dp_vs_num_blklsts--;
+    blklst_changed();
+}
+
+static int dp_vs_blklst_del(const struct dp_vs_blklst_conf *cf)
+{
+    struct dp_vs_blklst_conf ncf;
+    struct blklst_entry *entry;
+    int err;
+
+    if ((err = blklst_conf_normalize(cf, &ncf)) != EDPVS_OK)
+        return err;
+
+    entry = blklst_find(&ncf);
+    if (!entry)
+        return EDPVS_NOTEXIST;
+
+    blklst_entry_del(entry);
+    return EDPVS_OK;
+}
+
+/* rules live on master, each lcore deleting its svc copy calls it */
+void dp_vs_blklst_flush(struct dp_vs_service *svc)
 {
     struct blklst_entry *entry, *next;
     int hash;
 
+    if (rte_lcore_id() != rte_get_master_lcore() || !dp_vs_num_blklsts)
+        return;
+
     for (hash = 0; hash < DPVS_BLKLST_TAB_SIZE; hash++) {
-        list_for_each_entry_safe(entry, next, &this_blklst_tab[hash], list) {
-            if (entry->vaddr.in.s_addr == svc->addr.in.s_addr)
-                dp_vs_blklst_del(entry->proto, &entry->vaddr,
-                                 entry->vport, &entry->blklst);
+        list_for_each_entry_safe(entry, next, &dp_vs_blklst_tab[hash], list) {
+            if (entry->af == svc->af && entry->vport == svc->port &&
+                entry->proto == svc->proto &&
+                inet_addr_equal(svc->af, &entry->vaddr, &svc->addr))
+                blklst_entry_del(entry);
         }
     }
-    return;
 }
 
 static void dp_vs_blklst_flush_all(void)
@@ -218,12 +883,9 @@ static void dp_vs_blklst_flush_all(void)
     int hash;
 
     for (hash = 0; hash < DPVS_BLKLST_TAB_SIZE; hash++) {
-        list_for_each_entry_safe(entry, next, &this_blklst_tab[hash], list) {
-            dp_vs_blklst_del(entry->proto, &entry->vaddr,
-                             entry->vport, &entry->blklst);
-        }
+        list_for_each_entry_safe(entry, next, &dp_vs_blklst_tab[hash], list)
+            blklst_entry_del(entry);
     }
-    return;
 }
 
 /*
@@ -232,39 +894,35 @@ static void dp_vs_blklst_flush_all(void)
 static int blklst_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
 {
     const struct dp_vs_blklst_conf *blklst_conf = conf;
-    int err;
+    size_t i;
+    int err = EDPVS_OK;
 
-    if (!conf && size < sizeof(*blklst_conf))
+    if (opt == SOCKOPT_SET_BLKLST_FLUSH) {
+        dp_vs_blklst_flush_all();
+        return EDPVS_OK;
+    }
+
+    /* one rule or an array of them */
+    if (!conf || size < sizeof(*blklst_conf) || size % sizeof(*blklst_conf))
         return EDPVS_INVAL;
 
-    switch (opt) {
-    case SOCKOPT_SET_BLKLST_ADD:
-        err = dp_vs_blklst_add(blklst_conf->proto, &blklst_conf->vaddr,
-                               blklst_conf->vport, &blklst_conf->blklst);
-        break;
-    case SOCKOPT_SET_BLKLST_DEL:
-        err = dp_vs_blklst_del(blklst_conf->proto, &blklst_conf->vaddr,
-                               blklst_conf->vport, &blklst_conf->blklst);
-        break;
-    default:
-        err = EDPVS_NOTSUPP;
-        break;
+    for (i = 0; i < size / sizeof(*blklst_conf) && err == EDPVS_OK; i++) {
+        switch (opt) {
+        case SOCKOPT_SET_BLKLST_ADD:
+            err = dp_vs_blklst_add(&blklst_conf[i]);
+            break;
+        case SOCKOPT_SET_BLKLST_DEL:
+            err = dp_vs_blklst_del(&blklst_conf[i]);
+            break;
+        default:
+            err = EDPVS_NOTSUPP;
+            break;
+        }
     }
 
     return err;
 }
 
-static void blklst_fill_conf(int af, struct dp_vs_blklst_conf *cf,
-                            const struct blklst_entry *entry)
-{
-    memset(cf, 0 ,sizeof(*cf));
-    cf->af = af;
-    cf->vaddr = entry->vaddr;
-    cf->blklst = entry->blklst;
-    cf->proto = entry->proto;
-    cf->vport = entry->vport;
-}
-
 static int blklst_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
                              void **out, size_t *outsize)
 {
@@ -273,7 +931,7 @@ static int blklst_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
     size_t naddr, hash;
     int off = 0;
 
-    naddr = rte_atomic32_read(&this_num_blklsts);
+    naddr = dp_vs_num_blklsts;
     *outsize = sizeof(struct dp_vs_blklst_conf_array) +
                naddr * sizeof(struct dp_vs_blklst_conf);
     *out = rte_calloc_socket(NULL, 1, *outsize, 0, rte_socket_id());
@@ -283,48 +941,57 @@ static int blklst_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
     array->naddr = naddr;
 
     for (hash = 0; hash < DPVS_BLKLST_TAB_SIZE; hash++) {
-        list_for_each_entry(entry, &this_blklst_tab[hash], list) {
+        list_for_each_entry(entry, &dp_vs_blklst_tab[hash], list) {
             if (off >= naddr)
                 break;
-            blklst_fill_conf(AF_INET, &array->blklsts[off++], entry);
+            blklst_fill_conf(&array->blklsts[off], entry);
+            array->blklsts[off++].hits = blklst_entry_hits(entry);
         }
     }
 
     return EDPVS_OK;
 }
 
-
-static int blklst_msg_process(bool add, struct dpvs_msg *msg)
+static int blklst_swap_msg_cb(struct dpvs_msg *msg)
 {
-    struct dp_vs_blklst_conf *cf;
-    int err;
     assert(msg);
 
-    if (msg->len != sizeof(struct dp_vs_blklst_conf)){
+    if (msg->len != sizeof(struct blklst_acl *)) {
         RTE_LOG(ERR, SERVICE, "%s: bad message.\n", __func__);
         return EDPVS_INVAL;
     }
 
-    cf = (struct dp_vs_blklst_conf *)msg->data;
-    if (add)
-        err = dp_vs_blklst_add_lcore(cf->proto, &cf->vaddr, cf->vport, &cf->blklst);
+    this_blklst_acl = *(struct blklst_acl **)msg->data;
+    return EDPVS_OK;
+}
+
+static void early_drop_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+
+    assert(str);
+
+    if (strcasecmp(str, "on") == 0)
+        dp_vs_blklst_ctrl_early_drop = true;
+    else if (strcasecmp(str, "off") == 0)
+        dp_vs_blklst_ctrl_early_drop = false;
     else
-        err = dp_vs_blklst_del_lcore(cf->proto, &cf->vaddr, cf->vport, &cf->blklst);
-    if (err != EDPVS_OK)
-        RTE_LOG(ERR, SERVICE, "%s: fail to %s blklst: %s.\n",
-                __func__, add ? "add" : "del", dpvs_strerror(err));
+        RTE_LOG(WARNING, SERVICE, "invalid blklst:early_drop %s\n", str);
 
-    return err;
+    RTE_LOG(INFO, SERVICE, "blklst:early_drop = %s\n",
+            dp_vs_blklst_ctrl_early_drop ? "on" : "off");
+
+    FREE_PTR(str);
 }
 
-inline static int blklst_add_msg_cb(struct dpvs_msg *msg)
+void blklst_keyword_value_init(void)
 {
-    return blklst_msg_process(true, msg);
+    dp_vs_blklst_ctrl_early_drop = DPVS_BLKLST_EARLY_DROP_DEF;
 }
 
-inline static int blklst_del_msg_cb(struct dpvs_msg *msg)
+void install_blklst_keywords(void)
 {
-    return blklst_msg_process(false, msg);
+    install_keyword("early_drop", early_drop_handler, KW_TYPE_NORMAL);
 }
 
 static struct dpvs_sockopts blklst_sockopts = {
@@ -337,100 +1004,79 @@ static struct dpvs_sockopts blklst_sockopts = {
     .get                = blklst_sockopt_get,
 };
 
-static int blklst_lcore_init(void *args)
-{
-    int i;
-    if (!rte_lcore_is_enabled(rte_lcore_id()))
-    return EDPVS_DISABLED;
-    this_blklst_tab = rte_malloc_socket(NULL,
-                        sizeof(struct list_head) * DPVS_BLKLST_TAB_SIZE,
-                        RTE_CACHE_LINE_SIZE, rte_socket_id());
-    if (!this_blklst_tab)
-        return EDPVS_NOMEM;
-
-    for (i = 0; i < DPVS_BLKLST_TAB_SIZE; i++)
-        INIT_LIST_HEAD(&this_blklst_tab[i]);
-
-    return EDPVS_OK;
-}
-
-static int blklst_lcore_term(void *args)
-{
-    if (!rte_lcore_is_enabled(rte_lcore_id()))
-       return EDPVS_DISABLED;
-
-    dp_vs_blklst_flush_all();
-
-    if (this_blklst_tab) {
-       rte_free(this_blklst_tab);
-       this_blklst_tab = NULL;
-    }
-    return EDPVS_OK;
-}
+static struct dpvs_lcore_job blklst_acl_job = {
+    .name = "blklst_acl",
+    .func = blklst_acl_job_func,
+    .data = NULL,
+    .type = LCORE_JOB_LOOP,
+};
 
 int dp_vs_blklst_init(void)
 {
-    int err;
-    lcoreid_t cid;
+    int i, err;
     struct dpvs_msg_type msg_type;
 
-    rte_atomic32_set(&this_num_blklsts, 0);
+    dp_vs_blklst_tab = rte_malloc(NULL,
+                        sizeof(struct list_head) * DPVS_BLKLST_TAB_SIZE,
+                        RTE_CACHE_LINE_SIZE);
+    if (!dp_vs_blklst_tab)
+        return EDPVS_NOMEM;
 
-    rte_eal_mp_remote_launch(blklst_lcore_init, NULL, CALL_MASTER);
-    RTE_LCORE_FOREACH_SLAVE(cid) {
-        if ((err = rte_eal_wait_lcore(cid)) < 0) {
-            RTE_LOG(WARNING, SERVICE, "%s: lcore %d: %s.\n",
-                    __func__, cid, dpvs_strerror(err));
-            return err;
-        }
-    }
+    for (i = 0; i < DPVS_BLKLST_TAB_SIZE; i++)
+        INIT_LIST_HEAD(&dp_vs_blklst_tab[i]);
+    dp_vs_num_blklsts = 0;
+    dp_vs_blklst_rnd = (uint32_t)rte_rand();
 
     memset(&msg_type, 0, sizeof(struct dpvs_msg_type));
-    msg_type.type   = MSG_TYPE_BLKLST_ADD;
+    msg_type.type   = MSG_TYPE_BLKLST_SWAP;
     msg_type.mode   = DPVS_MSG_MULTICAST;
     msg_type.prio   = MSG_PRIO_NORM;
     msg_type.cid    = rte_lcore_id();
-    msg_type.unicast_msg_cb = blklst_add_msg_cb;
+    msg_type.unicast_msg_cb = blklst_swap_msg_cb;
     err = msg_type_mc_register(&msg_type);
     if (err != EDPVS_OK) {
         RTE_LOG(ERR, SERVICE, "%s: fail to register msg.\n", __func__);
-        return err;
+        goto errout;
     }
 
-    memset(&msg_type, 0, sizeof(struct dpvs_msg_type));
-    msg_type.type   = MSG_TYPE_BLKLST_DEL;
-    msg_type.mode   = DPVS_MSG_MULTICAST;
-    msg_type.prio   = MSG_PRIO_NORM;
-    msg_type.cid    = rte_lcore_id();
-    msg_type.unicast_msg_cb = blklst_del_msg_cb;
-    err = msg_type_mc_register(&msg_type);
-    if (err != EDPVS_OK) {
-        RTE_LOG(ERR, SERVICE, "%s: fail to register msg.\n", __func__);
-        return err;
-    }
+    err = dpvs_lcore_job_register(&blklst_acl_job, LCORE_ROLE_MASTER);
+    if (err != EDPVS_OK)
+        goto errout;
 
-    if ((err = sockopt_register(&blklst_sockopts)) != EDPVS_OK)
-        return err;
-    dp_vs_blklst_rnd = (uint32_t)random();
+    if ((err = sockopt_register(&blklst_sockopts)) != EDPVS_OK) {
+        dpvs_lcore_job_unregister(&blklst_acl_job, LCORE_ROLE_MASTER);
+        goto errout;
+    }
 
     return EDPVS_OK;
+
+errout:
+    rte_free(dp_vs_blklst_tab);
+    dp_vs_blklst_tab = NULL;
+    return err;
 }
 
 int dp_vs_blklst_term(void)
 {
+    struct blklst_acl *acl, *next;
     int err;
-    lcoreid_t cid;
 
     if ((err = sockopt_unregister(&blklst_sockopts)) != EDPVS_OK)
         return err;
 
-    rte_eal_mp_remote_launch(blklst_lcore_term, NULL, CALL_MASTER);
-    RTE_LCORE_FOREACH_SLAVE(cid) {
-        if ((err = rte_eal_wait_lcore(cid)) < 0) {
-            RTE_LOG(WARNING, SERVICE, "%s: lcore %d: %s.\n",
-                    __func__, cid, dpvs_strerror(err));
-        }
+    dpvs_lcore_job_unregister(&blklst_acl_job, LCORE_ROLE_MASTER);
+
+    /* lcores are stopped, nobody classifies any more */
+    list_for_each_entry_safe(acl, next, &blklst_acl_retired, list) {
+        list_del(&acl->list);
+        blklst_acl_free(acl);
     }
+    blklst_acl_free(this_blklst_acl);
+    this_blklst_acl = NULL;
+
+    dp_vs_blklst_flush_all();
+    rte_free(dp_vs_blklst_tab);
+    dp_vs_blklst_tab = NULL;
 
     return EDPVS_OK;
 }
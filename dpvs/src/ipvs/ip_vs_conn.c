@@ -31,8 +31,12 @@
 #include "ipvs/proto_tcp.h"
 #include "ipvs/proto_udp.h"
 #include "ipvs/proto_icmp.h"
+#include "ipvs/handoff.h"
+#include "ipvs/connlimit.h"
+#include "ipvs/sync.h"
 #include "parser/parser.h"
 #include "ctrl.h"
+#include "scheduler.h"
 #include "conf/conn.h"
 #include "sys_time.h"
 
@@ -45,8 +49,14 @@
 #define DPVS_CONN_POOL_SIZE_MIN     65536
 #define DPVS_CONN_CACHE_SIZE_DEF    256
 
+/* cold extension is needed by part of conns only, but nothing bounds
+ * that part below the conn pool under a flood of timestamped SYNs */
+#define DPVS_CONN_EXT_POOL_SIZE_DEF 2097152
+#define DPVS_CONN_EXT_POOL_SIZE_MIN 16384
+
 static int conn_pool_size  = DPVS_CONN_POOL_SIZE_DEF;
 static int conn_pool_cache = DPVS_CONN_CACHE_SIZE_DEF;
+static int conn_ext_pool_size = DPVS_CONN_EXT_POOL_SIZE_DEF;
 
 #define DPVS_CONN_INIT_TIMEOUT_DEF  3   /* sec */
 static int conn_init_timeout = DPVS_CONN_INIT_TIMEOUT_DEF;
@@ -58,6 +68,7 @@ static int conn_init_timeout = DPVS_CONN_INIT_TIMEOUT_DEF;
 #endif
 #define this_conn_count             (RTE_PER_LCORE(dp_vs_conn_count))
 #define this_conn_cache             (dp_vs_conn_cache[rte_socket_id()])
+#define this_conn_ext_cache         (dp_vs_conn_ext_cache[rte_socket_id()])
 
 /* dpvs control variables */
 static bool conn_expire_quiescent_template = false;
@@ -84,6 +95,10 @@ static uint32_t dp_vs_conn_rnd; /* hash random */
  * memory pool for dp_vs_conn{}
  */
 static struct rte_mempool *dp_vs_conn_cache[DPVS_MAX_SOCKET];
+static struct rte_mempool *dp_vs_conn_ext_cache[DPVS_MAX_SOCKET];
+
+/* lcore populating the pools of each socket */
+static lcoreid_t dp_vs_conn_pool_lcores[DPVS_MAX_SOCKET];
 
 static int dp_vs_conn_expire(void *priv);
 
@@ -111,6 +126,30 @@ static struct dp_vs_conn *dp_vs_conn_alloc(enum dpvs_fwd_mode fwdmode,
     return conn;
 }
 
+int dp_vs_conn_ext_alloc(struct dp_vs_conn *conn)
+{
+    struct dp_vs_conn_ext *ext;
+
+    if (likely(conn->ext != NULL))
+        return EDPVS_OK;
+
+    if (unlikely(rte_mempool_get(this_conn_ext_cache, (void **)&ext) != 0)) {
+        dp_vs_estats_inc(CONN_EXT_NOMEM);
+        RTE_LOG(DEBUG, IPVS, "%s: no memory for connection extension\n", __func__);
+        return EDPVS_NOMEM;
+    }
+
+    memset(ext, 0, sizeof(struct dp_vs_conn_ext));
+    ext->extpool = this_conn_ext_cache;
+    INIT_LIST_HEAD(&ext->ack_mbuf);
+    rte_atomic32_set(&ext->syn_retry_max, 0);
+    rte_atomic32_set(&ext->dup_ack_cnt, 0);
+    rte_atomic32_clear(&ext->n_control);
+
+    conn->ext = ext;
+    return EDPVS_OK;
+}
+
 static void dp_vs_conn_free(struct dp_vs_conn *conn)
 {
     if (!conn)
@@ -118,6 +157,11 @@ static void dp_vs_conn_free(struct dp_vs_conn *conn)
 
     dp_vs_redirect_free(conn);
 
+    if (conn->ext) {
+        rte_mempool_put(conn->ext->extpool, conn->ext);
+        conn->ext = NULL;
+    }
+
     rte_mempool_put(conn->connpool, conn);
     this_conn_count--;
 }
@@ -342,10 +386,13 @@ static int dp_vs_conn_bind_dest(struct dp_vs_conn *conn,
 
     rte_atomic32_inc(&dest->refcnt);
 
-    if (dp_vs_conn_is_template(conn))
+    if (dp_vs_conn_is_template(conn)) {
         rte_atomic32_inc(&dest->persistconns);
-    else
+    } else {
         rte_atomic32_inc(&dest->inactconns);
+        if (dest->svc && dest->svc->climit.conns)
+            dp_vs_connlimit_conn_hold(&dest->svc->climit, conn);
+    }
 
     switch (dest->fwdmode) {
     case DPVS_FWD_MODE_NAT:
@@ -393,6 +440,9 @@ static int dp_vs_conn_unbind_dest(struct dp_vs_conn *conn)
            }
     }
 
+    if (conn->climit_tag)
+        dp_vs_connlimit_conn_put(conn);
+
     if (dest->max_conn &&
             (rte_atomic32_read(&dest->inactconns) + \
              rte_atomic32_read(&dest->actconns) < dest->max_conn)) {
@@ -482,13 +532,14 @@ static inline void conn_stats_dump(const char *msg, struct dp_vs_conn *conn)
         daddr = inet_ntop(conn->af, &conn->daddr, dbuf, sizeof(dbuf)) ? dbuf : "::";
 
         RTE_LOG(DEBUG, IPVS, "[%s->%s]%s [%d] %s %s/%u %s/%u %s/%u %s/%u"
-                " inpkts=%ld, inbytes=%ld, outpkts=%ld, outbytes=%ld， timestamp_all=%u\n",
+                " inpkts=%lu, inbytes=%lu, outpkts=%lu, outbytes=%lu， timestamp_all=%u\n",
                 cycles_to_stime(conn->ctime, start_time, SYS_TIME_STR_LEN), sys_localtime_str(end_time, SYS_TIME_STR_LEN),
                 msg ? msg : "", rte_lcore_id(), inet_proto_name(conn->proto),
                 caddr, ntohs(conn->cport), vaddr, ntohs(conn->vport),
                 laddr, ntohs(conn->lport), daddr, ntohs(conn->dport),
-                rte_atomic64_read(&conn->stats.inpkts), rte_atomic64_read(&conn->stats.inbytes),
-                rte_atomic64_read(&conn->stats.outpkts), rte_atomic64_read(&conn->stats.outbytes), conn->timestamp_all);
+                conn->stats.inpkts, conn->stats.inbytes,
+                conn->stats.outpkts, conn->stats.outbytes,
+                conn->ext ? conn->ext->timestamp_all : 0);
     }
 }
 #endif
@@ -527,8 +578,9 @@ static int dp_vs_conn_resend_packets(struct dp_vs_conn *conn,
 {
     struct rte_mempool *pool;
     struct rte_mbuf *cloned_syn_mbuf;
+    struct dp_vs_conn_ext *ext = conn->ext;
 
-    if (conn->syn_mbuf && rte_atomic32_read(&conn->syn_retry_max) > 0) {
+    if (ext && ext->syn_mbuf && rte_atomic32_read(&ext->syn_retry_max) > 0) {
         if (likely(conn->packet_xmit != NULL)) {
             pool = get_mbuf_pool(conn, DPVS_CONN_DIR_INBOUND);
 
@@ -537,7 +589,7 @@ static int dp_vs_conn_resend_packets(struct dp_vs_conn *conn,
                         "%s: no route for syn_proxy rs's syn retransmit\n",
                         __func__);
             } else {
-                cloned_syn_mbuf = mbuf_copy(conn->syn_mbuf, pool);
+                cloned_syn_mbuf = mbuf_copy(ext->syn_mbuf, pool);
                 if (unlikely(!cloned_syn_mbuf)) {
                     RTE_LOG(WARNING, IPVS,
                             "%s: no memory for syn_proxy rs's syn retransmit\n",
@@ -549,7 +601,7 @@ static int dp_vs_conn_resend_packets(struct dp_vs_conn *conn,
             }
         }
 
-        rte_atomic32_dec(&conn->syn_retry_max);
+        rte_atomic32_dec(&ext->syn_retry_max);
         dp_vs_estats_inc(SYNPROXY_RS_ERROR);
 
         return EDPVS_OK;
@@ -602,20 +654,25 @@ static void dp_vs_conn_sa_release(struct dp_vs_conn *conn)
 static void dp_vs_conn_free_packets(struct dp_vs_conn *conn)
 {
     struct dp_vs_synproxy_ack_pakcet *ack_mbuf, *t_ack_mbuf;
+    struct dp_vs_conn_ext *ext = conn->ext;
+
+    if (!ext)
+        return;
 
     /* free stored ack packet */
-    list_for_each_entry_safe(ack_mbuf, t_ack_mbuf, &conn->ack_mbuf, list) {
+    list_for_each_entry_safe(ack_mbuf, t_ack_mbuf, &ext->ack_mbuf, list) {
         list_del_init(&ack_mbuf->list);
         rte_pktmbuf_free(ack_mbuf->mbuf);
         sp_dbg_stats32_dec(sp_ack_saved);
         rte_mempool_put(this_ack_mbufpool, ack_mbuf);
     }
 
-    conn->ack_num = 0;
+    ext->ack_num = 0;
 
     /* free stored syn mbuf */
-    if (conn->syn_mbuf) {
-        rte_pktmbuf_free(conn->syn_mbuf);
+    if (ext->syn_mbuf) {
+        rte_pktmbuf_free(ext->syn_mbuf);
+        ext->syn_mbuf = NULL;
         sp_dbg_stats32_dec(sp_syn_saved);
     }
 }
@@ -642,7 +699,7 @@ static int dp_vs_conn_expire(void *priv)
     }
 
     /* somebody is controlled by me, expire later */
-    if (rte_atomic32_read(&conn->n_control)) {
+    if (conn->ext && rte_atomic32_read(&conn->ext->n_control)) {
         dp_vs_conn_put_nolock(conn);
         return DTIMER_OK;
     }
@@ -657,12 +714,14 @@ static int dp_vs_conn_expire(void *priv)
         dp_vs_conn_detach_timer(conn, false);
 
         /* I was controlled by someone */
-        if (conn->control)
+        if (dp_vs_conn_control(conn))
             dp_vs_control_del(conn);
 
         if (pp && pp->conn_expire)
             pp->conn_expire(pp, conn);
 
+        dp_vs_sync_conn(conn, DP_VS_SYNC_CONN_EXPIRE);
+
         dp_vs_conn_sa_release(conn);
         dp_vs_conn_unbind_dest(conn);
         dp_vs_laddr_unbind(conn);
@@ -752,13 +811,13 @@ static void conn_flush(void)
 
                 dp_vs_conn_unbind_dest(conn);
                 dp_vs_laddr_unbind(conn);
+                dp_vs_conn_free_packets(conn);
                 rte_atomic32_dec(&conn->refcnt);
 
-                dp_vs_conn_free(conn);
-
 #ifdef CONFIG_DPVS_IPVS_STATS_DEBUG
                 conn_stats_dump("conn flush", conn);
 #endif
+                dp_vs_conn_free(conn);
             }
         }
     }
@@ -863,10 +922,6 @@ struct dp_vs_conn *dp_vs_conn_new(struct rte_mbuf *mbuf,
     new->in_dev = NULL;
     new->out_dev = NULL;
 
-    /* Controll member */
-    new->control = NULL;
-    rte_atomic32_clear(&new->n_control);
-
     /* caller will use it right after created,
      * just like dp_vs_conn_get(). */
     rte_atomic32_set(&new->refcnt, 1);
@@ -883,6 +938,12 @@ struct dp_vs_conn *dp_vs_conn_new(struct rte_mbuf *mbuf,
         goto errout;
     }
 
+    /* cold extension for synproxy (flag may come from dest) and template */
+    if (new->flags & (DPVS_CONN_F_SYNPROXY | DPVS_CONN_F_TEMPLATE)) {
+        if ((err = dp_vs_conn_ext_alloc(new)) != EDPVS_OK)
+            goto unbind_dest;
+    }
+
     /* FNAT only: select and bind local address/port */
     if (dest->fwdmode == DPVS_FWD_MODE_FNAT) {
         if ((err = dp_vs_laddr_bind(new, dest->svc)) != EDPVS_OK)
@@ -901,10 +962,6 @@ struct dp_vs_conn *dp_vs_conn_new(struct rte_mbuf *mbuf,
     new->timeout.tv_usec = 0;
 
     /* synproxy */
-    INIT_LIST_HEAD(&new->ack_mbuf);
-    rte_atomic32_set(&new->syn_retry_max, 0);
-    rte_atomic32_set(&new->dup_ack_cnt, 0);
-
     if ((flags & DPVS_CONN_F_SYNPROXY) && !dp_vs_conn_is_template(new)) {
         struct tcphdr _tcph, *th = NULL;
         struct dp_vs_synproxy_ack_pakcet *ack_mbuf;
@@ -922,8 +979,8 @@ struct dp_vs_conn *dp_vs_conn_new(struct rte_mbuf *mbuf,
             goto unbind_laddr;
         }
         ack_mbuf->mbuf = mbuf;
-        list_add_tail(&ack_mbuf->list, &new->ack_mbuf);
-        new->ack_num++;
+        list_add_tail(&ack_mbuf->list, &new->ext->ack_mbuf);
+        new->ext->ack_num++;
         sp_dbg_stats32_inc(sp_ack_saved);
 
         /* save ack_seq - 1 */
@@ -956,6 +1013,267 @@ errout:
     return NULL;
 }
 
+/* snapshot what's needed to rebuild @conn elsewhere */
+void dp_vs_conn_handoff_fill(const struct dp_vs_conn *conn,
+                             struct dp_vs_handoff_conn *hc)
+{
+    hc->af      = conn->af;
+    hc->daf     = tuplehash_out(conn).af;
+    hc->proto   = conn->proto;
+    hc->state   = conn->state;
+    hc->flags   = conn->flags & (DPVS_CONN_F_INACTIVE |
+                                 DPVS_CONN_F_SYNPROXY |
+                                 DPVS_CONN_F_NOFASTXMIT);
+    hc->act     = conn->act;
+    hc->inact   = conn->inact;
+    hc->caddr   = conn->caddr;
+    hc->vaddr   = conn->vaddr;
+    hc->laddr   = conn->laddr;
+    hc->daddr   = conn->daddr;
+    hc->cport   = conn->cport;
+    hc->vport   = conn->vport;
+    hc->lport   = conn->lport;
+    hc->dport   = conn->dport;
+    /* the wheel does not tell what's left, full timeout is the bound */
+    hc->timeout = conn->timeout.tv_sec;
+    hc->fnat_seq        = conn->fnat_seq;
+    hc->syn_proxy_seq   = conn->syn_proxy_seq;
+    hc->rs_end_seq      = conn->rs_end_seq;
+    hc->rs_end_ack      = conn->rs_end_ack;
+
+    /* a flow whose timestamps are rewritten must go on being rewritten,
+     * or the peers see them jump back and drop segments by PAWS */
+    if (conn->ext) {
+        hc->has_ext     = 1;
+        hc->tsval       = conn->ext->tsval;
+        hc->tsecr       = conn->ext->tsecr;
+        hc->tscent      = conn->ext->tscent;
+        hc->clienttsval = conn->ext->clienttsval;
+    } else {
+        hc->has_ext     = 0;
+        hc->tsval       = 0;
+        hc->tsecr       = 0;
+        hc->tscent      = 0;
+        hc->clienttsval = 0;
+    }
+    hc->reserved = 0;
+}
+
+/*
+ * serialize this lcore's connections for hot restart, at most @max of them.
+ * templates live in the global table and are rebuilt by new traffic, conns
+ * with synproxy handshake in flight hold mbufs and cannot be moved.
+ */
+int dp_vs_conn_handoff_export(struct dp_vs_handoff_conn *hcs, uint32_t max,
+                              uint32_t *skipped)
+{
+    struct conn_tuple_hash *tuphash;
+    struct dp_vs_conn *conn;
+    uint32_t n = 0;
+    int i;
+
+    *skipped = 0;
+
+#ifdef CONFIG_DPVS_IPVS_CONN_LOCK
+    rte_spinlock_lock(&this_conn_lock);
+#endif
+    for (i = 0; i < DPVS_CONN_TBL_SIZE; i++) {
+        list_for_each_entry(tuphash, &this_conn_tbl[i], list) {
+            if (tuphash->direct != DPVS_CONN_DIR_INBOUND)
+                continue;
+
+            conn = tuplehash_to_conn(tuphash);
+            if (dp_vs_conn_is_template(conn) || !conn->dest ||
+                (conn->ext && (conn->ext->ack_num || conn->ext->syn_mbuf)) ||
+                n >= max) {
+                (*skipped)++;
+                continue;
+            }
+
+            dp_vs_conn_handoff_fill(conn, &hcs[n++]);
+        }
+    }
+#ifdef CONFIG_DPVS_IPVS_CONN_LOCK
+    rte_spinlock_unlock(&this_conn_lock);
+#endif
+
+    return n;
+}
+
+/*
+ * call @fn on this lcore's connections in @nbuckets hash buckets from
+ * @cursor on, and move @cursor past them. @cursor wraps at the end of
+ * the table, so repeated calls sweep it over and over. @fn must not
+ * add or remove connections.
+ */
+void dp_vs_conn_walk(uint32_t *cursor, uint32_t nbuckets,
+                     void (*fn)(struct dp_vs_conn *conn, void *arg), void *arg)
+{
+    struct conn_tuple_hash *tuphash;
+
+    if (nbuckets > DPVS_CONN_TBL_SIZE)
+        nbuckets = DPVS_CONN_TBL_SIZE;
+
+#ifdef CONFIG_DPVS_IPVS_CONN_LOCK
+    rte_spinlock_lock(&this_conn_lock);
+#endif
+    for ( ; nbuckets > 0; nbuckets--) {
+        list_for_each_entry(tuphash, &this_conn_tbl[*cursor & DPVS_CONN_TBL_MASK], list) {
+            if (tuphash->direct == DPVS_CONN_DIR_INBOUND)
+                fn(tuplehash_to_conn(tuphash), arg);
+        }
+        *cursor = (*cursor + 1) & DPVS_CONN_TBL_MASK;
+    }
+#ifdef CONFIG_DPVS_IPVS_CONN_LOCK
+    rte_spinlock_unlock(&this_conn_lock);
+#endif
+}
+
+/*
+ * rebuild one handed-off connection on this lcore. fails with
+ * EDPVS_NOTEXIST until its service, dest and laddr are configured.
+ */
+int dp_vs_conn_handoff_import(const struct dp_vs_handoff_conn *hc,
+                              uint32_t timeout)
+{
+    struct dp_vs_service *svc;
+    struct dp_vs_dest *dest;
+    struct dp_vs_conn *new;
+    struct conn_tuple_hash *t;
+    int dir, err;
+
+    svc = dp_vs_service_lookup(hc->af, hc->proto, &hc->vaddr, hc->vport,
+                               0, NULL, NULL, NULL, rte_lcore_id());
+    if (!svc)
+        return EDPVS_NOTEXIST;
+
+    dest = dp_vs_lookup_dest(hc->daf, svc, &hc->daddr, hc->dport);
+    if (!dest)
+        return EDPVS_NOTEXIST;
+
+    /* SNAT conns are matched by mbuf, not by vaddr:vport */
+    if (dest->fwdmode == DPVS_FWD_MODE_SNAT)
+        return EDPVS_NOTSUPP;
+
+    new = dp_vs_conn_get(hc->af, hc->proto, &hc->caddr, &hc->vaddr,
+                         hc->cport, hc->vport, &dir, false);
+    if (new) {
+        dp_vs_conn_put_no_reset(new);
+        return EDPVS_EXIST;
+    }
+
+    new = dp_vs_conn_alloc(dest->fwdmode, hc->flags);
+    if (unlikely(!new))
+        return EDPVS_NOMEM;
+
+    new->flags = hc->flags & ~DPVS_CONN_F_INACTIVE;
+
+    t = &tuplehash_in(new);
+    t->direct   = DPVS_CONN_DIR_INBOUND;
+    t->af       = hc->af;
+    t->proto    = hc->proto;
+    t->saddr    = hc->caddr;
+    t->sport    = hc->cport;
+    t->daddr    = hc->vaddr;
+    t->dport    = hc->vport;
+    INIT_LIST_HEAD(&t->list);
+
+    t = &tuplehash_out(new);
+    t->direct   = DPVS_CONN_DIR_OUTBOUND;
+    t->af       = hc->daf;
+    t->proto    = hc->proto;
+    t->saddr    = hc->daddr;
+    t->sport    = hc->dport;
+    t->daddr    = hc->laddr;
+    t->dport    = hc->lport;
+    INIT_LIST_HEAD(&t->list);
+
+    new->af     = hc->af;
+    new->proto  = hc->proto;
+    new->caddr  = hc->caddr;
+    new->cport  = hc->cport;
+    new->vaddr  = hc->vaddr;
+    new->vport  = hc->vport;
+    new->laddr  = hc->laddr;
+    new->lport  = hc->lport;
+    new->daddr  = hc->daddr;
+    new->dport  = hc->dport;
+
+    if (AF_INET == hc->af)
+        new->in_nexthop.in.s_addr = htonl(INADDR_ANY);
+    else
+        new->in_nexthop.in6 = in6addr_any;
+
+    if (AF_INET == hc->daf)
+        new->out_nexthop.in.s_addr = htonl(INADDR_ANY);
+    else
+        new->out_nexthop.in6 = in6addr_any;
+
+    rte_atomic32_set(&new->refcnt, 1);
+    new->state          = hc->state;
+    new->old_state      = hc->state;
+    new->fnat_seq       = hc->fnat_seq;
+    new->syn_proxy_seq  = hc->syn_proxy_seq;
+    new->rs_end_seq     = hc->rs_end_seq;
+    new->rs_end_ack     = hc->rs_end_ack;
+#ifdef CONFIG_DPVS_IPVS_STATS_DEBUG
+    new->ctime = rte_rdtsc();
+#endif
+
+    err = dp_vs_conn_bind_dest(new, dest);
+    if (err != EDPVS_OK)
+        goto errout;
+
+    /* bind_dest counts the conn as inactive, same as a new one */
+    if (hc->flags & DPVS_CONN_F_INACTIVE) {
+        new->inact = hc->inact;
+        new->flags |= DPVS_CONN_F_INACTIVE;
+        dest->inact_timestamp_weight += new->inact;
+    } else {
+        new->act = hc->act;
+        dest->act_timestamp_weight += new->act;
+        rte_atomic32_dec(&dest->inactconns);
+        rte_atomic32_inc(&dest->actconns);
+        new->flags &= ~DPVS_CONN_F_INACTIVE;
+    }
+
+    if (hc->has_ext || (new->flags & DPVS_CONN_F_SYNPROXY)) {
+        if ((err = dp_vs_conn_ext_alloc(new)) != EDPVS_OK)
+            goto unbind_dest;
+        if (hc->has_ext) {
+            new->ext->tsval         = hc->tsval;
+            new->ext->tsecr         = hc->tsecr;
+            new->ext->tscent        = hc->tscent;
+            new->ext->clienttsval   = hc->clienttsval;
+        }
+    }
+
+    if (dest->fwdmode == DPVS_FWD_MODE_FNAT) {
+        if ((err = dp_vs_laddr_rebind(new, svc)) != EDPVS_OK)
+            goto unbind_dest;
+    }
+
+    dp_vs_redirect_init(new);
+
+    if ((err = dp_vs_conn_hash(new)) != EDPVS_OK)
+        goto unbind_laddr;
+
+    new->timeout.tv_sec = timeout;
+    new->timeout.tv_usec = 0;
+    dp_vs_conn_attach_timer(new, true);
+
+    rte_atomic32_dec(&new->refcnt);
+    return EDPVS_OK;
+
+unbind_laddr:
+    dp_vs_laddr_unbind(new);
+unbind_dest:
+    dp_vs_conn_unbind_dest(new);
+errout:
+    dp_vs_conn_free(new);
+    return err;
+}
+
 /**
  * try lookup and hold dp_vs_conn{} by packet tuple
  *
@@ -1145,6 +1463,60 @@ static void dp_vs_conn_put_nolock(struct dp_vs_conn *conn)
     rte_atomic32_dec(&conn->refcnt);
 }
 
+/*
+ * pick the lcore to populate the per-socket pools: a forwarding lcore of
+ * the socket if any, otherwise master if it's on the socket. the pool
+ * memory is then touched by a local core and different sockets can be
+ * populated in parallel. return RTE_MAX_LCORE if no lcore is on the socket.
+ */
+lcoreid_t dp_vs_conn_pool_lcore(int socket)
+{
+    lcoreid_t cid;
+
+    RTE_LCORE_FOREACH_SLAVE(cid) {
+        if (rte_lcore_to_socket_id(cid) == socket && !netif_lcore_is_idle(cid))
+            return cid;
+    }
+
+    if (rte_lcore_to_socket_id(rte_get_master_lcore()) == socket)
+        return rte_get_master_lcore();
+
+    return RTE_MAX_LCORE;
+}
+
+static int conn_pool_create(int socket)
+{
+    char poolname[32];
+    uint64_t start = rte_get_timer_cycles();
+
+    /* conns are never DMA'ed, no need of physically contiguous memory */
+    snprintf(poolname, sizeof(poolname), "dp_vs_conn_%d", socket);
+    dp_vs_conn_cache[socket] = rte_mempool_create(poolname,
+                                    conn_pool_size,
+                                    sizeof(struct dp_vs_conn),
+                                    conn_pool_cache,
+                                    0, NULL, NULL, NULL, NULL,
+                                    socket, MEMPOOL_F_NO_PHYS_CONTIG);
+    if (!dp_vs_conn_cache[socket])
+        return EDPVS_NOMEM;
+
+    snprintf(poolname, sizeof(poolname), "dp_vs_conn_ext_%d", socket);
+    dp_vs_conn_ext_cache[socket] = rte_mempool_create(poolname,
+                                    conn_ext_pool_size,
+                                    sizeof(struct dp_vs_conn_ext),
+                                    conn_pool_cache,
+                                    0, NULL, NULL, NULL, NULL,
+                                    socket, MEMPOOL_F_NO_PHYS_CONTIG);
+    if (!dp_vs_conn_ext_cache[socket])
+        return EDPVS_NOMEM;
+
+    RTE_LOG(INFO, IPVS, "%s: conn pools of socket %d populated on lcore %d "
+            "in %lu ms\n", __func__, socket, rte_lcore_id(),
+            (rte_get_timer_cycles() - start) * 1000 / rte_get_timer_hz());
+
+    return EDPVS_OK;
+}
+
 static int conn_init_lcore(void *arg)
 {
     int i;
@@ -1169,6 +1541,9 @@ static int conn_init_lcore(void *arg)
 #endif
     this_conn_count = 0;
 
+    if (dp_vs_conn_pool_lcores[rte_socket_id()] == rte_lcore_id())
+        return conn_pool_create(rte_socket_id());
+
     return EDPVS_OK;
 }
 
@@ -1196,13 +1571,41 @@ static int conn_term_lcore(void *arg)
 struct ip_vs_conn_array_list {
     int head;
     int tail;
+    uint32_t gen;               /* dump session the chunk belongs to */
     struct list_head ca_list;
     ipvs_conn_entry_t array[0];
 };
 
+/*
+ * A worker never walks its whole conn table at once. The dump job walks
+ * DPVS_CONN_DUMP_BUCKETS buckets per loop from a cursor, and hands filled
+ * chunks to master through a per-lcore ring. Master never waits for the
+ * workers: it returns whatever is staged, with GET_IPVS_CONN_RESL_MORE set
+ * until every worker has finished the current session.
+ */
+#define DPVS_CONN_DUMP_BUCKETS      1024
+#define DPVS_CONN_DUMP_RING_SIZE    32
+
+struct conn_dump_lcore {
+    /* shared with master */
+    struct rte_ring *ring;
+    volatile uint32_t gen;      /* written by master to start a session */
+    volatile uint32_t done;     /* written by worker when gen is staged */
+    volatile int err;
+    struct ip_vs_conn_filter filter;
+
+    /* worker private */
+    uint32_t walk_gen;
+    uint32_t cursor;
+    struct ip_vs_conn_filter walk_filter;
+    struct ip_vs_conn_array_list *cparr;
+    struct list_head backlog;   /* chunks the ring had no room for */
+} __rte_cache_aligned;
+
 static uint8_t g_slave_lcore_nb;
 static uint64_t g_slave_lcore_mask;
 static struct list_head conn_to_dump;
+static struct conn_dump_lcore conn_dumps[DPVS_MAX_LCORE];
 
 static inline char* get_conn_state_name(uint16_t proto, uint16_t state)
 {
@@ -1350,10 +1753,56 @@ static int sockopt_conn_get_specified(const struct ip_vs_conn_req *conn_req,
     return EDPVS_NOTEXIST;
 }
 
+static bool conn_dump_match(const struct dp_vs_conn *conn,
+        const struct ip_vs_conn_filter *filter)
+{
+    if (filter->proto && conn->proto != filter->proto)
+        return false;
+
+    if (filter->flags & GET_IPVS_CONN_FILTER_VADDR) {
+        if (tuplehash_in(conn).af != filter->af ||
+                !inet_addr_equal(filter->af, &conn->vaddr, &filter->vaddr))
+            return false;
+        if (filter->vport && conn->vport != filter->vport)
+            return false;
+    }
+
+    if (filter->flags & GET_IPVS_CONN_FILTER_DADDR) {
+        if (tuplehash_out(conn).af != filter->daf ||
+                !inet_addr_equal(filter->daf, &conn->daddr, &filter->daddr))
+            return false;
+        if (filter->dport && conn->dport != filter->dport)
+            return false;
+    }
+
+    if (filter->flags & GET_IPVS_CONN_FILTER_STATE) {
+        if (strcasecmp(get_conn_state_name(conn->proto, conn->state),
+                    filter->state))
+            return false;
+    }
+
+    return true;
+}
+
+static inline struct ip_vs_conn_array_list *conn_dump_chunk_alloc(uint32_t gen)
+{
+    struct ip_vs_conn_array_list *cparr;
+
+    cparr = rte_zmalloc("conn_ctrl", sizeof(struct ip_vs_conn_array_list)
+            + MAX_CTRL_CONN_GET_ENTRIES * sizeof(ipvs_conn_entry_t), 0);
+    if (unlikely(cparr == NULL))
+        return NULL;
+    cparr->head = cparr->tail = 0;
+    cparr->gen = gen;
+
+    return cparr;
+}
+
 /* call me on the same lcore as the conn table,
  * lock me if the conn table is global
  * */
-static int __lcore_conn_table_dump(const struct list_head *cplist)
+static int __lcore_conn_table_dump(const struct list_head *cplist,
+        const struct ip_vs_conn_filter *filter)
 {
     int i;
     struct conn_tuple_hash *tuphash;
@@ -1365,12 +1814,12 @@ static int __lcore_conn_table_dump(const struct list_head *cplist)
             if (tuphash->direct != DPVS_CONN_DIR_INBOUND)
                 continue;
             conn = tuplehash_to_conn(tuphash);
+            if (!conn_dump_match(conn, filter))
+                continue;
             if (unlikely(cparr == NULL || cparr->tail >= MAX_CTRL_CONN_GET_ENTRIES)) {
-                cparr = rte_zmalloc("conn_ctrl", sizeof(struct ip_vs_conn_array_list)
-                        + MAX_CTRL_CONN_GET_ENTRIES * sizeof(ipvs_conn_entry_t), 0);
+                cparr = conn_dump_chunk_alloc(0);
                 if (unlikely(cparr == NULL))
                     return EDPVS_NOMEM;
-                cparr->head = cparr->tail = 0;
             }
             sockopt_fill_conn_entry(conn, &cparr->array[cparr->tail++]);
             if (cparr->tail >= MAX_CTRL_CONN_GET_ENTRIES) {
@@ -1390,57 +1839,195 @@ static int __lcore_conn_table_dump(const struct list_head *cplist)
     return EDPVS_OK;
 }
 
-static int sockopt_conn_get_all(const struct ip_vs_conn_req *conn_req,
-        struct ip_vs_conn_array *conn_arr)
+static void conn_dump_reset(struct conn_dump_lcore *d)
+{
+    struct ip_vs_conn_array_list *calst, *tcalst;
+
+    if (d->cparr) {
+        rte_free(d->cparr);
+        d->cparr = NULL;
+    }
+    list_for_each_entry_safe(calst, tcalst, &d->backlog, ca_list) {
+        list_del_init(&calst->ca_list);
+        rte_free(calst);
+    }
+}
+
+/* hand staged chunks to master, false if the ring is still full */
+static bool conn_dump_flush(struct conn_dump_lcore *d)
+{
+    struct ip_vs_conn_array_list *calst, *tcalst;
+
+    list_for_each_entry_safe(calst, tcalst, &d->backlog, ca_list) {
+        if (rte_ring_enqueue(d->ring, calst) != 0)
+            return false;
+        list_del_init(&calst->ca_list);
+    }
+
+    return true;
+}
+
+static inline void conn_dump_stage(struct conn_dump_lcore *d)
+{
+    if (list_empty(&d->backlog) && rte_ring_enqueue(d->ring, d->cparr) == 0) {
+        d->cparr = NULL;
+        return;
+    }
+    list_add_tail(&d->cparr->ca_list, &d->backlog);
+    d->cparr = NULL;
+}
+
+static void conn_dump_job(void *arg)
+{
+    struct conn_dump_lcore *d = &conn_dumps[rte_lcore_id()];
+    struct conn_tuple_hash *tuphash;
+    struct dp_vs_conn *conn;
+    uint32_t gen = d->gen, end;
+
+    if (likely(gen == d->done))
+        return;
+
+    if (gen != d->walk_gen) { /* new session, drop what is left of the old one */
+        conn_dump_reset(d);
+        rte_rmb();
+        d->walk_filter = d->filter;
+        d->walk_gen = gen;
+        d->cursor = 0;
+    }
+
+    if (!conn_dump_flush(d))
+        return; /* master is slow, keep the cursor */
+
+    end = RTE_MIN(d->cursor + DPVS_CONN_DUMP_BUCKETS, (uint32_t)DPVS_CONN_TBL_SIZE);
+
+#ifdef CONFIG_DPVS_IPVS_CONN_LOCK
+    rte_spinlock_lock(&this_conn_lock);
+#endif
+    for ( ; d->cursor < end; d->cursor++) {
+        list_for_each_entry(tuphash, &this_conn_tbl[d->cursor], list) {
+            if (tuphash->direct != DPVS_CONN_DIR_INBOUND)
+                continue;
+            conn = tuplehash_to_conn(tuphash);
+            if (!conn_dump_match(conn, &d->walk_filter))
+                continue;
+            if (unlikely(d->cparr == NULL)) {
+                d->cparr = conn_dump_chunk_alloc(gen);
+                if (unlikely(d->cparr == NULL)) {
+#ifdef CONFIG_DPVS_IPVS_CONN_LOCK
+                    rte_spinlock_unlock(&this_conn_lock);
+#endif
+                    conn_dump_reset(d);
+                    d->err = EDPVS_NOMEM;
+                    rte_wmb();
+                    d->done = gen;
+                    return;
+                }
+            }
+            sockopt_fill_conn_entry(conn, &d->cparr->array[d->cparr->tail++]);
+            if (d->cparr->tail >= MAX_CTRL_CONN_GET_ENTRIES)
+                conn_dump_stage(d);
+        }
+        /* stop at bucket boundary once master falls behind */
+        if (!list_empty(&d->backlog)) {
+            d->cursor++;
+            break;
+        }
+    }
+#ifdef CONFIG_DPVS_IPVS_CONN_LOCK
+    rte_spinlock_unlock(&this_conn_lock);
+#endif
+
+    if (d->cursor < DPVS_CONN_TBL_SIZE)
+        return;
+
+    if (d->cparr)
+        conn_dump_stage(d);
+    if (!conn_dump_flush(d))
+        return;
+
+    rte_wmb();
+    d->done = gen;
+}
+
+static struct dpvs_lcore_job conn_dump_lcore_job = {
+    .name = "conn_dump",
+    .func = conn_dump_job,
+    .data = NULL,
+    .type = LCORE_JOB_LOOP,
+};
+
+/* start a new dump session on all workers, results of older ones are dropped */
+static void conn_dump_start(const struct ip_vs_conn_filter *filter)
 {
-    int n, res, got = 0;
+    struct ip_vs_conn_array_list *calst, *tcalst;
+    lcoreid_t cid;
+
+    list_for_each_entry_safe(calst, tcalst, &conn_to_dump, ca_list) {
+        list_del_init(&calst->ca_list);
+        rte_free(calst);
+    }
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!(g_slave_lcore_mask & (1UL << cid)))
+            continue;
+        while (rte_ring_dequeue(conn_dumps[cid].ring, (void **)&calst) == 0)
+            rte_free(calst);
+        conn_dumps[cid].filter = *filter;
+        conn_dumps[cid].err = EDPVS_OK;
+        rte_wmb();
+        conn_dumps[cid].gen++;
+    }
+}
+
+/* move staged entries into conn_arr, true if conn_arr is full */
+static bool conn_dump_copy(struct ip_vs_conn_array *conn_arr, int *got)
+{
+    int n;
     struct ip_vs_conn_array_list *larr, *next_larr;
-    struct dpvs_msg *msg;
-    lcoreid_t cid = conn_req->whence;
 
-again:
     list_for_each_entry_safe(larr, next_larr, &conn_to_dump, ca_list) {
         RTE_LOG(DEBUG, IPVS, "%s: printing conn_to_dump list(len=%d) --"
                 "%p:%d-%d\n", __func__, list_elems(&conn_to_dump), larr,
                 larr->head, larr->tail);
-        n = larr->tail - larr->head;
-        assert(n > 0);
-        if (n > MAX_CTRL_CONN_GET_ENTRIES - got) {
-            memcpy(&conn_arr->array[got], &larr->array[larr->head],
-                    (MAX_CTRL_CONN_GET_ENTRIES - got) * sizeof(ipvs_conn_entry_t));
-            larr->head += MAX_CTRL_CONN_GET_ENTRIES - got;
-            got += MAX_CTRL_CONN_GET_ENTRIES - got;
-
-            assert(got == MAX_CTRL_CONN_GET_ENTRIES);
-            conn_arr->nconns = got;
-            /* small chance that all done here, we assign GET_IPVS_CONN_RESL_MORE
-             * flag for simplicity here anyway */
-            conn_arr->resl = GET_IPVS_CONN_RESL_OK | GET_IPVS_CONN_RESL_MORE;
-            conn_arr->curcid = cid;
-            return EDPVS_OK;
-        } else {
-            memcpy(&conn_arr->array[got], &larr->array[larr->head],
-                    n * sizeof(ipvs_conn_entry_t));
-            larr->head += n;
-            assert(larr->head == larr->tail);
+        n = RTE_MIN(larr->tail - larr->head, MAX_CTRL_CONN_GET_ENTRIES - *got);
+        memcpy(&conn_arr->array[*got], &larr->array[larr->head],
+                n * sizeof(ipvs_conn_entry_t));
+        larr->head += n;
+        *got += n;
+        if (larr->head == larr->tail) {
             list_del_init(&larr->ca_list);
             rte_free(larr);
-            got += n;
-            if (got == MAX_CTRL_CONN_GET_ENTRIES) {
-                conn_arr->nconns = got;
-                /* low chance that all done here, we assign GET_IPVS_CONN_RESL_MORE
-                 * flag for simplicity here anyway */
-                conn_arr->resl = GET_IPVS_CONN_RESL_OK | GET_IPVS_CONN_RESL_MORE;
-                conn_arr->curcid = cid;
-                return EDPVS_OK;
-            }
         }
+        if (*got == MAX_CTRL_CONN_GET_ENTRIES)
+            return true;
+    }
+
+    return false;
+}
+
+static int sockopt_conn_get_all(const struct ip_vs_conn_req *conn_req,
+        struct ip_vs_conn_array *conn_arr)
+{
+    int res, got = 0;
+    uint32_t done;
+    struct conn_dump_lcore *d;
+    struct ip_vs_conn_array_list *larr;
+    lcoreid_t cid = conn_req->whence;
+
+again:
+    if (conn_dump_copy(conn_arr, &got)) {
+        conn_arr->nconns = got;
+        /* small chance that all done here, we assign GET_IPVS_CONN_RESL_MORE
+         * flag for simplicity here anyway */
+        conn_arr->resl = GET_IPVS_CONN_RESL_OK | GET_IPVS_CONN_RESL_MORE;
+        conn_arr->curcid = cid;
+        return EDPVS_OK;
     }
 
     if ((conn_req->flag & GET_IPVS_CONN_FLAG_TEMPLATE)
             && (cid == rte_get_master_lcore())) { /* persist conns */
         rte_spinlock_lock(&dp_vs_ct_lock);
-        res = __lcore_conn_table_dump(dp_vs_ct_tbl);
+        res = __lcore_conn_table_dump(dp_vs_ct_tbl, &conn_req->filter);
         rte_spinlock_unlock(&dp_vs_ct_lock);
         if (res != EDPVS_OK) {
             conn_arr->nconns = got;
@@ -1469,27 +2056,40 @@ again:
         return EDPVS_OK;
     }
 
-    /* get conns table from cid and saved into dump list */
-    msg = msg_make(MSG_TYPE_CONN_GET_ALL, 0, DPVS_MSG_UNICAST, rte_lcore_id(), 0, NULL);
-    /* FIXME: When conns in session table are not many enough, blockable msg would get
-     * timeout probably due to the traverse of the whole huge session table.  So non-
-     * blockable msg is used. A more elegant solution is to use an upper time limit for
-     * the session table access in this case, which is much more complicated. */
-    res = msg_send(msg, cid, DPVS_MSG_F_ASYNC, NULL);
-    while (!test_msg_flags(msg, DPVS_MSG_F_STATE_FIN|DPVS_MSG_F_STATE_DROP))
-        ; /* wait until msg processed */
+    /* pick up what lcore cid has staged so far, never wait for it */
+    d = &conn_dumps[cid];
+    done = d->done;
+    rte_rmb();
+    while (rte_ring_dequeue(d->ring, (void **)&larr) == 0) {
+        if (larr->gen != d->gen) { /* left over by an aborted session */
+            rte_free(larr);
+            continue;
+        }
+        list_add_tail(&larr->ca_list, &conn_to_dump);
+        if (conn_dump_copy(conn_arr, &got)) {
+            conn_arr->nconns = got;
+            conn_arr->resl = GET_IPVS_CONN_RESL_OK | GET_IPVS_CONN_RESL_MORE;
+            conn_arr->curcid = cid;
+            return EDPVS_OK;
+        }
+    }
+
+    if (done != d->gen) { /* still walking */
+        conn_arr->nconns = got;
+        conn_arr->resl = GET_IPVS_CONN_RESL_OK | GET_IPVS_CONN_RESL_MORE;
+        conn_arr->curcid = cid;
+        return EDPVS_OK;
+    }
 
-    if (res != EDPVS_OK || test_msg_flags(msg, DPVS_MSG_F_STATE_DROP|
-                DPVS_MSG_F_CALLBACK_FAIL)) {
+    if (d->err != EDPVS_OK) {
         RTE_LOG(WARNING, IPVS, "%s: fail to get lcore%d's connection table -- %s\n",
-                __func__, (int)cid, dpvs_strerror(res));
+                __func__, (int)cid, dpvs_strerror(d->err));
         conn_arr->nconns = got;
         conn_arr->resl = GET_IPVS_CONN_RESL_FAIL;
         conn_arr->curcid = cid;
-        msg_destroy(&msg);
-        return res;
+        return d->err;
     }
-    msg_destroy(&msg);
+
     cid++;
     goto again;
 }
@@ -1526,13 +2126,8 @@ static int sockopt_conn_get(sockoptid_t opt, const void *in, size_t inlen,
         {
             if (!(conn_req->flag & (GET_IPVS_CONN_FLAG_ALL|GET_IPVS_CONN_FLAG_MORE)))
                 return EDPVS_INVAL;
-            if (!(conn_req->flag & GET_IPVS_CONN_FLAG_MORE)) {
-                struct ip_vs_conn_array_list *calst, *tcalst;
-                list_for_each_entry_safe(calst, tcalst, &conn_to_dump, ca_list) {
-                    list_del_init(&calst->ca_list);
-                    rte_free(calst);
-                }
-            }
+            if (!(conn_req->flag & GET_IPVS_CONN_FLAG_MORE))
+                conn_dump_start(&conn_req->filter);
 
             arr_size = sizeof(struct ip_vs_conn_array) + MAX_CTRL_CONN_GET_ENTRIES *
                 sizeof(ipvs_conn_entry_t);
@@ -1613,16 +2208,10 @@ static int conn_get_msgcb_slave(struct dpvs_msg *msg)
     return EDPVS_OK;
 }
 
-static int conn_get_all_msgcb_slave(struct dpvs_msg *msg)
-{
-    return  __lcore_conn_table_dump(this_conn_tbl);
-}
-
 static int register_conn_get_msg(void)
 {
     int ret;
-    unsigned ii;
-    struct dpvs_msg_type conn_get, conn_get_all;
+    struct dpvs_msg_type conn_get;
 
     memset(&conn_get, 0, sizeof(struct dpvs_msg_type));
     conn_get.type = MSG_TYPE_CONN_GET;
@@ -1637,31 +2226,13 @@ static int register_conn_get_msg(void)
         return ret;
     }
 
-    memset(&conn_get_all, 0, sizeof(struct dpvs_msg_type));
-    conn_get_all.type = MSG_TYPE_CONN_GET_ALL;
-    conn_get_all.mode = DPVS_MSG_UNICAST;
-    conn_get_all.prio = MSG_PRIO_LOW;
-    conn_get_all.unicast_msg_cb = conn_get_all_msgcb_slave;
-    conn_get_all.multicast_msg_cb = NULL;
-    for (ii = 0; ii < DPVS_MAX_LCORE; ii++) {
-        if (!(g_slave_lcore_mask & (1UL << ii)))
-            continue;
-        conn_get_all.cid = ii;
-        if ((ret = msg_type_register(&conn_get_all)) < 0) {
-            RTE_LOG(ERR, IPVS, "%s: fail to register conn-get-all msg"
-                    " on lcore%d -- %s\n", __func__, ii, dpvs_strerror(ret));
-            return ret;
-        }
-    }
-
     return EDPVS_OK;
 }
 
 static int unregister_conn_get_msg(void)
 {
     int ret = EDPVS_OK;
-    unsigned ii;
-    struct dpvs_msg_type conn_get, conn_get_all;
+    struct dpvs_msg_type conn_get;
 
     memset(&conn_get, 0, sizeof(struct dpvs_msg_type));
     conn_get.type = MSG_TYPE_CONN_GET;
@@ -1674,23 +2245,50 @@ static int unregister_conn_get_msg(void)
                 __func__, dpvs_strerror(ret));
     }
 
-    memset(&conn_get_all, 0, sizeof(struct dpvs_msg_type));
-    conn_get_all.type = MSG_TYPE_CONN_GET_ALL;
-    conn_get_all.mode = DPVS_MSG_UNICAST;
-    conn_get_all.prio = MSG_PRIO_LOW;
-    conn_get_all.unicast_msg_cb = conn_get_msgcb_slave;
-    conn_get_all.multicast_msg_cb = NULL;
-    for (ii = 0; ii < DPVS_MAX_LCORE; ii++) {
-        if (!(g_slave_lcore_mask & (1UL << ii)))
+    return ret;
+}
+
+static void conn_dump_term(void)
+{
+    struct ip_vs_conn_array_list *calst;
+    lcoreid_t cid;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!conn_dumps[cid].ring)
+            continue;
+        while (rte_ring_dequeue(conn_dumps[cid].ring, (void **)&calst) == 0)
+            rte_free(calst);
+        rte_ring_free(conn_dumps[cid].ring);
+        conn_dumps[cid].ring = NULL;
+        conn_dump_reset(&conn_dumps[cid]);
+    }
+}
+
+static int conn_dump_init(void)
+{
+    char ring_name[RTE_RING_NAMESIZE];
+    lcoreid_t cid;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        memset(&conn_dumps[cid], 0, sizeof(conn_dumps[cid]));
+        INIT_LIST_HEAD(&conn_dumps[cid].backlog);
+    }
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!(g_slave_lcore_mask & (1UL << cid)))
             continue;
-        conn_get_all.cid = ii;
-        if ((ret = msg_type_unregister(&conn_get_all)) < 0) {
-            RTE_LOG(WARNING, IPVS, "%s: fail to unregister conn-get-all msg "
-                    "on lcore%d -- %s\n", __func__, ii, dpvs_strerror(ret));
+        snprintf(ring_name, sizeof(ring_name), "conn_dump_%d", cid);
+        conn_dumps[cid].ring = rte_ring_create(ring_name, DPVS_CONN_DUMP_RING_SIZE,
+                rte_lcore_to_socket_id(cid), RING_F_SP_ENQ | RING_F_SC_DEQ);
+        if (!conn_dumps[cid].ring) {
+            RTE_LOG(ERR, IPVS, "%s: fail to create conn dump ring for lcore%d\n",
+                    __func__, cid);
+            conn_dump_term();
+            return EDPVS_NOMEM;
         }
     }
 
-    return ret;
+    return EDPVS_OK;
 }
 
 static int conn_ctrl_init(void)
@@ -1700,12 +2298,26 @@ static int conn_ctrl_init(void)
     INIT_LIST_HEAD(&conn_to_dump);
     netif_get_slave_lcores(&g_slave_lcore_nb, &g_slave_lcore_mask);
 
-    if ((err = register_conn_get_msg()) != EDPVS_OK)
+    if ((err = conn_dump_init()) != EDPVS_OK)
         return err;
 
+    if ((err = dpvs_lcore_job_register(&conn_dump_lcore_job,
+                    LCORE_ROLE_FWD_WORKER)) != EDPVS_OK) {
+        conn_dump_term();
+        return err;
+    }
+
+    if ((err = register_conn_get_msg()) != EDPVS_OK) {
+        dpvs_lcore_job_unregister(&conn_dump_lcore_job, LCORE_ROLE_FWD_WORKER);
+        conn_dump_term();
+        return err;
+    }
+
     if ((err = sockopt_register(&conn_sockopts)) != EDPVS_OK) {
         RTE_LOG(ERR, IPVS, "%s: fail to register conn_sockopts\n", __func__);
         unregister_conn_get_msg();
+        dpvs_lcore_job_unregister(&conn_dump_lcore_job, LCORE_ROLE_FWD_WORKER);
+        conn_dump_term();
         return err;
     }
 
@@ -1723,13 +2335,14 @@ static void conn_ctrl_term(void)
 
     sockopt_unregister(&conn_sockopts);
     unregister_conn_get_msg();
+    dpvs_lcore_job_unregister(&conn_dump_lcore_job, LCORE_ROLE_FWD_WORKER);
+    conn_dump_term();
 }
 
 int dp_vs_conn_init(void)
 {
     int i, err;
     lcoreid_t lcore;
-    char poolname[32];
 
     /* init connection template table */
     dp_vs_ct_tbl = rte_malloc_socket(NULL, sizeof(struct list_head) * DPVS_CONN_TBL_SIZE,
@@ -1739,10 +2352,15 @@ int dp_vs_conn_init(void)
         INIT_LIST_HEAD(&dp_vs_ct_tbl[i]);
     rte_spinlock_init(&dp_vs_ct_lock);
 
+    for (i = 0; i < get_numa_nodes(); i++)
+        dp_vs_conn_pool_lcores[i] = dp_vs_conn_pool_lcore(i);
+
     /*
      * unlike linux per_cpu() which can assign CPU number,
      * RTE_PER_LCORE() can only access own instances.
      * it make codes looks strange.
+     *
+     * per-socket conn pools are populated by slaves in parallel as well.
      */
     rte_eal_mp_remote_launch(conn_init_lcore, NULL, SKIP_MASTER);
     RTE_LCORE_FOREACH_SLAVE(lcore) {
@@ -1754,16 +2372,17 @@ int dp_vs_conn_init(void)
 
     conn_ctrl_init();
 
-    /* connection cache on each NUMA socket */
+    /* connection cache on each NUMA socket with lcores */
     for (i = 0; i < get_numa_nodes(); i++) {
-        snprintf(poolname, sizeof(poolname), "dp_vs_conn_%d", i);
-        dp_vs_conn_cache[i] = rte_mempool_create(poolname,
-                                    conn_pool_size,
-                                    sizeof(struct dp_vs_conn),
-                                    conn_pool_cache,
-                                    0, NULL, NULL, NULL, NULL,
-                                    i, 0);
-        if (!dp_vs_conn_cache[i]) {
+        if (dp_vs_conn_pool_lcores[i] == RTE_MAX_LCORE)
+            continue;
+
+        if (dp_vs_conn_pool_lcores[i] == rte_get_master_lcore())
+            conn_pool_create(i);
+
+        if (!dp_vs_conn_cache[i] || !dp_vs_conn_ext_cache[i]) {
+            RTE_LOG(ERR, IPVS, "%s: fail to create conn pools on socket %d\n",
+                    __func__, i);
             err = EDPVS_NOMEM;
             goto cleanup;
         }
@@ -1799,6 +2418,11 @@ int dp_vs_conn_pool_size(void)
     return conn_pool_size;
 }
 
+int dp_vs_conn_tbl_size(void)
+{
+    return DPVS_CONN_TBL_SIZE;
+}
+
 int dp_vs_conn_pool_cache_size(void)
 {
     return conn_pool_cache;
@@ -1846,6 +2470,28 @@ static void conn_pool_cache_handler(vector_t tokens)
     FREE_PTR(str);
 }
 
+static void conn_ext_pool_size_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int pool_size;
+
+    assert(str);
+
+    pool_size = atoi(str);
+
+    if (pool_size < DPVS_CONN_EXT_POOL_SIZE_MIN) {
+        RTE_LOG(WARNING, IPVS, "invalid conn_ext_pool_size %s, using default %d\n",
+                str, DPVS_CONN_EXT_POOL_SIZE_DEF);
+        conn_ext_pool_size = DPVS_CONN_EXT_POOL_SIZE_DEF;
+    } else {
+        is_power2(pool_size, 0, &pool_size);
+        RTE_LOG(INFO, IPVS, "conn_ext_pool_size = %d (round to 2^n)\n", pool_size);
+        conn_ext_pool_size = pool_size;
+    }
+
+    FREE_PTR(str);
+}
+
 static void conn_init_timeout_handler(vector_t tokens)
 {
     char *str = set_value(tokens);
@@ -1897,11 +2543,15 @@ void ipvs_conn_keyword_value_init(void)
         /* KW_TYPE_INIT keyword */
         conn_pool_size = DPVS_CONN_POOL_SIZE_DEF;
         conn_pool_cache = DPVS_CONN_CACHE_SIZE_DEF;
+        conn_ext_pool_size = DPVS_CONN_EXT_POOL_SIZE_DEF;
         dp_vs_redirect_disable = true;
     }
     /* KW_TYPE_NORMAL keyword */
     conn_init_timeout = DPVS_CONN_INIT_TIMEOUT_DEF;
     conn_expire_quiescent_template = false;
+
+    handoff_keyword_value_init();
+    connlimit_keyword_value_init();
 }
 
 void install_ipvs_conn_keywords(void)
@@ -1909,10 +2559,13 @@ void install_ipvs_conn_keywords(void)
     install_sublevel();
     install_keyword("conn_pool_size", conn_pool_size_handler, KW_TYPE_INIT);
     install_keyword("conn_pool_cache", conn_pool_cache_handler, KW_TYPE_INIT);
+    install_keyword("conn_ext_pool_size", conn_ext_pool_size_handler, KW_TYPE_INIT);
     install_keyword("conn_init_timeout", conn_init_timeout_handler, KW_TYPE_NORMAL);
     install_keyword("expire_quiescent_template", conn_expire_quiscent_template_handler,
             KW_TYPE_NORMAL);
     install_keyword("redirect", conn_redirect_handler, KW_TYPE_INIT);
     install_xmit_keywords();
+    install_handoff_keywords();
+    install_connlimit_keywords();
     install_sublevel_end();
 }
@@ -0,0 +1,596 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#include <assert.h>
+#include <rte_jhash.h>
+#include "dpdk.h"
+#include "conf/common.h"
+#include "global_data.h"
+#include "netif.h"
+#include "ctrl.h"
+#include "linux_ipv6.h"
+#include "parser/parser.h"
+#include "ipvs/service.h"
+#include "ipvs/conn.h"
+#include "ipvs/connlimit.h"
+
+/**
+ * new connections of a client (prefix) to a service are paced by a
+ * token bucket. buckets are not allocated per client: every lcore keeps
+ * one count-min sketch of buckets for all services, a client maps to one
+ * cell per row, and the fullest of its cells tells its tokens. colliding
+ * clients can only make a bucket emptier, so the limit errs on the
+ * strict side; memory stays fixed however many sources show up.
+ *
+ * a client's connections are spread over the slave lcores by RSS, so
+ * each lcore grants 1/n of the rate and burst. token units are chosen so
+ * that a lcore refills exactly @rate units a millisecond and a
+ * connection costs 1000 * n units.
+ *
+ * concurrent connections are counted exactly as long as there is room.
+ * every lcore has a table of buckets, a cache line of eight slots each,
+ * a slot holding a client tag and how many connections of the client the
+ * lcore has. a client maps to the same bucket on all lcores, the check
+ * sums its slots over them. a slot is taken back once its count drops to
+ * zero; when all slots of a bucket are in use, a new client is let in
+ * uncounted, so a full table errs on the lenient side and never refuses
+ * a client for the sake of others. the lcore owning a connection is the
+ * only writer of its slot.
+ */
+
+#define DPVS_CONNLIMIT_ROWS         4
+#define DPVS_CONNLIMIT_COLS         (1 << 16)   /* power of 2 */
+#define DPVS_CONNLIMIT_MASK         (DPVS_CONNLIMIT_COLS - 1)
+
+#define DPVS_CONNLIMIT_MAX_BURST    (UINT32_MAX / 1000)
+
+#define DPVS_CONNLIMIT_SLOTS        8           /* a cache line */
+#define DPVS_CONNLIMIT_TBL_SIZE_DEF (1 << 20)   /* slots per lcore */
+#define DPVS_CONNLIMIT_TBL_SIZE_MIN DPVS_CONNLIMIT_SLOTS
+
+struct connlimit_cell {
+    uint32_t            tokens;
+    uint32_t            stamp;      /* ms */
+};
+
+struct connlimit_key {
+    uint32_t            addr[4];    /* client prefix */
+    uint64_t            limit;      /* the service of this lcore */
+};
+
+/* client prefix of a service, for the connection table */
+struct connlimit_conn_key {
+    uint32_t            addr[4];
+    uint32_t            svc_hash;
+};
+
+static struct connlimit_cell *dp_vs_connlimit_sketch[DPVS_MAX_LCORE];
+static uint64_t dp_vs_connlimit_cycles_ms;
+static uint32_t dp_vs_connlimit_cost;
+static uint32_t dp_vs_connlimit_rnd;
+
+/* slot: tag << 32 | count */
+static uint64_t *dp_vs_connlimit_conns[DPVS_MAX_LCORE];
+static uint32_t dp_vs_connlimit_bucket_mask;
+static lcoreid_t dp_vs_connlimit_lcores[DPVS_MAX_LCORE];
+static int dp_vs_connlimit_nlcores;
+
+static int connlimit_tbl_size = DPVS_CONNLIMIT_TBL_SIZE_DEF;
+
+static inline void connlimit_prefix(uint32_t *addr, uint8_t plen, int af,
+                                    const union inet_addr *saddr)
+{
+    if (af == AF_INET6) {
+        if (plen && plen < 128)
+            ipv6_addr_prefix((struct in6_addr *)addr, &saddr->in6, plen);
+        else
+            memcpy(addr, &saddr->in6, sizeof(saddr->in6));
+    } else {
+        addr[0] = saddr->in.s_addr;
+        if (plen && plen < 32)
+            addr[0] &= htonl(~0U << (32 - plen));
+    }
+}
+
+static inline void connlimit_key_fill(struct connlimit_key *key,
+                                      const struct dp_vs_connlimit *cl,
+                                      int af, const union inet_addr *saddr)
+{
+    memset(key, 0, sizeof(*key));
+    key->limit = (uint64_t)(uintptr_t)cl;
+    connlimit_prefix(key->addr, cl->plen, af, saddr);
+}
+
+/* bucket (first slot) and tag (never 0) of a client of a service */
+static inline void connlimit_conn_hash(const struct dp_vs_connlimit *cl,
+                                       int af, const union inet_addr *saddr,
+                                       uint32_t *slot, uint32_t *tag)
+{
+    struct connlimit_conn_key key;
+    uint32_t h1 = dp_vs_connlimit_rnd, h2 = 0;
+
+    memset(&key, 0, sizeof(key));
+    key.svc_hash = cl->svc_hash;
+    connlimit_prefix(key.addr, cl->plen, af, saddr);
+    rte_jhash_2hashes(&key, sizeof(key), &h1, &h2);
+
+    *slot = (h1 & dp_vs_connlimit_bucket_mask) * DPVS_CONNLIMIT_SLOTS;
+    *tag = h2 ? h2 : 1;
+}
+
+bool __dp_vs_connlimit_rate_check(struct dp_vs_connlimit *cl, int af,
+                                  const union inet_addr *saddr)
+{
+    struct connlimit_cell *sk = dp_vs_connlimit_sketch[rte_lcore_id()];
+    struct connlimit_cell *cell[DPVS_CONNLIMIT_ROWS];
+    struct connlimit_key key;
+    uint32_t h1 = dp_vs_connlimit_rnd, h2 = 0, now, left;
+    uint64_t tokens, best = 0;
+    int r;
+
+    if (unlikely(!sk))
+        return true;
+
+    connlimit_key_fill(&key, cl, af, saddr);
+    rte_jhash_2hashes(&key, sizeof(key), &h1, &h2);
+    h2 |= 1;
+
+    now = (uint32_t)(rte_get_timer_cycles() / dp_vs_connlimit_cycles_ms);
+
+    for (r = 0; r < DPVS_CONNLIMIT_ROWS; r++) {
+        cell[r] = &sk[r * DPVS_CONNLIMIT_COLS + ((h1 + r * h2) & DPVS_CONNLIMIT_MASK)];
+
+        tokens = cell[r]->tokens + (uint64_t)(uint32_t)(now - cell[r]->stamp)
+                                   * cl->rate;
+        if (tokens > cl->burst)
+            tokens = cl->burst;
+        cell[r]->tokens = tokens;
+        cell[r]->stamp = now;
+
+        if (tokens > best)
+            best = tokens;
+    }
+
+    if (best < dp_vs_connlimit_cost) {
+        cl->rate_drops++;
+        return false;
+    }
+
+    /* conservative update: lower no cell below what the client is left */
+    left = best - dp_vs_connlimit_cost;
+    for (r = 0; r < DPVS_CONNLIMIT_ROWS; r++) {
+        if (cell[r]->tokens > left)
+            cell[r]->tokens = left;
+    }
+
+    cl->passed++;
+    return true;
+}
+
+bool __dp_vs_connlimit_conn_over(struct dp_vs_connlimit *cl, int af,
+                                 const union inet_addr *saddr)
+{
+    const volatile uint64_t *bkt;
+    uint32_t slot, tag, conns = 0;
+    uint64_t val;
+    int i, j;
+
+    if (unlikely(!dp_vs_connlimit_nlcores))
+        return false;
+
+    connlimit_conn_hash(cl, af, saddr, &slot, &tag);
+
+    for (i = 0; i < dp_vs_connlimit_nlcores; i++)
+        rte_prefetch0(dp_vs_connlimit_conns[dp_vs_connlimit_lcores[i]] + slot);
+
+    for (i = 0; i < dp_vs_connlimit_nlcores; i++) {
+        bkt = dp_vs_connlimit_conns[dp_vs_connlimit_lcores[i]] + slot;
+        for (j = 0; j < DPVS_CONNLIMIT_SLOTS; j++) {
+            val = bkt[j];
+            if ((uint32_t)(val >> 32) == tag) {
+                conns += (uint32_t)val;
+                break;
+            }
+        }
+    }
+
+    return conns >= cl->conns;
+}
+
+bool __dp_vs_connlimit_conn_check(struct dp_vs_connlimit *cl, int af,
+                                  const union inet_addr *saddr)
+{
+    if (__dp_vs_connlimit_conn_over(cl, af, saddr)) {
+        cl->conn_drops++;
+        return false;
+    }
+    return true;
+}
+
+void dp_vs_connlimit_conn_hold(struct dp_vs_connlimit *cl,
+                               struct dp_vs_conn *conn)
+{
+    uint64_t *tbl = dp_vs_connlimit_conns[rte_lcore_id()];
+    uint32_t slot, tag;
+    int i, empty = -1;
+
+    if (unlikely(!tbl))
+        return;
+
+    connlimit_conn_hash(cl, conn->af, &conn->caddr, &slot, &tag);
+
+    for (i = 0; i < DPVS_CONNLIMIT_SLOTS; i++) {
+        if ((uint32_t)(tbl[slot + i] >> 32) == tag)
+            goto found;
+        if (empty < 0 && !(uint32_t)tbl[slot + i])
+            empty = i;
+    }
+
+    /* bucket full, let it go uncounted */
+    if (empty < 0)
+        return;
+    i = empty;
+    tbl[slot + i] = (uint64_t)tag << 32;
+
+found:
+    /* one store, read by other lcores without lock */
+    tbl[slot + i] = tbl[slot + i] + 1;
+    conn->climit_slot = slot + i;
+    conn->climit_tag = tag;
+}
+
+void dp_vs_connlimit_conn_put(struct dp_vs_conn *conn)
+{
+    uint64_t *tbl = dp_vs_connlimit_conns[rte_lcore_id()];
+    uint64_t val;
+
+    if (likely(tbl != NULL)) {
+        val = tbl[conn->climit_slot];
+        if ((uint32_t)(val >> 32) == conn->climit_tag && (uint32_t)val)
+            tbl[conn->climit_slot] = val - 1;
+    }
+    conn->climit_tag = 0;
+}
+
+static struct dp_vs_service *
+connlimit_service(const struct dp_vs_connlimit_conf *cf, lcoreid_t cid)
+{
+    struct dp_vs_service_entry entry;
+
+    memset(&entry, 0, sizeof(entry));
+    entry.af      = cf->af;
+    entry.proto   = cf->proto;
+    entry.addr    = cf->addr;
+    entry.port    = cf->port;
+    entry.fwmark  = cf->fwmark;
+    rte_memcpy(entry.srange, cf->srange, sizeof(cf->srange));
+    rte_memcpy(entry.drange, cf->drange, sizeof(cf->drange));
+    rte_memcpy(entry.iifname, cf->iifname, sizeof(cf->iifname));
+    rte_memcpy(entry.oifname, cf->oifname, sizeof(cf->oifname));
+
+    return dp_vs_get_service_lcore(&entry, cid);
+}
+
+static int connlimit_set(const struct dp_vs_connlimit_conf *cf, lcoreid_t cid)
+{
+    struct dp_vs_service *svc;
+    struct dp_vs_connlimit *cl;
+    uint32_t burst;
+
+    svc = connlimit_service(cf, cid);
+    if (!svc)
+        return EDPVS_NOTEXIST;
+    cl = &svc->climit;
+
+    burst = (cf->burst ? cf->burst : cf->rate) * 1000;
+    if (burst < dp_vs_connlimit_cost)
+        burst = dp_vs_connlimit_cost;
+
+    cl->conf_rate = cf->rate;
+    cl->conf_burst = cf->burst;
+    cl->plen = cf->plen;
+    cl->burst = burst;
+    cl->rate = cf->rate;
+
+    /* connections counted so far keep their slots (conn->climit_slot) */
+    cl->svc_hash = rte_jhash(&svc->addr, sizeof(svc->addr),
+                             rte_jhash_3words(svc->af, svc->proto << 16 | svc->port,
+                                              svc->fwmark, 0));
+    cl->policy = cf->policy;
+    cl->conns = cf->conns;
+
+    return EDPVS_OK;
+}
+
+static int connlimit_set_msg_cb(struct dpvs_msg *msg)
+{
+    assert(msg);
+
+    if (msg->len != sizeof(struct dp_vs_connlimit_conf))
+        return EDPVS_INVAL;
+
+    return connlimit_set((struct dp_vs_connlimit_conf *)msg->data,
+                         rte_lcore_id());
+}
+
+static int connlimit_get_msg_cb(struct dpvs_msg *msg)
+{
+    struct dp_vs_connlimit_conf *get, *output;
+    struct dp_vs_service *svc;
+    lcoreid_t cid = rte_lcore_id();
+
+    assert(msg);
+
+    if (msg->len != sizeof(*get))
+        return EDPVS_INVAL;
+    get = (struct dp_vs_connlimit_conf *)msg->data;
+
+    svc = connlimit_service(get, cid);
+    if (!svc)
+        return EDPVS_NOTEXIST;
+
+    output = msg_reply_alloc(sizeof(*output));
+    if (!output)
+        return EDPVS_NOMEM;
+
+    rte_memcpy(output, get, sizeof(*get));
+    output->cid        = cid;
+    output->rate       = svc->climit.conf_rate;
+    output->burst      = svc->climit.conf_burst;
+    output->plen       = svc->climit.plen;
+    output->passed     = svc->climit.passed;
+    output->rate_drops = svc->climit.rate_drops;
+    output->conns      = svc->climit.conns;
+    output->policy     = svc->climit.policy;
+    output->conn_drops = svc->climit.conn_drops;
+
+    msg->reply.len = sizeof(*output);
+    msg->reply.data = (void *)output;
+    return EDPVS_OK;
+}
+
+static int connlimit_sockopt_set(sockoptid_t opt, const void *conf,
+                                 size_t size)
+{
+    const struct dp_vs_connlimit_conf *cf = conf;
+    struct dpvs_msg *msg;
+    int err;
+
+    if (!conf || size != sizeof(*cf))
+        return EDPVS_INVAL;
+    if (opt != SOCKOPT_SET_CONNLIMIT)
+        return EDPVS_NOTSUPP;
+
+    if (cf->plen > (cf->af == AF_INET6 ? 128 : 32) ||
+            cf->rate > DPVS_CONNLIMIT_MAX_BURST ||
+            cf->burst > DPVS_CONNLIMIT_MAX_BURST ||
+            cf->policy > DPVS_CONNLIMIT_SYNPROXY)
+        return EDPVS_INVAL;
+
+    msg = msg_make(MSG_TYPE_CONNLIMIT_SET, 0, DPVS_MSG_MULTICAST,
+                   rte_lcore_id(), size, conf);
+    if (!msg)
+        return EDPVS_NOMEM;
+
+    err = multicast_msg_send(msg, 0, NULL);
+    msg_destroy(&msg);
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, SERVICE, "%s: fail to set limits on slaves.\n", __func__);
+        return err == EDPVS_MSG_FAIL ? EDPVS_NOTEXIST : err;
+    }
+
+    return connlimit_set(cf, rte_lcore_id());
+}
+
+static int connlimit_sockopt_get(sockoptid_t opt, const void *conf,
+                                 size_t size, void **out, size_t *outsize)
+{
+    const struct dp_vs_connlimit_conf *get = conf;
+    struct dp_vs_connlimit_conf *get_msg, *output = NULL;
+    struct dpvs_msg *msg, *cur;
+    struct dpvs_multicast_queue *reply = NULL;
+    lcoreid_t cid;
+    int err;
+
+    if (!conf || size != sizeof(*get) || !out || !outsize)
+        return EDPVS_INVAL;
+    if (get->cid >= DPVS_MAX_LCORE)
+        return EDPVS_INVAL;
+    cid = g_lcore_index[get->cid];
+
+    msg = msg_make(MSG_TYPE_CONNLIMIT_GET, 0, DPVS_MSG_MULTICAST,
+                   rte_lcore_id(), sizeof(*get), get);
+    if (!msg)
+        return EDPVS_NOMEM;
+
+    err = multicast_msg_send(msg, 0, &reply);
+    if (err != EDPVS_OK) {
+        msg_destroy(&msg);
+        RTE_LOG(ERR, SERVICE, "%s: send message fail.\n", __func__);
+        return err == EDPVS_MSG_FAIL ? EDPVS_NOTEXIST : err;
+    }
+
+    list_for_each_entry(cur, &reply->mq, mq_node) {
+        get_msg = (struct dp_vs_connlimit_conf *)cur->data;
+        /* master forwards nothing, a single lcore or all slaves */
+        if (cid != rte_get_master_lcore() && get_msg->cid != cid)
+            continue;
+
+        if (!output) {
+            output = rte_zmalloc("get_connlimit", sizeof(*output), 0);
+            if (!output) {
+                msg_destroy(&msg);
+                return EDPVS_NOMEM;
+            }
+            rte_memcpy(output, get_msg, sizeof(*output));
+            continue;
+        }
+
+        output->passed     += get_msg->passed;
+        output->rate_drops += get_msg->rate_drops;
+        output->conn_drops += get_msg->conn_drops;
+    }
+    msg_destroy(&msg);
+
+    if (!output)
+        return EDPVS_NOTEXIST;
+
+    output->cid = get->cid;
+    *out = output;
+    *outsize = sizeof(*output);
+    return EDPVS_OK;
+}
+
+static struct dpvs_sockopts connlimit_sockopts = {
+    .version            = SOCKOPT_VERSION,
+    .set_opt_min        = SOCKOPT_SET_CONNLIMIT,
+    .set_opt_max        = SOCKOPT_SET_CONNLIMIT,
+    .set                = connlimit_sockopt_set,
+    .get_opt_min        = SOCKOPT_GET_CONNLIMIT,
+    .get_opt_max        = SOCKOPT_GET_CONNLIMIT,
+    .get                = connlimit_sockopt_get,
+};
+
+static void connlimit_tables_free(void)
+{
+    lcoreid_t cid;
+
+    dp_vs_connlimit_nlcores = 0;
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        rte_free(dp_vs_connlimit_sketch[cid]);
+        dp_vs_connlimit_sketch[cid] = NULL;
+        rte_free(dp_vs_connlimit_conns[cid]);
+        dp_vs_connlimit_conns[cid] = NULL;
+    }
+}
+
+static void connlimit_tbl_size_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int size;
+
+    assert(str);
+
+    size = atoi(str);
+
+    if (size < DPVS_CONNLIMIT_TBL_SIZE_MIN) {
+        RTE_LOG(WARNING, SERVICE, "invalid connlimit_table_size %s, "
+                "using default %d\n", str, DPVS_CONNLIMIT_TBL_SIZE_DEF);
+        connlimit_tbl_size = DPVS_CONNLIMIT_TBL_SIZE_DEF;
+    } else {
+        is_power2(size, 0, &size);
+        RTE_LOG(INFO, SERVICE, "connlimit_table_size = %d (round to 2^n)\n",
+                size);
+        connlimit_tbl_size = size;
+    }
+
+    FREE_PTR(str);
+}
+
+void connlimit_keyword_value_init(void)
+{
+    if (dpvs_state_get() == DPVS_STATE_INIT) {
+        /* KW_TYPE_INIT keyword */
+        connlimit_tbl_size = DPVS_CONNLIMIT_TBL_SIZE_DEF;
+    }
+}
+
+void install_connlimit_keywords(void)
+{
+    install_keyword("connlimit_table_size", connlimit_tbl_size_handler,
+                    KW_TYPE_INIT);
+}
+
+int dp_vs_connlimit_init(void)
+{
+    struct dpvs_msg_type msg_type;
+    uint64_t slave_mask;
+    uint8_t nslaves;
+    lcoreid_t cid;
+    int err;
+
+    netif_get_slave_lcores(&nslaves, &slave_mask);
+    if (!nslaves)
+        nslaves = 1;
+
+    dp_vs_connlimit_cost = 1000 * nslaves;
+    dp_vs_connlimit_cycles_ms = rte_get_timer_hz() / 1000;
+    dp_vs_connlimit_rnd = (uint32_t)rte_rand();
+    dp_vs_connlimit_bucket_mask = connlimit_tbl_size / DPVS_CONNLIMIT_SLOTS - 1;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!(slave_mask & (1UL << cid)))
+            continue;
+        dp_vs_connlimit_sketch[cid] = rte_zmalloc_socket("connlimit",
+                sizeof(struct connlimit_cell) * DPVS_CONNLIMIT_ROWS
+                * DPVS_CONNLIMIT_COLS, RTE_CACHE_LINE_SIZE,
+                rte_lcore_to_socket_id(cid));
+        dp_vs_connlimit_conns[cid] = rte_zmalloc_socket("connlimit_conns",
+                sizeof(uint64_t) * connlimit_tbl_size, RTE_CACHE_LINE_SIZE,
+                rte_lcore_to_socket_id(cid));
+        if (!dp_vs_connlimit_sketch[cid] || !dp_vs_connlimit_conns[cid]) {
+            err = EDPVS_NOMEM;
+            goto errout;
+        }
+        dp_vs_connlimit_lcores[dp_vs_connlimit_nlcores++] = cid;
+    }
+
+    memset(&msg_type, 0, sizeof(struct dpvs_msg_type));
+    msg_type.type   = MSG_TYPE_CONNLIMIT_SET;
+    msg_type.mode   = DPVS_MSG_MULTICAST;
+    msg_type.prio   = MSG_PRIO_NORM;
+    msg_type.cid    = rte_lcore_id();
+    msg_type.unicast_msg_cb = connlimit_set_msg_cb;
+    err = msg_type_mc_register(&msg_type);
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, SERVICE, "%s: fail to register msg.\n", __func__);
+        goto errout;
+    }
+
+    memset(&msg_type, 0, sizeof(struct dpvs_msg_type));
+    msg_type.type   = MSG_TYPE_CONNLIMIT_GET;
+    msg_type.mode   = DPVS_MSG_MULTICAST;
+    msg_type.prio   = MSG_PRIO_LOW;
+    msg_type.cid    = rte_lcore_id();
+    msg_type.unicast_msg_cb = connlimit_get_msg_cb;
+    err = msg_type_mc_register(&msg_type);
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, SERVICE, "%s: fail to register msg.\n", __func__);
+        goto errout;
+    }
+
+    if ((err = sockopt_register(&connlimit_sockopts)) != EDPVS_OK)
+        goto errout;
+
+    return EDPVS_OK;
+
+errout:
+    connlimit_tables_free();
+    return err;
+}
+
+int dp_vs_connlimit_term(void)
+{
+    int err;
+
+    if ((err = sockopt_unregister(&connlimit_sockopts)) != EDPVS_OK)
+        return err;
+
+    /* lcores are stopped */
+    connlimit_tables_free();
+    return EDPVS_OK;
+}
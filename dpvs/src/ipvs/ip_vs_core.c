@@ -34,9 +34,16 @@
 #include "ipvs/xmit.h"
 #include "ipvs/synproxy.h"
 #include "ipvs/blklst.h"
+#include "ipvs/connlimit.h"
+#include "ipvs/attack.h"
+#include "ipvs/hwdrop.h"
+#include "ipvs/flood.h"
 #include "ipvs/proto_udp.h"
 #include "route6.h"
 #include "ipvs/redirect.h"
+#include "ipvs/handoff.h"
+#include "ipvs/sync.h"
+#include "startup.h"
 
 static inline int dp_vs_fill_iphdr(int af, struct rte_mbuf *mbuf,
                                    struct dp_vs_iphdr *iph)
@@ -167,7 +174,9 @@ static struct dp_vs_conn *dp_vs_sched_persist(struct dp_vs_service *svc,
     }
 
     /* add control for the new connection */
-    dp_vs_control_add(conn, ct);
+    if (unlikely(dp_vs_control_add(conn, ct) != EDPVS_OK))
+        RTE_LOG(WARNING, IPVS, "%s: persist-schedule: fail to add control.\n",
+                __func__);
     dp_vs_conn_put(ct);
 
     dp_vs_stats_conn(conn);
@@ -648,6 +657,7 @@ static int __dp_vs_in_icmp4(struct rte_mbuf *mbuf, int *related)
     struct dp_vs_iphdr dciph;
     struct dp_vs_proto *prot;
     struct dp_vs_conn *conn;
+    union inet_addr daddr;
     int off, dir, err;
     lcoreid_t cid, peer_cid;
     bool drop = false;
@@ -672,6 +682,13 @@ static int __dp_vs_in_icmp4(struct rte_mbuf *mbuf, int *related)
             ich->type, ntohs(icmp4_id(ich)), iph->src_addr, iph->dst_addr);
 #endif
 
+    /* echo requests are answered by icmp.c, within the budget */
+    memset(&daddr, 0, sizeof(daddr));
+    daddr.in.s_addr = iph->dst_addr;
+    if (ich->type == ICMP_ECHO)
+        return dp_vs_flood_check(DP_VS_FLOOD_ICMP_ECHO, AF_INET, &daddr) ?
+               INET_ACCEPT : INET_DROP;
+
     /* support these related error types only,
      * others either not support or not related. */
     if (ich->type != ICMP_DEST_UNREACH
@@ -679,6 +696,9 @@ static int __dp_vs_in_icmp4(struct rte_mbuf *mbuf, int *related)
             && ich->type != ICMP_TIME_EXCEEDED)
         return INET_ACCEPT;
 
+    if (!dp_vs_flood_check(DP_VS_FLOOD_ICMP_ERROR, AF_INET, &daddr))
+        return INET_DROP;
+
     /* inner (contained) IP header */
     off += sizeof(struct icmphdr);
     ciph = mbuf_header_pointer(mbuf, off, sizeof(_ciph), &_ciph);
@@ -814,6 +834,12 @@ static int __dp_vs_in_icmp6(struct rte_mbuf *mbuf, int *related)
     __dp_vs_icmp6_show(ip6h, ic6h);
 #endif
 
+    /* echo requests are answered by icmp6.c, within the budget */
+    if (ic6h->icmp6_type == ICMP6_ECHO_REQUEST)
+        return dp_vs_flood_check(DP_VS_FLOOD_ICMP_ECHO, AF_INET6,
+                                 (union inet_addr *)&ip6h->ip6_dst) ?
+               INET_ACCEPT : INET_DROP;
+
     /* support these related error types only,
      * others either not support or not related.
      */
@@ -822,6 +848,10 @@ static int __dp_vs_in_icmp6(struct rte_mbuf *mbuf, int *related)
             && ic6h->icmp6_type != ICMP6_TIME_EXCEEDED)
         return INET_ACCEPT;
 
+    if (!dp_vs_flood_check(DP_VS_FLOOD_ICMP_ERROR, AF_INET6,
+                           (union inet_addr *)&ip6h->ip6_dst))
+        return INET_DROP;
+
     /* inner (contained) IP header */
     off += sizeof(struct icmp6_hdr);
     cip6h = mbuf_header_pointer(mbuf, off, sizeof(_cip6h), &_cip6h);
@@ -929,8 +959,8 @@ static int __dp_vs_in(void *priv, struct rte_mbuf *mbuf,
     struct dp_vs_iphdr iph;
     struct dp_vs_proto *prot;
     struct dp_vs_conn *conn;
-    int dir, verdict, err, related;
-    bool drop = false;
+    int dir, verdict, err, related, state_before;
+    bool drop = false, created = false;
     lcoreid_t cid, peer_cid;
     eth_type_t etype = mbuf->packet_type; /* FIXME: use other field ? */
     assert(mbuf && state);
@@ -1005,6 +1035,7 @@ static int __dp_vs_in(void *priv, struct rte_mbuf *mbuf,
             dir = DPVS_CONN_DIR_OUTBOUND;
         else
             dir = DPVS_CONN_DIR_INBOUND;
+        created = true;
     }
 
     if (conn->flags & DPVS_CONN_F_SYNPROXY) {
@@ -1040,6 +1071,7 @@ static int __dp_vs_in(void *priv, struct rte_mbuf *mbuf,
         }
     }
 
+    state_before = conn->state;
     if (prot->state_trans) {
         err = prot->state_trans(prot, conn, mbuf, dir);
         if (err != EDPVS_OK)
@@ -1047,6 +1079,10 @@ static int __dp_vs_in(void *priv, struct rte_mbuf *mbuf,
     }
     conn->old_state = conn->state;
 
+    if (created || conn->state != state_before)
+        dp_vs_sync_conn(conn, created ? DP_VS_SYNC_CONN_CREATE :
+                                        DP_VS_SYNC_CONN_UPDATE);
+
     /* holding the conn, need a "put" later. */
     if (dir == DPVS_CONN_DIR_INBOUND)
         return xmit_inbound(mbuf, prot, conn);
@@ -1144,60 +1180,96 @@ int dp_vs_init(void)
 {
     int err;
 
-    err = dp_vs_proto_init();
+    err = DPVS_INIT_STAGE("ipvs.proto", dp_vs_proto_init());
     if (err != EDPVS_OK) {
         RTE_LOG(ERR, IPVS, "fail to init proto: %s\n", dpvs_strerror(err));
         return err;
     }
 
-    err = dp_vs_laddr_init();
+    err = DPVS_INIT_STAGE("ipvs.laddr", dp_vs_laddr_init());
     if (err != EDPVS_OK) {
         RTE_LOG(ERR, IPVS, "fail to init laddr: %s\n", dpvs_strerror(err));
         goto err_laddr;
     }
 
-    err = dp_vs_conn_init();
+    err = DPVS_INIT_STAGE("ipvs.conn", dp_vs_conn_init());
     if (err != EDPVS_OK) {
         RTE_LOG(ERR, IPVS, "fail to init conn: %s\n", dpvs_strerror(err));
         goto err_conn;
     }
 
-    err = dp_vs_redirects_init();
+    err = DPVS_INIT_STAGE("ipvs.redirect", dp_vs_redirects_init());
     if (err != EDPVS_OK) {
         RTE_LOG(ERR, IPVS, "fail to init redirect: %s\n", dpvs_strerror(err));
         goto err_redirect;
     }
 
-    err = dp_vs_synproxy_init();
+    err = DPVS_INIT_STAGE("ipvs.synproxy", dp_vs_synproxy_init());
     if (err != EDPVS_OK) {
         RTE_LOG(ERR, IPVS, "fail to init synproxy: %s\n", dpvs_strerror(err));
         goto err_synproxy;
     }
 
-    err = dp_vs_sched_init();
+    err = DPVS_INIT_STAGE("ipvs.sched", dp_vs_sched_init());
     if (err != EDPVS_OK) {
         RTE_LOG(ERR, IPVS, "fail to init sched: %s\n", dpvs_strerror(err));
         goto err_sched;
     }
 
-    err = dp_vs_service_init();
+    err = DPVS_INIT_STAGE("ipvs.service", dp_vs_service_init());
     if (err != EDPVS_OK) {
         RTE_LOG(ERR, IPVS, "fail to init serv: %s\n", dpvs_strerror(err));
         goto err_serv;
     }
 
-    err = dp_vs_blklst_init();
+    err = DPVS_INIT_STAGE("ipvs.blklst", dp_vs_blklst_init());
     if (err != EDPVS_OK) {
         RTE_LOG(ERR, IPVS, "fail to init blklst: %s\n", dpvs_strerror(err));
         goto err_blklst;
     }
 
-    err = dp_vs_stats_init();
+    err = DPVS_INIT_STAGE("ipvs.connlimit", dp_vs_connlimit_init());
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "fail to init connlimit: %s\n", dpvs_strerror(err));
+        goto err_connlimit;
+    }
+
+    err = DPVS_INIT_STAGE("ipvs.attack", dp_vs_attack_init());
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "fail to init attack: %s\n", dpvs_strerror(err));
+        goto err_attack;
+    }
+
+    err = DPVS_INIT_STAGE("ipvs.hwdrop", dp_vs_hwdrop_init());
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "fail to init hwdrop: %s\n", dpvs_strerror(err));
+        goto err_hwdrop;
+    }
+
+    err = DPVS_INIT_STAGE("ipvs.flood", dp_vs_flood_init());
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "fail to init flood: %s\n", dpvs_strerror(err));
+        goto err_flood;
+    }
+
+    err = DPVS_INIT_STAGE("ipvs.stats", dp_vs_stats_init());
     if (err != EDPVS_OK) {
         RTE_LOG(ERR, IPVS, "fail to init stats: %s\n", dpvs_strerror(err));
         goto err_stats;
     }
 
+    err = DPVS_INIT_STAGE("ipvs.handoff", dp_vs_handoff_init());
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "fail to init handoff: %s\n", dpvs_strerror(err));
+        goto err_handoff;
+    }
+
+    err = DPVS_INIT_STAGE("ipvs.sync", dp_vs_sync_init());
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "fail to init sync: %s\n", dpvs_strerror(err));
+        goto err_sync;
+    }
+
     err = inet_register_hooks(dp_vs_ops, NELEMS(dp_vs_ops));
     if (err != EDPVS_OK) {
         RTE_LOG(ERR, IPVS, "fail to register hooks: %s\n", dpvs_strerror(err));
@@ -1208,8 +1280,20 @@ int dp_vs_init(void)
     return EDPVS_OK;
 
 err_hooks:
+    dp_vs_sync_term();
+err_sync:
+    dp_vs_handoff_term();
+err_handoff:
     dp_vs_stats_term();
 err_stats:
+    dp_vs_flood_term();
+err_flood:
+    dp_vs_hwdrop_term();
+err_hwdrop:
+    dp_vs_attack_term();
+err_attack:
+    dp_vs_connlimit_term();
+err_connlimit:
     dp_vs_blklst_term();
 err_blklst:
     dp_vs_service_term();
@@ -1237,10 +1321,34 @@ int dp_vs_term(void)
     if (err != EDPVS_OK)
         RTE_LOG(ERR, IPVS, "fail to unregister hooks: %s\n", dpvs_strerror(err));
 
+    err = dp_vs_sync_term();
+    if (err != EDPVS_OK)
+        RTE_LOG(ERR, IPVS, "fail to terminate sync: %s\n", dpvs_strerror(err));
+
+    err = dp_vs_handoff_term();
+    if (err != EDPVS_OK)
+        RTE_LOG(ERR, IPVS, "fail to terminate handoff: %s\n", dpvs_strerror(err));
+
     err = dp_vs_stats_term();
     if (err != EDPVS_OK)
         RTE_LOG(ERR, IPVS, "fail to terminate term: %s\n", dpvs_strerror(err));
 
+    err = dp_vs_flood_term();
+    if (err != EDPVS_OK)
+        RTE_LOG(ERR, IPVS, "fail to terminate flood: %s\n", dpvs_strerror(err));
+
+    err = dp_vs_hwdrop_term();
+    if (err != EDPVS_OK)
+        RTE_LOG(ERR, IPVS, "fail to terminate hwdrop: %s\n", dpvs_strerror(err));
+
+    err = dp_vs_attack_term();
+    if (err != EDPVS_OK)
+        RTE_LOG(ERR, IPVS, "fail to terminate attack: %s\n", dpvs_strerror(err));
+
+    err = dp_vs_connlimit_term();
+    if (err != EDPVS_OK)
+        RTE_LOG(ERR, IPVS, "fail to terminate connlimit: %s\n", dpvs_strerror(err));
+
     err = dp_vs_blklst_term();
     if (err != EDPVS_OK)
         RTE_LOG(ERR, IPVS, "fail to terminate blklst: %s\n", dpvs_strerror(err));
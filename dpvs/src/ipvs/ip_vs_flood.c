@@ -0,0 +1,363 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/*
+ * per-VIP budgets of ICMP echo requests, ICMP errors and new UDP
+ * connections, see ipvs/flood.h.
+ *
+ * every slave lcore has a token bucket per VIP and type, so a budget is
+ * what one lcore grants a VIP: ICMP has no ports and RSS brings all of
+ * a source to one lcore, splitting the rate would starve it. buckets are
+ * not allocated per VIP, a VIP hashes to one of a fixed table; VIPs
+ * sharing a bucket share the budget, which errs on the strict side.
+ * packets over the budget are dropped before any connection lookup or
+ * allocation, a reflection flood costs no conn and no sa_pool port.
+ * drops are counted per bucket too, with the VIP of the last one, so
+ * that the flooded VIPs can be told apart.
+ *
+ * token units are chosen so that a bucket refills exactly @rate units a
+ * millisecond and a packet costs 1000 units.
+ */
+#include <assert.h>
+#include <rte_jhash.h>
+#include "dpdk.h"
+#include "conf/common.h"
+#include "netif.h"
+#include "ctrl.h"
+#include "parser/parser.h"
+#include "ipvs/ipvs.h"
+#include "ipvs/flood.h"
+
+#define DPVS_FLOOD_BUCKETS          4096    /* per lcore and type, 2^n */
+#define DPVS_FLOOD_MASK             (DPVS_FLOOD_BUCKETS - 1)
+
+#define DPVS_FLOOD_RATE_MAX         100000000
+#define DPVS_FLOOD_BURST_MAX        (UINT32_MAX / 1000)
+#define DPVS_FLOOD_COST             1000
+
+struct flood_bucket {
+    uint32_t            tokens;
+    uint32_t            stamp;      /* ms */
+};
+
+/* apart from the buckets, only packets dropped touch it */
+struct flood_drop {
+    uint64_t            dropped;
+    union inet_addr     vaddr;
+    uint8_t             af;
+};
+
+struct flood_lcore {
+    uint64_t            passed[DP_VS_FLOOD_MAX];
+    uint64_t            dropped[DP_VS_FLOOD_MAX];
+    struct flood_bucket buckets[DP_VS_FLOOD_MAX][DPVS_FLOOD_BUCKETS];
+    struct flood_drop   drops[DP_VS_FLOOD_MAX][DPVS_FLOOD_BUCKETS];
+};
+
+static const char *flood_type_names[DP_VS_FLOOD_MAX] = {
+    [DP_VS_FLOOD_ICMP_ECHO]     = "icmp_echo",
+    [DP_VS_FLOOD_ICMP_ERROR]    = "icmp_error",
+    [DP_VS_FLOOD_UDP_NEW]       = "udp_new",
+};
+
+uint32_t dp_vs_flood_rate[DP_VS_FLOOD_MAX];
+static uint32_t dp_vs_flood_burst[DP_VS_FLOOD_MAX];
+
+static struct flood_lcore *dp_vs_flood_lcores[DPVS_MAX_LCORE];
+static uint64_t dp_vs_flood_cycles_ms;
+static uint32_t dp_vs_flood_rnd;
+
+static inline uint32_t flood_hash(int af, const union inet_addr *vaddr)
+{
+    if (af == AF_INET6)
+        return rte_jhash(&vaddr->in6, sizeof(vaddr->in6), dp_vs_flood_rnd);
+    return rte_jhash_1word(vaddr->in.s_addr, dp_vs_flood_rnd);
+}
+
+bool __dp_vs_flood_check(int type, int af, const union inet_addr *vaddr)
+{
+    struct flood_lcore *fl = dp_vs_flood_lcores[rte_lcore_id()];
+    struct flood_bucket *bkt;
+    struct flood_drop *drop;
+    uint32_t idx, now, burst;
+    uint64_t tokens;
+
+    if (unlikely(!fl))
+        return true;
+
+    /* a burst of 0 is one second of the rate */
+    burst = dp_vs_flood_burst[type] ? : dp_vs_flood_rate[type];
+    if (burst > DPVS_FLOOD_BURST_MAX)
+        burst = DPVS_FLOOD_BURST_MAX;
+
+    idx = flood_hash(af, vaddr) & DPVS_FLOOD_MASK;
+    bkt = &fl->buckets[type][idx];
+    now = (uint32_t)(rte_get_timer_cycles() / dp_vs_flood_cycles_ms);
+
+    tokens = bkt->tokens + (uint64_t)(uint32_t)(now - bkt->stamp)
+                           * dp_vs_flood_rate[type];
+    if (tokens > (uint64_t)burst * DPVS_FLOOD_COST)
+        tokens = (uint64_t)burst * DPVS_FLOOD_COST;
+    bkt->stamp = now;
+
+    if (tokens < DPVS_FLOOD_COST) {
+        bkt->tokens = tokens;
+        fl->dropped[type]++;
+        drop = &fl->drops[type][idx];
+        drop->dropped++;
+        drop->af = af;
+        drop->vaddr = *vaddr;
+        return false;
+    }
+
+    bkt->tokens = tokens - DPVS_FLOOD_COST;
+    fl->passed[type]++;
+    return true;
+}
+
+/*
+ * sum the drops of bucket @idx over lcores into @vip, the VIP is taken
+ * from the lcore dropping the most. slaves write as master reads, a VIP
+ * read while another one sharing the bucket replaces it may be garbled.
+ */
+static void flood_vip_fill(struct dp_vs_flood_vip *vip, int type, uint32_t idx)
+{
+    const struct flood_drop *drop;
+    uint64_t dropped, max = 0;
+    lcoreid_t cid;
+
+    memset(vip, 0, sizeof(*vip));
+    vip->type = type;
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!dp_vs_flood_lcores[cid])
+            continue;
+        drop = &dp_vs_flood_lcores[cid]->drops[type][idx];
+        dropped = drop->dropped;
+        vip->dropped += dropped;
+        if (dropped <= max)
+            continue;
+        max = dropped;
+        vip->af = drop->af;
+        vip->vaddr = drop->vaddr;
+    }
+}
+
+/* keep the DP_VS_FLOOD_TOP buckets of @type with the most drops */
+static uint32_t flood_vips_top(struct dp_vs_flood_vip *top, int type)
+{
+    struct dp_vs_flood_vip vip;
+    uint32_t idx, n = 0, i;
+
+    for (idx = 0; idx < DPVS_FLOOD_BUCKETS; idx++) {
+        flood_vip_fill(&vip, type, idx);
+        if (!vip.dropped)
+            continue;
+        if (n == DP_VS_FLOOD_TOP && vip.dropped <= top[n - 1].dropped)
+            continue;
+
+        i = n < DP_VS_FLOOD_TOP ? n++ : n - 1;
+        for (; i > 0 && top[i - 1].dropped < vip.dropped; i--)
+            top[i] = top[i - 1];
+        top[i] = vip;
+    }
+    return n;
+}
+
+static int flood_sockopt_get(sockoptid_t opt, const void *conf,
+                             size_t size, void **out, size_t *outsize)
+{
+    struct dp_vs_flood_stats *stats;
+    struct flood_lcore *fl;
+    lcoreid_t cid;
+    size_t len;
+    int t;
+
+    if (!out || !outsize)
+        return EDPVS_INVAL;
+
+    len = sizeof(*stats) + DP_VS_FLOOD_MAX * DP_VS_FLOOD_TOP *
+                           sizeof(struct dp_vs_flood_vip);
+    stats = rte_zmalloc("flood_stats", len, 0);
+    if (!stats)
+        return EDPVS_NOMEM;
+
+    for (t = 0; t < DP_VS_FLOOD_MAX; t++) {
+        stats->rate[t] = dp_vs_flood_rate[t];
+        stats->burst[t] = dp_vs_flood_burst[t];
+    }
+
+    /* counters of slaves are read as they go, no msg needed */
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        fl = dp_vs_flood_lcores[cid];
+        if (!fl)
+            continue;
+        for (t = 0; t < DP_VS_FLOOD_MAX; t++) {
+            stats->passed[t] += fl->passed[t];
+            stats->dropped[t] += fl->dropped[t];
+        }
+    }
+
+    for (t = 0; t < DP_VS_FLOOD_MAX; t++) {
+        if (stats->dropped[t])
+            stats->nvips += flood_vips_top(&stats->vips[stats->nvips], t);
+    }
+
+    *out = stats;
+    *outsize = sizeof(*stats) + stats->nvips * sizeof(struct dp_vs_flood_vip);
+    return EDPVS_OK;
+}
+
+static struct dpvs_sockopts flood_sockopts = {
+    .version            = SOCKOPT_VERSION,
+    .set_opt_min        = 0,
+    .set_opt_max        = 0,
+    .set                = NULL,
+    .get_opt_min        = SOCKOPT_GET_FLOOD_STATS,
+    .get_opt_max        = SOCKOPT_GET_FLOOD_STATS,
+    .get                = flood_sockopt_get,
+};
+
+static inline void flood_handler_template(vector_t tokens, const char *kw,
+                                          uint32_t *val, int max)
+{
+    char *str = set_value(tokens);
+    int v;
+
+    assert(str);
+
+    v = atoi(str);
+    if (v >= 0 && v <= max) {
+        RTE_LOG(INFO, IPVS, "flood %s = %d\n", kw, v);
+        *val = v;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid flood %s %s, using default 0\n",
+                kw, str);
+        *val = 0;
+    }
+    FREE_PTR(str);
+}
+
+static void icmp_echo_rate_handler(vector_t tokens)
+{
+    flood_handler_template(tokens, "icmp_echo_rate",
+            &dp_vs_flood_rate[DP_VS_FLOOD_ICMP_ECHO], DPVS_FLOOD_RATE_MAX);
+}
+
+static void icmp_echo_burst_handler(vector_t tokens)
+{
+    flood_handler_template(tokens, "icmp_echo_burst",
+            &dp_vs_flood_burst[DP_VS_FLOOD_ICMP_ECHO], DPVS_FLOOD_BURST_MAX);
+}
+
+static void icmp_error_rate_handler(vector_t tokens)
+{
+    flood_handler_template(tokens, "icmp_error_rate",
+            &dp_vs_flood_rate[DP_VS_FLOOD_ICMP_ERROR], DPVS_FLOOD_RATE_MAX);
+}
+
+static void icmp_error_burst_handler(vector_t tokens)
+{
+    flood_handler_template(tokens, "icmp_error_burst",
+            &dp_vs_flood_burst[DP_VS_FLOOD_ICMP_ERROR], DPVS_FLOOD_BURST_MAX);
+}
+
+static void udp_new_rate_handler(vector_t tokens)
+{
+    flood_handler_template(tokens, "udp_new_rate",
+            &dp_vs_flood_rate[DP_VS_FLOOD_UDP_NEW], DPVS_FLOOD_RATE_MAX);
+}
+
+static void udp_new_burst_handler(vector_t tokens)
+{
+    flood_handler_template(tokens, "udp_new_burst",
+            &dp_vs_flood_burst[DP_VS_FLOOD_UDP_NEW], DPVS_FLOOD_BURST_MAX);
+}
+
+void flood_keyword_value_init(void)
+{
+    memset(dp_vs_flood_rate, 0, sizeof(dp_vs_flood_rate));
+    memset(dp_vs_flood_burst, 0, sizeof(dp_vs_flood_burst));
+}
+
+void install_flood_keywords(void)
+{
+    install_keyword("icmp_echo_rate", icmp_echo_rate_handler, KW_TYPE_NORMAL);
+    install_keyword("icmp_echo_burst", icmp_echo_burst_handler, KW_TYPE_NORMAL);
+    install_keyword("icmp_error_rate", icmp_error_rate_handler, KW_TYPE_NORMAL);
+    install_keyword("icmp_error_burst", icmp_error_burst_handler, KW_TYPE_NORMAL);
+    install_keyword("udp_new_rate", udp_new_rate_handler, KW_TYPE_NORMAL);
+    install_keyword("udp_new_burst", udp_new_burst_handler, KW_TYPE_NORMAL);
+}
+
+static void flood_lcores_free(void)
+{
+    lcoreid_t cid;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        rte_free(dp_vs_flood_lcores[cid]);
+        dp_vs_flood_lcores[cid] = NULL;
+    }
+}
+
+int dp_vs_flood_init(void)
+{
+    uint64_t slave_mask;
+    uint8_t nslaves;
+    lcoreid_t cid;
+    int t, err;
+
+    dp_vs_flood_cycles_ms = rte_get_timer_hz() / 1000;
+    dp_vs_flood_rnd = (uint32_t)rte_rand();
+
+    netif_get_slave_lcores(&nslaves, &slave_mask);
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!(slave_mask & (1UL << cid)))
+            continue;
+        dp_vs_flood_lcores[cid] = rte_zmalloc_socket("flood",
+                sizeof(struct flood_lcore), RTE_CACHE_LINE_SIZE,
+                rte_lcore_to_socket_id(cid));
+        if (!dp_vs_flood_lcores[cid]) {
+            flood_lcores_free();
+            return EDPVS_NOMEM;
+        }
+    }
+
+    if ((err = sockopt_register(&flood_sockopts)) != EDPVS_OK) {
+        flood_lcores_free();
+        return err;
+    }
+
+    for (t = 0; t < DP_VS_FLOOD_MAX; t++) {
+        if (dp_vs_flood_rate[t])
+            RTE_LOG(INFO, IPVS, "%s: %s %u pkts/s burst %u per VIP and "
+                    "lcore\n", __func__, flood_type_names[t],
+                    dp_vs_flood_rate[t], dp_vs_flood_burst[t]);
+    }
+    return EDPVS_OK;
+}
+
+int dp_vs_flood_term(void)
+{
+    int err;
+
+    if ((err = sockopt_unregister(&flood_sockopts)) != EDPVS_OK)
+        return err;
+
+    /* lcores are stopped */
+    flood_lcores_free();
+    return EDPVS_OK;
+}
@@ -0,0 +1,604 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * connection hand-off between an exiting dpvs and its successor,
+ * see ipvs/handoff.h for the overall flow and the file layout.
+ */
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "conf/common.h"
+#include "dpdk.h"
+#include "ctrl.h"
+#include "scheduler.h"
+#include "global_data.h"
+#include "parser/parser.h"
+#include "ipvs/conn.h"
+#include "ipvs/handoff.h"
+
+#define HANDOFF_FILE_DEF            "/dev/shm/dpvs_conn_handoff"
+#define HANDOFF_FILE_LEN            256
+
+#define HANDOFF_TIMEOUT_DEF         60      /* seconds */
+#define HANDOFF_TIMEOUT_MIN         1
+#define HANDOFF_TIMEOUT_MAX         3600
+
+#define HANDOFF_EXPORT_WAIT         10      /* seconds */
+#define HANDOFF_IMPORT_BATCH        256     /* records per lcore per run */
+#define HANDOFF_IMPORT_INTERVAL     100     /* lcore loops */
+
+/* per-lcore import progress, written by the owner lcore only */
+struct handoff_import {
+    struct dp_vs_handoff_conn   *conns;
+    uint32_t                    nconns;
+    uint8_t                     *done;      /* one byte per record */
+    uint32_t                    cursor;
+    uint32_t                    remain;
+    uint32_t                    imported;
+    uint32_t                    expired;
+    uint32_t                    failed;
+    volatile bool               finished;
+} __rte_cache_aligned;
+
+static char handoff_file[HANDOFF_FILE_LEN] = HANDOFF_FILE_DEF;
+static int handoff_timeout = HANDOFF_TIMEOUT_DEF;
+
+static volatile sig_atomic_t handoff_requested = 0;
+
+/* the region handed over by the previous process */
+static struct dp_vs_handoff_hdr *handoff_in = NULL;
+static size_t handoff_in_size = 0;
+static uint64_t handoff_deadline = 0;
+static struct handoff_import handoff_imports[DPVS_MAX_LCORE];
+
+static inline bool handoff_lcore(lcoreid_t cid)
+{
+    return g_lcore_role[cid] == LCORE_ROLE_FWD_WORKER;
+}
+
+/////////////////////////////// export ///////////////////////////////////////
+
+static int handoff_export_msg_cb(struct dpvs_msg *msg)
+{
+    struct dp_vs_handoff_hdr *hdr;
+    struct dp_vs_handoff_sect *sect;
+    uint32_t skipped;
+
+    if (unlikely(!msg || msg->len != sizeof(hdr)))
+        return EDPVS_INVAL;
+
+    hdr = *(struct dp_vs_handoff_hdr **)msg->data;
+    sect = &hdr->sects[rte_lcore_id()];
+
+    sect->nconns = dp_vs_conn_handoff_export((void *)hdr + sect->offset,
+                                             sect->capacity, &skipped);
+    sect->skipped = skipped;
+
+    rte_wmb();
+    sect->done = 1;
+
+    return EDPVS_OK;
+}
+
+/* publish the file only once it is complete, by renaming a temp file */
+static int handoff_export(void)
+{
+    struct dp_vs_handoff_hdr *hdr;
+    struct dp_vs_handoff_sect *sect;
+    struct dpvs_msg *msg;
+    char tmpfile[HANDOFF_FILE_LEN + 8];
+    uint64_t off, size, deadline;
+    uint32_t capacity, nconns = 0, skipped = 0;
+    lcoreid_t cid;
+    bool done;
+    int fd, err;
+
+    snprintf(tmpfile, sizeof(tmpfile), "%s.tmp", handoff_file);
+    fd = open(tmpfile, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        RTE_LOG(ERR, IPVS, "%s: fail to open %s: %s\n",
+                __func__, tmpfile, strerror(errno));
+        return EDPVS_SYSCALL;
+    }
+
+    /* any lcore may own the whole pool, the file stays sparse anyway */
+    capacity = dp_vs_conn_pool_size();
+    size = sizeof(*hdr);
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (handoff_lcore(cid))
+            size += (uint64_t)capacity * sizeof(struct dp_vs_handoff_conn);
+    }
+
+    if (ftruncate(fd, size) < 0) {
+        RTE_LOG(ERR, IPVS, "%s: fail to size %s: %s\n",
+                __func__, tmpfile, strerror(errno));
+        err = EDPVS_SYSCALL;
+        goto errout;
+    }
+
+    hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (hdr == MAP_FAILED) {
+        RTE_LOG(ERR, IPVS, "%s: fail to map %s: %s\n",
+                __func__, tmpfile, strerror(errno));
+        err = EDPVS_SYSCALL;
+        goto errout;
+    }
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic      = DPVS_HANDOFF_MAGIC;
+    hdr->version    = DPVS_HANDOFF_VERSION;
+    hdr->conn_size  = sizeof(struct dp_vs_handoff_conn);
+    hdr->timestamp  = time(NULL);
+    hdr->nsects     = DPVS_MAX_LCORE;
+
+    off = sizeof(*hdr);
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!handoff_lcore(cid))
+            continue;
+        hdr->sects[cid].offset = off;
+        hdr->sects[cid].capacity = capacity;
+        off += (uint64_t)capacity * sizeof(struct dp_vs_handoff_conn);
+    }
+
+    msg = msg_make(MSG_TYPE_CONN_HANDOFF, 0, DPVS_MSG_MULTICAST,
+                   rte_lcore_id(), sizeof(hdr), &hdr);
+    if (!msg) {
+        err = EDPVS_NOMEM;
+        goto unmap;
+    }
+
+    /* workers may take a while on big tables, much longer than
+     * a blocking msg is allowed to. poll the header instead. */
+    err = multicast_msg_send(msg, DPVS_MSG_F_ASYNC, NULL);
+    msg_destroy(&msg);
+    if (err != EDPVS_OK)
+        goto unmap;
+
+    deadline = rte_get_timer_cycles() + HANDOFF_EXPORT_WAIT * g_cycles_per_sec;
+    do {
+        done = true;
+        for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+            if (handoff_lcore(cid) && !hdr->sects[cid].done)
+                done = false;
+        }
+        if (done)
+            break;
+        rte_delay_ms(1);
+    } while (rte_get_timer_cycles() < deadline);
+
+    if (!done) {
+        RTE_LOG(ERR, IPVS, "%s: workers do not finish in %d seconds\n",
+                __func__, HANDOFF_EXPORT_WAIT);
+        err = EDPVS_BUSY;
+        goto unmap;
+    }
+
+    /* squeeze out the unused capacity */
+    off = sizeof(*hdr);
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        sect = &hdr->sects[cid];
+        if (!handoff_lcore(cid))
+            continue;
+
+        memmove((void *)hdr + off, (void *)hdr + sect->offset,
+                (uint64_t)sect->nconns * sizeof(struct dp_vs_handoff_conn));
+        sect->offset = off;
+        sect->capacity = sect->nconns;
+        off += (uint64_t)sect->nconns * sizeof(struct dp_vs_handoff_conn);
+
+        nconns += sect->nconns;
+        skipped += sect->skipped;
+    }
+    hdr->size = off;
+
+    munmap(hdr, size);
+
+    if (ftruncate(fd, off) < 0 || fsync(fd) < 0 ||
+        rename(tmpfile, handoff_file) < 0) {
+        RTE_LOG(ERR, IPVS, "%s: fail to publish %s: %s\n",
+                __func__, handoff_file, strerror(errno));
+        err = EDPVS_SYSCALL;
+        goto errout;
+    }
+    close(fd);
+
+    RTE_LOG(INFO, IPVS, "%s: %u conns handed off to %s (%lu bytes), "
+            "%u skipped\n", __func__, nconns, handoff_file, off, skipped);
+    return EDPVS_OK;
+
+unmap:
+    munmap(hdr, size);
+errout:
+    close(fd);
+    unlink(tmpfile);
+    return err;
+}
+
+static void handoff_sig_callback(int sig)
+{
+    handoff_requested = 1;
+}
+
+/////////////////////////////// import ///////////////////////////////////////
+
+static void handoff_import_job(void *arg)
+{
+    struct handoff_import *imp = &handoff_imports[rte_lcore_id()];
+    struct dp_vs_handoff_conn *hc;
+    uint32_t budget, i, timeout;
+    int64_t elapsed;
+    int err;
+
+    if (likely(imp->finished))
+        return;
+
+    if (rte_get_timer_cycles() > handoff_deadline) {
+        imp->failed += imp->remain;
+        imp->remain = 0;
+    }
+
+    elapsed = (int64_t)time(NULL) - (int64_t)handoff_in->timestamp;
+    if (elapsed < 0)
+        elapsed = 0;
+
+    for (budget = HANDOFF_IMPORT_BATCH; budget > 0 && imp->remain > 0; budget--) {
+        i = imp->cursor;
+        imp->cursor = (i + 1) % imp->nconns;
+        if (imp->done[i])
+            continue;
+
+        hc = &imp->conns[i];
+        if (hc->timeout <= elapsed) {
+            imp->expired++;
+        } else {
+            timeout = hc->timeout - elapsed;
+            err = dp_vs_conn_handoff_import(hc, timeout);
+            if (err == EDPVS_NOTEXIST)
+                continue; /* service/laddr not configured yet, retry later */
+            if (err == EDPVS_OK)
+                imp->imported++;
+            else
+                imp->failed++;
+        }
+
+        imp->done[i] = 1;
+        imp->remain--;
+    }
+
+    if (!imp->remain) {
+        RTE_LOG(INFO, IPVS, "%s: [%02d] %u conns restored, %u expired, "
+                "%u failed\n", __func__, rte_lcore_id(), imp->imported,
+                imp->expired, imp->failed);
+        rte_wmb();
+        imp->finished = true;
+    }
+}
+
+static void handoff_import_free(void)
+{
+    lcoreid_t cid;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (handoff_imports[cid].done)
+            rte_free(handoff_imports[cid].done);
+        memset(&handoff_imports[cid], 0, sizeof(handoff_imports[cid]));
+        handoff_imports[cid].finished = true;
+    }
+
+    if (handoff_in) {
+        munmap(handoff_in, handoff_in_size);
+        handoff_in = NULL;
+        handoff_in_size = 0;
+    }
+}
+
+static int handoff_import_check(const struct dp_vs_handoff_hdr *hdr, size_t size)
+{
+    const struct dp_vs_handoff_sect *sect;
+    lcoreid_t cid;
+
+    if (size < sizeof(*hdr) || hdr->magic != DPVS_HANDOFF_MAGIC)
+        return EDPVS_INVAL;
+
+    if (hdr->version != DPVS_HANDOFF_VERSION ||
+        hdr->conn_size != sizeof(struct dp_vs_handoff_conn) ||
+        hdr->nsects != DPVS_MAX_LCORE) {
+        RTE_LOG(WARNING, IPVS, "%s: unsupported version %u (conn size %u), "
+                "expect %u (%lu)\n", __func__, hdr->version, hdr->conn_size,
+                DPVS_HANDOFF_VERSION, sizeof(struct dp_vs_handoff_conn));
+        return EDPVS_NOTSUPP;
+    }
+
+    if (hdr->size != size)
+        return EDPVS_INVAL;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        sect = &hdr->sects[cid];
+        if (!sect->nconns)
+            continue;
+        if (sect->offset < sizeof(*hdr) || sect->offset > size ||
+            (size - sect->offset) / sizeof(struct dp_vs_handoff_conn) < sect->nconns)
+            return EDPVS_INVAL;
+    }
+
+    return EDPVS_OK;
+}
+
+/*
+ * map the file left by the previous process. it is unlinked right away,
+ * the mapping stays valid and a crash during import won't replay it.
+ */
+static int handoff_import_prepare(void)
+{
+    struct dp_vs_handoff_hdr *hdr;
+    struct handoff_import *imp;
+    struct stat st;
+    uint32_t nconns = 0, dropped = 0;
+    lcoreid_t cid;
+    int fd, err;
+
+    fd = open(handoff_file, O_RDONLY);
+    if (fd < 0)
+        return EDPVS_NOTEXIST;
+
+    if (fstat(fd, &st) < 0 || st.st_size < sizeof(*hdr)) {
+        close(fd);
+        unlink(handoff_file);
+        return EDPVS_INVAL;
+    }
+
+    hdr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    unlink(handoff_file);
+    if (hdr == MAP_FAILED) {
+        RTE_LOG(ERR, IPVS, "%s: fail to map %s: %s\n",
+                __func__, handoff_file, strerror(errno));
+        return EDPVS_SYSCALL;
+    }
+
+    err = handoff_import_check(hdr, st.st_size);
+    if (err != EDPVS_OK) {
+        RTE_LOG(WARNING, IPVS, "%s: ignore invalid %s: %s\n",
+                __func__, handoff_file, dpvs_strerror(err));
+        munmap(hdr, st.st_size);
+        return err;
+    }
+
+    handoff_in = hdr;
+    handoff_in_size = st.st_size;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        imp = &handoff_imports[cid];
+        memset(imp, 0, sizeof(*imp));
+        imp->finished = true;
+
+        if (!hdr->sects[cid].nconns)
+            continue;
+
+        /* FNAT lports and RSS queues tie conns to the lcore */
+        if (!handoff_lcore(cid)) {
+            dropped += hdr->sects[cid].nconns;
+            continue;
+        }
+
+        imp->done = rte_zmalloc_socket("handoff_import", hdr->sects[cid].nconns,
+                                       0, rte_lcore_to_socket_id(cid));
+        if (!imp->done) {
+            handoff_import_free();
+            return EDPVS_NOMEM;
+        }
+
+        imp->conns  = (void *)hdr + hdr->sects[cid].offset;
+        imp->nconns = hdr->sects[cid].nconns;
+        imp->remain = imp->nconns;
+        nconns += imp->nconns;
+        imp->finished = false;
+    }
+
+    handoff_deadline = rte_get_timer_cycles() + handoff_timeout * g_cycles_per_sec;
+
+    RTE_LOG(INFO, IPVS, "%s: %u conns to restore from %s (exported %lds ago), "
+            "%u dropped for lcore mismatch\n", __func__, nconns, handoff_file,
+            (long)(time(NULL) - hdr->timestamp), dropped);
+
+    return EDPVS_OK;
+}
+
+/////////////////////////////// jobs ///////////////////////////////////////
+
+static void handoff_master_job(void *arg)
+{
+    lcoreid_t cid;
+
+    if (unlikely(handoff_requested)) {
+        handoff_requested = 0;
+        if (handoff_export() == EDPVS_OK) {
+            /* leave NIC queues to the successor, through the usual
+             * cleanup of main() once all lcores are out of their loops */
+            RTE_LOG(INFO, IPVS, "%s: hand-off done, terminating\n", __func__);
+            dpvs_lcore_stop();
+            return;
+        }
+        RTE_LOG(WARNING, IPVS, "%s: hand-off failed, keep running\n", __func__);
+    }
+
+    if (likely(!handoff_in))
+        return;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!handoff_imports[cid].finished)
+            return;
+    }
+
+    rte_rmb();
+    handoff_import_free();
+    RTE_LOG(INFO, IPVS, "%s: connection hand-off finished\n", __func__);
+}
+
+static struct dpvs_lcore_job handoff_jobs[] = {
+    {
+        .name = "handoff_master",
+        .func = handoff_master_job,
+        .data = NULL,
+        .type = LCORE_JOB_LOOP,
+    },
+    {
+        .name = "handoff_import",
+        .func = handoff_import_job,
+        .data = NULL,
+        .type = LCORE_JOB_SLOW,
+        .skip_loops = HANDOFF_IMPORT_INTERVAL,
+    },
+};
+
+int dp_vs_handoff_init(void)
+{
+    struct dpvs_msg_type msg_type;
+    struct sigaction sig;
+    lcoreid_t cid;
+    int err;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++)
+        handoff_imports[cid].finished = true;
+
+    memset(&msg_type, 0, sizeof(struct dpvs_msg_type));
+    msg_type.type   = MSG_TYPE_CONN_HANDOFF;
+    msg_type.mode   = DPVS_MSG_MULTICAST;
+    msg_type.prio   = MSG_PRIO_LOW;
+    msg_type.cid    = rte_lcore_id();
+    msg_type.unicast_msg_cb = handoff_export_msg_cb;
+    err = msg_type_mc_register(&msg_type);
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "%s: fail to register msg.\n", __func__);
+        return err;
+    }
+
+    err = dpvs_lcore_job_register(&handoff_jobs[0], LCORE_ROLE_MASTER);
+    if (err != EDPVS_OK)
+        goto unreg_msg;
+
+    if (handoff_import_prepare() == EDPVS_OK) {
+        err = dpvs_lcore_job_register(&handoff_jobs[1], LCORE_ROLE_FWD_WORKER);
+        if (err != EDPVS_OK) {
+            handoff_import_free();
+            goto unreg_job;
+        }
+    }
+
+    memset(&sig, 0, sizeof(struct sigaction));
+    sig.sa_handler = handoff_sig_callback;
+    sigemptyset(&sig.sa_mask);
+    sig.sa_flags = 0;
+
+    if (sigaction(SIGUSR2, &sig, NULL) < 0) {
+        RTE_LOG(ERR, IPVS, "%s: signal handler register failed\n", __func__);
+        err = EDPVS_SYSCALL;
+        goto unreg_import;
+    }
+
+    return EDPVS_OK;
+
+unreg_import:
+    if (handoff_in) {
+        dpvs_lcore_job_unregister(&handoff_jobs[1], LCORE_ROLE_FWD_WORKER);
+        handoff_import_free();
+    }
+unreg_job:
+    dpvs_lcore_job_unregister(&handoff_jobs[0], LCORE_ROLE_MASTER);
+unreg_msg:
+    msg_type_mc_unregister(&msg_type);
+    return err;
+}
+
+int dp_vs_handoff_term(void)
+{
+    struct dpvs_msg_type msg_type;
+
+    signal(SIGUSR2, SIG_DFL);
+
+    dpvs_lcore_job_unregister(&handoff_jobs[1], LCORE_ROLE_FWD_WORKER);
+    dpvs_lcore_job_unregister(&handoff_jobs[0], LCORE_ROLE_MASTER);
+    handoff_import_free();
+
+    memset(&msg_type, 0, sizeof(struct dpvs_msg_type));
+    msg_type.type   = MSG_TYPE_CONN_HANDOFF;
+    msg_type.mode   = DPVS_MSG_MULTICAST;
+    msg_type.prio   = MSG_PRIO_LOW;
+    msg_type.cid    = rte_lcore_id();
+    msg_type.unicast_msg_cb = handoff_export_msg_cb;
+
+    return msg_type_mc_unregister(&msg_type);
+}
+
+/////////////////////////////// config ///////////////////////////////////////
+
+static void handoff_file_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+
+    assert(str);
+
+    if (strlen(str) >= HANDOFF_FILE_LEN - 1) {
+        RTE_LOG(WARNING, IPVS, "invalid handoff_file %s, using default %s\n",
+                str, HANDOFF_FILE_DEF);
+        snprintf(handoff_file, sizeof(handoff_file), "%s", HANDOFF_FILE_DEF);
+    } else {
+        RTE_LOG(INFO, IPVS, "handoff_file = %s\n", str);
+        snprintf(handoff_file, sizeof(handoff_file), "%s", str);
+    }
+
+    FREE_PTR(str);
+}
+
+static void handoff_timeout_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int timeout;
+
+    assert(str);
+
+    timeout = atoi(str);
+
+    if (timeout >= HANDOFF_TIMEOUT_MIN && timeout <= HANDOFF_TIMEOUT_MAX) {
+        RTE_LOG(INFO, IPVS, "handoff_timeout = %d\n", timeout);
+        handoff_timeout = timeout;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid handoff_timeout %s, using default %d\n",
+                str, HANDOFF_TIMEOUT_DEF);
+        handoff_timeout = HANDOFF_TIMEOUT_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+void handoff_keyword_value_init(void)
+{
+    if (dpvs_state_get() == DPVS_STATE_INIT) {
+        /* KW_TYPE_INIT keyword */
+        snprintf(handoff_file, sizeof(handoff_file), "%s", HANDOFF_FILE_DEF);
+        handoff_timeout = HANDOFF_TIMEOUT_DEF;
+    }
+}
+
+void install_handoff_keywords(void)
+{
+    install_keyword("handoff_file", handoff_file_handler, KW_TYPE_INIT);
+    install_keyword("handoff_timeout", handoff_timeout_handler, KW_TYPE_INIT);
+}
@@ -0,0 +1,772 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/*
+ * the sources dropping most packets in software get a drop rule on the
+ * NICs (rte_flow), so that their packets cost no more rx and CPU.
+ *
+ * only drops a spoofed source cannot cause to someone else are counted:
+ * blacklist denies, and connlimit refusals of clients that proved their
+ * address with a syn cookie. a rule matches the source and the VIP it
+ * was dropped for, and never a local address, real server or LIP.
+ *
+ * every slave lcore counts these drops by source and VIP, in a table of
+ * fixed size: a pair hashes to a bucket of a few slots, a bucket full of
+ * other pairs takes one count off each of them (Misra-Gries within the
+ * bucket), so only the heavy hitters stay in. counts are per second of
+ * the TSC; at the first drop of the next second the lcore reports its
+ * pairs over its share of the rate to master.
+ *
+ * master sums the reports of a second per pair and installs a drop rule
+ * for a pair reaching the rate on every physical port, up to max_flows
+ * rules a port, evicting the slowest pair when full. rules go ttl
+ * seconds after the last report of the pair; a source still attacking
+ * is reported again once its packets are seen after that. ports of PMDs
+ * without rte_flow (net_tap, ...) are skipped.
+ */
+#include <assert.h>
+#include <rte_jhash.h>
+#include "dpdk.h"
+#include "list.h"
+#include "conf/common.h"
+#include "global_data.h"
+#include "netif.h"
+#include "inet.h"
+#include "inetaddr.h"
+#include "ctrl.h"
+#include "scheduler.h"
+#include "parser/parser.h"
+#include "ipvs/ipvs.h"
+#include "ipvs/service.h"
+#include "ipvs/hwdrop.h"
+
+#define DPVS_HWDROP_RATE_DEF        0
+#define DPVS_HWDROP_RATE_MAX        100000000
+#define DPVS_HWDROP_TTL_DEF         30
+#define DPVS_HWDROP_TTL_MAX         86400
+#define DPVS_HWDROP_MAX_FLOWS_DEF   1024
+#define DPVS_HWDROP_MAX_FLOWS_MAX   65536
+
+#define DPVS_HWDROP_SLOTS           1024    /* per lcore, power of 2 */
+#define DPVS_HWDROP_WAYS            4       /* slots a bucket */
+#define DPVS_HWDROP_REPORT_MAX      64      /* sources a report */
+
+#define DPVS_HWDROP_TAB_BITS        8
+#define DPVS_HWDROP_TAB_SIZE        (1 << DPVS_HWDROP_TAB_BITS)
+#define DPVS_HWDROP_TAB_MASK        (DPVS_HWDROP_TAB_SIZE - 1)
+#define DPVS_HWDROP_MAX_SRCS        4096    /* on master */
+#define DPVS_HWDROP_IDLE_SEC        2       /* candidates not reported */
+
+struct hwdrop_slot {
+    union inet_addr     addr;
+    union inet_addr     vaddr;
+    uint32_t            count;
+    uint8_t             af;
+};
+
+struct hwdrop_lcore {
+    uint64_t            tick;       /* TSC the current second ends at */
+    uint32_t            sec;
+    struct hwdrop_slot  slots[DPVS_HWDROP_SLOTS];
+};
+
+struct hwdrop_report_src {
+    int                 af;
+    union inet_addr     addr;
+    union inet_addr     vaddr;
+    uint32_t            count;
+};
+
+struct hwdrop_report {
+    uint32_t            sec;
+    uint32_t            nsrcs;
+    struct hwdrop_report_src srcs[DPVS_HWDROP_REPORT_MAX];
+};
+
+#define HWDROP_REPORT_LEN(n)    (offsetof(struct hwdrop_report, srcs) + \
+                                 (n) * sizeof(struct hwdrop_report_src))
+
+/* a source and the VIP it attacks, on master */
+struct hwdrop_src {
+    struct list_head    list;
+    int                 af;
+    union inet_addr     addr;
+    union inet_addr     vaddr;
+    uint32_t            sec;        /* of @count */
+    uint32_t            count;      /* reported for @sec so far */
+    uint32_t            rate;
+    uint64_t            last;       /* TSC of the last report */
+    uint64_t            tried;      /* TSC rules were last tried */
+    uint16_t            nports;
+    struct rte_flow     *flows[RTE_MAX_ETHPORTS];
+};
+
+struct hwdrop_port {
+    uint32_t            nflows;
+    bool                nosupp;
+};
+
+uint32_t dp_vs_hwdrop_rate = DPVS_HWDROP_RATE_DEF;
+static uint32_t dp_vs_hwdrop_ttl = DPVS_HWDROP_TTL_DEF;
+static uint32_t dp_vs_hwdrop_max_flows = DPVS_HWDROP_MAX_FLOWS_DEF;
+
+static struct hwdrop_lcore *dp_vs_hwdrop_lcores[DPVS_MAX_LCORE];
+static uint32_t dp_vs_hwdrop_nlcores;
+static uint32_t dp_vs_hwdrop_rnd;
+
+/* master only */
+static struct list_head dp_vs_hwdrop_tab[DPVS_HWDROP_TAB_SIZE];
+static struct hwdrop_port dp_vs_hwdrop_ports[RTE_MAX_ETHPORTS];
+static uint32_t dp_vs_hwdrop_nsrcs;
+static uint32_t dp_vs_hwdrop_nflows;
+static uint64_t dp_vs_hwdrop_installs;
+static uint64_t dp_vs_hwdrop_evicts;
+static uint64_t dp_vs_hwdrop_expires;
+static uint64_t dp_vs_hwdrop_fails;
+static uint64_t dp_vs_hwdrop_checked;
+
+static inline uint32_t hwdrop_hash(int af, const union inet_addr *addr,
+                                   const union inet_addr *vaddr)
+{
+    if (af == AF_INET6)
+        return rte_jhash(&addr->in6, sizeof(addr->in6),
+                         rte_jhash(&vaddr->in6, sizeof(vaddr->in6),
+                                   dp_vs_hwdrop_rnd));
+    return rte_jhash_2words(addr->in.s_addr, vaddr->in.s_addr,
+                            dp_vs_hwdrop_rnd);
+}
+
+static inline void hwdrop_addr_copy(int af, union inet_addr *dst,
+                                    const union inet_addr *src)
+{
+    memset(dst, 0, sizeof(*dst));
+    if (af == AF_INET6)
+        dst->in6 = src->in6;
+    else
+        dst->in = src->in;
+}
+
+static void hwdrop_report(struct hwdrop_lcore *hl, uint64_t now)
+{
+    struct hwdrop_report rep;
+    struct dpvs_msg *msg;
+    uint64_t hz = rte_get_timer_hz();
+    uint32_t sec = now / hz, thresh, i;
+    lcoreid_t cid = rte_lcore_id();
+    int err;
+
+    /* half the share of the lcore, RSS spreads a source unevenly */
+    thresh = dp_vs_hwdrop_rate / dp_vs_hwdrop_nlcores / 2;
+    if (!thresh)
+        thresh = 1;
+
+    /* a second older than the last is stale, left out */
+    rep.sec = hl->sec;
+    rep.nsrcs = 0;
+    if (hl->tick && sec == hl->sec + 1) {
+        for (i = 0; i < DPVS_HWDROP_SLOTS; i++) {
+            if (hl->slots[i].count < thresh)
+                continue;
+            rep.srcs[rep.nsrcs].af = hl->slots[i].af;
+            rep.srcs[rep.nsrcs].addr = hl->slots[i].addr;
+            rep.srcs[rep.nsrcs].vaddr = hl->slots[i].vaddr;
+            rep.srcs[rep.nsrcs].count = hl->slots[i].count;
+            if (++rep.nsrcs >= DPVS_HWDROP_REPORT_MAX)
+                break;
+        }
+    }
+
+    memset(hl->slots, 0, sizeof(hl->slots));
+    hl->sec = sec;
+    hl->tick = (uint64_t)(sec + 1) * hz;
+
+    if (!rep.nsrcs)
+        return;
+
+    msg = msg_make(MSG_TYPE_HWDROP_REPORT, 0, DPVS_MSG_UNICAST, cid,
+                   HWDROP_REPORT_LEN(rep.nsrcs), &rep);
+    if (unlikely(!msg))
+        return;
+
+    err = msg_send(msg, rte_get_master_lcore(), DPVS_MSG_F_ASYNC, NULL);
+    if (err != EDPVS_OK)
+        RTE_LOG(WARNING, IPVS, "[%02d] %s: msg_send failed -- %s\n",
+                cid, __func__, dpvs_strerror(err));
+    msg_destroy(&msg);
+}
+
+void __dp_vs_hwdrop_count(int af, const union inet_addr *saddr,
+                          const union inet_addr *vaddr)
+{
+    struct hwdrop_lcore *hl = dp_vs_hwdrop_lcores[rte_lcore_id()];
+    struct hwdrop_slot *bkt, *empty = NULL;
+    uint64_t now;
+    int i;
+
+    if (unlikely(!hl))
+        return;
+
+    now = rte_get_timer_cycles();
+    if (unlikely(now >= hl->tick))
+        hwdrop_report(hl, now);
+
+    bkt = &hl->slots[hwdrop_hash(af, saddr, vaddr) & (DPVS_HWDROP_SLOTS - 1)
+                     & ~(DPVS_HWDROP_WAYS - 1)];
+    for (i = 0; i < DPVS_HWDROP_WAYS; i++) {
+        if (!bkt[i].count) {
+            if (!empty)
+                empty = &bkt[i];
+            continue;
+        }
+        if (bkt[i].af == af && inet_addr_equal(af, &bkt[i].addr, saddr) &&
+                inet_addr_equal(af, &bkt[i].vaddr, vaddr)) {
+            bkt[i].count++;
+            return;
+        }
+    }
+
+    if (empty) {
+        hwdrop_addr_copy(af, &empty->addr, saddr);
+        hwdrop_addr_copy(af, &empty->vaddr, vaddr);
+        empty->af = af;
+        empty->count = 1;
+        return;
+    }
+
+    for (i = 0; i < DPVS_HWDROP_WAYS; i++)
+        bkt[i].count--;
+}
+
+static inline bool hwdrop_port_usable(const struct netif_port *dev)
+{
+    return dev && (dev->type == PORT_TYPE_GENERAL ||
+                   dev->type == PORT_TYPE_BOND_SLAVE) &&
+           !dp_vs_hwdrop_ports[dev->id].nosupp;
+}
+
+static void hwdrop_uninstall(struct hwdrop_src *src)
+{
+    struct netif_port *dev;
+    portid_t pid;
+
+    if (!src->nports)
+        return;
+
+    for (pid = 0; pid < RTE_MAX_ETHPORTS; pid++) {
+        if (!src->flows[pid])
+            continue;
+        /* a rule failing to go is counted gone, it is not ours any more */
+        dev = netif_port_get(pid);
+        if (dev)
+            netif_flow_destroy(dev, src->flows[pid]);
+        dp_vs_hwdrop_ports[pid].nflows--;
+        src->flows[pid] = NULL;
+    }
+    src->nports = 0;
+    dp_vs_hwdrop_nflows--;
+}
+
+/* a local address, real server or LIP gets no rule, whatever it sent */
+static bool hwdrop_src_ours(const struct hwdrop_src *src)
+{
+    union inet_addr addr = src->addr;
+
+    return inet_addr_get_iface(src->af, &addr) != NULL ||
+           dp_vs_service_addr_used(src->af, &src->addr, rte_lcore_id());
+}
+
+static void hwdrop_install(struct hwdrop_src *src)
+{
+    struct rte_flow_attr attr;
+    struct rte_flow_item pattern[3];
+    struct rte_flow_action actions[2];
+    struct rte_flow_item_ipv4 spec4, mask4;
+    struct rte_flow_item_ipv6 spec6, mask6;
+    struct netif_port *dev;
+    portid_t pid, nports = dpvs_rte_eth_dev_count();
+    char addr[64], vaddr[64];
+    int err;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.ingress = 1;
+
+    memset(pattern, 0, sizeof(pattern));
+    pattern[0].type = RTE_FLOW_ITEM_TYPE_ETH;
+    if (src->af == AF_INET6) {
+        memset(&spec6, 0, sizeof(spec6));
+        memset(&mask6, 0, sizeof(mask6));
+        memcpy(spec6.hdr.src_addr, &src->addr.in6, sizeof(spec6.hdr.src_addr));
+        memset(mask6.hdr.src_addr, 0xff, sizeof(mask6.hdr.src_addr));
+        memcpy(spec6.hdr.dst_addr, &src->vaddr.in6, sizeof(spec6.hdr.dst_addr));
+        memset(mask6.hdr.dst_addr, 0xff, sizeof(mask6.hdr.dst_addr));
+        pattern[1].type = RTE_FLOW_ITEM_TYPE_IPV6;
+        pattern[1].spec = &spec6;
+        pattern[1].mask = &mask6;
+    } else {
+        memset(&spec4, 0, sizeof(spec4));
+        memset(&mask4, 0, sizeof(mask4));
+        spec4.hdr.src_addr = src->addr.in.s_addr;
+        mask4.hdr.src_addr = 0xffffffff;
+        spec4.hdr.dst_addr = src->vaddr.in.s_addr;
+        mask4.hdr.dst_addr = 0xffffffff;
+        pattern[1].type = RTE_FLOW_ITEM_TYPE_IPV4;
+        pattern[1].spec = &spec4;
+        pattern[1].mask = &mask4;
+    }
+    pattern[2].type = RTE_FLOW_ITEM_TYPE_END;
+
+    memset(actions, 0, sizeof(actions));
+    actions[0].type = RTE_FLOW_ACTION_TYPE_DROP;
+    actions[1].type = RTE_FLOW_ACTION_TYPE_END;
+
+    src->tried = rte_get_timer_cycles();
+    for (pid = 0; pid < nports && pid < RTE_MAX_ETHPORTS; pid++) {
+        dev = netif_port_get(pid);
+        if (!hwdrop_port_usable(dev) ||
+                dp_vs_hwdrop_ports[pid].nflows >= dp_vs_hwdrop_max_flows)
+            continue;
+
+        err = netif_flow_create(dev, &attr, pattern, actions,
+                                &src->flows[pid]);
+        if (err == EDPVS_NOTSUPP) {
+            RTE_LOG(INFO, IPVS, "%s: no rte_flow drop rules on %s, "
+                    "skipped\n", __func__, dev->name);
+            dp_vs_hwdrop_ports[pid].nosupp = true;
+            src->flows[pid] = NULL;
+            continue;
+        }
+        if (err != EDPVS_OK) {
+            dp_vs_hwdrop_fails++;
+            src->flows[pid] = NULL;
+            continue;
+        }
+        dp_vs_hwdrop_ports[pid].nflows++;
+        src->nports++;
+    }
+
+    if (!src->nports)
+        return;
+
+    dp_vs_hwdrop_nflows++;
+    dp_vs_hwdrop_installs++;
+    RTE_LOG(INFO, IPVS, "%s: %s -> %s dropped on %u port(s), %u pkts/s\n",
+            __func__, inet_ntop(src->af, &src->addr, addr, sizeof(addr)) ?
+            addr : "::", inet_ntop(src->af, &src->vaddr, vaddr,
+            sizeof(vaddr)) ? vaddr : "::", src->nports, src->rate);
+}
+
+/* installed source of the lowest rate */
+static struct hwdrop_src *hwdrop_slowest(void)
+{
+    struct hwdrop_src *src, *min = NULL;
+    int i;
+
+    for (i = 0; i < DPVS_HWDROP_TAB_SIZE; i++) {
+        list_for_each_entry(src, &dp_vs_hwdrop_tab[i], list) {
+            if (src->nports && (!min || src->rate < min->rate))
+                min = src;
+        }
+    }
+    return min;
+}
+
+static void hwdrop_src_free(struct hwdrop_src *src)
+{
+    hwdrop_uninstall(src);
+    list_del(&src->list);
+    rte_free(src);
+    dp_vs_hwdrop_nsrcs--;
+}
+
+static struct hwdrop_src *hwdrop_src_get(int af, const union inet_addr *addr,
+                                         const union inet_addr *vaddr)
+{
+    struct list_head *head;
+    struct hwdrop_src *src;
+
+    head = &dp_vs_hwdrop_tab[hwdrop_hash(af, addr, vaddr)
+                             & DPVS_HWDROP_TAB_MASK];
+    list_for_each_entry(src, head, list) {
+        if (src->af == af && inet_addr_equal(af, &src->addr, addr) &&
+                inet_addr_equal(af, &src->vaddr, vaddr))
+            return src;
+    }
+
+    if (dp_vs_hwdrop_nsrcs >= DPVS_HWDROP_MAX_SRCS)
+        return NULL;
+
+    src = rte_zmalloc("hwdrop_src", sizeof(*src), RTE_CACHE_LINE_SIZE);
+    if (!src)
+        return NULL;
+    src->af = af;
+    hwdrop_addr_copy(af, &src->addr, addr);
+    hwdrop_addr_copy(af, &src->vaddr, vaddr);
+    list_add(&src->list, head);
+    dp_vs_hwdrop_nsrcs++;
+    return src;
+}
+
+static void hwdrop_flush(void)
+{
+    struct hwdrop_src *src, *next;
+    int i;
+
+    for (i = 0; i < DPVS_HWDROP_TAB_SIZE; i++) {
+        list_for_each_entry_safe(src, next, &dp_vs_hwdrop_tab[i], list)
+            hwdrop_src_free(src);
+    }
+}
+
+static int hwdrop_report_msg_cb(struct dpvs_msg *msg)
+{
+    struct hwdrop_report *rep;
+    struct hwdrop_src *src, *min;
+    uint64_t now = rte_get_timer_cycles();
+    uint32_t i;
+
+    assert(rte_lcore_id() == rte_get_master_lcore());
+
+    if (!msg || msg->len < HWDROP_REPORT_LEN(0))
+        return EDPVS_INVAL;
+    rep = (struct hwdrop_report *)msg->data;
+    if (rep->nsrcs > DPVS_HWDROP_REPORT_MAX ||
+            msg->len != HWDROP_REPORT_LEN(rep->nsrcs))
+        return EDPVS_INVAL;
+
+    if (!dp_vs_hwdrop_rate)
+        return EDPVS_OK;
+
+    for (i = 0; i < rep->nsrcs; i++) {
+        src = hwdrop_src_get(rep->srcs[i].af, &rep->srcs[i].addr,
+                             &rep->srcs[i].vaddr);
+        if (!src)
+            return EDPVS_NOROOM;
+
+        /* reports of an older second come late, left out */
+        if (rep->sec != src->sec) {
+            if ((int32_t)(rep->sec - src->sec) < 0)
+                continue;
+            src->rate = rep->sec == src->sec + 1 ? src->count : 0;
+            src->sec = rep->sec;
+            src->count = 0;
+        }
+        src->count += rep->srcs[i].count;
+        if (src->count > src->rate)
+            src->rate = src->count;
+        src->last = now;
+
+        if (src->nports || src->rate < dp_vs_hwdrop_rate)
+            continue;
+        /* NIC refused or the source is ours, try again a second later */
+        if (src->tried && now - src->tried < g_cycles_per_sec)
+            continue;
+        if (hwdrop_src_ours(src)) {
+            src->tried = now;
+            continue;
+        }
+
+        if (dp_vs_hwdrop_nflows >= dp_vs_hwdrop_max_flows) {
+            min = hwdrop_slowest();
+            if (!min || min->rate >= src->rate)
+                continue;
+            hwdrop_uninstall(min);
+            dp_vs_hwdrop_evicts++;
+        }
+        hwdrop_install(src);
+    }
+
+    return EDPVS_OK;
+}
+
+static void hwdrop_job_func(void *arg)
+{
+    struct hwdrop_src *src, *next, *min;
+    uint64_t now = rte_get_timer_cycles();
+    int i;
+
+    if (now - dp_vs_hwdrop_checked < g_cycles_per_sec)
+        return;
+    dp_vs_hwdrop_checked = now;
+
+    if (!dp_vs_hwdrop_nsrcs)
+        return;
+
+    /* turned off by reload */
+    if (!dp_vs_hwdrop_rate) {
+        hwdrop_flush();
+        return;
+    }
+
+    for (i = 0; i < DPVS_HWDROP_TAB_SIZE; i++) {
+        list_for_each_entry_safe(src, next, &dp_vs_hwdrop_tab[i], list) {
+            if (src->nports) {
+                if (now - src->last < dp_vs_hwdrop_ttl * g_cycles_per_sec)
+                    continue;
+                dp_vs_hwdrop_expires++;
+            } else if (now - src->last <
+                       DPVS_HWDROP_IDLE_SEC * g_cycles_per_sec) {
+                continue;
+            }
+            hwdrop_src_free(src);
+        }
+    }
+
+    /* max_flows lowered by reload */
+    while (dp_vs_hwdrop_nflows > dp_vs_hwdrop_max_flows &&
+           (min = hwdrop_slowest()) != NULL) {
+        hwdrop_uninstall(min);
+        dp_vs_hwdrop_evicts++;
+    }
+}
+
+static int hwdrop_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
+{
+    if (opt != SOCKOPT_SET_HWDROP_FLUSH)
+        return EDPVS_NOTSUPP;
+
+    hwdrop_flush();
+    return EDPVS_OK;
+}
+
+static int hwdrop_sockopt_get(sockoptid_t opt, const void *conf,
+                              size_t size, void **out, size_t *outsize)
+{
+    struct dp_vs_hwdrop_show *show;
+    struct dp_vs_hwdrop_entry *ent;
+    struct hwdrop_src *src;
+    struct netif_port *dev;
+    uint64_t now = rte_get_timer_cycles(), age;
+    portid_t pid, nports = dpvs_rte_eth_dev_count();
+    size_t len;
+    int i;
+
+    if (!out || !outsize)
+        return EDPVS_INVAL;
+
+    len = sizeof(*show) + dp_vs_hwdrop_nsrcs * sizeof(*ent);
+    show = rte_zmalloc("hwdrop_show", len, 0);
+    if (!show)
+        return EDPVS_NOMEM;
+
+    show->rate = dp_vs_hwdrop_rate;
+    show->ttl = dp_vs_hwdrop_ttl;
+    show->max_flows = dp_vs_hwdrop_max_flows;
+    for (pid = 0; pid < nports && pid < RTE_MAX_ETHPORTS; pid++) {
+        dev = netif_port_get(pid);
+        if (!dev || (dev->type != PORT_TYPE_GENERAL &&
+                     dev->type != PORT_TYPE_BOND_SLAVE))
+            continue;
+        if (dp_vs_hwdrop_ports[pid].nosupp)
+            show->nports_nosupp++;
+        else
+            show->nports++;
+    }
+    show->nflows = dp_vs_hwdrop_nflows;
+    show->installs = dp_vs_hwdrop_installs;
+    show->evicts = dp_vs_hwdrop_evicts;
+    show->expires = dp_vs_hwdrop_expires;
+    show->fails = dp_vs_hwdrop_fails;
+
+    for (i = 0; i < DPVS_HWDROP_TAB_SIZE; i++) {
+        list_for_each_entry(src, &dp_vs_hwdrop_tab[i], list) {
+            ent = &show->entries[show->nentries++];
+            ent->af = src->af;
+            ent->addr = src->addr;
+            ent->vaddr = src->vaddr;
+            ent->rate = src->rate;
+            ent->nports = src->nports;
+            age = (now - src->last) / g_cycles_per_sec;
+            if (src->nports && age < dp_vs_hwdrop_ttl)
+                ent->ttl = dp_vs_hwdrop_ttl - age;
+        }
+    }
+
+    *out = show;
+    *outsize = len;
+    return EDPVS_OK;
+}
+
+static void hwdrop_rate_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int rate;
+
+    assert(str);
+
+    rate = atoi(str);
+    if (rate >= 0 && rate <= DPVS_HWDROP_RATE_MAX) {
+        RTE_LOG(INFO, IPVS, "hwdrop rate = %d\n", rate);
+        dp_vs_hwdrop_rate = rate;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid hwdrop rate %s, using default %d\n",
+                str, DPVS_HWDROP_RATE_DEF);
+        dp_vs_hwdrop_rate = DPVS_HWDROP_RATE_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+static void hwdrop_ttl_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int ttl;
+
+    assert(str);
+
+    ttl = atoi(str);
+    if (ttl >= 1 && ttl <= DPVS_HWDROP_TTL_MAX) {
+        RTE_LOG(INFO, IPVS, "hwdrop ttl = %d\n", ttl);
+        dp_vs_hwdrop_ttl = ttl;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid hwdrop ttl %s, using default %d\n",
+                str, DPVS_HWDROP_TTL_DEF);
+        dp_vs_hwdrop_ttl = DPVS_HWDROP_TTL_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+static void hwdrop_max_flows_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int max_flows;
+
+    assert(str);
+
+    max_flows = atoi(str);
+    if (max_flows >= 1 && max_flows <= DPVS_HWDROP_MAX_FLOWS_MAX) {
+        RTE_LOG(INFO, IPVS, "hwdrop max_flows = %d\n", max_flows);
+        dp_vs_hwdrop_max_flows = max_flows;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid hwdrop max_flows %s, "
+                "using default %d\n", str, DPVS_HWDROP_MAX_FLOWS_DEF);
+        dp_vs_hwdrop_max_flows = DPVS_HWDROP_MAX_FLOWS_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+void hwdrop_keyword_value_init(void)
+{
+    dp_vs_hwdrop_rate = DPVS_HWDROP_RATE_DEF;
+    dp_vs_hwdrop_ttl = DPVS_HWDROP_TTL_DEF;
+    dp_vs_hwdrop_max_flows = DPVS_HWDROP_MAX_FLOWS_DEF;
+}
+
+void install_hwdrop_keywords(void)
+{
+    install_keyword("rate", hwdrop_rate_handler, KW_TYPE_NORMAL);
+    install_keyword("ttl", hwdrop_ttl_handler, KW_TYPE_NORMAL);
+    install_keyword("max_flows", hwdrop_max_flows_handler, KW_TYPE_NORMAL);
+}
+
+static struct dpvs_sockopts hwdrop_sockopts = {
+    .version            = SOCKOPT_VERSION,
+    .set_opt_min        = SOCKOPT_SET_HWDROP_FLUSH,
+    .set_opt_max        = SOCKOPT_SET_HWDROP_FLUSH,
+    .set                = hwdrop_sockopt_set,
+    .get_opt_min        = SOCKOPT_GET_HWDROP_SHOW,
+    .get_opt_max        = SOCKOPT_GET_HWDROP_SHOW,
+    .get                = hwdrop_sockopt_get,
+};
+
+static struct dpvs_lcore_job hwdrop_job = {
+    .name = "hwdrop",
+    .func = hwdrop_job_func,
+    .data = NULL,
+    .type = LCORE_JOB_LOOP,
+};
+
+static void hwdrop_lcores_free(void)
+{
+    lcoreid_t cid;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        rte_free(dp_vs_hwdrop_lcores[cid]);
+        dp_vs_hwdrop_lcores[cid] = NULL;
+    }
+    dp_vs_hwdrop_nlcores = 0;
+}
+
+int dp_vs_hwdrop_init(void)
+{
+    struct dpvs_msg_type msg_type;
+    uint64_t slave_mask;
+    uint8_t nslaves;
+    lcoreid_t cid;
+    int i, err;
+
+    for (i = 0; i < DPVS_HWDROP_TAB_SIZE; i++)
+        INIT_LIST_HEAD(&dp_vs_hwdrop_tab[i]);
+    dp_vs_hwdrop_rnd = (uint32_t)rte_rand();
+
+    netif_get_slave_lcores(&nslaves, &slave_mask);
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!(slave_mask & (1UL << cid)))
+            continue;
+        dp_vs_hwdrop_lcores[cid] = rte_zmalloc_socket("hwdrop",
+                sizeof(struct hwdrop_lcore), RTE_CACHE_LINE_SIZE,
+                rte_lcore_to_socket_id(cid));
+        if (!dp_vs_hwdrop_lcores[cid]) {
+            err = EDPVS_NOMEM;
+            goto errout;
+        }
+        dp_vs_hwdrop_nlcores++;
+    }
+
+    memset(&msg_type, 0, sizeof(struct dpvs_msg_type));
+    msg_type.type   = MSG_TYPE_HWDROP_REPORT;
+    msg_type.mode   = DPVS_MSG_UNICAST;
+    msg_type.prio   = MSG_PRIO_LOW;
+    msg_type.cid    = rte_get_master_lcore();
+    msg_type.unicast_msg_cb = hwdrop_report_msg_cb;
+    err = msg_type_register(&msg_type);
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "%s: fail to register msg.\n", __func__);
+        goto errout;
+    }
+
+    err = dpvs_lcore_job_register(&hwdrop_job, LCORE_ROLE_MASTER);
+    if (err != EDPVS_OK)
+        goto errout;
+
+    if ((err = sockopt_register(&hwdrop_sockopts)) != EDPVS_OK) {
+        dpvs_lcore_job_unregister(&hwdrop_job, LCORE_ROLE_MASTER);
+        goto errout;
+    }
+
+    return EDPVS_OK;
+
+errout:
+    hwdrop_lcores_free();
+    return err;
+}
+
+int dp_vs_hwdrop_term(void)
+{
+    int err;
+
+    if ((err = sockopt_unregister(&hwdrop_sockopts)) != EDPVS_OK)
+        return err;
+
+    dpvs_lcore_job_unregister(&hwdrop_job, LCORE_ROLE_MASTER);
+
+    /* lcores are stopped, rules go with the sources */
+    hwdrop_flush();
+    hwdrop_lcores_free();
+    return EDPVS_OK;
+}
@@ -118,7 +118,7 @@ static inline int __laddr_step(struct dp_vs_service *svc)
     * */
     if (strncmp(svc->scheduler->name, "rr", 2) == 0 ||
             strncmp(svc->scheduler->name, "wrr", 3) == 0)
-        return (random() % 100) < 5 ? 2 : 1;
+        return dpvs_rand_range(100) < 5 ? 2 : 1;
 
     return 1;
 }
@@ -254,6 +254,69 @@ int dp_vs_laddr_bind(struct dp_vs_conn *conn, struct dp_vs_service *svc)
     return EDPVS_OK;
 }
 
+/*
+ * bind the conn to the <laddr, lport> it already carries instead of
+ * selecting a new one, used to restore connections from hand-off.
+ */
+int dp_vs_laddr_rebind(struct dp_vs_conn *conn, struct dp_vs_service *svc)
+{
+    struct dp_vs_laddr *laddr;
+    struct sockaddr_storage dsin, ssin;
+    int err;
+
+    if (!conn || !conn->dest || !svc)
+        return EDPVS_INVAL;
+    if (svc->proto != IPPROTO_TCP && svc->proto != IPPROTO_UDP)
+        return EDPVS_NOTSUPP;
+    if (dp_vs_conn_is_template(conn))
+        return EDPVS_OK;
+
+    list_for_each_entry(laddr, &svc->laddr_list, list) {
+        if (inet_addr_equal(laddr->af, &laddr->addr, &conn->laddr))
+            goto found;
+    }
+    return EDPVS_NOTEXIST;
+
+found:
+    memset(&dsin, 0, sizeof(struct sockaddr_storage));
+    memset(&ssin, 0, sizeof(struct sockaddr_storage));
+
+    if (laddr->af == AF_INET) {
+        struct sockaddr_in *daddr, *saddr;
+        daddr = (struct sockaddr_in *)&dsin;
+        daddr->sin_family = laddr->af;
+        daddr->sin_addr = conn->daddr.in;
+        daddr->sin_port = conn->dport;
+        saddr = (struct sockaddr_in *)&ssin;
+        saddr->sin_family = laddr->af;
+        saddr->sin_addr = laddr->addr.in;
+        saddr->sin_port = conn->lport;
+    } else {
+        struct sockaddr_in6 *daddr, *saddr;
+        daddr = (struct sockaddr_in6 *)&dsin;
+        daddr->sin6_family = laddr->af;
+        daddr->sin6_addr = conn->daddr.in6;
+        daddr->sin6_port = conn->dport;
+        saddr = (struct sockaddr_in6 *)&ssin;
+        saddr->sin6_family = laddr->af;
+        saddr->sin6_addr = laddr->addr.in6;
+        saddr->sin6_port = conn->lport;
+    }
+
+    err = sa_reserve(laddr->iface, &dsin, &ssin);
+    if (err != EDPVS_OK)
+        return err;
+
+    rte_atomic32_inc(&laddr->refcnt);
+    rte_atomic32_inc(&laddr->conn_counts);
+
+    tuplehash_out(conn).daddr = laddr->addr;
+    tuplehash_out(conn).dport = conn->lport;
+
+    conn->local = laddr;
+    return EDPVS_OK;
+}
+
 int dp_vs_laddr_unbind(struct dp_vs_conn *conn)
 {
     struct sockaddr_storage dsin, ssin;
@@ -361,6 +424,19 @@ int dp_vs_laddr_del(struct dp_vs_service *svc, int af, const union inet_addr *ad
     return err;
 }
 
+bool dp_vs_laddr_exist(const struct dp_vs_service *svc, int af,
+                       const union inet_addr *addr)
+{
+    struct dp_vs_laddr *laddr;
+
+    list_for_each_entry(laddr, &svc->laddr_list, list) {
+        if (af == laddr->af && inet_addr_equal(af, &laddr->addr, addr))
+            return true;
+    }
+
+    return false;
+}
+
 /* if success, it depend on caller to free @addrs by rte_free() */
 static int dp_vs_laddr_getall(struct dp_vs_service *svc,
                               struct dp_vs_laddr_entry **addrs, size_t *naddr)
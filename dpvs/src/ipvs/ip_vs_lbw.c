@@ -0,0 +1,102 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * Least Bandwidth scheduling.
+ *
+ * A new connection goes to the server with the least estimated traffic
+ * relative to its weight,
+ *                (Bi + Ni * B / C) / Wi
+ * Bi being the in+out byte rate of the server from the rate estimator,
+ * Ni the connections it got since the last estimation, B / C the average
+ * byte rate of an active connection of the service and Wi the weight.
+ * Ni * B / C accounts for connections not yet reflected in Bi, otherwise
+ * all new connections would herd to the same server for an interval.
+ *
+ * Rates and counters are those of this lcore's copy of the service, as
+ * the connections it schedules. Ties, e.g. when nothing was estimated
+ * yet, are broken by Shortest Expected Delay, (Ci + 1) / Wi.
+ */
+#include "ipvs/lbw.h"
+
+static inline uint64_t dp_vs_lbw_dest_bps(const struct dp_vs_dest *dest)
+{
+    return (uint64_t)dest->stats.inbps + dest->stats.outbps;
+}
+
+static inline uint64_t dp_vs_lbw_dest_fresh(const struct dp_vs_dest *dest)
+{
+    /* zeroed counters, est catches up at the next estimation */
+    if (unlikely(dest->stats.conns < dest->est.last_conns))
+        return dest->stats.conns;
+    return dest->stats.conns - dest->est.last_conns;
+}
+
+static struct dp_vs_dest *dp_vs_lbw_schedule(struct dp_vs_service *svc,
+                                             const struct rte_mbuf *mbuf)
+{
+    struct dp_vs_dest *dest, *least = NULL;
+    uint64_t bps = 0, conns = 0;
+    double per_conn = 0, lload = 0, dload;
+    unsigned int loh = 0, doh;
+    int lw = 0, dw;
+
+    list_for_each_entry(dest, &svc->dests, n_list) {
+        if (!dp_vs_dest_is_valid(dest))
+            continue;
+        bps += dp_vs_lbw_dest_bps(dest);
+        conns += rte_atomic32_read(&dest->actconns);
+    }
+    if (conns)
+        per_conn = (double)bps / conns;
+
+    list_for_each_entry(dest, &svc->dests, n_list) {
+        if (!dp_vs_dest_is_valid(dest))
+            continue;
+
+        dw = rte_atomic16_read(&dest->weight);
+        dload = (dp_vs_lbw_dest_bps(dest) +
+                 dp_vs_lbw_dest_fresh(dest) * per_conn) / dw;
+        doh = rte_atomic32_read(&dest->actconns) + 1;
+
+        if (!least || dload < lload ||
+            (dload == lload && (uint64_t)loh * dw > (uint64_t)doh * lw)) {
+            least = dest;
+            lload = dload;
+            loh = doh;
+            lw = dw;
+        }
+    }
+
+    return least;
+}
+
+static struct dp_vs_scheduler dp_vs_lbw_scheduler = {
+    .name = "lbw",
+    .n_list = LIST_HEAD_INIT(dp_vs_lbw_scheduler.n_list),
+    .schedule = dp_vs_lbw_schedule,
+};
+
+int dp_vs_lbw_init(void)
+{
+    return register_dp_vs_scheduler(&dp_vs_lbw_scheduler);
+}
+
+int dp_vs_lbw_term(void)
+{
+    return unregister_dp_vs_scheduler(&dp_vs_lbw_scheduler);
+}
@@ -0,0 +1,73 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * Never Queue scheduling, as the kernel's ip_vs_nq.
+ *
+ * A new connection goes to an idle server if there is one, instead of
+ * waiting for a faster busy server. If all servers are busy it falls
+ * back to Shortest Expected Delay, (Ci + 1) / Ui.
+ */
+#include "ipvs/nq.h"
+
+static inline unsigned int dp_vs_nq_dest_overhead(struct dp_vs_dest *dest)
+{
+    return rte_atomic32_read(&dest->actconns);
+}
+
+static struct dp_vs_dest *dp_vs_nq_schedule(struct dp_vs_service *svc,
+                                            const struct rte_mbuf *mbuf)
+{
+    struct dp_vs_dest *dest, *least = NULL;
+    unsigned int loh = 0, doh;
+
+    list_for_each_entry(dest, &svc->dests, n_list) {
+        if (!dp_vs_dest_is_valid(dest))
+            continue;
+
+        doh = dp_vs_nq_dest_overhead(dest);
+
+        /* an idle server, take it right away */
+        if (doh == 0)
+            return dest;
+
+        if (!least ||
+            (uint64_t)(loh + 1) * rte_atomic16_read(&dest->weight) >
+            (uint64_t)(doh + 1) * rte_atomic16_read(&least->weight)) {
+            least = dest;
+            loh = doh;
+        }
+    }
+
+    return least;
+}
+
+static struct dp_vs_scheduler dp_vs_nq_scheduler = {
+    .name = "nq",
+    .n_list = LIST_HEAD_INIT(dp_vs_nq_scheduler.n_list),
+    .schedule = dp_vs_nq_schedule,
+};
+
+int dp_vs_nq_init(void)
+{
+    return register_dp_vs_scheduler(&dp_vs_nq_scheduler);
+}
+
+int dp_vs_nq_term(void)
+{
+    return unregister_dp_vs_scheduler(&dp_vs_nq_scheduler);
+}
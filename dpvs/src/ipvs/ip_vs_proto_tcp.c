@@ -31,6 +31,7 @@
 #include "ipvs/dest.h"
 #include "ipvs/synproxy.h"
 #include "ipvs/blklst.h"
+#include "ipvs/connlimit.h"
 #include "parser/parser.h"
 /* we need more detailed fields than dpdk tcp_hdr{},
  * like tcphdr.syn, so use standard definition. */
@@ -317,8 +318,16 @@ static inline void tcp_in_adjust_seq(struct dp_vs_conn *conn, struct tcphdr *th)
 static void tcp_in_change_ts(struct dp_vs_conn *conn, struct tcphdr *tcph)
 {
     unsigned char *ptr;
+    struct dp_vs_conn_ext *ext;
  
     int len;
+
+    /* RTT tracking lives in the cold extension, attached on a SYN with
+     * a timestamp only, so that the timestamps of one flow are rewritten
+     * all or none and flows without them never touch it */
+    if (!conn->ext && !(tcph->syn && !tcph->ack))
+        return;
+
     ptr = (unsigned char *)(tcph + 1);
     len = (tcph->doff << 2) - sizeof(struct tcphdr);
     uint32_t *tmp;
@@ -342,7 +351,10 @@ static void tcp_in_change_ts(struct dp_vs_conn *conn, struct tcphdr *tcph)
             if ((opcode == TCP_OPT_TIMESTAMP)
                     && (opsize == TCP_OLEN_TIMESTAMP)) 
             {       
-                conn->clienttsval=get_unaligned_be32(ptr);
+                if (!conn->ext && dp_vs_conn_ext_alloc(conn) != EDPVS_OK)
+                    return;
+                ext = conn->ext;
+                ext->clienttsval=get_unaligned_be32(ptr);
               
                 tmp = (uint32_t *) ptr;
                 *tmp++ = htonl((uint32_t)(TCP_OPT_TIMESTAMP(tsp_now)));
@@ -352,10 +364,10 @@ static void tcp_in_change_ts(struct dp_vs_conn *conn, struct tcphdr *tcph)
                 if(tcph->syn && ! tcph->ack)
                 {     
                      *tmp++ =0;
-                      conn->timestamp_all=0;
-                      conn->ack_count=0;
+                      ext->timestamp_all=0;
+                      ext->ack_count=0;
                 }
-                *tmp++ = htonl(conn->tscent); 
+                *tmp++ = htonl(ext->tscent); 
                 return;
             
 
@@ -373,6 +385,11 @@ static void tcp_in_get_ts(struct dp_vs_conn *conn, struct tcphdr *tcph)
     uint32_t *tmp;
     int len;
     uint32_t timenow;
+    struct dp_vs_conn_ext *ext = conn->ext;
+
+    if (!ext)
+        return;
+
     ptr = (unsigned char *)(tcph + 1);
     len = (tcph->doff << 2) - sizeof(struct tcphdr);
     while (len > 0) {
@@ -393,19 +410,27 @@ static void tcp_in_get_ts(struct dp_vs_conn *conn, struct tcphdr *tcph)
             if ((opcode == TCP_OPT_TIMESTAMP)
                     && (opsize == TCP_OLEN_TIMESTAMP)) 
             {       
-		    conn->tsval=get_unaligned_be32(ptr);
-            conn->tscent=conn->tsval;
-			conn->tsval_dpvs=get_unaligned_be32(ptr+4);       
+		    ext->tsval=get_unaligned_be32(ptr);
+            ext->tscent=ext->tsval;
+			ext->tsval_dpvs=get_unaligned_be32(ptr+4);       
             tmp = (uint32_t *) ptr;
-            *tmp++=htonl(conn->tsval);
-            *tmp++=htonl(conn->clienttsval);
+            *tmp++=htonl(ext->tsval);
+            *tmp++=htonl(ext->clienttsval);
             struct timespec tsp_now;
             clock_gettime(CLOCK_REALTIME, &tsp_now);
             timenow = (uint32_t)(TCP_OPT_TIMESTAMP(tsp_now));
-            conn->timestamp=timenow-conn->tsval_dpvs;
-            conn->timestamp_all=conn->timestamp_all+conn->timestamp;
-            conn->ack_count++;
-            conn->timestamp_avg=conn->timestamp_all/conn->ack_count;
+            if (timenow < ext->tsval_dpvs)
+                timenow += TCP_OPT_TIMESTAMP_WRAP;
+            ext->timestamp=timenow-ext->tsval_dpvs;
+            /* RS echoes the same value until it sees a newer one,
+             * only the first echo is a fresh sample */
+            if (ext->tsval_dpvs && ext->tsval_dpvs != ext->tsecr) {
+                ext->tsecr = ext->tsval_dpvs;
+                dp_vs_stats_rtt(conn, ext->timestamp);
+                ext->timestamp_all=ext->timestamp_all+ext->timestamp;
+                ext->ack_count++;
+                ext->timestamp_avg=ext->timestamp_all/ext->ack_count;
+            }
             
   
             /*int i;
@@ -710,6 +735,14 @@ static int tcp_conn_sched(struct dp_vs_proto *proto,
                 saddr, ntohs(th->source), daddr, ntohs(th->dest));
 #endif
 
+        svc = dp_vs_service_lookup(iph->af, iph->proto, &iph->daddr, th->dest,
+                                   0, NULL, NULL, NULL, rte_lcore_id());
+        if (svc) {
+            if (th->rst)
+                dp_vs_attack_inc(&svc->attack, DP_VS_ATTACK_RST);
+            dp_vs_attack_inc(&svc->attack, DP_VS_ATTACK_NO_CONN);
+        }
+
         /* Drop tcp packet which is send to vip and !vport */
         if (g_defence_tcp_drop &&
                 (svc = dp_vs_lookup_vip(iph->af, iph->proto, 
@@ -738,6 +771,19 @@ static int tcp_conn_sched(struct dp_vs_proto *proto,
         return EDPVS_NOSERV;
     }
 
+    if (!dp_vs_connlimit_rate_check(&svc->climit, iph->af, &iph->saddr)) {
+        *verdict = INET_DROP;
+        return EDPVS_OVERLOAD;
+    }
+
+    if (!dp_vs_connlimit_conn_check(&svc->climit, iph->af, &iph->saddr)) {
+        if (svc->climit.policy == DPVS_CONNLIMIT_RST)
+            dp_vs_synproxy_send_rst(iph->af, mbuf, iph, verdict);
+        else
+            *verdict = INET_DROP;
+        return EDPVS_OVERLOAD;
+    }
+
     *conn = dp_vs_schedule(svc, iph, mbuf, false, outwall);
     if (!*conn) {
         *verdict = INET_DROP;
@@ -760,14 +806,17 @@ tcp_conn_lookup(struct dp_vs_proto *proto, const struct dp_vs_iphdr *iph,
     if (unlikely(!th))
         return NULL;
 
-    if (dp_vs_blklst_lookup(iph->proto, &iph->daddr, th->dest, &iph->saddr)) {
+    conn = dp_vs_conn_get(iph->af, iph->proto,
+            &iph->saddr, &iph->daddr, th->source, th->dest, direct, reverse);
+
+    /* only new flows are checked against the blacklist */
+    if (!conn && dp_vs_blklst_deny(mbuf, iph->af, iph->proto, &iph->daddr,
+                                   th->dest, &iph->saddr, ((uint8_t *)th)[13])) {
+        dp_vs_attack_blklst(iph, th->dest);
         *drop = true;
         return NULL;
     }
 
-    conn = dp_vs_conn_get(iph->af, iph->proto,
-            &iph->saddr, &iph->daddr, th->source, th->dest, direct, reverse);
-
     /*
      * L2 confirm neighbour
      * pkt in from client confirm neighbour to client
@@ -981,6 +1030,8 @@ static int tcp_state_trans(struct dp_vs_proto *proto, struct dp_vs_conn *conn,
     th = mbuf_header_pointer(mbuf, iphdrlen, sizeof(_tcph), &_tcph);
     if (unlikely(!th))
         return EDPVS_INVPKT;
+    if (unlikely(th->rst) && dir == DPVS_CONN_DIR_INBOUND && dest->svc)
+        dp_vs_attack_inc(&dest->svc->attack, DP_VS_ATTACK_RST);
     if (dest->fwdmode == DPVS_FWD_MODE_DR || dest->fwdmode == DPVS_FWD_MODE_TUNNEL)
         off = 8;
     else if (dir == DPVS_CONN_DIR_INBOUND)
@@ -1019,6 +1070,14 @@ tcp_state_out:
             rte_atomic32_read(&conn->refcnt));
 #endif
 
+    /* handshakes completed without synproxy */
+    if (new_state == DPVS_TCP_S_ESTABLISHED &&
+            conn->state == DPVS_TCP_S_SYN_RECV &&
+            !(conn->flags & DPVS_CONN_F_SYNPROXY) && dest && dest->svc) {
+        dp_vs_attack_inc(&dest->svc->attack, DP_VS_ATTACK_ESTAB);
+        dp_vs_synproxy_auto_count(dest->svc, false);
+    }
+
     conn->old_state = conn->state; // old_state called when connection reused
     conn->state = new_state;
 
@@ -1037,19 +1096,19 @@ tcp_state_out:
                 && (new_state != DPVS_TCP_S_ESTABLISHED)) {
        
             
-            if (conn->timestamp_avg <= 2000)
+            if (dp_vs_conn_rtt_avg(conn) <= 2000)
                conn->inact=1;           
-            else if (conn->timestamp_avg <= 5000 && conn->timestamp_avg > 2000)
+            else if (dp_vs_conn_rtt_avg(conn) <= 5000 && dp_vs_conn_rtt_avg(conn) > 2000)
                conn->inact=2;
-            else if (conn->timestamp_avg <= 10000 && conn->timestamp_avg > 5000)
+            else if (dp_vs_conn_rtt_avg(conn) <= 10000 && dp_vs_conn_rtt_avg(conn) > 5000)
                conn->inact=3;
-            else if (conn->timestamp_avg <= 50000 && conn->timestamp_avg > 10000)
+            else if (dp_vs_conn_rtt_avg(conn) <= 50000 && dp_vs_conn_rtt_avg(conn) > 10000)
                conn->inact=4;
-            else if (conn->timestamp_avg <= 200000 && conn->timestamp_avg > 50000) 
+            else if (dp_vs_conn_rtt_avg(conn) <= 200000 && dp_vs_conn_rtt_avg(conn) > 50000) 
                conn->inact=5;
-             else if (conn->timestamp_avg <= 1000000 && conn->timestamp_avg > 200000) 
+             else if (dp_vs_conn_rtt_avg(conn) <= 1000000 && dp_vs_conn_rtt_avg(conn) > 200000) 
                conn->inact=6;
-             else if (conn->timestamp_avg <= 10000000 && conn->timestamp_avg > 1000000) 
+             else if (dp_vs_conn_rtt_avg(conn) <= 10000000 && dp_vs_conn_rtt_avg(conn) > 1000000) 
                conn->inact=7;
      
             dest->inact_timestamp_weight=dest->inact_timestamp_weight+conn->inact;
@@ -1065,19 +1124,19 @@ tcp_state_out:
          
             
                   
-            if (conn->timestamp_avg <= 2000)
+            if (dp_vs_conn_rtt_avg(conn) <= 2000)
                conn->act=1;           
-            else if (conn->timestamp_avg <= 5000 && conn->timestamp_avg > 2000)
+            else if (dp_vs_conn_rtt_avg(conn) <= 5000 && dp_vs_conn_rtt_avg(conn) > 2000)
                conn->act=2;
-            else if (conn->timestamp_avg <= 10000 && conn->timestamp_avg > 5000)
+            else if (dp_vs_conn_rtt_avg(conn) <= 10000 && dp_vs_conn_rtt_avg(conn) > 5000)
                conn->act=3;
-            else if (conn->timestamp_avg <= 50000 && conn->timestamp_avg > 10000)
+            else if (dp_vs_conn_rtt_avg(conn) <= 50000 && dp_vs_conn_rtt_avg(conn) > 10000)
                conn->act=4;
-            else if (conn->timestamp_avg <= 200000 && conn->timestamp_avg > 50000) 
+            else if (dp_vs_conn_rtt_avg(conn) <= 200000 && dp_vs_conn_rtt_avg(conn) > 50000) 
                conn->act=5;
-             else if (conn->timestamp_avg <= 1000000 && conn->timestamp_avg > 200000) 
+             else if (dp_vs_conn_rtt_avg(conn) <= 1000000 && dp_vs_conn_rtt_avg(conn) > 200000) 
                conn->act=6;
-             else if (conn->timestamp_avg <= 10000000 && conn->timestamp_avg > 1000000) 
+             else if (dp_vs_conn_rtt_avg(conn) <= 10000000 && dp_vs_conn_rtt_avg(conn) > 1000000) 
                conn->act=7;
 
 
@@ -29,6 +29,8 @@
 #include "ipvs/conn.h"
 #include "ipvs/service.h"
 #include "ipvs/blklst.h"
+#include "ipvs/connlimit.h"
+#include "ipvs/flood.h"
 #include "ipvs/redirect.h"
 #include "parser/parser.h"
 #include "uoa.h"
@@ -167,6 +169,18 @@ static int udp_conn_sched(struct dp_vs_proto *proto,
         return EDPVS_NOSERV;
     }
 
+    /* before anything is allocated for the flow */
+    if (!dp_vs_flood_check(DP_VS_FLOOD_UDP_NEW, iph->af, &iph->daddr)) {
+        *verdict = INET_DROP;
+        return EDPVS_OVERLOAD;
+    }
+
+    if (!dp_vs_connlimit_rate_check(&svc->climit, iph->af, &iph->saddr) ||
+            !dp_vs_connlimit_conn_check(&svc->climit, iph->af, &iph->saddr)) {
+        *verdict = INET_DROP;
+        return EDPVS_OVERLOAD;
+    }
+
     /* schedule RS and create new connection */
     *conn = dp_vs_schedule(svc, iph, mbuf, false, outwall);
     if (!*conn) {
@@ -206,17 +220,19 @@ udp_conn_lookup(struct dp_vs_proto *proto,
     if (unlikely(!uh))
         return NULL;
 
-    if (dp_vs_blklst_lookup(iph->proto, &iph->daddr, uh->dst_port,
-                            &iph->saddr)) {
-        *drop = true;
-        return NULL;
-    }
-
     conn = dp_vs_conn_get(iph->af, iph->proto,
                           &iph->saddr, &iph->daddr,
                           uh->src_port, uh->dst_port,
                           direct, reverse);
 
+    /* only new flows are checked against the blacklist */
+    if (!conn && dp_vs_blklst_deny(mbuf, iph->af, iph->proto, &iph->daddr,
+                                   uh->dst_port, &iph->saddr, 0)) {
+        dp_vs_attack_blklst(iph, uh->dst_port);
+        *drop = true;
+        return NULL;
+    }
+
     /*
      * L2 confirm neighbour
      * UDP has no ack, we don't know pkt from client is response or not
@@ -91,7 +91,7 @@ void dp_vs_redirect_free(struct dp_vs_conn *conn)
 #ifdef CONFIG_DPVS_IPVS_DEBUG
         dp_vs_redirect_show(conn->redirect, "free");
 #endif
-        rte_mempool_put(this_cr_cache, conn->redirect);
+        rte_mempool_put(conn->redirect->redirect_pool, conn->redirect);
         conn->redirect = NULL;
     }
 }
@@ -267,32 +267,55 @@ void dp_vs_redirect_ring_proc(struct netif_queue_conf *qconf, lcoreid_t cid)
     }
 }
 
+static int dp_vs_redirect_cache_create(void *arg)
+{
+    int socket = (int)(uintptr_t)arg;
+    char pool_name[32];
+
+    snprintf(pool_name, sizeof(pool_name), "dp_vs_redirect_%d", socket);
+
+    dp_vs_cr_cache[socket] =
+        rte_mempool_create(pool_name,
+                           dp_vs_conn_pool_size(),
+                           sizeof(struct dp_vs_redirect),
+                           dp_vs_conn_pool_cache_size(),
+                           0, NULL, NULL, NULL, NULL,
+                           socket, MEMPOOL_F_NO_PHYS_CONTIG);
+
+    return dp_vs_cr_cache[socket] ? EDPVS_OK : EDPVS_NOMEM;
+}
+
 /*
  * allocate redirect cache on each NUMA socket and its size is
- * same as conn_pool_size
+ * same as conn_pool_size. like conn pools, each socket's cache is
+ * populated by a local lcore and sockets are done in parallel.
  */
 static int dp_vs_redirect_cache_alloc(void)
 {
-    int i;
-    char pool_name[32];
+    int i, err = EDPVS_OK;
+    lcoreid_t cid[DPVS_MAX_SOCKET];
 
     for (i = 0; i < get_numa_nodes(); i++) {
-        snprintf(pool_name, sizeof(pool_name), "dp_vs_redirect_%d", i);
-
-        dp_vs_cr_cache[i] =
-            rte_mempool_create(pool_name,
-                               dp_vs_conn_pool_size(),
-                               sizeof(struct dp_vs_redirect),
-                               dp_vs_conn_pool_cache_size(),
-                               0, NULL, NULL, NULL, NULL,
-                               i, 0);
-
-        if (!dp_vs_cr_cache[i]) {
-            return EDPVS_NOMEM;
-        }
+        cid[i] = dp_vs_conn_pool_lcore(i);
+        if (cid[i] == RTE_MAX_LCORE || cid[i] == rte_get_master_lcore())
+            continue;
+        rte_eal_remote_launch(dp_vs_redirect_cache_create,
+                              (void *)(uintptr_t)i, cid[i]);
     }
 
-    return EDPVS_OK;
+    for (i = 0; i < get_numa_nodes(); i++) {
+        if (cid[i] == RTE_MAX_LCORE)
+            continue;
+        if (cid[i] == rte_get_master_lcore())
+            dp_vs_redirect_cache_create((void *)(uintptr_t)i);
+        else
+            rte_eal_wait_lcore(cid[i]);
+
+        if (!dp_vs_cr_cache[i])
+            err = EDPVS_NOMEM;
+    }
+
+    return err;
 }
 
 static void dp_vs_redirect_cache_free(void)
@@ -24,6 +24,9 @@
 #include "ipvs/wlc.h"
 #include "ipvs/conhash.h"
 #include "ipvs/fo.h"
+#include "ipvs/sed.h"
+#include "ipvs/nq.h"
+#include "ipvs/lbw.h"
 
 /*
  *  IPVS scheduler list
@@ -185,6 +188,9 @@ int dp_vs_sched_init(void)
     dp_vs_wlc_init();
     dp_vs_conhash_init();
     dp_vs_fo_init();
+    dp_vs_sed_init();
+    dp_vs_nq_init();
+    dp_vs_lbw_init();
 
     return EDPVS_OK;
 }
@@ -196,6 +202,9 @@ int dp_vs_sched_term(void)
     dp_vs_wlc_term();
     dp_vs_conhash_term();    
     dp_vs_fo_term();
+    dp_vs_sed_term();
+    dp_vs_nq_term();
+    dp_vs_lbw_term();
 
     return EDPVS_OK;
 }
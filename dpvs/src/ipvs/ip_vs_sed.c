@@ -0,0 +1,80 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * Shortest Expected Delay scheduling, as the kernel's ip_vs_sed.
+ *
+ * The expected delay of a new connection on a server is
+ *                (Ci + 1) / Ui
+ * Ci being the active connections and Ui the weight of the server.
+ * Unlike wlc inactive connections do not count.
+ */
+#include "ipvs/sed.h"
+
+static inline unsigned int dp_vs_sed_dest_overhead(struct dp_vs_dest *dest)
+{
+    return rte_atomic32_read(&dest->actconns) + 1;
+}
+
+static struct dp_vs_dest *dp_vs_sed_schedule(struct dp_vs_service *svc,
+                                             const struct rte_mbuf *mbuf)
+{
+    struct dp_vs_dest *dest, *least;
+    unsigned int loh, doh;
+
+    list_for_each_entry(dest, &svc->dests, n_list) {
+        if (dp_vs_dest_is_valid(dest)) {
+            least = dest;
+            loh = dp_vs_sed_dest_overhead(least);
+            goto nextstage;
+        }
+    }
+    return NULL;
+
+    /*
+     *    Find the destination with the least load.
+     */
+nextstage:
+    list_for_each_entry_continue(dest, &svc->dests, n_list) {
+        if (!dp_vs_dest_is_valid(dest))
+            continue;
+        doh = dp_vs_sed_dest_overhead(dest);
+        if ((uint64_t)loh * rte_atomic16_read(&dest->weight) >
+            (uint64_t)doh * rte_atomic16_read(&least->weight)) {
+            least = dest;
+            loh = doh;
+        }
+    }
+
+    return least;
+}
+
+static struct dp_vs_scheduler dp_vs_sed_scheduler = {
+    .name = "sed",
+    .n_list = LIST_HEAD_INIT(dp_vs_sed_scheduler.n_list),
+    .schedule = dp_vs_sed_schedule,
+};
+
+int dp_vs_sed_init(void)
+{
+    return register_dp_vs_scheduler(&dp_vs_sed_scheduler);
+}
+
+int dp_vs_sed_term(void)
+{
+    return unregister_dp_vs_scheduler(&dp_vs_sed_scheduler);
+}
@@ -29,6 +29,8 @@
 #include "ipvs/sched.h"
 #include "ipvs/laddr.h"
 #include "ipvs/blklst.h"
+#include "conf/svc_batch.h"
+#include "conf/rtt.h"
 #include "ctrl.h"
 #include "route.h"
 #include "route6.h"
@@ -452,6 +454,44 @@ struct dp_vs_service *dp_vs_lookup_vip(int af, uint16_t protocol,
     return NULL;
 }
 
+static bool dp_vs_svc_addr_used(const struct dp_vs_service *svc, int af,
+                                const union inet_addr *addr)
+{
+    struct dp_vs_dest *dest;
+
+    list_for_each_entry(dest, &svc->dests, n_list) {
+        if (dest->af == af && inet_addr_equal(af, &dest->addr, addr))
+            return true;
+    }
+
+    return dp_vs_laddr_exist(svc, af, addr);
+}
+
+bool dp_vs_service_addr_used(int af, const union inet_addr *addr,
+                             lcoreid_t cid)
+{
+    struct dp_vs_service *svc;
+    int idx;
+
+    for (idx = 0; idx < DP_VS_SVC_TAB_SIZE; idx++) {
+        list_for_each_entry(svc, &dp_vs_svc_table[cid][idx], s_list) {
+            if (dp_vs_svc_addr_used(svc, af, addr))
+                return true;
+        }
+        list_for_each_entry(svc, &dp_vs_svc_fwm_table[cid][idx], f_list) {
+            if (dp_vs_svc_addr_used(svc, af, addr))
+                return true;
+        }
+    }
+
+    list_for_each_entry(svc, &dp_vs_svc_match_list[cid], m_list) {
+        if (dp_vs_svc_addr_used(svc, af, addr))
+            return true;
+    }
+
+    return false;
+}
+
 void
 dp_vs_bind_svc(struct dp_vs_dest *dest, struct dp_vs_service *svc)
 {
@@ -513,7 +553,7 @@ static int dp_vs_add_service(struct dp_vs_service_conf *u,
     svc->addr = u->addr;
     svc->port = u->port;
     svc->fwmark = u->fwmark;
-    svc->flags = u->flags;
+    svc->flags = u->flags & ~DP_VS_SVC_F_SYNPROXY_ON;
     svc->timeout = u->timeout;
     svc->conn_timeout = u->conn_timeout;
     svc->bps = u->bps;
@@ -535,6 +575,7 @@ static int dp_vs_add_service(struct dp_vs_service_conf *u,
     svc->laddr_curr = &svc->laddr_list;
 
     INIT_LIST_HEAD(&svc->dests);
+    INIT_LIST_HEAD(&svc->est_list);
 
     ret = dp_vs_bind_scheduler(svc, sched);
     if (ret)
@@ -547,6 +588,7 @@ static int dp_vs_add_service(struct dp_vs_service_conf *u,
     if (ret != EDPVS_OK)
         return ret;
     rte_atomic32_set(&svc->refcnt, 1);
+    dp_vs_estimator_start(svc);
 
     *svc_p = svc;
     return EDPVS_OK;
@@ -585,7 +627,9 @@ static int dp_vs_edit_service(struct dp_vs_service *svc, struct dp_vs_service_co
     /*
      * Set the flags and timeout value
      */
-    svc->flags = u->flags | DP_VS_SVC_F_HASHED;
+    svc->flags = (u->flags & ~DP_VS_SVC_F_SYNPROXY_ON) | DP_VS_SVC_F_HASHED;
+    if (!(svc->flags & DP_VS_SVC_F_SYNPROXY_AUTO))
+        memset(&svc->sp_auto, 0, sizeof(svc->sp_auto));
     svc->timeout = u->timeout;
     svc->conn_timeout = u->conn_timeout;
     svc->netmask = u->netmask;
@@ -633,6 +677,8 @@ static void __dp_vs_del_service(struct dp_vs_service *svc)
     /* Count only IPv4 services for old get/setsockopt interface */
     rte_atomic16_dec(&dp_vs_num_services[rte_lcore_id()]);
 
+    dp_vs_estimator_stop(svc);
+
     /* Unbind scheduler */
     dp_vs_unbind_scheduler(svc);
 
@@ -687,6 +733,8 @@ dp_vs_copy_service(struct dp_vs_service_entry *dst, struct dp_vs_service *src)
     snprintf(dst->sched_name, sizeof(dst->sched_name),
              "%s", src->scheduler->name);
     dst->flags = src->flags;
+    if ((src->flags & DP_VS_SVC_F_SYNPROXY_AUTO) && src->sp_auto.active)
+        dst->flags |= DP_VS_SVC_F_SYNPROXY_ON;
     dst->timeout = src->timeout;
     dst->conn_timeout = src->conn_timeout;
     dst->netmask = src->netmask;
@@ -806,8 +854,12 @@ static int dp_vs_zero_service(struct dp_vs_service *svc)
 
     list_for_each_entry(dest, &svc->dests, n_list) {
         dp_vs_stats_clear(&dest->stats);
+        dp_vs_estimator_zero(&dest->est);
+        memset(&dest->rtt, 0, sizeof(dest->rtt));
     }
     dp_vs_stats_clear(&svc->stats);
+    memset(&svc->rtt, 0, sizeof(svc->rtt));
+    memset(&svc->attack, 0, sizeof(svc->attack));
     return EDPVS_OK;
 }
 
@@ -911,7 +963,9 @@ static int svc_msg_seq(void)
     return seq++;
 }
 
-static int dp_vs_set_svc(sockoptid_t opt, const void *user, size_t len)
+/* apply one set op to the tables of lcore cid */
+static int __dp_vs_set_svc(sockoptid_t opt, const void *user, size_t len,
+                           lcoreid_t cid)
 {
     int ret;
     unsigned char arg[MAX_ARG_LEN];
@@ -920,28 +974,6 @@ static int dp_vs_set_svc(sockoptid_t opt, const void *user, size_t len)
     struct dp_vs_service *svc = NULL;
     struct dp_vs_dest_user *udest_compat;
     struct dp_vs_dest_conf udest;
-    struct in_addr *vip;
-    lcoreid_t cid = rte_lcore_id();
-
-    if (opt == DPVS_SO_SET_GRATARP && cid == rte_get_master_lcore()){
-        vip = (struct in_addr *)user;
-        return gratuitous_arp_send_vip(vip);
-    }
- 
-    // send to slave core
-    if (cid == rte_get_master_lcore()) {
-        struct dpvs_msg *msg;
-
-        msg = msg_make(set_opt_so2msg(opt), svc_msg_seq(), DPVS_MSG_MULTICAST, cid, len, user);
-        if (!msg)
-            return EDPVS_NOMEM;
-
-        ret = multicast_msg_send(msg, DPVS_MSG_F_ASYNC, NULL);
-        /* go on in master core, not return */
-        if (ret != EDPVS_OK)
-            RTE_LOG(ERR, SERVICE, "[%s] fail to send multicast message\n", __func__);
-        msg_destroy(&msg);
-    }
 
     if (opt == DPVS_SO_SET_FLUSH)
         return dp_vs_flush(cid);
@@ -982,8 +1014,10 @@ static int dp_vs_set_svc(sockoptid_t opt, const void *user, size_t len)
         return EDPVS_INVAL;
     }
 
-    if(opt != DPVS_SO_SET_ADD &&
-            (svc == NULL || svc->proto != usvc.protocol)){
+    if (opt != DPVS_SO_SET_ADD && svc == NULL)
+        return EDPVS_NOTEXIST;
+
+    if(opt != DPVS_SO_SET_ADD && svc->proto != usvc.protocol){
         return EDPVS_INVAL;
     }
 
@@ -1022,6 +1056,126 @@ static int dp_vs_set_svc(sockoptid_t opt, const void *user, size_t len)
     return ret;
 }
 
+static int dp_vs_svc_batch_apply(const struct dp_vs_svc_batch *batch,
+                                 const struct dp_vs_svc_batch_op *op,
+                                 lcoreid_t cid)
+{
+    int ret;
+
+    ret = __dp_vs_set_svc(op->opt, op->arg, op->len, cid);
+    if (ret == EDPVS_OK || !(batch->flags & DP_VS_SVC_BATCH_F_IDEMPOTENT))
+        return ret;
+
+    switch (op->opt) {
+        case DPVS_SO_SET_ADD:
+        case DPVS_SO_SET_ADDDEST:
+            if (ret == EDPVS_EXIST || ret == EDPVS_MSG_FAIL)
+                ret = EDPVS_OK;
+            break;
+        case DPVS_SO_SET_DEL:
+        case DPVS_SO_SET_DELDEST:
+            /* NOTEXIST of DELDEST may be the service or the dest */
+            if (ret == EDPVS_NOTEXIST || ret == EDPVS_MSG_FAIL)
+                ret = EDPVS_OK;
+            break;
+        case DPVS_SO_SET_EDITDEST:
+            if (ret == EDPVS_NOTEXIST || ret == EDPVS_MSG_FAIL)
+                ret = __dp_vs_set_svc(DPVS_SO_SET_ADDDEST, op->arg, op->len, cid);
+            break;
+        default:
+            break;
+    }
+
+    return ret;
+}
+
+/*
+ * master applies the batch first and stops at the first failed op, then
+ * the ops it applied go to slaves in one msg, so all lcores stay identical
+ * and packets never see a half applied batch.
+ */
+static int dp_vs_set_svc_batch(const void *user, size_t len)
+{
+    const struct dp_vs_svc_batch *batch = user;
+    struct dp_vs_svc_batch *applied;
+    struct dpvs_msg *msg;
+    lcoreid_t cid = rte_lcore_id();
+    uint32_t i;
+    int ret = EDPVS_OK, err;
+
+    if (!batch || len < sizeof(*batch) || batch->nops > DP_VS_SVC_BATCH_MAX ||
+            len != sizeof(*batch) + batch->nops * sizeof(struct dp_vs_svc_batch_op))
+        return EDPVS_INVAL;
+
+    for (i = 0; i < batch->nops; i++) {
+        if (batch->ops[i].opt < DPVS_SO_SET_FLUSH ||
+                batch->ops[i].opt > DPVS_SO_SET_DELDEST ||
+                batch->ops[i].len > MAX_ARG_LEN)
+            return EDPVS_INVAL;
+    }
+
+    for (i = 0; i < batch->nops; i++) {
+        ret = dp_vs_svc_batch_apply(batch, &batch->ops[i], cid);
+        if (ret != EDPVS_OK) {
+            RTE_LOG(WARNING, SERVICE, "%s: op %u/%u (opt %u) failed -- %s\n",
+                    __func__, i, batch->nops, batch->ops[i].opt, dpvs_strerror(ret));
+            break;
+        }
+    }
+
+    if (i == 0)
+        return ret;
+
+    msg = msg_make(MSG_TYPE_SVC_SET_BATCH, svc_msg_seq(), DPVS_MSG_MULTICAST, cid,
+                   sizeof(*batch) + i * sizeof(struct dp_vs_svc_batch_op), batch);
+    if (!msg)
+        return EDPVS_NOMEM;
+    applied = (struct dp_vs_svc_batch *)msg->data;
+    applied->nops = i;
+
+    err = multicast_msg_send(msg, DPVS_MSG_F_ASYNC, NULL);
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, SERVICE, "[%s] fail to send multicast message\n", __func__);
+        if (ret == EDPVS_OK)
+            ret = err;
+    }
+    msg_destroy(&msg);
+
+    return ret;
+}
+
+static int dp_vs_set_svc(sockoptid_t opt, const void *user, size_t len)
+{
+    int ret;
+    struct in_addr *vip;
+    lcoreid_t cid = rte_lcore_id();
+
+    if (opt == DPVS_SO_SET_GRATARP && cid == rte_get_master_lcore()){
+        vip = (struct in_addr *)user;
+        return gratuitous_arp_send_vip(vip);
+    }
+
+    if (opt == DPVS_SO_SET_BATCH)
+        return dp_vs_set_svc_batch(user, len);
+ 
+    // send to slave core
+    if (cid == rte_get_master_lcore()) {
+        struct dpvs_msg *msg;
+
+        msg = msg_make(set_opt_so2msg(opt), svc_msg_seq(), DPVS_MSG_MULTICAST, cid, len, user);
+        if (!msg)
+            return EDPVS_NOMEM;
+
+        ret = multicast_msg_send(msg, DPVS_MSG_F_ASYNC, NULL);
+        /* go on in master core, not return */
+        if (ret != EDPVS_OK)
+            RTE_LOG(ERR, SERVICE, "[%s] fail to send multicast message\n", __func__);
+        msg_destroy(&msg);
+    }
+
+    return __dp_vs_set_svc(opt, user, len, cid);
+}
+
 /*
  * for example : SOCKOPT_SVC_BASE is 200, SOCKOPT_SVC_GET_CMD_MAX is 204, 
  * old_opt 205 means core 1 get opt 200 
@@ -1096,7 +1250,7 @@ static int dp_vs_get_services_uc_cb(struct dpvs_msg *msg)
     return EDPVS_OK;
 }
 
-static struct dp_vs_service *
+struct dp_vs_service *
 dp_vs_get_service_lcore(const struct dp_vs_service_entry *entry,
                                               lcoreid_t cid)
 {
@@ -1198,6 +1352,154 @@ static int dp_vs_get_dests_uc_cb(struct dpvs_msg *msg)
     return EDPVS_OK;
 }
 
+static struct dp_vs_service *
+dp_vs_get_rtt_service(const struct dp_vs_get_rtt *get, lcoreid_t cid)
+{
+    struct dp_vs_service_entry entry;
+
+    memset(&entry, 0, sizeof(entry));
+    entry.af      = get->af;
+    entry.proto   = get->proto;
+    entry.addr    = get->addr;
+    entry.port    = get->port;
+    entry.fwmark  = get->fwmark;
+    rte_memcpy(entry.srange, get->srange, sizeof(get->srange));
+    rte_memcpy(entry.drange, get->drange, sizeof(get->drange));
+    rte_memcpy(entry.iifname, get->iifname, sizeof(get->iifname));
+    rte_memcpy(entry.oifname, get->oifname, sizeof(get->oifname));
+
+    return dp_vs_get_service_lcore(&entry, cid);
+}
+
+static int dp_vs_get_rtt_uc_cb(struct dpvs_msg *msg)
+{
+    lcoreid_t cid = rte_lcore_id();
+    struct dp_vs_get_rtt *get, *output;
+    struct dp_vs_service *svc;
+    struct dp_vs_dest *dest;
+    unsigned int i = 0;
+    size_t size;
+
+    get = (struct dp_vs_get_rtt *)msg->data;
+    svc = dp_vs_get_rtt_service(get, cid);
+    if (!svc)
+        return EDPVS_NOTEXIST;
+    if (svc->num_dests != get->num_dests) {
+        RTE_LOG(ERR, SERVICE, "%s: dests number not match in cid=%d.\n", __func__, cid);
+        return EDPVS_INVAL;
+    }
+
+    size = sizeof(*get) + sizeof(struct dp_vs_rtt_entry) * svc->num_dests;
+    output = msg_reply_alloc(size);
+    if (output == NULL)
+        return EDPVS_NOMEM;
+
+    rte_memcpy(output, get, sizeof(*get));
+    output->cid = cid;
+    rte_memcpy(&output->svc, &svc->rtt, sizeof(svc->rtt));
+    list_for_each_entry(dest, &svc->dests, n_list) {
+        if (i >= svc->num_dests)
+            break;
+        output->entrytable[i].af   = dest->af;
+        output->entrytable[i].addr = dest->addr;
+        output->entrytable[i].port = dest->port;
+        rte_memcpy(&output->entrytable[i].rtt, &dest->rtt, sizeof(dest->rtt));
+        i++;
+    }
+
+    msg->reply.len = size;
+    msg->reply.data = (void *)output;
+    return EDPVS_OK;
+}
+
+/* lcores keep dests in the same order, as DPVS_SO_GET_DESTS relies on */
+static int dp_vs_merge_rtt(struct dp_vs_get_rtt *dst,
+                           const struct dp_vs_get_rtt *src)
+{
+    unsigned int i;
+
+    if (dst->num_dests != src->num_dests)
+        return EDPVS_INVAL;
+
+    dp_vs_rtt_add(&dst->svc, &src->svc);
+    for (i = 0; i < dst->num_dests; i++) {
+        if (dst->entrytable[i].port != src->entrytable[i].port ||
+                !inet_addr_equal(src->entrytable[i].af,
+                                 &dst->entrytable[i].addr,
+                                 &src->entrytable[i].addr))
+            return EDPVS_INVAL;
+        dp_vs_rtt_add(&dst->entrytable[i].rtt, &src->entrytable[i].rtt);
+    }
+
+    return EDPVS_OK;
+}
+
+static int dp_vs_get_svc_rtt(sockoptid_t opt, const void *user, size_t len,
+                             void **out, size_t *outlen)
+{
+    const struct dp_vs_get_rtt *get = user;
+    struct dp_vs_get_rtt *get_msg, *output = NULL;
+    struct dpvs_msg *msg, *cur;
+    struct dpvs_multicast_queue *reply = NULL;
+    lcoreid_t cid;
+    size_t size;
+    int ret;
+
+    if (!user || len != sizeof(*get) || !out || !outlen)
+        return EDPVS_INVAL;
+    if (get->cid >= DPVS_MAX_LCORE)
+        return EDPVS_INVAL;
+    cid = g_lcore_index[get->cid];
+
+    msg = msg_make(MSG_TYPE_SVC_GET_RTT, 0, DPVS_MSG_MULTICAST, rte_lcore_id(),
+                   sizeof(*get), get);
+    if (!msg)
+        return EDPVS_NOMEM;
+
+    ret = multicast_msg_send(msg, 0, &reply);
+    if (ret != EDPVS_OK) {
+        msg_destroy(&msg);
+        RTE_LOG(ERR, SERVICE, "%s: send message fail.\n", __func__);
+        return ret == EDPVS_MSG_FAIL ? EDPVS_NOTEXIST : ret;
+    }
+
+    size = sizeof(*get) + sizeof(struct dp_vs_rtt_entry) * get->num_dests;
+    list_for_each_entry(cur, &reply->mq, mq_node) {
+        get_msg = (struct dp_vs_get_rtt *)cur->data;
+        /* master forwards nothing, a single lcore or all slaves */
+        if (cid != rte_get_master_lcore() && get_msg->cid != cid)
+            continue;
+
+        if (!output) {
+            output = rte_zmalloc("get_rtt", size, 0);
+            if (!output) {
+                msg_destroy(&msg);
+                return EDPVS_NOMEM;
+            }
+            rte_memcpy(output, get_msg, size);
+            continue;
+        }
+
+        ret = dp_vs_merge_rtt(output, get_msg);
+        if (ret != EDPVS_OK) {
+            RTE_LOG(ERR, SERVICE, "%s: dests not match in cid=%d.\n",
+                    __func__, get_msg->cid);
+            msg_destroy(&msg);
+            rte_free(output);
+            return ret;
+        }
+    }
+    msg_destroy(&msg);
+
+    if (!output)
+        return EDPVS_NOTEXIST;
+
+    output->cid = get->cid;
+    *out = output;
+    *outlen = size;
+    return EDPVS_OK;
+}
+
 static int dp_vs_get_svc(sockoptid_t opt, const void *user, size_t len, void **out, size_t *outlen)
 {
     int ret = 0;
@@ -1502,6 +1804,16 @@ struct dpvs_sockopts sockopts_svc = {
     .get            = dp_vs_get_svc,
 };
 
+static struct dpvs_sockopts sockopts_svc_rtt = {
+    .version        = SOCKOPT_VERSION,
+    .set_opt_min    = 0,
+    .set_opt_max    = 0,
+    .set            = NULL,
+    .get_opt_min    = SOCKOPT_GET_SVC_RTT,
+    .get_opt_max    = SOCKOPT_GET_SVC_RTT,
+    .get            = dp_vs_get_svc_rtt,
+};
+
 static int flush_msg_cb(struct dpvs_msg *msg)
 {
     
@@ -1543,6 +1855,28 @@ static int deldest_msg_cb(struct dpvs_msg *msg)
     return dp_vs_set_svc(DPVS_SO_SET_DELDEST, msg->data, msg->len);
 }
 
+static int batch_msg_cb(struct dpvs_msg *msg)
+{
+    const struct dp_vs_svc_batch *batch = (struct dp_vs_svc_batch *)msg->data;
+    lcoreid_t cid = rte_lcore_id();
+    uint32_t i;
+    int ret, err = EDPVS_OK;
+
+    /* master has applied these ops, a failure here means lcores diverge */
+    for (i = 0; i < batch->nops; i++) {
+        ret = dp_vs_svc_batch_apply(batch, &batch->ops[i], cid);
+        if (ret != EDPVS_OK) {
+            RTE_LOG(ERR, SERVICE, "%s: lcore%d op %u/%u (opt %u) failed -- %s\n",
+                    __func__, cid, i, batch->nops, batch->ops[i].opt,
+                    dpvs_strerror(ret));
+            if (err == EDPVS_OK)
+                err = ret;
+        }
+    }
+
+    return err;
+}
+
 int dp_vs_service_init(void)
 {
     int idx, cid, err;
@@ -1655,6 +1989,18 @@ int dp_vs_service_init(void)
          return err;
     }
 
+    memset(&msg_type, 0, sizeof(struct dpvs_msg_type));
+    msg_type.type   = MSG_TYPE_SVC_SET_BATCH;
+    msg_type.mode   = DPVS_MSG_MULTICAST;
+    msg_type.prio   = MSG_PRIO_NORM;
+    msg_type.cid    = rte_lcore_id();
+    msg_type.unicast_msg_cb = batch_msg_cb;
+    err = msg_type_mc_register(&msg_type);
+    if (err != EDPVS_OK) {
+         RTE_LOG(ERR, SERVICE, "%s: fail to register msg.\n", __func__);
+         return err;
+    }
+
     memset(&msg_type, 0, sizeof(struct dpvs_msg_type));
     msg_type.type   = MSG_TYPE_SVC_GET_SERVICES;
     msg_type.mode   = DPVS_MSG_MULTICAST;
@@ -1691,6 +2037,24 @@ int dp_vs_service_init(void)
          return err;
     }
 
+    memset(&msg_type, 0, sizeof(struct dpvs_msg_type));
+    msg_type.type   = MSG_TYPE_SVC_GET_RTT;
+    msg_type.mode   = DPVS_MSG_MULTICAST;
+    msg_type.prio   = MSG_PRIO_LOW;
+    msg_type.cid    = rte_lcore_id();
+    msg_type.unicast_msg_cb = dp_vs_get_rtt_uc_cb;
+    err = msg_type_mc_register(&msg_type);
+    if (err != EDPVS_OK) {
+         RTE_LOG(ERR, SERVICE, "%s: fail to register msg.\n", __func__);
+         return err;
+    }
+
+    err = sockopt_register(&sockopts_svc_rtt);
+    if (err != EDPVS_OK) {
+         RTE_LOG(ERR, SERVICE, "%s: fail to register rtt sockopt.\n", __func__);
+         return err;
+    }
+
     return EDPVS_OK;
 }
 
@@ -1700,6 +2064,7 @@ int dp_vs_service_term(void)
     for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
         dp_vs_flush(cid);
     }
+    sockopt_unregister(&sockopts_svc_rtt);
     dp_vs_dest_term();
     return EDPVS_OK;
 }
@@ -20,16 +20,40 @@
 #include "netif.h"
 #include "list.h"
 #include "ctrl.h"
+#include "global_data.h"
+#include "scheduler.h"
 #include "ipvs/conn.h"
 #include "ipvs/dest.h"
 #include "ipvs/service.h"
 #include "ipvs/stats.h"
 
-#define this_dpvs_stats             (dpvs_stats[rte_lcore_id()])
+#define this_dpvs_stats             (dpvs_stats[rte_lcore_id()].stats)
 #define this_dpvs_estats            (dpvs_estats[rte_lcore_id()])
 
-static struct dp_vs_stats dpvs_stats[DPVS_MAX_LCORE];
-static struct dp_vs_estats dpvs_estats[DPVS_MAX_LCORE];
+/*
+ * every counter here has a single writer: the global ones are per lcore
+ * and padded to cache lines, svc/dest are per-lcore copies and conns are
+ * owned by one lcore. readers sum them up via msg, so no atomics.
+ */
+struct dp_vs_lcore_stats {
+    struct dp_vs_stats  stats;
+} __rte_cache_aligned;
+
+static struct dp_vs_lcore_stats dpvs_stats[DPVS_MAX_LCORE];
+static struct dp_vs_estats dpvs_estats[DPVS_MAX_LCORE] __rte_cache_aligned;
+
+/* services on each lcore whose dests' rates are estimated */
+struct dp_vs_est_lcore {
+    struct list_head    svcs;
+    uint64_t            last;       /* cycles of the last estimation */
+} __rte_cache_aligned;
+
+static struct dp_vs_est_lcore dp_vs_est[DPVS_MAX_LCORE];
+
+/* only checks the clock, estimation itself runs every DP_VS_EST_INTERVAL */
+#define DP_VS_EST_SKIP_LOOPS        10000
+
+static struct dpvs_lcore_job dp_vs_est_job;
 
 void dp_vs_stats_clear(struct dp_vs_stats *stats)
 {
@@ -38,6 +62,12 @@ void dp_vs_stats_clear(struct dp_vs_stats *stats)
     stats->inbytes  = 0;
     stats->outpkts  = 0;
     stats->outbytes = 0;
+
+    stats->cps      = 0;
+    stats->inpps    = 0;
+    stats->inbps    = 0;
+    stats->outpps   = 0;
+    stats->outbps   = 0;
 }
 
 int dp_vs_add_stats(struct dp_vs_stats* dst, struct dp_vs_stats* src)
@@ -47,6 +77,12 @@ int dp_vs_add_stats(struct dp_vs_stats* dst, struct dp_vs_stats* src)
     dst->inbytes  += src->inbytes;
     dst->outbytes += src->outbytes;
     dst->outpkts  += src->outpkts;
+
+    dst->cps      += src->cps;
+    dst->inpps    += src->inpps;
+    dst->inbps    += src->inbps;
+    dst->outpps   += src->outpps;
+    dst->outbps   += src->outbps;
     return EDPVS_OK;
 }
 
@@ -59,7 +95,7 @@ int dp_vs_stats_in(struct dp_vs_conn *conn, struct rte_mbuf *mbuf)
         /*limit rate*/
         if ((dest->limit_proportion < 100) &&
             (dest->limit_proportion > 0)) {
-            return (rand()%100) > dest->limit_proportion
+            return dpvs_rand_range(100) > dest->limit_proportion
                         ? EDPVS_OVERLOAD : EDPVS_OK;
         }
 
@@ -68,8 +104,8 @@ int dp_vs_stats_in(struct dp_vs_conn *conn, struct rte_mbuf *mbuf)
     }
 
 #ifdef CONFIG_DPVS_IPVS_STATS_DEBUG
-    rte_atomic64_inc(&conn->stats.inpkts);
-    rte_atomic64_add(&conn->stats.inbytes, mbuf->pkt_len);
+    conn->stats.inpkts++;
+    conn->stats.inbytes += mbuf->pkt_len;
 #endif
 
     this_dpvs_stats.inpkts++;
@@ -86,7 +122,7 @@ int dp_vs_stats_out(struct dp_vs_conn *conn, struct rte_mbuf *mbuf)
         /*limit rate*/
         if ((dest->limit_proportion < 100) &&
             (dest->limit_proportion > 0)) {
-            return (rand()%100) > dest->limit_proportion
+            return dpvs_rand_range(100) > dest->limit_proportion
             ? EDPVS_OVERLOAD : EDPVS_OK;
         }
 
@@ -95,8 +131,8 @@ int dp_vs_stats_out(struct dp_vs_conn *conn, struct rte_mbuf *mbuf)
     }
 
 #ifdef CONFIG_DPVS_IPVS_STATS_DEBUG
-    rte_atomic64_inc(&conn->stats.outpkts);
-    rte_atomic64_add(&conn->stats.outbytes, mbuf->pkt_len);
+    conn->stats.outpkts++;
+    conn->stats.outbytes += mbuf->pkt_len;
 #endif
 
     this_dpvs_stats.outpkts++;
@@ -112,6 +148,113 @@ void dp_vs_stats_conn(struct dp_vs_conn *conn)
     this_dpvs_stats.conns++;
 }
 
+static inline void dp_vs_rtt_record(struct dp_vs_rtt_hist *hist, uint32_t rtt_us)
+{
+    hist->count++;
+    hist->sum_us += rtt_us;
+    if (rtt_us > hist->max_us)
+        hist->max_us = rtt_us;
+    hist->buckets[dp_vs_rtt_bucket(rtt_us)]++;
+}
+
+/* conn, its dest and svc all belong to this lcore, no atomics needed */
+void dp_vs_stats_rtt(struct dp_vs_conn *conn, uint32_t rtt_us)
+{
+    struct dp_vs_dest *dest = conn->dest;
+
+    if (!dest)
+        return;
+
+    dp_vs_rtt_record(&dest->rtt, rtt_us);
+    if (dest->svc)
+        dp_vs_rtt_record(&dest->svc->rtt, rtt_us);
+}
+
+void dp_vs_rtt_add(struct dp_vs_rtt_hist *dst, const struct dp_vs_rtt_hist *src)
+{
+    int i;
+
+    dst->count  += src->count;
+    dst->sum_us += src->sum_us;
+    if (src->max_us > dst->max_us)
+        dst->max_us = src->max_us;
+    for (i = 0; i < DP_VS_RTT_BUCKETS; i++)
+        dst->buckets[i] += src->buckets[i];
+}
+
+void dp_vs_estimator_start(struct dp_vs_service *svc)
+{
+    list_add_tail(&svc->est_list, &dp_vs_est[rte_lcore_id()].svcs);
+}
+
+void dp_vs_estimator_stop(struct dp_vs_service *svc)
+{
+    list_del_init(&svc->est_list);
+}
+
+/* counters are zeroed too, the next estimation starts from scratch */
+void dp_vs_estimator_zero(struct dp_vs_estimator *est)
+{
+    memset(est, 0, sizeof(*est));
+}
+
+/* avg += (rate - avg) / 4, the kernel's weight for a 2s interval */
+static inline uint32_t dp_vs_ewma(double *avg, uint64_t *last, uint64_t cur,
+                                  double secs)
+{
+    /* counters zeroed behind us */
+    if (unlikely(cur < *last))
+        *last = cur;
+
+    *avg += ((cur - *last) / secs - *avg) / 4;
+    *last = cur;
+
+    return *avg > UINT32_MAX ? UINT32_MAX : (uint32_t)(*avg + 0.5);
+}
+
+void dp_vs_estimate(struct dp_vs_dest *dest, double secs)
+{
+    struct dp_vs_estimator *est = &dest->est;
+    struct dp_vs_stats *stats = &dest->stats;
+
+    stats->cps    = dp_vs_ewma(&est->cps, &est->last_conns, stats->conns, secs);
+    stats->inpps  = dp_vs_ewma(&est->inpps, &est->last_inpkts, stats->inpkts, secs);
+    stats->outpps = dp_vs_ewma(&est->outpps, &est->last_outpkts, stats->outpkts, secs);
+    stats->inbps  = dp_vs_ewma(&est->inbps, &est->last_inbytes, stats->inbytes, secs);
+    stats->outbps = dp_vs_ewma(&est->outbps, &est->last_outbytes, stats->outbytes, secs);
+}
+
+static void dp_vs_est_job_func(void *arg)
+{
+    struct dp_vs_est_lcore *el = &dp_vs_est[rte_lcore_id()];
+    struct dp_vs_service *svc;
+    struct dp_vs_dest *dest;
+    uint64_t now = rte_get_timer_cycles();
+    double secs;
+
+    if (now - el->last < DP_VS_EST_INTERVAL * g_cycles_per_sec)
+        return;
+    secs = (double)(now - el->last) / g_cycles_per_sec;
+    el->last = now;
+
+    list_for_each_entry(svc, &el->svcs, est_list) {
+        svc->stats.cps    = 0;
+        svc->stats.inpps  = 0;
+        svc->stats.outpps = 0;
+        svc->stats.inbps  = 0;
+        svc->stats.outbps = 0;
+
+        list_for_each_entry(dest, &svc->dests, n_list) {
+            dp_vs_estimate(dest, secs);
+            svc->stats.cps    += dest->stats.cps;
+            svc->stats.inpps  += dest->stats.inpps;
+            svc->stats.outpps += dest->stats.outpps;
+            svc->stats.inbps  += dest->stats.inbps;
+            svc->stats.outbps += dest->stats.outbps;
+        }
+    }
+}
+
 void dp_vs_estats_inc(enum dp_vs_estats_type field)
 {
     this_dpvs_estats.mibs[field]++;
@@ -129,12 +272,31 @@ uint64_t dp_vs_estats_get(enum dp_vs_estats_type field)
 
 int dp_vs_stats_init(void)
 {
+    lcoreid_t cid;
+    int err;
+
     dp_vs_estats_clear();
-    srand(rte_rdtsc());
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        INIT_LIST_HEAD(&dp_vs_est[cid].svcs);
+        dp_vs_est[cid].last = rte_get_timer_cycles();
+    }
+
+    snprintf(dp_vs_est_job.name, sizeof(dp_vs_est_job.name), "%s", "ipvs_est");
+    dp_vs_est_job.func = dp_vs_est_job_func;
+    dp_vs_est_job.data = NULL;
+    dp_vs_est_job.type = LCORE_JOB_SLOW;
+    dp_vs_est_job.skip_loops = DP_VS_EST_SKIP_LOOPS;
+    err = dpvs_lcore_job_register(&dp_vs_est_job, LCORE_ROLE_FWD_WORKER);
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "%s: fail to register estimator job\n", __func__);
+        return err;
+    }
+
     return EDPVS_OK;
 }
 
 int dp_vs_stats_term(void)
 {
-    return EDPVS_OK;
+    return dpvs_lcore_job_unregister(&dp_vs_est_job, LCORE_ROLE_FWD_WORKER);
 }
@@ -0,0 +1,928 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * connection state synchronization, see ipvs/sync.h.
+ */
+#include <unistd.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "conf/common.h"
+#include "dpdk.h"
+#include "ctrl.h"
+#include "netif.h"
+#include "scheduler.h"
+#include "global_data.h"
+#include "parser/parser.h"
+#include "ipvs/conn.h"
+#include "ipvs/dest.h"
+#include "ipvs/sync.h"
+
+#define SYNC_MCAST_GROUP_DEF        "224.0.0.81"
+#define SYNC_PORT_DEF               8848
+
+#define SYNC_RATE_DEF               100000  /* records per second per lcore */
+#define SYNC_RATE_MIN               100
+#define SYNC_RATE_MAX               10000000
+
+#define SYNC_RING_SIZE_DEF          4096
+#define SYNC_RING_SIZE_MIN          256
+#define SYNC_RING_SIZE_MAX          1048576
+
+#define SYNC_MAXLEN_DEF             1472    /* UDP payload for 1500 MTU */
+#define SYNC_MAXLEN_MIN             256
+#define SYNC_MAXLEN_MAX             65000
+
+#define SYNC_RESYNC_DEF             30      /* seconds, 0 to disable */
+#define SYNC_RESYNC_MAX             3600
+#define SYNC_RESYNC_LOOPS           1000    /* lcore loops between runs */
+
+#define SYNC_BURST                  32
+#define SYNC_RX_DGRAMS              64      /* datagrams per master loop */
+#define SYNC_EXPIRE_DELAY           1       /* seconds */
+
+#define SYNC_MASTER                 0
+#define SYNC_BACKUP                 1
+
+struct sync_daemon {
+    int                 state;      /* DP_VS_SYNC_S_XXX, 0 if not running */
+    char                ifname[IFNAMSIZ];
+    int                 syncid;
+    int                 sockfd;
+    uint64_t            dgrams;
+    uint64_t            records;
+    uint64_t            errors;
+};
+
+/* all counters are written by the owner lcore only */
+struct sync_lcore {
+    struct rte_ring     *tx_ring;   /* worker -> master */
+    struct rte_ring     *rx_ring;   /* master -> worker */
+    uint64_t            tokens;
+    uint64_t            last;       /* cycles of last refill */
+    uint32_t            resync_cursor;
+    uint64_t            resync_last;    /* cycles of last resync run */
+    uint64_t            tx_limited;
+    uint64_t            tx_dropped;
+    uint64_t            rx_installed;
+    uint64_t            rx_updated;
+    uint64_t            rx_refused;
+} __rte_cache_aligned;
+
+volatile int dp_vs_sync_state = DP_VS_SYNC_S_NONE;
+
+static struct in_addr sync_mcast_group;
+static struct in_addr sync_peer;
+static uint16_t sync_port = SYNC_PORT_DEF;
+static int sync_rate = SYNC_RATE_DEF;
+static int sync_ring_size = SYNC_RING_SIZE_DEF;
+static int sync_maxlen = SYNC_MAXLEN_DEF;
+static int sync_resync_interval = SYNC_RESYNC_DEF;
+
+static struct sync_daemon sync_daemons[2];
+static struct sync_lcore sync_lcores[DPVS_MAX_LCORE];
+static struct rte_mempool *sync_pools[DPVS_MAX_SOCKET];
+
+/* master lcore only */
+static char sync_txbuf[SYNC_MAXLEN_MAX];
+static char sync_rxbuf[SYNC_MAXLEN_MAX];
+static uint16_t sync_txlen;
+
+static inline bool sync_lcore_enabled(lcoreid_t cid)
+{
+    return g_lcore_role[cid] == LCORE_ROLE_FWD_WORKER;
+}
+
+/////////////////////////////// workers ///////////////////////////////////////
+
+static inline bool sync_rate_limit(struct sync_lcore *sl)
+{
+    uint64_t now, add;
+
+    if (likely(sl->tokens > 0)) {
+        sl->tokens--;
+        return false;
+    }
+
+    now = rte_get_timer_cycles();
+    add = (now - sl->last) * sync_rate / g_cycles_per_sec;
+    if (!add)
+        return true;
+
+    sl->tokens = RTE_MIN(add, (uint64_t)sync_ring_size) - 1;
+    sl->last = now;
+    return false;
+}
+
+void __dp_vs_sync_conn(struct dp_vs_conn *conn, int type)
+{
+    struct sync_lcore *sl = &sync_lcores[rte_lcore_id()];
+    struct dp_vs_sync_rec *rec;
+
+    /* templates are rebuilt by traffic, SNAT conns are matched by mbuf */
+    if (dp_vs_conn_is_template(conn) || !conn->dest ||
+        conn->dest->fwdmode == DPVS_FWD_MODE_SNAT ||
+        (conn->proto != IPPROTO_TCP && conn->proto != IPPROTO_UDP))
+        return;
+
+    /* synproxy handshake in flight holds mbufs, sync it once done */
+    if (conn->ext && (conn->ext->ack_num || conn->ext->syn_mbuf))
+        return;
+
+    if (unlikely(!sl->tx_ring))
+        return;
+
+    if (sync_rate_limit(sl)) {
+        sl->tx_limited++;
+        return;
+    }
+
+    if (unlikely(rte_mempool_get(sync_pools[rte_socket_id()], (void **)&rec))) {
+        sl->tx_dropped++;
+        return;
+    }
+
+    rec->type = type;
+    rec->cid = rte_lcore_id();
+    rec->reserved = 0;
+    rec->reserved2 = 0;
+    dp_vs_conn_handoff_fill(conn, &rec->conn);
+
+    if (unlikely(rte_ring_sp_enqueue(sl->tx_ring, rec))) {
+        rte_mempool_put(sync_pools[rte_socket_id()], rec);
+        sl->tx_dropped++;
+    }
+}
+
+static void sync_resync_conn(struct dp_vs_conn *conn, void *arg)
+{
+    __dp_vs_sync_conn(conn, DP_VS_SYNC_CONN_UPDATE);
+}
+
+/*
+ * conns are synced on transitions only, so the backup copy of a long
+ * established one would expire there after its timeout. sweep the conn
+ * table once every resync_interval to refresh them, in small steps.
+ */
+static void sync_resync_job(void *arg)
+{
+    struct sync_lcore *sl = &sync_lcores[rte_lcore_id()];
+    uint64_t now = rte_get_timer_cycles();
+    uint64_t ms, period;
+    uint32_t nbuckets;
+
+    if (!(dp_vs_sync_state & DP_VS_SYNC_S_MASTER) || !sync_resync_interval) {
+        sl->resync_last = now;
+        return;
+    }
+
+    period = (uint64_t)sync_resync_interval * 1000;
+    ms = RTE_MIN((now - sl->resync_last) * 1000 / g_cycles_per_sec, period);
+    nbuckets = ms * dp_vs_conn_tbl_size() / period;
+    if (!nbuckets)
+        return;
+
+    sl->resync_last = now;
+    dp_vs_conn_walk(&sl->resync_cursor, nbuckets, sync_resync_conn, NULL);
+}
+
+static void sync_conn_update(struct dp_vs_conn *conn,
+                             const struct dp_vs_handoff_conn *hc)
+{
+    struct dp_vs_dest *dest = conn->dest;
+
+    conn->old_state = conn->state;
+    conn->state = hc->state;
+    conn->fnat_seq = hc->fnat_seq;
+    conn->syn_proxy_seq = hc->syn_proxy_seq;
+    conn->rs_end_seq = hc->rs_end_seq;
+    conn->rs_end_ack = hc->rs_end_ack;
+    conn->timeout.tv_sec = hc->timeout ? : SYNC_EXPIRE_DELAY;
+    conn->timeout.tv_usec = 0;
+
+    if (hc->has_ext && (conn->ext || dp_vs_conn_ext_alloc(conn) == EDPVS_OK)) {
+        conn->ext->tsval        = hc->tsval;
+        conn->ext->tsecr        = hc->tsecr;
+        conn->ext->tscent       = hc->tscent;
+        conn->ext->clienttsval  = hc->clienttsval;
+    }
+
+    if (!dest || dp_vs_conn_is_template(conn))
+        return;
+
+    /* same accounting as the state transition on the sender */
+    if (!(conn->flags & DPVS_CONN_F_INACTIVE) &&
+        (hc->flags & DPVS_CONN_F_INACTIVE)) {
+        conn->inact = hc->inact;
+        dest->inact_timestamp_weight += conn->inact;
+        dest->act_timestamp_weight -= conn->act;
+        rte_atomic32_dec(&dest->actconns);
+        rte_atomic32_inc(&dest->inactconns);
+        conn->flags |= DPVS_CONN_F_INACTIVE;
+    } else if ((conn->flags & DPVS_CONN_F_INACTIVE) &&
+               !(hc->flags & DPVS_CONN_F_INACTIVE)) {
+        conn->act = hc->act;
+        dest->act_timestamp_weight += conn->act;
+        dest->inact_timestamp_weight -= conn->inact;
+        rte_atomic32_inc(&dest->actconns);
+        rte_atomic32_dec(&dest->inactconns);
+        conn->flags &= ~DPVS_CONN_F_INACTIVE;
+    }
+}
+
+static void sync_rec_install(struct sync_lcore *sl,
+                             const struct dp_vs_sync_rec *rec)
+{
+    const struct dp_vs_handoff_conn *hc = &rec->conn;
+    struct dp_vs_conn *conn;
+    int dir, err;
+
+    conn = dp_vs_conn_get(hc->af, hc->proto, &hc->caddr, &hc->vaddr,
+                          hc->cport, hc->vport, &dir, false);
+
+    if (rec->type == DP_VS_SYNC_CONN_EXPIRE) {
+        if (conn) {
+            /* let the local timer do the cleanup */
+            conn->timeout.tv_sec = SYNC_EXPIRE_DELAY;
+            conn->timeout.tv_usec = 0;
+            dp_vs_conn_put(conn);
+            sl->rx_updated++;
+        }
+        return;
+    }
+
+    if (conn) {
+        sync_conn_update(conn, hc);
+        dp_vs_conn_put(conn);
+        sl->rx_updated++;
+        return;
+    }
+
+    err = dp_vs_conn_handoff_import(hc, hc->timeout ? : SYNC_EXPIRE_DELAY);
+    if (err == EDPVS_OK)
+        sl->rx_installed++;
+    else
+        sl->rx_refused++;
+}
+
+static void sync_worker_job(void *arg)
+{
+    struct sync_lcore *sl = &sync_lcores[rte_lcore_id()];
+    struct dp_vs_sync_rec *recs[SYNC_BURST];
+    unsigned int i, n;
+
+    if (unlikely(!sl->rx_ring))
+        return;
+
+    n = rte_ring_sc_dequeue_burst(sl->rx_ring, (void **)recs, SYNC_BURST, NULL);
+    for (i = 0; i < n; i++) {
+        sync_rec_install(sl, recs[i]);
+        rte_mempool_put(rte_mempool_from_obj(recs[i]), recs[i]);
+    }
+}
+
+/////////////////////////////// master lcore ///////////////////////////////////
+
+static void sync_tx_flush(struct sync_daemon *dm)
+{
+    struct dp_vs_sync_hdr *hdr = (struct dp_vs_sync_hdr *)sync_txbuf;
+    struct sockaddr_in sin;
+
+    if (!hdr->nrecs)
+        return;
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(sync_port);
+    sin.sin_addr = sync_peer.s_addr ? sync_peer : sync_mcast_group;
+
+    if (sendto(dm->sockfd, sync_txbuf, sync_txlen, MSG_DONTWAIT,
+               (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+        dm->errors++;
+    } else {
+        dm->dgrams++;
+        dm->records += hdr->nrecs;
+    }
+
+    hdr->nrecs = 0;
+    sync_txlen = sizeof(*hdr);
+}
+
+/* drain the rings even when stopped, so that records always go back */
+static void sync_tx(void)
+{
+    struct sync_daemon *dm = &sync_daemons[SYNC_MASTER];
+    struct dp_vs_sync_hdr *hdr = (struct dp_vs_sync_hdr *)sync_txbuf;
+    struct dp_vs_sync_rec *recs[SYNC_BURST];
+    unsigned int i, n;
+    lcoreid_t cid;
+
+    hdr->magic = DP_VS_SYNC_MAGIC;
+    hdr->version = DP_VS_SYNC_VERSION;
+    hdr->syncid = dm->syncid;
+    hdr->rec_size = sizeof(struct dp_vs_sync_rec);
+    hdr->reserved = 0;
+    hdr->nrecs = 0;
+    sync_txlen = sizeof(*hdr);
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!sync_lcores[cid].tx_ring)
+            continue;
+
+        n = rte_ring_sc_dequeue_burst(sync_lcores[cid].tx_ring, (void **)recs,
+                                      SYNC_BURST, NULL);
+        for (i = 0; i < n; i++) {
+            if (dm->state) {
+                if (sync_txlen + sizeof(struct dp_vs_sync_rec) > sync_maxlen)
+                    sync_tx_flush(dm);
+                rte_memcpy(sync_txbuf + sync_txlen, recs[i],
+                           sizeof(struct dp_vs_sync_rec));
+                sync_txlen += sizeof(struct dp_vs_sync_rec);
+                hdr->nrecs++;
+            }
+            rte_mempool_put(rte_mempool_from_obj(recs[i]), recs[i]);
+        }
+    }
+
+    if (dm->state)
+        sync_tx_flush(dm);
+}
+
+static void sync_rx_dispatch(struct sync_daemon *dm, const char *buf, ssize_t len)
+{
+    const struct dp_vs_sync_hdr *hdr = (const struct dp_vs_sync_hdr *)buf;
+    const struct dp_vs_sync_rec *src;
+    struct dp_vs_sync_rec *rec;
+    struct rte_ring *ring;
+    int i;
+
+    if (len < sizeof(*hdr) || hdr->magic != DP_VS_SYNC_MAGIC ||
+        hdr->version != DP_VS_SYNC_VERSION ||
+        hdr->rec_size != sizeof(struct dp_vs_sync_rec) ||
+        hdr->syncid != (uint8_t)dm->syncid ||
+        (len - sizeof(*hdr)) / sizeof(struct dp_vs_sync_rec) < hdr->nrecs) {
+        dm->errors++;
+        return;
+    }
+
+    dm->dgrams++;
+
+    src = (const struct dp_vs_sync_rec *)(hdr + 1);
+    for (i = 0; i < hdr->nrecs; i++, src++) {
+        /* conns stay on the same lcore, tied by FNAT lport and RSS */
+        if (src->cid >= DPVS_MAX_LCORE ||
+            !(ring = sync_lcores[src->cid].rx_ring)) {
+            dm->errors++;
+            continue;
+        }
+
+        if (unlikely(rte_mempool_get(sync_pools[rte_socket_id()], (void **)&rec))) {
+            dm->errors++;
+            continue;
+        }
+
+        rte_memcpy(rec, src, sizeof(*rec));
+        if (unlikely(rte_ring_sp_enqueue(ring, rec))) {
+            rte_mempool_put(sync_pools[rte_socket_id()], rec);
+            dm->errors++;
+            continue;
+        }
+
+        dm->records++;
+    }
+}
+
+static void sync_rx(void)
+{
+    struct sync_daemon *dm = &sync_daemons[SYNC_BACKUP];
+    ssize_t len;
+    int i;
+
+    if (!dm->state)
+        return;
+
+    for (i = 0; i < SYNC_RX_DGRAMS; i++) {
+        len = recv(dm->sockfd, sync_rxbuf, sizeof(sync_rxbuf), MSG_DONTWAIT);
+        if (len < 0)
+            break;
+        sync_rx_dispatch(dm, sync_rxbuf, len);
+    }
+}
+
+static void sync_master_job(void *arg)
+{
+    sync_tx();
+    sync_rx();
+}
+
+/////////////////////////////// daemons ///////////////////////////////////////
+
+static int sync_socket_open(int state, const char *ifname)
+{
+    struct ip_mreqn mreq;
+    struct sockaddr_in sin;
+    unsigned char ttl = 1, loop = 0;
+    int fd, on = 1;
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+        return -1;
+
+    memset(&mreq, 0, sizeof(mreq));
+    if (ifname[0]) {
+        mreq.imr_ifindex = if_nametoindex(ifname);
+        if (!mreq.imr_ifindex ||
+            setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, ifname,
+                       strlen(ifname) + 1) < 0)
+            goto errout;
+    }
+
+    if (state == DP_VS_SYNC_S_MASTER) {
+        if (sync_peer.s_addr)
+            return fd;
+
+        if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &mreq, sizeof(mreq)) < 0 ||
+            setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0 ||
+            setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0)
+            goto errout;
+        return fd;
+    }
+
+    /* backup */
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(sync_port);
+    sin.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+        bind(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+        goto errout;
+
+    mreq.imr_multiaddr = sync_mcast_group;
+    if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+        goto errout;
+
+    return fd;
+
+errout:
+    close(fd);
+    return -1;
+}
+
+static int sync_daemon_start(const struct dp_vs_sync_daemon_conf *conf)
+{
+    struct sync_daemon *dm;
+    int fd;
+
+    if (conf->state == DP_VS_SYNC_S_MASTER)
+        dm = &sync_daemons[SYNC_MASTER];
+    else if (conf->state == DP_VS_SYNC_S_BACKUP)
+        dm = &sync_daemons[SYNC_BACKUP];
+    else
+        return EDPVS_INVAL;
+
+    if (dm->state)
+        return EDPVS_EXIST;
+
+    fd = sync_socket_open(conf->state, conf->mcast_ifn);
+    if (fd < 0) {
+        RTE_LOG(ERR, IPVS, "%s: fail to open sync socket on %s: %s\n",
+                __func__, conf->mcast_ifn, strerror(errno));
+        return EDPVS_SYSCALL;
+    }
+
+    memset(dm, 0, sizeof(*dm));
+    snprintf(dm->ifname, sizeof(dm->ifname), "%s", conf->mcast_ifn);
+    dm->syncid = conf->syncid;
+    dm->sockfd = fd;
+    dm->state = conf->state;
+
+    rte_wmb();
+    dp_vs_sync_state |= conf->state;
+
+    RTE_LOG(INFO, IPVS, "%s sync daemon started (ifn=%s, syncid=%d)\n",
+            conf->state == DP_VS_SYNC_S_MASTER ? "master" : "backup",
+            dm->ifname, dm->syncid);
+    return EDPVS_OK;
+}
+
+static int sync_daemon_stop(int state)
+{
+    struct sync_daemon *dm;
+    uint64_t limited = 0, dropped = 0, installed = 0, updated = 0, refused = 0;
+    lcoreid_t cid;
+
+    if (state == DP_VS_SYNC_S_MASTER)
+        dm = &sync_daemons[SYNC_MASTER];
+    else if (state == DP_VS_SYNC_S_BACKUP)
+        dm = &sync_daemons[SYNC_BACKUP];
+    else
+        return EDPVS_INVAL;
+
+    if (!dm->state)
+        return EDPVS_NOTEXIST;
+
+    dp_vs_sync_state &= ~state;
+    rte_wmb();
+
+    close(dm->sockfd);
+    dm->sockfd = -1;
+    dm->state = DP_VS_SYNC_S_NONE;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        limited += sync_lcores[cid].tx_limited;
+        dropped += sync_lcores[cid].tx_dropped;
+        installed += sync_lcores[cid].rx_installed;
+        updated += sync_lcores[cid].rx_updated;
+        refused += sync_lcores[cid].rx_refused;
+    }
+
+    RTE_LOG(INFO, IPVS, "%s sync daemon stopped: %lu datagrams, %lu records, "
+            "%lu errors; lcores: %lu rate-limited, %lu dropped, %lu installed, "
+            "%lu updated, %lu refused\n",
+            state == DP_VS_SYNC_S_MASTER ? "master" : "backup",
+            dm->dgrams, dm->records, dm->errors,
+            limited, dropped, installed, updated, refused);
+    return EDPVS_OK;
+}
+
+static int sync_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
+{
+    const struct dp_vs_sync_daemon_conf *dmconf = conf;
+
+    if (!conf || size < sizeof(*dmconf))
+        return EDPVS_INVAL;
+
+    switch (opt) {
+    case SOCKOPT_SET_SYNC_START:
+        return sync_daemon_start(dmconf);
+    case SOCKOPT_SET_SYNC_STOP:
+        return sync_daemon_stop(dmconf->state);
+    default:
+        return EDPVS_NOTSUPP;
+    }
+}
+
+static int sync_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
+                            void **out, size_t *outsize)
+{
+    struct dp_vs_sync_daemon_conf *dms;
+    int i;
+
+    if (opt != SOCKOPT_GET_SYNC_DAEMON)
+        return EDPVS_NOTSUPP;
+
+    dms = rte_zmalloc("sync_daemons", 2 * sizeof(*dms), 0);
+    if (!dms)
+        return EDPVS_NOMEM;
+
+    for (i = SYNC_MASTER; i <= SYNC_BACKUP; i++) {
+        dms[i].state = sync_daemons[i].state;
+        snprintf(dms[i].mcast_ifn, sizeof(dms[i].mcast_ifn), "%s",
+                 sync_daemons[i].ifname);
+        dms[i].syncid = sync_daemons[i].syncid;
+    }
+
+    *out = dms;
+    *outsize = 2 * sizeof(*dms);
+    return EDPVS_OK;
+}
+
+static struct dpvs_sockopts sync_sockopts = {
+    .version        = SOCKOPT_VERSION,
+    .set_opt_min    = SOCKOPT_SET_SYNC_START,
+    .set_opt_max    = SOCKOPT_SET_SYNC_STOP,
+    .set            = sync_sockopt_set,
+    .get_opt_min    = SOCKOPT_GET_SYNC_DAEMON,
+    .get_opt_max    = SOCKOPT_GET_SYNC_DAEMON,
+    .get            = sync_sockopt_get,
+};
+
+static struct dpvs_lcore_job sync_jobs[] = {
+    {
+        .name = "sync_master",
+        .func = sync_master_job,
+        .data = NULL,
+        .type = LCORE_JOB_LOOP,
+    },
+    {
+        .name = "sync_worker",
+        .func = sync_worker_job,
+        .data = NULL,
+        .type = LCORE_JOB_LOOP,
+    },
+    {
+        .name = "sync_resync",
+        .func = sync_resync_job,
+        .data = NULL,
+        .type = LCORE_JOB_SLOW,
+        .skip_loops = SYNC_RESYNC_LOOPS,
+    },
+};
+
+/////////////////////////////// init ///////////////////////////////////////
+
+static void sync_rings_free(void)
+{
+    lcoreid_t cid;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        rte_ring_free(sync_lcores[cid].tx_ring);
+        rte_ring_free(sync_lcores[cid].rx_ring);
+        sync_lcores[cid].tx_ring = NULL;
+        sync_lcores[cid].rx_ring = NULL;
+    }
+}
+
+static int sync_rings_create(void)
+{
+    char name[RTE_RING_NAMESIZE];
+    unsigned int nrecs[DPVS_MAX_SOCKET] = { 0 };
+    int socket, master_socket = rte_lcore_to_socket_id(rte_get_master_lcore());
+    lcoreid_t cid;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!sync_lcore_enabled(cid))
+            continue;
+
+        socket = rte_lcore_to_socket_id(cid);
+        snprintf(name, sizeof(name), "sync_tx_%d", cid);
+        sync_lcores[cid].tx_ring = rte_ring_create(name, sync_ring_size, socket,
+                                                   RING_F_SP_ENQ | RING_F_SC_DEQ);
+        snprintf(name, sizeof(name), "sync_rx_%d", cid);
+        sync_lcores[cid].rx_ring = rte_ring_create(name, sync_ring_size, socket,
+                                                   RING_F_SP_ENQ | RING_F_SC_DEQ);
+        if (!sync_lcores[cid].tx_ring || !sync_lcores[cid].rx_ring)
+            goto nomem;
+
+        sync_lcores[cid].last = rte_get_timer_cycles();
+        sync_lcores[cid].resync_last = sync_lcores[cid].last;
+
+        /* tx records come from the worker's socket, rx ones from master's */
+        nrecs[socket] += sync_ring_size;
+        nrecs[master_socket] += sync_ring_size;
+    }
+
+    for (socket = 0; socket < DPVS_MAX_SOCKET; socket++) {
+        if (!nrecs[socket])
+            continue;
+
+        snprintf(name, sizeof(name), "dp_vs_sync_%d", socket);
+        sync_pools[socket] = rte_mempool_create(name, nrecs[socket],
+                                    sizeof(struct dp_vs_sync_rec),
+                                    SYNC_BURST * 2, 0, NULL, NULL, NULL, NULL,
+                                    socket, MEMPOOL_F_NO_PHYS_CONTIG);
+        if (!sync_pools[socket])
+            goto nomem;
+    }
+
+    return EDPVS_OK;
+
+nomem:
+    /* no API opposite to rte_mempool_create() */
+    sync_rings_free();
+    return EDPVS_NOMEM;
+}
+
+int dp_vs_sync_init(void)
+{
+    int err;
+
+    sync_daemons[SYNC_MASTER].sockfd = -1;
+    sync_daemons[SYNC_BACKUP].sockfd = -1;
+
+    err = sync_rings_create();
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "%s: fail to create sync rings\n", __func__);
+        return err;
+    }
+
+    err = dpvs_lcore_job_register(&sync_jobs[0], LCORE_ROLE_MASTER);
+    if (err != EDPVS_OK)
+        goto free_rings;
+
+    err = dpvs_lcore_job_register(&sync_jobs[1], LCORE_ROLE_FWD_WORKER);
+    if (err != EDPVS_OK)
+        goto unreg_master;
+
+    err = dpvs_lcore_job_register(&sync_jobs[2], LCORE_ROLE_FWD_WORKER);
+    if (err != EDPVS_OK)
+        goto unreg_worker;
+
+    err = sockopt_register(&sync_sockopts);
+    if (err != EDPVS_OK)
+        goto unreg_resync;
+
+    return EDPVS_OK;
+
+unreg_resync:
+    dpvs_lcore_job_unregister(&sync_jobs[2], LCORE_ROLE_FWD_WORKER);
+unreg_worker:
+    dpvs_lcore_job_unregister(&sync_jobs[1], LCORE_ROLE_FWD_WORKER);
+unreg_master:
+    dpvs_lcore_job_unregister(&sync_jobs[0], LCORE_ROLE_MASTER);
+free_rings:
+    sync_rings_free();
+    return err;
+}
+
+int dp_vs_sync_term(void)
+{
+    if (sync_daemons[SYNC_MASTER].state)
+        sync_daemon_stop(DP_VS_SYNC_S_MASTER);
+    if (sync_daemons[SYNC_BACKUP].state)
+        sync_daemon_stop(DP_VS_SYNC_S_BACKUP);
+
+    sockopt_unregister(&sync_sockopts);
+    dpvs_lcore_job_unregister(&sync_jobs[2], LCORE_ROLE_FWD_WORKER);
+    dpvs_lcore_job_unregister(&sync_jobs[1], LCORE_ROLE_FWD_WORKER);
+    dpvs_lcore_job_unregister(&sync_jobs[0], LCORE_ROLE_MASTER);
+    sync_rings_free();
+
+    return EDPVS_OK;
+}
+
+/////////////////////////////// config ///////////////////////////////////////
+
+static void sync_mcast_group_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    struct in_addr addr;
+
+    assert(str);
+
+    if (inet_pton(AF_INET, str, &addr) == 1 && IN_MULTICAST(ntohl(addr.s_addr))) {
+        RTE_LOG(INFO, IPVS, "sync mcast_group = %s\n", str);
+        sync_mcast_group = addr;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid sync mcast_group %s, using default %s\n",
+                str, SYNC_MCAST_GROUP_DEF);
+        inet_pton(AF_INET, SYNC_MCAST_GROUP_DEF, &sync_mcast_group);
+    }
+
+    FREE_PTR(str);
+}
+
+static void sync_peer_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    struct in_addr addr;
+
+    assert(str);
+
+    if (inet_pton(AF_INET, str, &addr) == 1) {
+        RTE_LOG(INFO, IPVS, "sync peer = %s\n", str);
+        sync_peer = addr;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid sync peer %s, using multicast\n", str);
+        sync_peer.s_addr = htonl(INADDR_ANY);
+    }
+
+    FREE_PTR(str);
+}
+
+static void sync_port_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int port;
+
+    assert(str);
+
+    port = atoi(str);
+    if (port > 0 && port < 65536) {
+        RTE_LOG(INFO, IPVS, "sync port = %d\n", port);
+        sync_port = port;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid sync port %s, using default %d\n",
+                str, SYNC_PORT_DEF);
+        sync_port = SYNC_PORT_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+static void sync_rate_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int rate;
+
+    assert(str);
+
+    rate = atoi(str);
+    if (rate >= SYNC_RATE_MIN && rate <= SYNC_RATE_MAX) {
+        RTE_LOG(INFO, IPVS, "sync rate = %d\n", rate);
+        sync_rate = rate;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid sync rate %s, using default %d\n",
+                str, SYNC_RATE_DEF);
+        sync_rate = SYNC_RATE_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+static void sync_ring_size_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int size, lower;
+
+    assert(str);
+
+    size = atoi(str);
+    if (size >= SYNC_RING_SIZE_MIN && size <= SYNC_RING_SIZE_MAX) {
+        is_power2(size, 0, &lower);
+        if (size != lower)
+            RTE_LOG(WARNING, IPVS, "sync ring_size %d not power of 2, "
+                    "rounded to %d\n", size, lower);
+        RTE_LOG(INFO, IPVS, "sync ring_size = %d\n", lower);
+        sync_ring_size = lower;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid sync ring_size %s, using default %d\n",
+                str, SYNC_RING_SIZE_DEF);
+        sync_ring_size = SYNC_RING_SIZE_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+static void sync_maxlen_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int len;
+
+    assert(str);
+
+    len = atoi(str);
+    if (len >= SYNC_MAXLEN_MIN && len <= SYNC_MAXLEN_MAX) {
+        RTE_LOG(INFO, IPVS, "sync maxlen = %d\n", len);
+        sync_maxlen = len;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid sync maxlen %s, using default %d\n",
+                str, SYNC_MAXLEN_DEF);
+        sync_maxlen = SYNC_MAXLEN_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+static void sync_resync_interval_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int interval;
+
+    assert(str);
+
+    interval = atoi(str);
+    if (interval >= 0 && interval <= SYNC_RESYNC_MAX) {
+        RTE_LOG(INFO, IPVS, "sync resync_interval = %d\n", interval);
+        sync_resync_interval = interval;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid sync resync_interval %s, using default %d\n",
+                str, SYNC_RESYNC_DEF);
+        sync_resync_interval = SYNC_RESYNC_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+void ipvs_sync_keyword_value_init(void)
+{
+    if (dpvs_state_get() == DPVS_STATE_INIT) {
+        /* KW_TYPE_INIT keyword */
+        inet_pton(AF_INET, SYNC_MCAST_GROUP_DEF, &sync_mcast_group);
+        sync_peer.s_addr = htonl(INADDR_ANY);
+        sync_port = SYNC_PORT_DEF;
+        sync_ring_size = SYNC_RING_SIZE_DEF;
+        sync_maxlen = SYNC_MAXLEN_DEF;
+    }
+    /* KW_TYPE_NORMAL keyword */
+    sync_rate = SYNC_RATE_DEF;
+    sync_resync_interval = SYNC_RESYNC_DEF;
+}
+
+void install_ipvs_sync_keywords(void)
+{
+    install_keyword("mcast_group", sync_mcast_group_handler, KW_TYPE_INIT);
+    install_keyword("peer", sync_peer_handler, KW_TYPE_INIT);
+    install_keyword("port", sync_port_handler, KW_TYPE_INIT);
+    install_keyword("ring_size", sync_ring_size_handler, KW_TYPE_INIT);
+    install_keyword("maxlen", sync_maxlen_handler, KW_TYPE_INIT);
+    install_keyword("rate", sync_rate_handler, KW_TYPE_NORMAL);
+    install_keyword("resync_interval", sync_resync_interval_handler, KW_TYPE_NORMAL);
+}
@@ -18,7 +18,6 @@
 #include <assert.h>
 #include <netinet/ip.h>
 #include <netinet/tcp.h>
-#include <openssl/md5.h>
 #include "conf/common.h"
 #include "dpdk.h"
 #include "ipvs/ipvs.h"
@@ -29,7 +28,12 @@
 #include "ipvs/proto.h"
 #include "ipvs/proto_tcp.h"
 #include "ipvs/blklst.h"
+#include "ipvs/hwdrop.h"
+#include "ipvs/connlimit.h"
+#include "ipvs/sync.h"
 #include "parser/parser.h"
+#include "siphash.h"
+#include "ctrl.h"
 
 /* synproxy controll variables */
 /* syn-proxy ctrl variables */
@@ -48,6 +52,11 @@
 #define DP_VS_SYNPROXY_CONN_REUSE_CW_DEFAULT    0
 #define DP_VS_SYNPROXY_CONN_REUSE_LA_DEFAULT    0
 #define DP_VS_SYNPROXY_SYN_RETRY_DEFAULT        3
+#define DP_VS_SYNPROXY_SYN_BURST_DEFAULT        0
+#define DP_VS_SYNPROXY_TFO_DEFAULT              0
+#define DP_VS_SYNPROXY_AUTO_SYN_RATE_DEFAULT    50000
+#define DP_VS_SYNPROXY_AUTO_HALF_OPEN_DEFAULT   5000
+#define DP_VS_SYNPROXY_AUTO_COOL_DOWN_DEFAULT   60
 int dp_vs_synproxy_ctrl_init_mss = DP_VS_SYNPROXY_INIT_MSS_DEFAULT;
 int dp_vs_synproxy_ctrl_sack = DP_VS_SYNPROXY_SACK_DEFAULT;
 int dp_vs_synproxy_ctrl_wscale = DP_VS_SYNPROXY_WSCALE_DEFAULT;
@@ -63,6 +72,13 @@ int dp_vs_synproxy_ctrl_conn_reuse_la = DP_VS_SYNPROXY_CONN_REUSE_LA_DEFAULT;
 int dp_vs_synproxy_ctrl_dup_ack_thresh = DP_VS_SYNPROXY_DUP_ACK_DEFAULT;
 int dp_vs_synproxy_ctrl_max_ack_saved = DP_VS_SYNPROXY_MAX_ACK_SAVED_DEFAULT;
 int dp_vs_synproxy_ctrl_syn_retry = DP_VS_SYNPROXY_SYN_RETRY_DEFAULT;
+int dp_vs_synproxy_ctrl_syn_burst = DP_VS_SYNPROXY_SYN_BURST_DEFAULT;
+int dp_vs_synproxy_ctrl_tfo = DP_VS_SYNPROXY_TFO_DEFAULT;
+static struct dp_vs_synproxy_auto_conf dp_vs_synproxy_auto_conf = {
+    .syn_rate   = DP_VS_SYNPROXY_AUTO_SYN_RATE_DEFAULT,
+    .half_open  = DP_VS_SYNPROXY_AUTO_HALF_OPEN_DEFAULT,
+    .cool_down  = DP_VS_SYNPROXY_AUTO_COOL_DOWN_DEFAULT,
+};
 
 #define DP_VS_SYNPROXY_ACK_MBUFPOOL_SIZE        1048575  // 2^20 - 1
 #define DP_VS_SYNPROXY_ACK_CACHE_SIZE           256
@@ -76,10 +92,11 @@ static struct dpvs_timer g_second_timer;
 #endif
 
 /*
- * syncookies using digest function from openssl libray,
- * a little difference from kernel, which uses md5_transform
+ * syncookies keyed by SipHash-2-4 as the kernel does since 4.13,
+ * instead of MD5 which dominated the per-SYN cost under floods
  * */
-static uint32_t g_net_secret[2][MD5_LBLOCK];
+static struct siphash_key g_net_secret[2];
+static struct siphash_key g_tfo_secret;
 static struct dpvs_timer g_minute_timer;
 static rte_atomic32_t g_minute_count;
 
@@ -114,15 +131,164 @@ static int second_timer_expire(void *priv)
 }
 #endif
 
+/*
+ * Adaptive synproxy (DP_VS_SVC_F_SYNPROXY_AUTO): every lcore counts the
+ * SYNs and completed handshakes of the service and reports them to master
+ * at most once a second, on a SYN or handshake. Master sums the reports and
+ * switches synproxy of the service on all lcores with the thresholds of
+ * dp_vs_synproxy_auto_next(). Connections created while it's off are plain,
+ * without sequence translation. With no traffic at all there's no report,
+ * the state holds until the service is used again.
+ */
+struct dp_vs_synproxy_auto_msg {
+    int                 af;
+    uint8_t             proto;
+    uint8_t             active;
+    uint16_t            port;
+    union inet_addr     addr;
+    uint32_t            syns;
+    uint32_t            acks;
+};
+
+void __dp_vs_synproxy_auto_report(struct dp_vs_service *svc)
+{
+    struct dp_vs_synproxy_auto_msg rep;
+    struct dpvs_msg *msg;
+    lcoreid_t cid = rte_lcore_id();
+    int err;
+
+    memset(&rep, 0, sizeof(rep));
+    rep.af = svc->af;
+    rep.proto = svc->proto;
+    rep.port = svc->port;
+    rep.addr = svc->addr;
+    rep.syns = svc->sp_auto.syns;
+    rep.acks = svc->sp_auto.acks;
+
+    svc->sp_auto.syns = svc->sp_auto.acks = 0;
+    svc->sp_auto.stamp = rte_get_timer_cycles();
+
+    msg = msg_make(MSG_TYPE_SYNPROXY_AUTO_REPORT, 0, DPVS_MSG_UNICAST,
+                   cid, sizeof(rep), &rep);
+    if (unlikely(!msg))
+        return;
+
+    err = msg_send(msg, rte_get_master_lcore(), DPVS_MSG_F_ASYNC, NULL);
+    if (err != EDPVS_OK)
+        RTE_LOG(WARNING, IPVS, "[%02d] %s: msg_send failed -- %s\n",
+                cid, __func__, dpvs_strerror(err));
+    msg_destroy(&msg);
+}
+
+static int synproxy_auto_report_msg_cb(struct dpvs_msg *msg)
+{
+    struct dp_vs_synproxy_auto_msg *rep;
+    struct dp_vs_synproxy_auto *sa;
+    struct dp_vs_service *svc;
+    struct dpvs_msg *set;
+    char addr[64];
+    uint64_t now;
+    int err;
+
+    assert(rte_lcore_id() == rte_get_master_lcore());
+
+    if (!msg || msg->len != sizeof(*rep))
+        return EDPVS_INVAL;
+    rep = (struct dp_vs_synproxy_auto_msg *)msg->data;
+
+    svc = dp_vs_service_lookup(rep->af, rep->proto, &rep->addr, rep->port,
+                               0, NULL, NULL, NULL, rte_lcore_id());
+    if (!svc || !(svc->flags & DP_VS_SVC_F_SYNPROXY_AUTO))
+        return EDPVS_NOTEXIST;
+    sa = &svc->sp_auto;
+
+    sa->sum_syns += rep->syns;
+    sa->sum_acks += rep->acks;
+
+    now = rte_get_timer_cycles();
+    if (!sa->stamp) {
+        sa->stamp = now;
+        return EDPVS_OK;
+    }
+    if (now - sa->stamp < rte_get_timer_hz())
+        return EDPVS_OK;
+
+    if (!dp_vs_synproxy_auto_next(&dp_vs_synproxy_auto_conf, sa,
+                (now - sa->stamp) * 1000 / rte_get_timer_hz())) {
+        sa->stamp = now;
+        return EDPVS_OK;
+    }
+    sa->stamp = now;
+
+    RTE_LOG(INFO, IPVS, "%s: synproxy %s for %s:%u\n", __func__,
+            sa->active ? "on" : "off",
+            inet_ntop(svc->af, &svc->addr, addr, sizeof(addr)) ? addr : "::",
+            ntohs(svc->port));
+    dp_vs_estats_inc(sa->active ? SYNPROXY_AUTO_ON : SYNPROXY_AUTO_OFF);
+
+    rep->active = sa->active;
+    set = msg_make(MSG_TYPE_SYNPROXY_AUTO_SET, 0, DPVS_MSG_MULTICAST,
+                   rte_lcore_id(), sizeof(*rep), rep);
+    if (unlikely(!set))
+        return EDPVS_NOMEM;
+
+    err = multicast_msg_send(set, DPVS_MSG_F_ASYNC, NULL);
+    if (err != EDPVS_OK)
+        RTE_LOG(WARNING, IPVS, "%s: multicast_msg_send failed -- %s\n",
+                __func__, dpvs_strerror(err));
+    msg_destroy(&set);
+    return err;
+}
+
+static int synproxy_auto_set_msg_cb(struct dpvs_msg *msg)
+{
+    struct dp_vs_synproxy_auto_msg *set;
+    struct dp_vs_service *svc;
+
+    if (!msg || msg->len != sizeof(*set))
+        return EDPVS_INVAL;
+    set = (struct dp_vs_synproxy_auto_msg *)msg->data;
+
+    svc = dp_vs_service_lookup(set->af, set->proto, &set->addr, set->port,
+                               0, NULL, NULL, NULL, rte_lcore_id());
+    if (!svc)
+        return EDPVS_NOTEXIST;
+
+    svc->sp_auto.active = set->active;
+    return EDPVS_OK;
+}
+
+static struct dpvs_msg_type synproxy_auto_msg_types[] = {
+    {
+        .type               = MSG_TYPE_SYNPROXY_AUTO_REPORT,
+        .prio               = MSG_PRIO_LOW,
+        .mode               = DPVS_MSG_UNICAST,
+        .unicast_msg_cb     = synproxy_auto_report_msg_cb,
+    },
+    {
+        .type               = MSG_TYPE_SYNPROXY_AUTO_SET,
+        .prio               = MSG_PRIO_NORM,
+        .mode               = DPVS_MSG_MULTICAST,
+        .unicast_msg_cb     = synproxy_auto_set_msg_cb,
+    },
+};
+
 int dp_vs_synproxy_init(void)
 {
-    int i;
+    int i, err;
     char ack_mbufpool_name[32];
     struct timeval tv;
 
-    for (i = 0; i < MD5_LBLOCK; i++) {
-        g_net_secret[0][i] = (uint32_t)random();
-        g_net_secret[1][i] = (uint32_t)random();
+    /* cookies are only as strong as these keys */
+    if (get_random_bytes(g_net_secret, sizeof(g_net_secret)) != 0 ||
+        get_random_bytes(&g_tfo_secret, sizeof(g_tfo_secret)) != 0) {
+        RTE_LOG(WARNING, IPVS, "%s: no kernel random data, keys from rte_rand\n",
+                __func__);
+        for (i = 0; i < 2; i++) {
+            g_net_secret[0].key[i] = rte_rand();
+            g_net_secret[1].key[i] = rte_rand();
+            g_tfo_secret.key[i] = rte_rand();
+        }
     }
 
     rte_atomic32_set(&g_minute_count, (uint32_t)random());
@@ -130,6 +296,17 @@ int dp_vs_synproxy_init(void)
     tv.tv_usec = 0;
     dpvs_timer_sched(&g_minute_timer, &tv, minute_timer_expire, NULL, true);
 
+    synproxy_auto_msg_types[0].cid = rte_get_master_lcore();
+    synproxy_auto_msg_types[1].cid = rte_lcore_id();
+    err = msg_type_register(&synproxy_auto_msg_types[0]);
+    if (err != EDPVS_OK)
+        return err;
+    err = msg_type_mc_register(&synproxy_auto_msg_types[1]);
+    if (err != EDPVS_OK) {
+        msg_type_unregister(&synproxy_auto_msg_types[0]);
+        return err;
+    }
+
     /* allocate NUMA-aware ACK list cache */
     for (i = 0; i < get_numa_nodes(); i++) {
         snprintf(ack_mbufpool_name, sizeof(ack_mbufpool_name), "ack_mbufpool_%d", i);
@@ -142,6 +319,8 @@ int dp_vs_synproxy_init(void)
         if (!dp_vs_synproxy_ack_mbufpool[i]) {
             for (i = i - 1; i >= 0; i--)
                 rte_mempool_free(dp_vs_synproxy_ack_mbufpool[i]);
+            msg_type_mc_unregister(&synproxy_auto_msg_types[1]);
+            msg_type_unregister(&synproxy_auto_msg_types[0]);
             return EDPVS_NOMEM;
         }
     }
@@ -163,146 +342,15 @@ int dp_vs_synproxy_term(void)
     int i;
     dpvs_timer_cancel(&g_minute_timer, true);
 
+    msg_type_mc_unregister(&synproxy_auto_msg_types[1]);
+    msg_type_unregister(&synproxy_auto_msg_types[0]);
+
     for (i = 0; i < get_numa_nodes(); i++)
         rte_mempool_free(dp_vs_synproxy_ack_mbufpool[i]);
 
     return EDPVS_OK;
 }
 
-#define COOKIEBITS 24 /* Upper bits store count */
-#define COOKIEMASK (((uint32_t)1 << COOKIEBITS) - 1)
-
-static uint32_t
-cookie_hash(uint32_t saddr, uint32_t daddr,
-            uint16_t sport, uint16_t dport,
-            uint32_t count, int c)
-{
-    unsigned char hash[MD5_DIGEST_LENGTH];
-    uint32_t data[5];
-    uint32_t hvalue;
-
-    data[0] = saddr;
-    data[1] = daddr;
-    data[2] = (sport << 16) + dport;
-    data[3] = count;
-    data[4] = g_net_secret[c][0];
-
-    MD5((unsigned char *)data, sizeof(data), hash);
-    memcpy(&hvalue, hash, sizeof(hvalue));
-
-    return hvalue;
-}
-
-static uint32_t
-secure_tcp_syn_cookie(uint32_t saddr, uint32_t daddr,
-                      uint16_t sport, uint16_t dport,
-                      uint32_t sseq, uint32_t count,
-                      uint32_t data)
-{
-    /*
-     * Compute the secure sequence number.
-     * The output should be:
-     * HASH(sec1, saddr, sport, daddr, dport, sec1) + sseq + (count * 2^24)
-     *      + (HASH(sec2, saddr, sport, daddr, dport, count, sec2) % 2^24).
-     * Where sseq is their sequence number and count increases every minute by 1.
-     * As an extra hack, we add a small "data" value that encodes the MSS into
-     * the second hash value.
-     */
-    return (cookie_hash(saddr, daddr, sport, dport, 0, 0) +
-        sseq + (count << COOKIEBITS) +
-        ((cookie_hash(saddr, daddr, sport, dport, count, 1) + data) & COOKIEMASK));
-}
-
-static uint32_t
-check_tcp_syn_cookie(uint32_t cookie,
-                     uint32_t saddr, uint32_t daddr,
-                     uint16_t sport, uint16_t dport,
-                     uint32_t sseq, uint32_t count,
-                     uint32_t maxdiff)
-{
-    /*
-     * This retrieves the small "data" value from the syncookie.
-     * If the syncookie is bad, the data returned will be out of range.
-     * This must be checked by the caller.
-     *
-     * The count value used to generate the cookie must be within "maxdiff"
-     * if the current (passed-in) "count". The return value is (uint32_t) -1
-     * if this test fails.
-     */
-    uint32_t diff;
-
-    /* Strip away the layers from the cookie */
-    cookie -= cookie_hash(saddr, daddr, sport, dport, 0, 0) + sseq;
-
-    /* Cookie is now reduced to (count * 2^24) ^ (hash % 2^24) */
-    diff = (count - (cookie >> COOKIEBITS)) & ((uint32_t) -1 >> COOKIEBITS);
-    if (diff >= maxdiff)
-        return (uint32_t) -1;
-
-    return (cookie - cookie_hash(saddr, daddr, sport, dport, count - diff, 1))
-        & COOKIEMASK; /* Leaving the data behind */
-}
-
-static uint32_t
-cookie_hash_v6(const struct in6_addr *saddr,
-               const struct in6_addr *daddr,
-               uint16_t sport, uint16_t dport,
-               uint32_t count, int c)
-{
-    int i;
-    uint32_t hvalue, data[MD5_LBLOCK];
-    unsigned char hash[MD5_DIGEST_LENGTH];
-
-    for (i = 0; i < 4; i++)
-        data[i] = g_net_secret[c][i] + ((uint32_t *)saddr)[i];
-    for (i = 4; i < 8; i++)
-        data[i] = g_net_secret[c][i] + ((uint32_t *)daddr)[i-4];
-
-    data[8] = g_net_secret[c][8] + ((sport << 16) + dport);
-    data[9] = g_net_secret[c][9] + count;
-
-    for (i = 10; i < MD5_LBLOCK; i++)
-        data[i] = g_net_secret[c][i];
-
-    MD5((unsigned char*)data, sizeof(data), hash);
-    memcpy(&hvalue, hash, sizeof(hvalue));
-
-    return hvalue;
-}
-
-static uint32_t
-secure_tcp_syn_cookie_v6(const struct in6_addr *saddr,
-                      const struct in6_addr *daddr,
-                      uint16_t sport, uint16_t dport,
-                      uint32_t sseq, uint32_t count,
-                      uint32_t data)
-{
-    return (cookie_hash_v6(saddr, daddr, sport, dport, 0, 0)
-            + sseq + (count << COOKIEBITS)
-            + ((cookie_hash_v6(saddr, daddr, sport, dport, count, 1)
-                    + data) & COOKIEMASK));
-}
-
-static uint32_t
-check_tcp_syn_cookie_v6(uint32_t cookie,
-                        const struct in6_addr *saddr,
-                        const struct in6_addr *daddr,
-                        uint16_t sport, uint16_t dport,
-                        uint32_t sseq, uint32_t count,
-                        uint32_t maxdiff)
-{
-    uint32_t diff;
-
-    cookie -= cookie_hash_v6(saddr, daddr, sport, dport, 0, 0) + sseq;
-
-    diff = (count - (cookie >> COOKIEBITS)) & ((uint32_t) -1 >> COOKIEBITS);
-    if (diff >= maxdiff)
-        return (uint32_t) -1;
-
-    return (cookie - cookie_hash_v6(saddr, daddr, sport, dport,
-                count - diff, 1)) & COOKIEMASK;
-}
-
 /* This table has to be sorted and terminated with (uint16_t)-1.
  * XXX generate a better table.
  * Unresolved Issues: HIPPI with a 64K MSS is not well supported.
@@ -363,7 +411,7 @@ syn_proxy_cookie_v4_init_sequence(struct rte_mbuf *mbuf,
     data |= opts->tstamp_ok << DP_VS_SYNPROXY_TSOK_BIT;
     data |= ((opts->snd_wscale & 0xf) << DP_VS_SYNPROXY_SND_WSCALE_BITS);
 
-    return secure_tcp_syn_cookie(iph->saddr, iph->daddr,
+    return dp_vs_synproxy_cookie(g_net_secret, iph->saddr, iph->daddr,
             th->source, th->dest, ntohl(th->seq),
             rte_atomic32_read(&g_minute_count), data);
 }
@@ -388,8 +436,8 @@ syn_proxy_cookie_v6_init_sequence(struct rte_mbuf *mbuf,
     data |= opts->tstamp_ok << DP_VS_SYNPROXY_TSOK_BIT;
     data |= ((opts->snd_wscale & 0xf) << DP_VS_SYNPROXY_SND_WSCALE_BITS);
 
-    return secure_tcp_syn_cookie_v6(&ip6h->ip6_src, &ip6h->ip6_dst,
-            th->source, th->dest, ntohl(th->seq),
+    return dp_vs_synproxy_cookie_v6(g_net_secret,
+            &ip6h->ip6_src, &ip6h->ip6_dst, th->source, th->dest, ntohl(th->seq),
             rte_atomic32_read(&g_minute_count), data);
 }
 
@@ -407,9 +455,9 @@ syn_proxy_v4_cookie_check(struct rte_mbuf *mbuf, uint32_t cookie,
 
     uint32_t seq = ntohl(th->seq) - 1;
     uint32_t mssind;
-    uint32_t res = check_tcp_syn_cookie(cookie, iph->saddr, iph->daddr,
-            th->source, th->dest, seq, rte_atomic32_read(&g_minute_count),
-            DP_VS_SYNPROXY_COUNTER_TRIES);
+    uint32_t res = dp_vs_synproxy_cookie_check(g_net_secret, cookie,
+            iph->saddr, iph->daddr, th->source, th->dest, seq,
+            rte_atomic32_read(&g_minute_count), DP_VS_SYNPROXY_COUNTER_TRIES);
 
     if ((uint32_t) -1 == res) /* count is invalid, g_minute_count' >> g_minute_count */
         return 0;
@@ -444,8 +492,9 @@ syn_proxy_v6_cookie_check(struct rte_mbuf *mbuf, uint32_t cookie,
 
     uint32_t seq = ntohl(th->seq) - 1;
     uint32_t mssind;
-    uint32_t res = check_tcp_syn_cookie_v6(cookie, &ip6h->ip6_src, &ip6h->ip6_dst,
-                   th->source, th->dest, seq, rte_atomic32_read(&g_minute_count),
+    uint32_t res = dp_vs_synproxy_cookie_check_v6(g_net_secret, cookie,
+                   &ip6h->ip6_src, &ip6h->ip6_dst, th->source, th->dest, seq,
+                   rte_atomic32_read(&g_minute_count),
                    DP_VS_SYNPROXY_COUNTER_TRIES);
 
     if ((uint32_t) -1 == res) /* count is invalid, g_minute_count' >> g_minute_count */
@@ -472,6 +521,58 @@ syn_proxy_v6_cookie_check(struct rte_mbuf *mbuf, uint32_t cookie,
     return 0;
 }
 
+/*
+ * TCP Fast Open cookie of client @saddr to @daddr, a MAC of the addresses
+ * as the kernel's, so a client proves it owns its address by showing it.
+ */
+static void syn_proxy_tfo_cookie(int af, const union inet_addr *saddr,
+                                 const union inet_addr *daddr, uint8_t *cookie)
+{
+    uint64_t data[4], mac;
+
+    if (AF_INET6 == af) {
+        memcpy(&data[0], &saddr->in6, sizeof(struct in6_addr));
+        memcpy(&data[2], &daddr->in6, sizeof(struct in6_addr));
+        mac = siphash(data, 4, &g_tfo_secret);
+    } else {
+        data[0] = ((uint64_t)daddr->in.s_addr << 32) | saddr->in.s_addr;
+        mac = siphash(data, 1, &g_tfo_secret);
+    }
+    memcpy(cookie, &mac, DP_VS_SYNPROXY_TFO_COOKIE_LEN);
+}
+
+/* TFO option of SYN @th, *len is the length of the cookie in it */
+static uint8_t *syn_proxy_tfo_opt(struct tcphdr *th, int *len)
+{
+    uint8_t *ptr = (uint8_t *)(th + 1);
+    int length = (th->doff * 4) - sizeof(struct tcphdr);
+    int opsize;
+
+    while (length > 0) {
+        switch (ptr[0]) {
+        case TCPOPT_EOL:
+            return NULL;
+        case TCPOPT_NOP:
+            ptr++;
+            length--;
+            continue;
+        default:
+            if (length < 2)
+                return NULL;
+            opsize = ptr[1];
+            if (opsize < 2 || opsize > length)
+                return NULL;
+            if (ptr[0] == TCPOPT_FASTOPEN) {
+                *len = opsize - TCPOLEN_FASTOPEN_BASE;
+                return ptr;
+            }
+            ptr += opsize;
+            length -= opsize;
+        }
+    }
+    return NULL;
+}
+
 /*
  *  Synproxy implementation
  */
@@ -571,18 +672,24 @@ static void syn_proxy_parse_set_opts(struct rte_mbuf *mbuf, struct tcphdr *th,
 
 /* Reuse mbuf for syn proxy, called by syn_proxy_syn_rcv().
  * do following things:
- * 1) set tcp options,
- * 2) compute seq with cookie func,
- * 3) set tcp seq and ack_seq,
- * 4) exchange ip addr and tcp port,
- * 5) compute iphdr and tcp check (HW xmit checksum offload not support for syn).
+ * 1) drop the payload and add TFO cookie @tfo_cookie if any,
+ * 2) set tcp options,
+ * 3) compute seq with cookie func, or take @conn_isn of the conn a TFO SYN
+ *    is a retransmission for,
+ * 4) set tcp seq and ack_seq, acking @acked bytes of payload (TFO),
+ * 5) exchange ip addr and tcp port,
+ * 6) compute iphdr and tcp check (HW xmit checksum offload not support for syn).
+ * @return EDPVS_OK if the SYN-ACK is ready.
  */
-static void syn_proxy_reuse_mbuf(int af, struct rte_mbuf *mbuf,
-                                 struct tcphdr *th,
-                                 struct dp_vs_synproxy_opt *opt)
+static int syn_proxy_reuse_mbuf(int af, struct rte_mbuf *mbuf,
+                                struct tcphdr *th,
+                                struct dp_vs_synproxy_opt *opt,
+                                uint32_t acked, const uint8_t *tfo_cookie,
+                                const uint32_t *conn_isn)
 {
-    uint32_t isn;
+    uint32_t isn, payload;
     uint16_t tmpport;
+    uint8_t *ptr;
     int iphlen;
 
     if (AF_INET6 == af)
@@ -591,13 +698,37 @@ static void syn_proxy_reuse_mbuf(int af, struct rte_mbuf *mbuf,
         iphlen = ip4_hdrlen(mbuf);
 
     if (mbuf_may_pull(mbuf, iphlen + (th->doff << 2)) != 0)
-        return;
+        return EDPVS_INVPKT;
+
+    /* the SYN-ACK carries no data, the client's is acked (TFO) or resent */
+    payload = mbuf->pkt_len - iphlen - (th->doff << 2);
+    if (payload && rte_pktmbuf_trim(mbuf, payload) != 0)
+        return EDPVS_NOTSUPP;
+
+    if (tfo_cookie && th->doff * 4 + DP_VS_SYNPROXY_TFO_OPT_ALIGNED <= 60 &&
+            (ptr = (uint8_t *)rte_pktmbuf_append(mbuf,
+                                DP_VS_SYNPROXY_TFO_OPT_ALIGNED)) != NULL) {
+        ptr[0] = TCPOPT_NOP;
+        ptr[1] = TCPOPT_NOP;
+        ptr[2] = TCPOPT_FASTOPEN;
+        ptr[3] = TCPOLEN_FASTOPEN_BASE + DP_VS_SYNPROXY_TFO_COOKIE_LEN;
+        memcpy(&ptr[4], tfo_cookie, DP_VS_SYNPROXY_TFO_COOKIE_LEN);
+        th->doff += DP_VS_SYNPROXY_TFO_OPT_ALIGNED >> 2;
+        dp_vs_estats_inc(SYNPROXY_TFO_COOKIE);
+    }
+
+    if (AF_INET6 == af)
+        ip6_hdr(mbuf)->ip6_plen = htons(mbuf->pkt_len - iphlen);
+    else
+        ip4_hdr(mbuf)->total_length = htons(mbuf->pkt_len);
 
     /* deal with tcp options */
     syn_proxy_parse_set_opts(mbuf, th, opt);
 
     /* get cookie */
-    if (AF_INET6 == af)
+    if (conn_isn)
+        isn = *conn_isn;
+    else if (AF_INET6 == af)
         isn = syn_proxy_cookie_v6_init_sequence(mbuf, th, opt);
     else
         isn = syn_proxy_cookie_v4_init_sequence(mbuf, th, opt);
@@ -612,7 +743,7 @@ static void syn_proxy_reuse_mbuf(int af, struct rte_mbuf *mbuf,
     /* set window size to zero */
     th->window = 0;
     /* set seq(cookie) and ack_seq */
-    th->ack_seq = htonl(ntohl(th->seq) + 1);
+    th->ack_seq = htonl(ntohl(th->seq) + 1 + acked);
     th->seq = htonl(isn);
 
     /* exchage addresses */
@@ -631,7 +762,7 @@ static void syn_proxy_reuse_mbuf(int af, struct rte_mbuf *mbuf,
             th->check = ip6_phdr_cksum(ip6h, mbuf->ol_flags, mbuf->l3_len, IPPROTO_TCP);
         } else {
             if (mbuf_may_pull(mbuf, mbuf->pkt_len) != 0)
-                return;
+                return EDPVS_INVPKT;
             tcp6_send_csum((struct ipv6_hdr*)ip6h, th);
         }
     } else {
@@ -651,7 +782,7 @@ static void syn_proxy_reuse_mbuf(int af, struct rte_mbuf *mbuf,
             th->check = ip4_phdr_cksum((struct ipv4_hdr*)iph, mbuf->ol_flags);
         } else {
             if (mbuf_may_pull(mbuf, mbuf->pkt_len) != 0)
-                return;
+                return EDPVS_INVPKT;
             tcp4_send_csum((struct ipv4_hdr*)iph, th);
         }
 
@@ -660,6 +791,156 @@ static void syn_proxy_reuse_mbuf(int af, struct rte_mbuf *mbuf,
         else
             ip4_send_csum((struct ipv4_hdr*)iph);
     }
+
+    return EDPVS_OK;
+}
+
+static int syn_proxy_send_rs_syn(int af, const struct tcphdr *th,
+        struct dp_vs_conn *cp, struct rte_mbuf *mbuf,
+        struct dp_vs_proto *pp, struct dp_vs_synproxy_opt *opt);
+
+/*
+ * TCP Fast Open on client's SYN @mbuf, before it's reused for the SYN-ACK.
+ * The client's TFO option is blanked. If it asks for a cookie or shows a
+ * bad one, @cookie is set for the SYN-ACK. If it shows a good one with
+ * data, the client is proven as by the ack of step 2, and a copy of the
+ * SYN is returned to become the first data segment to rs, *acked is the
+ * length of the data. If the SYN is a retransmission, its data is with
+ * the conn already: nothing is returned but *acked, and *resend is set
+ * with *isn the conn's, to send the SYN-ACK again.
+ */
+static struct rte_mbuf *syn_proxy_tfo_rcv(int af, struct rte_mbuf *mbuf,
+        const struct dp_vs_iphdr *iph, struct dp_vs_service *svc,
+        uint8_t *cookie, bool *send_cookie, uint32_t *acked,
+        bool *resend, uint32_t *isn)
+{
+    uint8_t good[DP_VS_SYNPROXY_TFO_COOKIE_LEN], *opt;
+    struct dp_vs_conn *cp;
+    struct rte_mbuf *data;
+    struct tcphdr *th;
+    uint32_t payload;
+    int len, dir;
+
+    *send_cookie = false;
+    *resend = false;
+    *acked = 0;
+
+    if (mbuf_may_pull(mbuf, iph->len + sizeof(struct tcphdr)) != 0)
+        return NULL;
+    th = rte_pktmbuf_mtod_offset(mbuf, struct tcphdr *, iph->len);
+    if (mbuf_may_pull(mbuf, iph->len + (th->doff << 2)) != 0)
+        return NULL;
+    th = rte_pktmbuf_mtod_offset(mbuf, struct tcphdr *, iph->len);
+
+    if (!(opt = syn_proxy_tfo_opt(th, &len)))
+        return NULL;
+    memset(opt, TCPOPT_NOP, len + TCPOLEN_FASTOPEN_BASE);
+
+    syn_proxy_tfo_cookie(af, &iph->saddr, &iph->daddr, good);
+    if (len != DP_VS_SYNPROXY_TFO_COOKIE_LEN ||
+            memcmp(opt + TCPOLEN_FASTOPEN_BASE, good, len) != 0) {
+        if (len)
+            dp_vs_estats_inc(SYNPROXY_TFO_BAD_COOKIE);
+        memcpy(cookie, good, DP_VS_SYNPROXY_TFO_COOKIE_LEN);
+        *send_cookie = true;
+        return NULL;
+    }
+
+    payload = mbuf->pkt_len - iph->len - (th->doff << 2);
+    if (!payload)
+        return NULL;
+
+    /* syn_rcv comes before the conn lookup, never a second conn for a
+     * tuple. one in syn-proxy handshake with rs, or past it, was made by
+     * this SYN before; any other is an old one closing, which the
+     * client's ACK reuses, and the data is resent after the handshake */
+    cp = dp_vs_conn_get(af, iph->proto, &iph->saddr, &iph->daddr,
+                        th->source, th->dest, &dir, false);
+    if (cp) {
+        if ((cp->flags & DPVS_CONN_F_SYNPROXY) &&
+                (cp->state == DPVS_TCP_S_SYN_SENT ||
+                 cp->state == DPVS_TCP_S_ESTABLISHED)) {
+            dp_vs_estats_inc(SYNPROXY_TFO_RETRANS);
+            *isn = ntohl(cp->syn_proxy_seq.isn);
+            *resend = true;
+            *acked = payload;
+        }
+        dp_vs_conn_put_no_reset(cp);
+        return NULL;
+    }
+
+    /* the checks of step 2, the client resends its data if they fail */
+    if (!dp_vs_connlimit_rate_check(&svc->climit, af, &iph->saddr) ||
+            !dp_vs_connlimit_conn_check(&svc->climit, af, &iph->saddr))
+        return NULL;
+
+    data = mbuf_copy(mbuf, mbuf->pool);
+    if (unlikely(!data))
+        return NULL;
+
+    *acked = payload;
+    return data;
+}
+
+/*
+ * Syn-proxy step 2 for TFO: turn @data, the copy of the SYN, into the
+ * first data segment of the client acking @isn, create the conn with it
+ * saved as the ack of step 2, and send syn to rs. @data is consumed.
+ */
+static int syn_proxy_tfo_conn(int af, struct rte_mbuf *data,
+        const struct dp_vs_iphdr *iph, struct dp_vs_service *svc,
+        struct dp_vs_synproxy_opt *opt, uint32_t isn)
+{
+    struct dp_vs_proto *pp = dp_vs_proto_lookup(IPPROTO_TCP);
+    struct dp_vs_conn *cp;
+    struct tcphdr *th;
+    uint8_t *ptr;
+    int length, opsize, err;
+
+    th = rte_pktmbuf_mtod_offset(data, struct tcphdr *, iph->len);
+
+    /* only the timestamp is meaningful past the SYN */
+    ptr = (uint8_t *)(th + 1);
+    length = (th->doff * 4) - sizeof(struct tcphdr);
+    while (length > 0) {
+        if (ptr[0] == TCPOPT_EOL)
+            break;
+        if (ptr[0] == TCPOPT_NOP) {
+            ptr++;
+            length--;
+            continue;
+        }
+        opsize = length < 2 ? length : ptr[1];
+        if (opsize < 2 || opsize > length)
+            opsize = length;
+        if (ptr[0] != TCPOPT_TIMESTAMP)
+            memset(ptr, TCPOPT_NOP, opsize);
+        ptr += opsize;
+        length -= opsize;
+    }
+
+    th->syn = 0;
+    th->ack = 1;
+    th->seq = htonl(ntohl(th->seq) + 1);
+    th->ack_seq = htonl(isn + 1);
+    if (opt->wscale_ok)
+        th->window = htons(ntohs(th->window) >> opt->snd_wscale);
+
+    cp = dp_vs_schedule(svc, iph, data, 1, 0);
+    if (unlikely(!cp)) {
+        rte_pktmbuf_free(data);
+        return EDPVS_RESOURCE;
+    }
+
+    /* session will be correctly freed in dp_vs_conn_expire on failure */
+    err = syn_proxy_send_rs_syn(af, th, cp, data, pp, opt);
+    if (err != EDPVS_OK)
+        RTE_LOG(ERR, IPVS, "%s: syn_proxy_send_rs_syn failed -- %s\n",
+                __func__, dpvs_strerror(err));
+
+    dp_vs_estats_inc(SYNPROXY_TFO_DATA);
+    dp_vs_conn_put(cp);
+    return EDPVS_OK;
 }
 
 /* Syn-proxy step 1 logic: receive client's Syn.
@@ -683,6 +964,10 @@ int dp_vs_synproxy_syn_rcv(int af, struct rte_mbuf *mbuf,
     struct netif_port *dev;
     struct ether_hdr *eth;
     struct ether_addr ethaddr;
+    struct rte_mbuf *tfo_data = NULL;
+    uint8_t tfo_cookie[DP_VS_SYNPROXY_TFO_COOKIE_LEN];
+    bool tfo_send_cookie = false, tfo_resend = false;
+    uint32_t tfo_acked = 0, tfo_isn = 0;
 
     th = mbuf_header_pointer(mbuf, iph->len, sizeof(_tcph), &_tcph);
     if (unlikely(NULL == th))
@@ -690,8 +975,13 @@ int dp_vs_synproxy_syn_rcv(int af, struct rte_mbuf *mbuf,
 
     if (th->syn && !th->ack && !th->rst && !th->fin &&
             (svc = dp_vs_service_lookup(af, iph->proto, &iph->daddr, th->dest, 0,
-                                        NULL, NULL, NULL, rte_lcore_id())) &&
-            (svc->flags & DP_VS_SVC_F_SYNPROXY)) {
+                                        NULL, NULL, NULL, rte_lcore_id()))) {
+        dp_vs_attack_inc(&svc->attack, DP_VS_ATTACK_SYN);
+        dp_vs_synproxy_auto_count(svc, true);
+    }
+
+    if (svc && (dp_vs_synproxy_svc_on(svc) ||
+                dp_vs_connlimit_synproxy(&svc->climit, af, &iph->saddr))) {
         /* if service's weight is zero (non-active realserver),
          * do noting and drop the packet */
         if (svc->weight == 0) {
@@ -700,7 +990,9 @@ int dp_vs_synproxy_syn_rcv(int af, struct rte_mbuf *mbuf,
         }
 
         /* drop packet from blacklist */
-        if (dp_vs_blklst_lookup(iph->proto, &iph->daddr, th->dest, &iph->saddr)) {
+        if (dp_vs_blklst_deny(mbuf, iph->af, iph->proto, &iph->daddr, th->dest,
+                              &iph->saddr, ((uint8_t *)th)[13])) {
+            dp_vs_attack_inc(&svc->attack, DP_VS_ATTACK_BLKLST);
             goto syn_rcv_out;
         }
     } else {
@@ -723,6 +1015,15 @@ int dp_vs_synproxy_syn_rcv(int af, struct rte_mbuf *mbuf,
                 __func__, mbuf->port);
         goto syn_rcv_out;
     }
+
+    /* TCP Fast Open, the data copy is made before tx offload flags */
+    if (dp_vs_synproxy_ctrl_tfo) {
+        tfo_data = syn_proxy_tfo_rcv(af, mbuf, iph, svc, tfo_cookie,
+                                     &tfo_send_cookie, &tfo_acked,
+                                     &tfo_resend, &tfo_isn);
+        th = rte_pktmbuf_mtod_offset(mbuf, struct tcphdr *, iph->len);
+    }
+
     if (likely(dev && (dev->flag & NETIF_PORT_FLAG_TX_TCP_CSUM_OFFLOAD))) {
         if (af == AF_INET)
             mbuf->ol_flags |= (PKT_TX_TCP_CKSUM | PKT_TX_IP_CKSUM | PKT_TX_IPV4);
@@ -731,7 +1032,18 @@ int dp_vs_synproxy_syn_rcv(int af, struct rte_mbuf *mbuf,
     }
 
     /* reuse mbuf */
-    syn_proxy_reuse_mbuf(af, mbuf, th, &tcp_opt);
+    if (syn_proxy_reuse_mbuf(af, mbuf, th, &tcp_opt, tfo_acked,
+                             tfo_send_cookie ? tfo_cookie : NULL,
+                             tfo_resend ? &tfo_isn : NULL) != EDPVS_OK) {
+        if (tfo_data)
+            rte_pktmbuf_free(tfo_data);
+        goto syn_rcv_out;
+    }
+
+    /* no SYN-ACK acking data without a conn to deliver it */
+    if (tfo_data && syn_proxy_tfo_conn(af, tfo_data, iph, svc, &tcp_opt,
+                                       ntohl(th->seq)) != EDPVS_OK)
+        goto syn_rcv_out;
 
     /* set L2 header and send the packet out
      * It is noted that "ipv4_xmit" should not used here,
@@ -762,6 +1074,336 @@ syn_rcv_out:
     return 0;
 }
 
+/*
+ * Syn-proxy step 1, burst version: answer the bare SYNs to syn-proxy
+ * services in a burst just received, ahead of L2/L3 processing.
+ *
+ * only the plain cases are taken: untagged IPv4 without options or IPv6
+ * without extension headers, headers in the first segment, to this port's
+ * MAC, on a port without bonding, KNI forwarding or tc. all of these are
+ * checked first, then the blacklist is classified for the whole burst,
+ * then the SYN-ACKs are built in place and queued to the tx queue of the
+ * lcore together. anything else is left in @mbufs, in order, for the
+ * normal path, which also takes care of the corner cases of syn_rcv
+ * (zero weight services, connlimit's syn-proxy policy, stats).
+ *
+ * the packets taken skip ipv4/ipv6 stats, iftraf and inet hooks.
+ *
+ * @return the number of mbufs left, @nbytes is what the others took.
+ */
+#define SYN_BURST_MAX   NETIF_MAX_PKT_BURST
+
+struct syn_burst_pkt {
+    struct rte_mbuf         *mbuf;
+    struct netif_port       *dev;
+    int                     af;
+    uint16_t                iphlen;
+};
+
+/* af of a bare SYN @mbuf (at ether header) fit for the fast path, or 0 */
+static inline int syn_burst_parse(struct rte_mbuf *mbuf,
+                                  const struct netif_port *dev,
+                                  struct dp_vs_blklst_key *key,
+                                  uint16_t *iphlen)
+{
+    struct ether_hdr *eth = rte_pktmbuf_mtod(mbuf, struct ether_hdr *);
+    struct tcphdr *th;
+    uint32_t iplen;
+    int af, len;
+
+    if ((mbuf->ol_flags & PKT_RX_VLAN_STRIPPED) ||
+            !is_same_ether_addr(&eth->d_addr, &dev->addr))
+        return 0;
+
+    if (eth->ether_type == htons(ETHER_TYPE_IPv4)) {
+        struct ipv4_hdr *ip4h = (struct ipv4_hdr *)(eth + 1);
+
+        *iphlen = sizeof(struct ipv4_hdr);
+        if (mbuf->data_len < sizeof(*eth) + *iphlen + sizeof(*th) ||
+                ip4h->version_ihl != 0x45 ||
+                ip4h->next_proto_id != IPPROTO_TCP || ip4_is_frag(ip4h))
+            return 0;
+        if (!(dev->flag & NETIF_PORT_FLAG_RX_IP_CSUM_OFFLOAD) &&
+                rte_raw_cksum(ip4h, *iphlen) != 0xFFFF)
+            return 0;
+
+        af = AF_INET;
+        iplen = ntohs(ip4h->total_length);
+        key->vaddr.in.s_addr = ip4h->dst_addr;
+        key->saddr.in.s_addr = ip4h->src_addr;
+    } else if (eth->ether_type == htons(ETHER_TYPE_IPv6)) {
+        struct ip6_hdr *ip6h = (struct ip6_hdr *)(eth + 1);
+
+        *iphlen = sizeof(struct ip6_hdr);
+        if (mbuf->data_len < sizeof(*eth) + *iphlen + sizeof(*th) ||
+                ip6h->ip6_nxt != IPPROTO_TCP)
+            return 0;
+
+        af = AF_INET6;
+        iplen = ntohs(ip6h->ip6_plen) + *iphlen;
+        key->vaddr.in6 = ip6h->ip6_dst;
+        key->saddr.in6 = ip6h->ip6_src;
+    } else {
+        return 0;
+    }
+
+    /* SYN without ACK, RST or FIN, options in the first segment */
+    th = (struct tcphdr *)((char *)(eth + 1) + *iphlen);
+    if ((((uint8_t *)th)[13] & 0x17) != 0x02 || th->doff < 5 ||
+            iplen < *iphlen + (th->doff << 2) ||
+            iplen > mbuf->pkt_len - sizeof(*eth) ||
+            mbuf->data_len < sizeof(*eth) + *iphlen + (th->doff << 2))
+        return 0;
+
+    /* TFO cookies and data are for syn_rcv */
+    if (dp_vs_synproxy_ctrl_tfo &&
+            (iplen > *iphlen + (th->doff << 2) || syn_proxy_tfo_opt(th, &len)))
+        return 0;
+
+    key->proto = IPPROTO_TCP;
+    key->vport = th->dest;
+    key->tcp_flags = ((uint8_t *)th)[13];
+    return af;
+}
+
+/* reply @p with a SYN-ACK built in place, ready for the tx queue */
+static inline int syn_burst_reply(struct syn_burst_pkt *p)
+{
+    struct rte_mbuf *mbuf = p->mbuf;
+    struct dp_vs_synproxy_opt tcp_opt;
+    struct ether_addr ethaddr;
+    struct ether_hdr *eth;
+    struct tcphdr *th;
+    uint32_t iplen;
+
+    rte_pktmbuf_adj(mbuf, sizeof(struct ether_hdr));
+    mbuf->l2_len = sizeof(struct ether_hdr);
+
+    /* trim L2 padding, as ipv4_rcv/ipv6_rcv do */
+    if (p->af == AF_INET6)
+        iplen = ntohs(ip6_hdr(mbuf)->ip6_plen) + sizeof(struct ip6_hdr);
+    else
+        iplen = ntohs(ip4_hdr(mbuf)->total_length);
+    if (mbuf->pkt_len > iplen &&
+            rte_pktmbuf_trim(mbuf, mbuf->pkt_len - iplen) != 0)
+        return EDPVS_INVPKT;
+
+    if (likely(p->dev->flag & NETIF_PORT_FLAG_TX_TCP_CSUM_OFFLOAD)) {
+        if (p->af == AF_INET)
+            mbuf->ol_flags |= (PKT_TX_TCP_CKSUM | PKT_TX_IP_CKSUM | PKT_TX_IPV4);
+        else
+            mbuf->ol_flags |= (PKT_TX_TCP_CKSUM | PKT_TX_IPV6);
+    }
+
+    th = rte_pktmbuf_mtod_offset(mbuf, struct tcphdr *, p->iphlen);
+    if (syn_proxy_reuse_mbuf(p->af, mbuf, th, &tcp_opt, 0, NULL, NULL) != EDPVS_OK)
+        return EDPVS_INVPKT;
+
+    eth = (struct ether_hdr *)rte_pktmbuf_prepend(mbuf, mbuf->l2_len);
+    if (unlikely(!eth))
+        return EDPVS_NOROOM;
+    ether_addr_copy(&eth->s_addr, &ethaddr);
+    ether_addr_copy(&eth->d_addr, &eth->s_addr);
+    ether_addr_copy(&ethaddr, &eth->d_addr);
+
+    return EDPVS_OK;
+}
+
+uint16_t dp_vs_synproxy_syn_burst(struct rte_mbuf **mbufs, uint16_t count,
+                                  uint32_t *nbytes)
+{
+    struct syn_burst_pkt syns[SYN_BURST_MAX];
+    struct dp_vs_blklst_key keys[SYN_BURST_MAX];
+    const struct dp_vs_blklst_key *kptr[SYN_BURST_MAX];
+    struct rte_mbuf *txs[SYN_BURST_MAX];
+    bool drop[SYN_BURST_MAX * 2];   /* second half for lookup results */
+    struct dp_vs_service *svc = NULL;
+    struct netif_port *dev, *txdev = NULL;
+    struct dp_vs_blklst_key *key;
+    lcoreid_t cid = rte_lcore_id();
+    uint16_t i, j, n = 0, left = 0, ntx = 0, iphlen;
+    int af, a;
+
+    *nbytes = 0;
+    if (likely(!dp_vs_synproxy_ctrl_syn_burst) || count > SYN_BURST_MAX)
+        return count;
+
+    for (i = 0; i < count; i++)
+        rte_prefetch0(rte_pktmbuf_mtod(mbufs[i], void *));
+
+    /* 1. pick the bare SYNs to syn-proxy services */
+    for (i = 0; i < count; i++) {
+        struct rte_mbuf *mbuf = mbufs[i];
+
+        key = &keys[n];
+        memset(key, 0, sizeof(*key));
+
+        dev = netif_port_get(mbuf->port);
+        if (unlikely(!dev) || dev->type != PORT_TYPE_GENERAL ||
+                (dev->flag & (NETIF_PORT_FLAG_FORWARD2KNI |
+                              NETIF_PORT_FLAG_TC_INGRESS |
+                              NETIF_PORT_FLAG_TC_EGRESS)) ||
+                !(af = syn_burst_parse(mbuf, dev, key, &iphlen)))
+            goto slow;
+
+        /* floods mostly aim at one service */
+        if (!svc || svc->af != af || svc->port != key->vport ||
+                !inet_addr_equal(af, &svc->addr, &key->vaddr))
+            svc = dp_vs_service_lookup(af, IPPROTO_TCP, &key->vaddr,
+                                       key->vport, 0, NULL, NULL, NULL, cid);
+        if (!svc || !dp_vs_synproxy_svc_on(svc) || !svc->weight)
+            goto slow;
+        dp_vs_attack_inc(&svc->attack, DP_VS_ATTACK_SYN);
+        dp_vs_synproxy_auto_count(svc, true);
+
+        syns[n].mbuf = mbuf;
+        syns[n].dev = dev;
+        syns[n].af = af;
+        syns[n].iphlen = iphlen;
+        *nbytes += mbuf->pkt_len;
+        n++;
+        continue;
+slow:
+        mbufs[left++] = mbuf;
+    }
+
+    if (!n)
+        return count;
+
+    /* 2. blacklist, the rx stage's verdict if it classified the SYN,
+     * the others for each family at once */
+    for (i = 0; i < n; i++)
+        drop[i] = !!(syns[i].mbuf->ol_flags & PKT_RX_BLKLST_DENY);
+    for (a = 0; a < 2; a++) {
+        af = a ? AF_INET6 : AF_INET;
+        for (i = 0, j = 0; i < n; i++) {
+            if (syns[i].af == af && !(syns[i].mbuf->ol_flags &
+                        (PKT_RX_BLKLST_PASS | PKT_RX_BLKLST_DENY)))
+                kptr[j++] = &keys[i];
+        }
+        if (!j)
+            continue;
+        dp_vs_blklst_lookup_burst(af, kptr, &drop[n], j);
+        for (i = 0, j = 0; i < n; i++) {
+            if (syns[i].af == af && !(syns[i].mbuf->ol_flags &
+                        (PKT_RX_BLKLST_PASS | PKT_RX_BLKLST_DENY)))
+                drop[i] = drop[n + j++];
+        }
+    }
+
+    /* 3. SYN-ACKs in place, 4. to the tx queue, a run per port */
+    for (i = 0; i < n; i++) {
+        if (drop[i] || syn_burst_reply(&syns[i]) != EDPVS_OK) {
+            rte_pktmbuf_free(syns[i].mbuf);
+            continue;
+        }
+        dp_vs_estats_inc(SYNPROXY_SYN_CNT);
+
+        if (txdev && txdev != syns[i].dev) {
+            netif_hard_xmit_burst(txs, ntx, txdev);
+            ntx = 0;
+        }
+        txdev = syns[i].dev;
+        txs[ntx++] = syns[i].mbuf;
+    }
+    if (ntx)
+        netif_hard_xmit_burst(txs, ntx, txdev);
+
+    return left;
+}
+
+/* Answer the client's SYN or ACK with a RST, reusing the mbuf.
+ * Options and payload are dropped, checksums computed in software.
+ * @verdict is INET_STOLEN if sent, INET_DROP otherwise. */
+void dp_vs_synproxy_send_rst(int af, struct rte_mbuf *mbuf,
+        const struct dp_vs_iphdr *iph, int *verdict)
+{
+    int ret;
+    uint32_t seglen;
+    uint16_t tmpport;
+    struct tcphdr *th;
+    struct netif_port *dev;
+    struct ether_hdr *eth;
+    struct ether_addr ethaddr;
+
+    *verdict = INET_DROP;
+
+    if (mbuf->l2_len != sizeof(struct ether_hdr))
+        return;
+    dev = netif_port_get(mbuf->port);
+    if (unlikely(!dev))
+        return;
+
+    if (mbuf_may_pull(mbuf, mbuf->pkt_len) != 0)
+        return;
+    th = rte_pktmbuf_mtod_offset(mbuf, struct tcphdr *, iph->len);
+
+    /* sequence space the segment takes, mbuf may have L2 padding */
+    if (AF_INET6 == af)
+        seglen = ntohs(ip6_hdr(mbuf)->ip6_plen) + sizeof(struct ip6_hdr);
+    else
+        seglen = ntohs(ip4_hdr(mbuf)->total_length);
+    seglen += th->syn + th->fin - iph->len - (th->doff << 2);
+    if (rte_pktmbuf_trim(mbuf, mbuf->pkt_len - iph->len
+                                 - sizeof(struct tcphdr)) != 0)
+        return;
+
+    if (th->ack) {
+        th->seq = th->ack_seq;
+        th->ack_seq = 0;
+        ((uint8_t *)th)[13] = 0x04; /* RST */
+    } else {
+        th->ack_seq = htonl(ntohl(th->seq) + seglen);
+        th->seq = 0;
+        ((uint8_t *)th)[13] = 0x14; /* RST|ACK */
+    }
+    th->doff = sizeof(struct tcphdr) >> 2;
+    th->window = 0;
+    th->urg_ptr = 0;
+    tmpport = th->dest;
+    th->dest = th->source;
+    th->source = tmpport;
+
+    mbuf->ol_flags &= ~(PKT_TX_TCP_CKSUM | PKT_TX_IP_CKSUM);
+    if (AF_INET6 == af) {
+        struct in6_addr tmpaddr;
+        struct ip6_hdr *ip6h = ip6_hdr(mbuf);
+
+        tmpaddr = ip6h->ip6_src;
+        ip6h->ip6_src = ip6h->ip6_dst;
+        ip6h->ip6_dst = tmpaddr;
+        ip6h->ip6_hlim = dp_vs_synproxy_ctrl_synack_ttl;
+        ip6h->ip6_plen = htons(iph->len + sizeof(struct tcphdr)
+                               - sizeof(struct ip6_hdr));
+        tcp6_send_csum((struct ipv6_hdr *)ip6h, th);
+    } else {
+        uint32_t tmpaddr;
+        struct iphdr *ip4h = (struct iphdr *)ip4_hdr(mbuf);
+
+        tmpaddr = ip4h->saddr;
+        ip4h->saddr = ip4h->daddr;
+        ip4h->daddr = tmpaddr;
+        ip4h->ttl = dp_vs_synproxy_ctrl_synack_ttl;
+        ip4h->tos = 0;
+        ip4h->tot_len = htons(iph->len + sizeof(struct tcphdr));
+        tcp4_send_csum((struct ipv4_hdr *)ip4h, th);
+        ip4_send_csum((struct ipv4_hdr *)ip4h);
+    }
+
+    eth = (struct ether_hdr *)rte_pktmbuf_prepend(mbuf, mbuf->l2_len);
+    if (unlikely(!eth))
+        return;
+    memcpy(&ethaddr, &eth->s_addr, sizeof(struct ether_addr));
+    memcpy(&eth->s_addr, &eth->d_addr, sizeof(struct ether_addr));
+    memcpy(&eth->d_addr, &ethaddr, sizeof(struct ether_addr));
+
+    /* netif_xmit consumes the mbuf anyway */
+    if (unlikely(EDPVS_OK != (ret = netif_xmit(mbuf, dev))))
+        RTE_LOG(ERR, IPVS, "%s: netif_xmit failed -- %s\n",
+                __func__, dpvs_strerror(ret));
+    *verdict = INET_STOLEN;
+}
+
 /* Check if mbuf has user data */
 static inline int syn_proxy_ack_has_data(struct rte_mbuf *mbuf,
         const struct dp_vs_iphdr *iph, struct tcphdr *th)
@@ -924,9 +1566,9 @@ static int syn_proxy_send_rs_syn(int af, const struct tcphdr *th,
         }
 
         syn_mbuf_cloned->userdata = NULL;
-        cp->syn_mbuf = syn_mbuf_cloned;
+        cp->ext->syn_mbuf = syn_mbuf_cloned;
         sp_dbg_stats32_inc(sp_syn_saved);
-        rte_atomic32_set(&cp->syn_retry_max, dp_vs_synproxy_ctrl_syn_retry);
+        rte_atomic32_set(&cp->ext->syn_retry_max, dp_vs_synproxy_ctrl_syn_retry);
     }
 
     /* TODO: Save info for fast_response_xmit */
@@ -976,6 +1618,7 @@ int dp_vs_synproxy_ack_rcv(int af, struct rte_mbuf *mbuf,
         if (!res_cookie_check) {
             /* Update statistics */
             dp_vs_estats_inc(SYNPROXY_BAD_ACK);
+            dp_vs_attack_inc(&svc->attack, DP_VS_ATTACK_BAD_COOKIE);
             /* Cookie check failed, drop the packet */
             RTE_LOG(DEBUG, IPVS, "%s: syn_cookie check failed seq=%u\n", __func__,
                     ntohl(th->ack_seq) - 1);
@@ -985,6 +1628,28 @@ int dp_vs_synproxy_ack_rcv(int af, struct rte_mbuf *mbuf,
 
         /* Update statistics */
         dp_vs_estats_inc(SYNPROXY_OK_ACK);
+        dp_vs_attack_inc(&svc->attack, DP_VS_ATTACK_ESTAB);
+        dp_vs_synproxy_auto_count(svc, false);
+
+        /* the cookie proves the source, only now it pays a token, and
+         * its refusals may go to the NICs */
+        if (!dp_vs_connlimit_rate_check(&svc->climit, af, &iph->saddr)) {
+            dp_vs_hwdrop_count(af, &iph->saddr, &iph->daddr);
+            *verdict = INET_DROP;
+            return 0;
+        }
+
+        /* the syn-proxy policy only makes the client prove its source,
+         * the cap holds all the same. the handshake is done, so a client
+         * refused after it is told with a RST */
+        if (!dp_vs_connlimit_conn_check(&svc->climit, af, &iph->saddr)) {
+            dp_vs_hwdrop_count(af, &iph->saddr, &iph->daddr);
+            if (svc->climit.policy != DPVS_CONNLIMIT_DROP)
+                dp_vs_synproxy_send_rst(af, mbuf, iph, verdict);
+            else
+                *verdict = INET_DROP;
+            return 0;
+        }
 
         /* Let the virtual server select a real server for the incoming connetion,
          * and create a connection entry */
@@ -1245,20 +1910,20 @@ int dp_vs_synproxy_synack_rcv(struct rte_mbuf *mbuf, struct dp_vs_conn *cp,
         /* TODO: ip_vs_synproxy_save_fast_xmit_info ? */
 
         /* Free stored syn mbuf, no need for retransmition any more */
-        if (cp->syn_mbuf) {
-            rte_pktmbuf_free(cp->syn_mbuf);
-            cp->syn_mbuf = NULL;
+        if (cp->ext->syn_mbuf) {
+            rte_pktmbuf_free(cp->ext->syn_mbuf);
+            cp->ext->syn_mbuf = NULL;
             sp_dbg_stats32_dec(sp_syn_saved);
         }
 
-        if (list_empty(&cp->ack_mbuf)) {
+        if (list_empty(&cp->ext->ack_mbuf)) {
             /*
              * FIXME: Maybe a bug here, print err msg and go.
              * Attention: cp->state has been changed and we
              * should still DROP the syn/ack mbuf.
              */
             RTE_LOG(ERR, IPVS, "%s: got ack_mbuf NULL pointer: ack-saved = %u\n",
-                    __func__, cp->ack_num);
+                    __func__, cp->ext->ack_num);
             *verdict = INET_DROP;
             return 0;
         }
@@ -1269,15 +1934,15 @@ int dp_vs_synproxy_synack_rcv(struct rte_mbuf *mbuf, struct dp_vs_conn *cp,
          * The probe will be forward to RS and RS will respond a window update.
          * So DPVS has no need to send a window update.
          */
-        if (cp->ack_num == 1)
+        if (cp->ext->ack_num == 1)
             syn_proxy_send_window_update(tuplehash_out(cp).af, mbuf, cp, pp, th);
 
-        list_for_each_entry_safe(tmbuf, tmbuf2, &cp->ack_mbuf, list) {
+        list_for_each_entry_safe(tmbuf, tmbuf2, &cp->ext->ack_mbuf, list) {
             list_del_init(&tmbuf->list);
-            cp->ack_num--;
+            cp->ext->ack_num--;
             list_add_tail(&tmbuf->list, &save_mbuf);
         }
-        assert(cp->ack_num == 0);
+        assert(cp->ext->ack_num == 0);
 
         list_for_each_entry_safe(tmbuf, tmbuf2, &save_mbuf, list) {
             list_del_init(&tmbuf->list);
@@ -1288,6 +1953,10 @@ int dp_vs_synproxy_synack_rcv(struct rte_mbuf *mbuf, struct dp_vs_conn *cp,
             sp_dbg_stats32_dec(sp_ack_saved);
         }
 
+        /* the conn skipped the state transition of dp_vs_in(), and was
+         * not synced while holding mbufs, it's complete from now on */
+        dp_vs_sync_conn(cp, DP_VS_SYNC_CONN_CREATE);
+
         *verdict = INET_DROP;
         return 0;
     } else if ((th->rst) &&
@@ -1316,32 +1985,32 @@ static inline int __syn_proxy_reuse_conn(struct dp_vs_conn *cp,
     struct dp_vs_synproxy_ack_pakcet *tmbuf, *tmbuf2;
 
     /* Free stored ack packet */
-    list_for_each_entry_safe(tmbuf, tmbuf2, &cp->ack_mbuf, list) {
+    list_for_each_entry_safe(tmbuf, tmbuf2, &cp->ext->ack_mbuf, list) {
         list_del_init(&tmbuf->list);
-        cp->ack_num--;
+        cp->ext->ack_num--;
         rte_pktmbuf_free(tmbuf->mbuf);
         sp_dbg_stats32_dec(sp_ack_saved);
         rte_mempool_put(this_ack_mbufpool, tmbuf) ;
     }
-    assert(cp->ack_num == 0);
+    assert(cp->ext->ack_num == 0);
 
     /* Free stored syn mbuf */
-    if (cp->syn_mbuf) {
-        rte_pktmbuf_free(cp->syn_mbuf);
+    if (cp->ext->syn_mbuf) {
+        rte_pktmbuf_free(cp->ext->syn_mbuf);
         sp_dbg_stats32_dec(sp_syn_saved);
-        cp->syn_mbuf = NULL;
+        cp->ext->syn_mbuf = NULL;
     }
 
     /* Store new ack_mbuf */
-    assert(list_empty(&cp->ack_mbuf));
-    INIT_LIST_HEAD(&cp->ack_mbuf);
+    assert(list_empty(&cp->ext->ack_mbuf));
+    INIT_LIST_HEAD(&cp->ext->ack_mbuf);
 
     if (unlikely(rte_mempool_get(this_ack_mbufpool, (void **)&tmbuf) != 0))
         return EDPVS_NOMEM;
     tmbuf->mbuf = ack_mbuf;
-    list_add_tail(&tmbuf->list, &cp->ack_mbuf);
+    list_add_tail(&tmbuf->list, &cp->ext->ack_mbuf);
     sp_dbg_stats32_inc(sp_ack_saved);
-    cp->ack_num++;
+    cp->ext->ack_num++;
 
     /* Save ack_seq - 1 */
     cp->syn_proxy_seq.isn = htonl((uint32_t)((ntohl(th->ack_seq) - 1)));
@@ -1353,7 +2022,7 @@ static inline int __syn_proxy_reuse_conn(struct dp_vs_conn *cp,
     cp->fnat_seq.isn = 0;
 
     /* Clean duplicated ack count */
-    rte_atomic32_set(&cp->dup_ack_cnt, 0);
+    rte_atomic32_set(&cp->ext->dup_ack_cnt, 0);
 
     /* Set timeout value */
     cp->state = DPVS_TCP_S_SYN_SENT;
@@ -1461,22 +2130,25 @@ static int syn_proxy_is_ack_storm(struct tcphdr *tcph, struct dp_vs_conn *cp)
     if (unlikely(dp_vs_synproxy_ctrl_dup_ack_thresh == 0))
         return 1;
 
-    if(unlikely(tcph->seq == cp->last_seq &&
-                tcph->ack_seq == cp->last_ack_seq)) {
-        rte_atomic32_inc(&cp->dup_ack_cnt);
-        if (rte_atomic32_read(&cp->dup_ack_cnt) >= dp_vs_synproxy_ctrl_dup_ack_thresh) {
-            rte_atomic32_set(&cp->dup_ack_cnt, dp_vs_synproxy_ctrl_dup_ack_thresh);
+    if(unlikely(tcph->seq == cp->ext->last_seq &&
+                tcph->ack_seq == cp->ext->last_ack_seq)) {
+        rte_atomic32_inc(&cp->ext->dup_ack_cnt);
+        if (rte_atomic32_read(&cp->ext->dup_ack_cnt) >= dp_vs_synproxy_ctrl_dup_ack_thresh) {
+            rte_atomic32_set(&cp->ext->dup_ack_cnt, dp_vs_synproxy_ctrl_dup_ack_thresh);
             /* Update statisitcs */
             dp_vs_estats_inc(SYNPROXY_ACK_STORM);
+            if (cp->dest && cp->dest->svc)
+                dp_vs_attack_inc(&cp->dest->svc->attack,
+                                 DP_VS_ATTACK_ACK_STORM);
             return 0;
         }
 
         return 1;
     }
 
-    cp->last_seq = tcph->seq;
-    cp->last_ack_seq = tcph->ack_seq;
-    rte_atomic32_set(&cp->dup_ack_cnt, 0);
+    cp->ext->last_seq = tcph->seq;
+    cp->ext->last_ack_seq = tcph->ack_seq;
+    rte_atomic32_set(&cp->ext->dup_ack_cnt, 0);
 
     return 1;
 }
@@ -1530,7 +2202,7 @@ int dp_vs_synproxy_filter_ack(struct rte_mbuf *mbuf, struct dp_vs_conn *cp,
 
         /* the length of ack list should be limited to avoid pktpool resource drained
          * when we does not recieve rs's reply to our syn in no time */
-        if (dp_vs_synproxy_ctrl_max_ack_saved < cp->ack_num) {
+        if (dp_vs_synproxy_ctrl_max_ack_saved < cp->ext->ack_num) {
             dp_vs_estats_inc(SYNPROXY_SYNSEND_QLEN);
             sp_dbg_stats64_inc(sp_ack_refused);
             *verdict = INET_DROP;
@@ -1545,8 +2217,8 @@ int dp_vs_synproxy_filter_ack(struct rte_mbuf *mbuf, struct dp_vs_conn *cp,
         }
 
         ack_mbuf->mbuf = mbuf;
-        list_add_tail(&ack_mbuf->list, &cp->ack_mbuf);
-        cp->ack_num++;
+        list_add_tail(&ack_mbuf->list, &cp->ext->ack_mbuf);
+        cp->ext->ack_num++;
         sp_dbg_stats32_inc(sp_ack_saved);
 
         *verdict = INET_STOLEN;
@@ -1675,6 +2347,56 @@ static void max_ack_saved_handler(vector_t tokens)
     FREE_PTR(str);
 }
 
+static void tfo_handler(vector_t tokens)
+{
+    RTE_LOG(INFO, IPVS, "synproxy_tfo ON\n");
+    dp_vs_synproxy_ctrl_tfo = 1;
+}
+
+static void auto_uint_handler(vector_t tokens, const char *name,
+                              uint32_t *val, uint32_t def, uint32_t max)
+{
+    char *str = set_value(tokens);
+    long v;
+    assert(str);
+
+    v = atol(str);
+    if (v >= 0 && v <= max) {
+        RTE_LOG(INFO, IPVS, "synproxy_auto %s = %ld\n", name, v);
+        *val = v;
+    } else {
+        RTE_LOG(INFO, IPVS, "invalid synproxy_auto %s %s, using default %u\n",
+                name, str, def);
+        *val = def;
+    }
+
+    FREE_PTR(str);
+}
+
+static void auto_syn_rate_handler(vector_t tokens)
+{
+    auto_uint_handler(tokens, "syn_rate", &dp_vs_synproxy_auto_conf.syn_rate,
+                      DP_VS_SYNPROXY_AUTO_SYN_RATE_DEFAULT, 100000000);
+}
+
+static void auto_half_open_handler(vector_t tokens)
+{
+    auto_uint_handler(tokens, "half_open", &dp_vs_synproxy_auto_conf.half_open,
+                      DP_VS_SYNPROXY_AUTO_HALF_OPEN_DEFAULT, 100000000);
+}
+
+static void auto_cool_down_handler(vector_t tokens)
+{
+    auto_uint_handler(tokens, "cool_down", &dp_vs_synproxy_auto_conf.cool_down,
+                      DP_VS_SYNPROXY_AUTO_COOL_DOWN_DEFAULT, 86400);
+}
+
+static void syn_burst_handler(vector_t tokens)
+{
+    RTE_LOG(INFO, IPVS, "synproxy_syn_burst ON\n");
+    dp_vs_synproxy_ctrl_syn_burst = 1;
+}
+
 static void conn_reuse_handler(vector_t tokens)
 {
     RTE_LOG(INFO, IPVS, "synproxy_conn_reuse ON\n");
@@ -1731,6 +2453,11 @@ void synproxy_keyword_value_init(void)
     dp_vs_synproxy_ctrl_dup_ack_thresh = DP_VS_SYNPROXY_DUP_ACK_DEFAULT;
     dp_vs_synproxy_ctrl_max_ack_saved = DP_VS_SYNPROXY_MAX_ACK_SAVED_DEFAULT;
     dp_vs_synproxy_ctrl_syn_retry = DP_VS_SYNPROXY_SYN_RETRY_DEFAULT;
+    dp_vs_synproxy_ctrl_syn_burst = DP_VS_SYNPROXY_SYN_BURST_DEFAULT;
+    dp_vs_synproxy_ctrl_tfo = DP_VS_SYNPROXY_TFO_DEFAULT;
+    dp_vs_synproxy_auto_conf.syn_rate = DP_VS_SYNPROXY_AUTO_SYN_RATE_DEFAULT;
+    dp_vs_synproxy_auto_conf.half_open = DP_VS_SYNPROXY_AUTO_HALF_OPEN_DEFAULT;
+    dp_vs_synproxy_auto_conf.cool_down = DP_VS_SYNPROXY_AUTO_COOL_DOWN_DEFAULT;
 }
 
 void install_synproxy_keywords(void)
@@ -1752,6 +2479,15 @@ void install_synproxy_keywords(void)
     install_keyword("rs_syn_max_retry", rs_syn_max_retry_handler, KW_TYPE_NORMAL);
     install_keyword("ack_storm_thresh", ack_storm_thresh_handler, KW_TYPE_NORMAL);
     install_keyword("max_ack_saved", max_ack_saved_handler, KW_TYPE_NORMAL);
+    install_keyword("syn_burst", syn_burst_handler, KW_TYPE_NORMAL);
+    install_keyword("tfo", tfo_handler, KW_TYPE_NORMAL);
+
+    install_keyword("auto", NULL, KW_TYPE_NORMAL);
+    install_sublevel();
+    install_keyword("syn_rate", auto_syn_rate_handler, KW_TYPE_NORMAL);
+    install_keyword("half_open", auto_half_open_handler, KW_TYPE_NORMAL);
+    install_keyword("cool_down", auto_cool_down_handler, KW_TYPE_NORMAL);
+    install_sublevel_end();
 
     install_keyword("conn_reuse_state", conn_reuse_handler, KW_TYPE_NORMAL);
     install_sublevel();
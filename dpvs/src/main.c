@@ -37,6 +37,7 @@
 #include "route6.h"
 #include "iftraf.h"
 #include "scheduler.h"
+#include "startup.h"
 
 #define DPVS    "dpvs"
 #define RTE_LOGTYPE_DPVS RTE_LOGTYPE_USER1
@@ -184,7 +185,10 @@ int main(int argc, char *argv[])
         exit(EXIT_FAILURE);
     }
 
+    /* rte_eal_init() returns the number of args parsed on success */
+    dpvs_startup_stage_begin("eal");
     err = rte_eal_init(argc, argv);
+    dpvs_startup_stage_end(err < 0 ? err : 0);
     if (err < 0)
         rte_exit(EXIT_FAILURE, "Invalid EAL parameters\n");
 
@@ -199,62 +203,66 @@ int main(int argc, char *argv[])
         rte_exit(EXIT_FAILURE, "Fail to init dpdk pdump framework\n");
     }
 #endif
-    if ((err = dpvs_scheduler_init()) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("scheduler", dpvs_scheduler_init())) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init dpvs scheduler\n");
 
-    if ((err = global_data_init()) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("global_data", global_data_init())) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init global data\n");
 
-    if ((err = cfgfile_init()) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("cfgfile", cfgfile_init())) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init configuration file: %s\n",
                  dpvs_strerror(err));
 
-    if ((err = netif_virtual_devices_add()) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("virtual_devices", netif_virtual_devices_add())) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to add virtual devices:%s\n",
                  dpvs_strerror(err));
 
-    if ((err = dpvs_timer_init()) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("timer", dpvs_timer_init())) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init timer on %s\n", dpvs_strerror(err));
 
-    if ((err = tc_init()) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("tc", tc_init())) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init traffic control: %s\n",
                  dpvs_strerror(err));
 
-    if ((err = netif_init(NULL)) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("netif", netif_init(NULL))) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init netif: %s\n", dpvs_strerror(err));
     /* Default lcore conf and port conf are used and may be changed here
      * with "netif_port_conf_update" and "netif_lcore_conf_set" */
 
-    if ((err = ctrl_init()) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("ctrl", ctrl_init())) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init ctrl plane: %s\n",
                  dpvs_strerror(err));
 
-    if ((err = tc_ctrl_init()) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("tc_ctrl", tc_ctrl_init())) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init tc control plane: %s\n",
                  dpvs_strerror(err));
 
-    if ((err = vlan_init()) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("vlan", vlan_init())) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init vlan: %s\n", dpvs_strerror(err));
 
-    if ((err = inet_init()) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("inet", inet_init())) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init inet: %s\n", dpvs_strerror(err));
 
-    if ((err = sa_pool_init()) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("sa_pool", sa_pool_init())) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init sa_pool: %s\n", dpvs_strerror(err));
 
-    if ((err = ip_tunnel_init()) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("ip_tunnel", ip_tunnel_init())) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init tunnel: %s\n", dpvs_strerror(err));
 
-    if ((err = dp_vs_init()) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("ipvs", dp_vs_init())) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init ipvs: %s\n", dpvs_strerror(err));
 
-    if ((err = netif_ctrl_init()) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("netif_ctrl", netif_ctrl_init())) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init netif_ctrl: %s\n",
                  dpvs_strerror(err));
 
-    if ((err = iftraf_init()) != EDPVS_OK)
+    if ((err = DPVS_INIT_STAGE("iftraf", iftraf_init())) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init stats: %s\n", dpvs_strerror(err));
-    
+
+    if ((err = DPVS_INIT_STAGE("startup_ctrl", dpvs_startup_ctrl_init())) != EDPVS_OK)
+        rte_exit(EXIT_FAILURE, "Fail to init startup ctrl: %s\n",
+                 dpvs_strerror(err));
+
     /* config and start all available dpdk ports */
     nports = dpvs_rte_eth_dev_count();
     for (pid = 0; pid < nports; pid++) {
@@ -264,12 +272,14 @@ int main(int argc, char *argv[])
             continue;
         }
 
-        err = netif_port_start(dev);
+        err = DPVS_INIT_STAGE(dev->name, netif_port_start(dev));
         if (err != EDPVS_OK)
             RTE_LOG(WARNING, DPVS, "Start %s failed, skipping ...\n",
                     dev->name);
     }
 
+    dpvs_startup_dump();
+
     /* print port-queue-lcore relation */
     netif_print_lcore_conf(pql_conf_buf, &pql_conf_buf_len, true, 0);
     RTE_LOG(INFO, DPVS, "\nport-queue-lcore relation array: \n%s\n",
@@ -291,7 +301,15 @@ int main(int argc, char *argv[])
     dpvs_lcore_start(1);
 
 end:
+    /* wait for the slaves still holding the NIC queues */
+    dpvs_lcore_stop();
+    rte_eal_mp_wait_lcore();
+
+    /* from now on msgs skip the stopped slaves, terms act on master */
     dpvs_state_set(DPVS_STATE_FINISH);
+    if ((err = dpvs_startup_ctrl_term()) != EDPVS_OK)
+        RTE_LOG(ERR, DPVS, "Fail to term startup ctrl: %s\n",
+                dpvs_strerror(err));
     if ((err = iftraf_term()) !=0 )
         rte_exit(EXIT_FAILURE, "Fail to term iftraf: %s\n",
                 dpvs_strerror(err));
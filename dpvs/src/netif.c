@@ -43,6 +43,8 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <ipvs/redirect.h>
+#include <ipvs/synproxy.h>
+#include <ipvs/blklst.h>
 
 #define NETIF_PKTPOOL_NB_MBUF_DEF   65535
 #define NETIF_PKTPOOL_NB_MBUF_MIN   1023
@@ -2112,6 +2114,46 @@ int netif_hard_xmit(struct rte_mbuf *mbuf, struct netif_port *dev)
     return EDPVS_OK;
 }
 
+/*
+ * queue @count mbufs, ready to go out (no tc, no checks), to the tx queue
+ * of this slave lcore for @dev at once. for packets answered right from
+ * the rx burst.
+ */
+int netif_hard_xmit_burst(struct rte_mbuf **mbufs, uint16_t count,
+                          struct netif_port *dev)
+{
+    lcoreid_t cid = rte_lcore_id();
+    struct netif_queue_conf *txq;
+    int pid, qindex, i;
+
+    if (unlikely(!count))
+        return EDPVS_OK;
+
+    if ((dev->netif_ops && dev->netif_ops->op_xmit) ||
+            rte_get_master_lcore() == cid) {
+        for (i = 0; i < count; i++)
+            netif_hard_xmit(mbufs[i], dev);
+        return EDPVS_OK;
+    }
+
+    pid = dev->id;
+    qindex = (((uint32_t) mbufs[0]->buf_physaddr) >> 8) %
+        (lcore_conf[lcore2index[cid]].pqs[port2index[cid][pid]].ntxq);
+    txq = &lcore_conf[lcore2index[cid]].pqs[port2index[cid][pid]].txqs[qindex];
+
+    for (i = 0; i < count; i++) {
+        if (unlikely(txq->len == NETIF_MAX_PKT_BURST)) {
+            netif_tx_burst(cid, pid, qindex);
+            txq->len = 0;
+        }
+        mbufs[i]->port = pid;
+        lcore_stats[cid].obytes += mbufs[i]->pkt_len;
+        txq->mbufs[txq->len++] = mbufs[i];
+    }
+
+    return EDPVS_OK;
+}
+
 int netif_xmit(struct rte_mbuf *mbuf, struct netif_port *dev)
 {
     int ret = EDPVS_OK;
@@ -2281,9 +2323,24 @@ void lcore_process_packets(struct netif_queue_conf *qconf, struct rte_mbuf **mbu
                       lcoreid_t cid, uint16_t count, bool pkts_from_ring)
 {
     int i, t;
+    uint16_t left;
+    uint32_t nbytes;
     struct ether_hdr *eth_hdr;
     struct rte_mbuf *mbuf_copied = NULL;
 
+    if (!pkts_from_ring) {
+        /* blacklist verdicts of the burst, denied ones dropped with early_drop */
+        left = dp_vs_blklst_rx_burst(mbufs, count);
+        lcore_stats[cid].dropped += count - left;
+        count = left;
+
+        /* bare SYNs to syn-proxy services are answered right away */
+        left = dp_vs_synproxy_syn_burst(mbufs, count, &nbytes);
+        lcore_stats[cid].ipackets += count - left;
+        lcore_stats[cid].ibytes += nbytes;
+        count = left;
+    }
+
     /* prefetch packets */
     for (t = 0; t < count && t < NETIF_PKT_PREFETCH_OFFSET; t++)
         rte_prefetch0(rte_pktmbuf_mtod(mbufs[t], void *));
@@ -3005,10 +3062,76 @@ static int dpdk_set_fdir_filt(struct netif_port *dev, enum rte_filter_op op,
     return EDPVS_OK;
 }
 
+static inline int dpdk_flow_errno(int err)
+{
+    switch (err) {
+    case ENOSYS:
+    case ENOTSUP:
+        return EDPVS_NOTSUPP;
+    case ENOMEM:
+    case ENOSPC:
+        return EDPVS_NOROOM;
+    default:
+        return EDPVS_DPDKAPIFAIL;
+    }
+}
+
+static int dpdk_flow_create(struct netif_port *dev,
+                            const struct rte_flow_attr *attr,
+                            const struct rte_flow_item pattern[],
+                            const struct rte_flow_action actions[],
+                            struct rte_flow **flow)
+{
+    struct rte_flow_error error;
+    int ret;
+
+    memset(&error, 0, sizeof(error));
+    rte_rwlock_write_lock(&dev->dev_lock);
+    ret = rte_flow_validate(dev->id, attr, pattern, actions, &error);
+    if (!ret) {
+        *flow = rte_flow_create(dev->id, attr, pattern, actions, &error);
+        if (!*flow)
+            ret = rte_errno ? -rte_errno : -EINVAL;
+    }
+    rte_rwlock_write_unlock(&dev->dev_lock);
+    if (ret < 0) {
+        /* PMDs without rte_flow, callers are expected to fall back */
+        if (ret == -ENOSYS || ret == -ENOTSUP)
+            return EDPVS_NOTSUPP;
+        RTE_LOG(WARNING, NETIF, "%s: flow create failed for %s -- %s(%d)\n",
+                __func__, dev->name, error.message ? error.message :
+                rte_strerror(-ret), ret);
+        return dpdk_flow_errno(-ret);
+    }
+
+    return EDPVS_OK;
+}
+
+static int dpdk_flow_destroy(struct netif_port *dev, struct rte_flow *flow)
+{
+    struct rte_flow_error error;
+    int ret;
+
+    memset(&error, 0, sizeof(error));
+    rte_rwlock_write_lock(&dev->dev_lock);
+    ret = rte_flow_destroy(dev->id, flow, &error);
+    rte_rwlock_write_unlock(&dev->dev_lock);
+    if (ret < 0) {
+        RTE_LOG(WARNING, NETIF, "%s: flow destroy failed for %s -- %s(%d)\n",
+                __func__, dev->name, error.message ? error.message :
+                rte_strerror(-ret), ret);
+        return dpdk_flow_errno(-ret);
+    }
+
+    return EDPVS_OK;
+}
+
 static struct netif_ops dpdk_netif_ops = {
     .op_set_mc_list      = dpdk_set_mc_list,
     .op_set_fdir_filt    = dpdk_set_fdir_filt,
     .op_filter_supported = dpdk_filter_supported,
+    .op_flow_create      = dpdk_flow_create,
+    .op_flow_destroy     = dpdk_flow_destroy,
 };
 
 static struct netif_ops bond_netif_ops = {
@@ -3243,6 +3366,29 @@ int netif_fdir_filter_set(struct netif_port *port, enum rte_filter_op opcode,
     return port->netif_ops->op_set_fdir_filt(port, opcode, fdir_flt);
 }
 
+int netif_flow_create(struct netif_port *port, const struct rte_flow_attr *attr,
+                      const struct rte_flow_item pattern[],
+                      const struct rte_flow_action actions[],
+                      struct rte_flow **flow)
+{
+    assert(port && port->netif_ops && flow);
+
+    if (!port->netif_ops->op_flow_create)
+        return EDPVS_NOTSUPP;
+
+    return port->netif_ops->op_flow_create(port, attr, pattern, actions, flow);
+}
+
+int netif_flow_destroy(struct netif_port *port, struct rte_flow *flow)
+{
+    assert(port && port->netif_ops);
+
+    if (!port->netif_ops->op_flow_destroy)
+        return EDPVS_NOTSUPP;
+
+    return port->netif_ops->op_flow_destroy(port, flow);
+}
+
 int netif_port_conf_get(struct netif_port *port, struct rte_eth_conf *eth_conf)
 {
 
@@ -808,6 +808,71 @@ int sa_release(const struct netif_port *dev,
     return EDPVS_OK;
 }
 
+int sa_reserve(const struct netif_port *dev,
+               const struct sockaddr_storage *daddr,
+               const struct sockaddr_storage *saddr)
+{
+    struct inet_ifaddr *ifa;
+    struct sa_entry_pool *pool;
+    struct sa_entry *ent;
+    const struct sa_fdir *fdir = &sa_fdirs[rte_lcore_id()];
+    const union inet_addr *addr;
+    uint16_t port;
+    int af;
+
+    if (!saddr)
+        return EDPVS_INVAL;
+
+    if (daddr && saddr->ss_family != daddr->ss_family)
+        return EDPVS_INVAL;
+
+    af = saddr->ss_family;
+    if (AF_INET == af) {
+        const struct sockaddr_in *saddr4 = (const struct sockaddr_in *)saddr;
+        addr = (const union inet_addr *)&saddr4->sin_addr;
+        port = ntohs(saddr4->sin_port);
+    } else if (AF_INET6 == af) {
+        const struct sockaddr_in6 *saddr6 = (const struct sockaddr_in6 *)saddr;
+        addr = (const union inet_addr *)&saddr6->sin6_addr;
+        port = ntohs(saddr6->sin6_port);
+    } else {
+        return EDPVS_NOTSUPP;
+    }
+
+    ifa = inet_addr_ifa_get(af, dev, (union inet_addr *)addr);
+    if (!ifa)
+        return EDPVS_NOTEXIST;
+
+    if (!ifa->sa_pool) {
+        RTE_LOG(WARNING, SAPOOL, "%s: reserve addr on IP without pool.",
+                __func__);
+        inet_addr_ifa_put(ifa);
+        return EDPVS_INVAL;
+    }
+
+    if (port < ifa->sa_pool->low || port > ifa->sa_pool->high ||
+        (fdir->mask && (port & fdir->mask) != ntohs(fdir->port_base))) {
+        inet_addr_ifa_put(ifa);
+        return EDPVS_INVAL;
+    }
+
+    pool = sa_pool_hash(ifa->sa_pool, daddr);
+    ent = &pool->sa_entries[port];
+    if (ent->flags & SA_F_USED) {
+        inet_addr_ifa_put(ifa);
+        return EDPVS_EXIST;
+    }
+
+    ent->flags |= SA_F_USED;
+    list_move_tail(&ent->list, &pool->used_enties);
+    pool->used_cnt++;
+    pool->free_cnt--;
+    rte_atomic32_inc(&ifa->sa_pool->refcnt);
+
+    inet_addr_ifa_put(ifa);
+    return EDPVS_OK;
+}
+
 int get_sa_pool_stats(const struct inet_ifaddr *ifa, struct sa_pool_stats *stats)
 {
     int hash;
@@ -25,6 +25,9 @@
  */
 static struct list_head dpvs_lcore_jobs[LCORE_ROLE_MAX][LCORE_JOB_TYPE_MAX];
 
+/* set once by dpvs_lcore_stop(), lcores leave their loops at next round */
+static volatile bool dpvs_lcore_stopping = false;
+
 struct dpvs_role_str {
     dpvs_lcore_role_t role;
     const char *str;
@@ -189,7 +192,7 @@ static int dpvs_job_loop(void *arg)
         do_lcore_job(job);
     }
 
-    while (1) {
+    while (likely(!dpvs_lcore_stopping)) {
 #ifdef CONFIG_RECORD_BIG_LOOP
         loop_start = rte_get_timer_cycles();
 #endif
@@ -224,9 +227,18 @@ static int dpvs_job_loop(void *arg)
 #endif
     }
 
+    RTE_LOG(INFO, DSCHED, "lcore %02d leave %s loop\n", cid, dpvs_lcore_role_str(role));
     return EDPVS_OK;
 }
 
+/* make all lcores return from dpvs_lcore_start(), so that dpvs terminates
+ * through its normal cleanup path */
+void dpvs_lcore_stop(void)
+{
+    dpvs_lcore_stopping = true;
+    rte_wmb();
+}
+
 int dpvs_lcore_start(int is_master)
 {
     if (is_master)
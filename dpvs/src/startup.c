@@ -0,0 +1,191 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#include <time.h>
+#include <string.h>
+#include "dpdk.h"
+#include "ctrl.h"
+#include "startup.h"
+
+#define RTE_LOGTYPE_STARTUP     RTE_LOGTYPE_USER1
+
+#define STARTUP_MAX_DEPTH       4
+
+static struct dp_vs_startup_stage startup_stages[DPVS_STARTUP_MAX_STAGES];
+static uint32_t startup_nstages = 0;
+
+/* stack of open stages, index into startup_stages or -1 if dropped */
+static int startup_stack[STARTUP_MAX_DEPTH];
+static int startup_depth = 0;
+
+static uint64_t startup_base_us = 0;
+static uint64_t startup_end_us = 0;
+static int64_t  startup_base_mem = 0;
+static int64_t  startup_stack_mem[STARTUP_MAX_DEPTH];
+
+static inline uint64_t startup_clock_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* memzones are carved from the malloc heap, so the heap stats also cover
+ * mempools and rings. physmem size stays 0 until EAL maps hugepages. */
+static int64_t startup_heap_allocated(void)
+{
+    struct rte_malloc_socket_stats stats;
+    int64_t total = 0;
+    int socket;
+
+    if (!rte_eal_get_physmem_size())
+        return 0;
+
+    for (socket = 0; socket < RTE_MAX_NUMA_NODES; socket++) {
+        if (rte_malloc_get_socket_stats(socket, &stats) == 0)
+            total += stats.heap_allocsz_bytes;
+    }
+
+    return total;
+}
+
+void dpvs_startup_stage_begin(const char *name)
+{
+    struct dp_vs_startup_stage *stage;
+    uint64_t now = startup_clock_us();
+    int idx = -1;
+
+    if (!startup_base_us)
+        startup_base_us = now;
+
+    if (startup_depth >= STARTUP_MAX_DEPTH) {
+        startup_depth++;
+        return;
+    }
+
+    if (startup_nstages < DPVS_STARTUP_MAX_STAGES) {
+        idx = startup_nstages++;
+        stage = &startup_stages[idx];
+
+        memset(stage, 0, sizeof(*stage));
+        snprintf(stage->name, sizeof(stage->name), "%s", name);
+        stage->depth = startup_depth;
+        stage->start_us = now - startup_base_us;
+    }
+
+    startup_stack_mem[startup_depth] = startup_heap_allocated();
+    startup_stack[startup_depth++] = idx;
+}
+
+void dpvs_startup_stage_end(int err)
+{
+    struct dp_vs_startup_stage *stage;
+    uint64_t now = startup_clock_us();
+    int idx;
+
+    if (startup_depth <= 0)
+        return;
+
+    if (--startup_depth >= STARTUP_MAX_DEPTH)
+        return;
+
+    startup_end_us = now;
+
+    idx = startup_stack[startup_depth];
+    if (idx < 0)
+        return;
+
+    stage = &startup_stages[idx];
+    stage->err = err;
+    stage->cost_us = now - startup_base_us - stage->start_us;
+    stage->mem_bytes = startup_heap_allocated() - startup_stack_mem[startup_depth];
+
+    /* EAL itself is the first stage, nothing is measurable before it */
+    if (!startup_base_mem && !startup_depth)
+        startup_base_mem = startup_stack_mem[0];
+
+    RTE_LOG(INFO, STARTUP, "init stage %*s%-*s %8.3f ms %10ld KB%s\n",
+            stage->depth * 2, "", 20 - stage->depth * 2, stage->name,
+            stage->cost_us / 1000.0, stage->mem_bytes / 1024,
+            err ? " (failed)" : "");
+}
+
+void dpvs_startup_dump(void)
+{
+    struct dp_vs_startup_stage *stage;
+    uint32_t i;
+
+    RTE_LOG(INFO, STARTUP, "startup timeline: %u stages, %.3f ms, %ld KB\n",
+            startup_nstages, (startup_end_us - startup_base_us) / 1000.0,
+            (startup_heap_allocated() - startup_base_mem) / 1024);
+    RTE_LOG(INFO, STARTUP, "  %-24s %12s %12s %12s\n",
+            "stage", "start(ms)", "cost(ms)", "mem(KB)");
+
+    for (i = 0; i < startup_nstages; i++) {
+        stage = &startup_stages[i];
+        RTE_LOG(INFO, STARTUP, "  %*s%-*s %12.3f %12.3f %12ld\n",
+                stage->depth * 2, "", 24 - stage->depth * 2, stage->name,
+                stage->start_us / 1000.0, stage->cost_us / 1000.0,
+                stage->mem_bytes / 1024);
+    }
+}
+
+static int startup_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
+                               void **out, size_t *outsize)
+{
+    struct dp_vs_startup_timeline *timeline;
+    size_t len;
+
+    if (opt != SOCKOPT_GET_STARTUP_SHOW)
+        return EDPVS_NOTSUPP;
+
+    len = sizeof(*timeline) + startup_nstages * sizeof(struct dp_vs_startup_stage);
+    timeline = rte_zmalloc("startup_timeline", len, 0);
+    if (!timeline)
+        return EDPVS_NOMEM;
+
+    timeline->total_us = startup_end_us - startup_base_us;
+    timeline->total_mem_bytes = startup_heap_allocated() - startup_base_mem;
+    timeline->nstages = startup_nstages;
+    memcpy(timeline->stages, startup_stages,
+           startup_nstages * sizeof(struct dp_vs_startup_stage));
+
+    *out = timeline;
+    *outsize = len;
+    return EDPVS_OK;
+}
+
+static struct dpvs_sockopts startup_sockopts = {
+    .version        = SOCKOPT_VERSION,
+    .set_opt_min    = 0,
+    .set_opt_max    = 0,
+    .set            = NULL,
+    .get_opt_min    = SOCKOPT_GET_STARTUP_SHOW,
+    .get_opt_max    = SOCKOPT_GET_STARTUP_SHOW,
+    .get            = startup_sockopt_get,
+};
+
+int dpvs_startup_ctrl_init(void)
+{
+    return sockopt_register(&startup_sockopts);
+}
+
+int dpvs_startup_ctrl_term(void)
+{
+    return sockopt_unregister(&startup_sockopts);
+}
@@ -350,8 +350,9 @@ static int timer_init_schedler(struct timer_scheduler *sched, lcoreid_t cid)
     for (l = 0; l < LEVEL_DEPTH; l++) {
         sched->cursors[l] = 0;
 
-        sched->hashs[l] = rte_malloc(NULL,
-                                     sizeof(struct list_head) * LEVEL_SIZE, 0);
+        sched->hashs[l] = rte_malloc_socket(NULL,
+                                     sizeof(struct list_head) * LEVEL_SIZE, 0,
+                                     rte_lcore_to_socket_id(cid));
         if (!sched->hashs[l]) {
             RTE_LOG(ERR, DTIMER, "[%02d] no memory.\n", cid);
             timer_sched_unlock(sched);
@@ -419,21 +420,25 @@ static int timer_lcore_term(void *arg)
 int dpvs_timer_init(void)
 {
     lcoreid_t cid;
-    int err;
+    int err, ret;
 
-    /* per-lcore timer */
+    /* per-lcore timer, each wheel (LEVEL_SIZE * LEVEL_DEPTH list heads) is
+     * allocated and initialized by its own lcore on its own socket. */
     rte_eal_mp_remote_launch(timer_lcore_init, NULL, SKIP_MASTER);
+
+    /* global timer, built by master while slaves are busy */
+    ret = timer_init_schedler(&g_timer_sched, rte_get_master_lcore());
+
     RTE_LCORE_FOREACH_SLAVE(cid) {
         err = rte_eal_wait_lcore(cid);
         if (err < 0) {
             RTE_LOG(ERR, DTIMER, "%s: lcore %d: %s.\n",
                     __func__, cid, dpvs_strerror(err));
-            return err;
+            ret = err;
         }
     }
 
-    /* global timer */
-    return timer_init_schedler(&g_timer_sched, rte_get_master_lcore());
+    return ret;
 }
 
 int dpvs_timer_term(void)
@@ -0,0 +1,276 @@
+/*
+ * compile time and classification rate of the blklst ACL, with a large
+ * set of random source prefixes spread over a few services, classifying
+ * one key at a time (as dp_vs_blklst_lookup) and in bursts. the rules
+ * are compiled by dp_vs_blklst_acl_build() of ip_vs_blklst.c itself,
+ * what it needs of the rest of dpvs is stubbed below.
+ *
+ * build: make -C .. acl_bench RTE_SDK=...
+ * usage: acl_bench [EAL args] -- [-r rules] [-s services] [-n million keys]
+ *                  [-6] [-a]
+ *   e.g. acl_bench --no-huge -l 0 -m 512 -- -r 100000
+ *
+ * prefixes are /8 to /32 (/32 to /128 with -6), the first rule of every
+ * service is an allow rule when -a is given, making it a whitelist.
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <rte_acl.h>
+#include "dpdk.h"
+#include "inet.h"
+#include "ctrl.h"
+#include "scheduler.h"
+#include "parser/parser.h"
+#include "ipvs/blklst.h"
+#include "ipvs/hwdrop.h"
+
+#define NKEYS           (1 << 16)
+#define MAX_BURST       64
+
+/* what ip_vs_blklst.c takes from the rest of dpvs, never reached here */
+uint64_t g_cycles_per_sec;
+uint32_t dp_vs_hwdrop_rate;
+
+void __dp_vs_hwdrop_count(int af, const union inet_addr *saddr,
+                          const union inet_addr *vaddr)
+{
+}
+
+int dpvs_log(uint32_t level, uint32_t logtype, const char *func, int line,
+             const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    rte_vlog(level, logtype, format, ap);
+    va_end(ap);
+    return 0;
+}
+
+bool inet_addr_equal(int af, const union inet_addr *a1,
+                     const union inet_addr *a2)
+{
+    return false;
+}
+
+int inet_plen_to_mask(int af, uint8_t plen, union inet_addr *mask)
+{
+    return EDPVS_NOTSUPP;
+}
+
+int inet_addr_net(int af, const union inet_addr *addr,
+                  const union inet_addr *mask, union inet_addr *net)
+{
+    return EDPVS_NOTSUPP;
+}
+
+void install_keyword(char *str, keyword_callback_t handler,
+                     keyword_type_t type)
+{
+}
+
+void *set_value(vector_t tokens)
+{
+    return NULL;
+}
+
+struct dpvs_msg *msg_make(msgid_t type, uint32_t seq, msg_mode_t mode,
+                          lcoreid_t cid, uint32_t len, const void *data)
+{
+    return NULL;
+}
+
+int msg_destroy(struct dpvs_msg **pmsg)
+{
+    return EDPVS_OK;
+}
+
+int multicast_msg_send(struct dpvs_msg *msg, uint32_t flags,
+                       struct dpvs_multicast_queue **reply)
+{
+    return EDPVS_NOTSUPP;
+}
+
+int msg_type_mc_register(const struct dpvs_msg_type *msg_type)
+{
+    return EDPVS_OK;
+}
+
+int sockopt_register(struct dpvs_sockopts *sockopts)
+{
+    return EDPVS_OK;
+}
+
+int sockopt_unregister(struct dpvs_sockopts *sockopts)
+{
+    return EDPVS_OK;
+}
+
+int dpvs_lcore_job_register(struct dpvs_lcore_job *lcore_job,
+                            dpvs_lcore_role_t role)
+{
+    return EDPVS_OK;
+}
+
+int dpvs_lcore_job_unregister(struct dpvs_lcore_job *lcore_job,
+                              dpvs_lcore_role_t role)
+{
+    return EDPVS_OK;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void rand_addr(int af, union inet_addr *addr)
+{
+    int i;
+
+    if (af == AF_INET6) {
+        for (i = 0; i < 4; i++)
+            addr->in6.s6_addr32[i] = random();
+        /* 2000::/3 */
+        addr->in6.s6_addr[0] = 0x20 | (addr->in6.s6_addr[0] & 0x1f);
+    } else {
+        addr->in.s_addr = random();
+    }
+}
+
+static void vip_addr(int af, int idx, union inet_addr *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    if (af == AF_INET6) {
+        addr->in6.s6_addr[0] = 0x24;
+        addr->in6.s6_addr[1] = 0x0e;
+        addr->in6.s6_addr[15] = idx + 1;
+    } else {
+        addr->in.s_addr = htonl(0x0a000001 + idx);
+    }
+}
+
+static void bench(struct rte_acl_ctx *ctx, const struct dp_vs_blklst_key *keys,
+                  long n, unsigned int burst)
+{
+    const uint8_t *data[MAX_BURST];
+    uint32_t res[MAX_BURST];
+    long i, hit = 0;
+    unsigned int j;
+    double t0, t1;
+
+    t0 = now();
+    for (i = 0; i < n; i += burst) {
+        for (j = 0; j < burst; j++)
+            data[j] = (const uint8_t *)&keys[(i + j) % NKEYS];
+        rte_acl_classify(ctx, data, res, burst, 1);
+        for (j = 0; j < burst; j++)
+            hit += res[j] != 0;
+    }
+    t1 = now();
+
+    printf("burst %-3u %7.2f Mpps  %5.1f ns/key  (%ld matched)\n", burst,
+           n / (t1 - t0) / 1e6, (t1 - t0) * 1e9 / n, hit);
+}
+
+int main(int argc, char *argv[])
+{
+    struct dp_vs_blklst_conf *rules;
+    struct dp_vs_blklst_key *keys;
+    struct rte_acl_ctx *ctx;
+    int nrules = 100000, nsvcs = 16, af = AF_INET;
+    bool allow = false;
+    long n = 10 * 1000000;
+    int i, err, opt;
+    uint8_t maxlen;
+    double t0, t1;
+
+    err = rte_eal_init(argc, argv);
+    if (err < 0) {
+        fprintf(stderr, "rte_eal_init failed\n");
+        return 1;
+    }
+    argc -= err;
+    argv += err;
+
+    while ((opt = getopt(argc, argv, "r:s:n:6a")) != -1) {
+        switch (opt) {
+        case 'r':
+            nrules = atoi(optarg);
+            break;
+        case 's':
+            nsvcs = atoi(optarg);
+            break;
+        case 'n':
+            n = atol(optarg) * 1000000;
+            break;
+        case '6':
+            af = AF_INET6;
+            break;
+        case 'a':
+            allow = true;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [EAL args] -- [-r rules] [-s services] "
+                    "[-n million keys] [-6] [-a]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (nrules < 1 || nsvcs < 1 || nsvcs > 250 || n < MAX_BURST)
+        return 1;
+    maxlen = af == AF_INET6 ? 128 : 32;
+
+    rules = calloc(nrules, sizeof(*rules));
+    keys = calloc(NKEYS, sizeof(*keys));
+    if (!rules || !keys)
+        return 1;
+
+    srandom(time(NULL));
+    for (i = 0; i < nrules; i++) {
+        rules[i].af = af;
+        rules[i].proto = IPPROTO_TCP;
+        vip_addr(af, i % nsvcs, &rules[i].vaddr);
+        rules[i].vport = htons(80);
+        rand_addr(af, &rules[i].blklst);
+        rules[i].plen = 8 + random() % (maxlen - 7);
+        rules[i].action = (allow && i < nsvcs) ?
+                          DPVS_BLKLST_ALLOW : DPVS_BLKLST_DENY;
+    }
+
+    /* half of the keys come from listed prefixes */
+    for (i = 0; i < NKEYS; i++) {
+        keys[i].proto = IPPROTO_TCP;
+        vip_addr(af, i % nsvcs, &keys[i].vaddr);
+        keys[i].vport = htons(80);
+        if (i & 1)
+            keys[i].saddr = rules[random() % nrules].blklst;
+        else
+            rand_addr(af, &keys[i].saddr);
+    }
+
+    t0 = now();
+    ctx = dp_vs_blklst_acl_build(af, "acl_bench", rules, nrules);
+    t1 = now();
+    if (!ctx) {
+        fprintf(stderr, "fail to build the ACL\n");
+        return 1;
+    }
+    printf("%d %s rules over %d services built in %.3f s\n",
+           nrules, af == AF_INET6 ? "IPv6" : "IPv4", nsvcs, t1 - t0);
+
+    bench(ctx, keys, n, 1);
+    bench(ctx, keys, n, 8);
+    bench(ctx, keys, n, 32);
+    bench(ctx, keys, n, 64);
+
+    rte_acl_free(ctx);
+    free(rules);
+    free(keys);
+    return 0;
+}
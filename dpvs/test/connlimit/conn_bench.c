@@ -0,0 +1,297 @@
+/*
+ * the per-client connection table of ip_vs_connlimit.c at scale: clients
+ * open connections spread over lcores (as RSS would), the check sums a
+ * client's slots over all lcores, and connections are closed again in
+ * random order. the bench links ip_vs_connlimit.c itself, what it needs
+ * of the rest of dpvs is stubbed below; lcores are simulated on one
+ * thread by switching the lcore id.
+ *
+ * build: make -C .. conn_bench RTE_SDK=...
+ * usage: conn_bench [EAL args] -- [-c million clients] [-k conns per client]
+ *                   [-l lcores] [-s slots per lcore] [-m cap]
+ *   e.g. conn_bench --no-huge -l 0 -m 1024 -- -c 10 -l 8 -s 2097152
+ *
+ * reports the rate of hold/check/put, how many connections went
+ * uncounted because their bucket was full, and how many clients under
+ * the cap are refused anyway (clients of a bucket sharing a tag).
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "dpdk.h"
+#include "global_data.h"
+#include "netif.h"
+#include "ctrl.h"
+#include "parser/parser.h"
+#include "ipvs/service.h"
+#include "ipvs/conn.h"
+#include "ipvs/connlimit.h"
+
+struct conn {
+    uint32_t    client;
+    uint8_t     lcore;
+    uint32_t    slot;
+    uint32_t    tag;        /* 0 if uncounted */
+};
+
+static int nlcores = 4;
+static const char *tbl_size;
+static keyword_callback_t tbl_size_handler;
+
+/* what ip_vs_connlimit.c takes from the rest of dpvs */
+int g_lcore_index[DPVS_MAX_LCORE];
+
+void netif_get_slave_lcores(uint8_t *nb, uint64_t *mask)
+{
+    *nb = nlcores;
+    *mask = ((1UL << nlcores) - 1) << 1;
+}
+
+void install_keyword(char *str, keyword_callback_t handler,
+                     keyword_type_t type)
+{
+    if (!strcmp(str, "connlimit_table_size"))
+        tbl_size_handler = handler;
+}
+
+void *set_value(vector_t tokens)
+{
+    char *str = rte_malloc(NULL, strlen(tbl_size) + 1, 0);
+
+    if (str)
+        strcpy(str, tbl_size);
+    return str;
+}
+
+int dpvs_log(uint32_t level, uint32_t logtype, const char *func, int line,
+             const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    rte_vlog(level, logtype, format, ap);
+    va_end(ap);
+    return 0;
+}
+
+struct dpvs_msg *msg_make(msgid_t type, uint32_t seq, msg_mode_t mode,
+                          lcoreid_t cid, uint32_t len, const void *data)
+{
+    return NULL;
+}
+
+int msg_destroy(struct dpvs_msg **pmsg)
+{
+    return EDPVS_OK;
+}
+
+int multicast_msg_send(struct dpvs_msg *msg, uint32_t flags,
+                       struct dpvs_multicast_queue **reply)
+{
+    return EDPVS_NOTSUPP;
+}
+
+void *msg_reply_alloc(int size)
+{
+    return NULL;
+}
+
+int msg_type_mc_register(const struct dpvs_msg_type *msg_type)
+{
+    return EDPVS_OK;
+}
+
+int sockopt_register(struct dpvs_sockopts *sockopts)
+{
+    return EDPVS_OK;
+}
+
+int sockopt_unregister(struct dpvs_sockopts *sockopts)
+{
+    return EDPVS_OK;
+}
+
+struct dp_vs_service *
+dp_vs_get_service_lcore(const struct dp_vs_service_entry *entry, lcoreid_t cid)
+{
+    return NULL;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static inline void client_addr(union inet_addr *addr, uint32_t client)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->in.s_addr = client;
+}
+
+static inline void set_lcore(unsigned int cid)
+{
+    RTE_PER_LCORE(_lcore_id) = cid;
+}
+
+static void conn_hold(struct dp_vs_connlimit *cl, struct conn *c)
+{
+    struct dp_vs_conn conn;
+
+    conn.af = AF_INET;
+    client_addr(&conn.caddr, c->client);
+    conn.climit_tag = 0;
+
+    set_lcore(c->lcore);
+    dp_vs_connlimit_conn_hold(cl, &conn);
+    c->slot = conn.climit_slot;
+    c->tag = conn.climit_tag;
+}
+
+static void conn_put(struct conn *c)
+{
+    struct dp_vs_conn conn;
+
+    if (!c->tag)
+        return;
+    conn.climit_slot = c->slot;
+    conn.climit_tag = c->tag;
+
+    set_lcore(c->lcore);
+    dp_vs_connlimit_conn_put(&conn);
+    c->tag = 0;
+}
+
+int main(int argc, char *argv[])
+{
+    long nclients = 10 * 1000000, nconns, i, j, untracked = 0, refused = 0;
+    long size = 1 << 20;
+    int k = 1, cap = 0, opt, err;
+    struct dp_vs_connlimit cl;
+    struct conn *conns, tmp;
+    union inet_addr addr;
+    char size_str[32];
+    double t0, t1;
+
+    err = rte_eal_init(argc, argv);
+    if (err < 0) {
+        fprintf(stderr, "rte_eal_init failed\n");
+        return 1;
+    }
+    argc -= err;
+    argv += err;
+
+    while ((opt = getopt(argc, argv, "c:k:l:s:m:")) != -1) {
+        switch (opt) {
+        case 'c':
+            nclients = atof(optarg) * 1000000;
+            break;
+        case 'k':
+            k = atoi(optarg);
+            break;
+        case 'l':
+            nlcores = atoi(optarg);
+            break;
+        case 's':
+            size = atol(optarg);
+            break;
+        case 'm':
+            cap = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [EAL args] -- [-c million clients] "
+                    "[-k conns per client] [-l lcores] [-s slots per lcore] "
+                    "[-m cap]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (nclients < 1 || k < 1 || nlcores < 1 || nlcores >= DPVS_MAX_LCORE ||
+            size < 8 || size > INT32_MAX || (size & (size - 1)))
+        return 1;
+    if (!cap)
+        cap = k + 1;
+
+    /* the table is sized as dpvs.conf would */
+    install_connlimit_keywords();
+    snprintf(size_str, sizeof(size_str), "%ld", size);
+    tbl_size = size_str;
+    tbl_size_handler(NULL);
+
+    if (dp_vs_connlimit_init() != EDPVS_OK) {
+        fprintf(stderr, "dp_vs_connlimit_init failed, more EAL memory (-m)?\n");
+        return 1;
+    }
+
+    memset(&cl, 0, sizeof(cl));
+    cl.conns = cap;
+    cl.svc_hash = 0x5eed;
+
+    nconns = nclients * k;
+    conns = calloc(nconns, sizeof(*conns));
+    if (!conns)
+        return 1;
+
+    srandom(time(NULL));
+    for (i = 0; i < nconns; i++) {
+        conns[i].client = (uint32_t)(i / k) * 2654435761U;
+        conns[i].lcore = 1 + random() % nlcores;
+    }
+
+    printf("%ld clients x %d conns, %d lcores of %ld slots (%.1f MB each)\n",
+           nclients, k, nlcores, size, size * 8.0 / (1 << 20));
+
+    t0 = now();
+    for (i = 0; i < nconns; i++)
+        conn_hold(&cl, &conns[i]);
+    t1 = now();
+    printf("hold   %7.2f Mops  %5.1f ns\n", nconns / (t1 - t0) / 1e6,
+           (t1 - t0) * 1e9 / nconns);
+
+    for (i = 0; i < nconns; i++)
+        untracked += !conns[i].tag;
+
+    t0 = now();
+    for (i = 0; i < nclients; i++) {
+        client_addr(&addr, conns[i * k].client);
+        refused += !__dp_vs_connlimit_conn_check(&cl, AF_INET, &addr);
+    }
+    t1 = now();
+    printf("check  %7.2f Mops  %5.1f ns\n", nclients / (t1 - t0) / 1e6,
+           (t1 - t0) * 1e9 / nclients);
+    printf("uncounted %ld of %ld conns (%.3f%%), %ld clients refused under "
+           "cap %d\n", untracked, nconns, 100.0 * untracked / nconns,
+           refused, cap);
+
+    /* close in random order */
+    for (i = nconns - 1; i > 0; i--) {
+        j = random() % (i + 1);
+        tmp = conns[i];
+        conns[i] = conns[j];
+        conns[j] = tmp;
+    }
+    t0 = now();
+    for (i = 0; i < nconns; i++)
+        conn_put(&conns[i]);
+    t1 = now();
+    printf("put    %7.2f Mops  %5.1f ns\n", nconns / (t1 - t0) / 1e6,
+           (t1 - t0) * 1e9 / nconns);
+
+    /* every client is back to 0, under any cap */
+    cl.conns = 1;
+    for (i = 0; i < nclients; i++) {
+        client_addr(&addr, conns[i].client);
+        if (!__dp_vs_connlimit_conn_check(&cl, AF_INET, &addr)) {
+            fprintf(stderr, "client %08x not back to 0\n", conns[i].client);
+            return 1;
+        }
+    }
+
+    free(conns);
+    dp_vs_connlimit_term();
+    return 0;
+}
@@ -0,0 +1,234 @@
+/*
+ * the msg path of dpvs shutdown: main.c stops the slave lcores, waits for
+ * them, then runs the *_term() of every module, some of which still send
+ * msgs to the slaves (e.g. blklst_acl_swap() on each rule flushed with
+ * the services). the sim runs the real ctrl.c with the slaves looping on
+ * msg_slave_process() as in their job loop, stops them, then sends a
+ * blockable multicast and a unicast msg the way a term would: first with
+ * dpvs still NORMAL (the former behaviour, each msg waits for its timeout),
+ * then FINISH as main.c sets it after rte_eal_mp_wait_lcore().
+ *
+ * build: make -C .. shutdown_sim RTE_SDK=...
+ * usage: shutdown_sim [EAL args]
+ *   e.g. shutdown_sim -m 1100 --no-pci --lcores 0@0,1@0,2@0
+ *
+ * msg_pool needs hugepages, its larger elements do not fit in 4K pages.
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "dpdk.h"
+#include "global_data.h"
+#include "scheduler.h"
+#include "ctrl.h"
+#include "netif.h"
+#include "parser/parser.h"
+
+#define SIM_MC_TYPE     60
+#define SIM_UC_TYPE     61
+
+static volatile bool slaves_stop;
+static int master_calls;
+
+/* what ctrl.c takes from the rest of dpvs */
+void netif_get_slave_lcores(uint8_t *nb, uint64_t *mask)
+{
+    unsigned cid;
+
+    *nb = 0;
+    *mask = 0;
+    RTE_LCORE_FOREACH_SLAVE(cid) {
+        (*nb)++;
+        *mask |= 1UL << cid;
+    }
+}
+
+int netif_register_master_xmit_msg(void)
+{
+    return EDPVS_OK;
+}
+
+int dpvs_lcore_job_register(struct dpvs_lcore_job *lcore_job,
+                            dpvs_lcore_role_t role)
+{
+    return EDPVS_OK;
+}
+
+int dpvs_lcore_job_unregister(struct dpvs_lcore_job *lcore_job,
+                              dpvs_lcore_role_t role)
+{
+    return EDPVS_OK;
+}
+
+void install_keyword_root(char *str, keyword_callback_t handler)
+{
+}
+
+void install_keyword(char *str, keyword_callback_t handler,
+                     keyword_type_t type)
+{
+}
+
+void install_sublevel(void)
+{
+}
+
+void install_sublevel_end(void)
+{
+}
+
+void *set_value(vector_t tokens)
+{
+    return NULL;
+}
+
+int dpvs_log(uint32_t level, uint32_t logtype, const char *func, int line,
+             const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    rte_vlog(level, logtype, format, ap);
+    va_end(ap);
+    return 0;
+}
+
+static int sim_slave_cb(struct dpvs_msg *msg)
+{
+    return EDPVS_OK;
+}
+
+static int sim_master_cb(struct dpvs_multicast_queue *mcq)
+{
+    master_calls++;
+    return EDPVS_OK;
+}
+
+/* the msg job of a slave in dpvs_job_loop(), the sim shares one cpu */
+static int slave_loop(void *arg)
+{
+    while (!slaves_stop) {
+        msg_slave_process(0);
+        usleep(10);
+    }
+    return 0;
+}
+
+static int count_replies(struct dpvs_multicast_queue *mcq)
+{
+    struct dpvs_msg *cur;
+    int n = 0;
+
+    list_for_each_entry(cur, &mcq->mq, mq_node)
+        n++;
+    return n;
+}
+
+/* what a term does: one blockable multicast, one unicast per slave */
+static void send_msgs(const char *stage)
+{
+    struct dpvs_multicast_queue *mcq = NULL;
+    struct dpvs_msg *msg;
+    uint64_t start;
+    unsigned cid;
+    int err, calls = master_calls;
+
+    start = rte_get_timer_cycles();
+    msg = msg_make(SIM_MC_TYPE, 0, DPVS_MSG_MULTICAST, rte_lcore_id(), 0, NULL);
+    if (!msg)
+        return;
+    err = multicast_msg_send(msg, 0, &mcq);
+    printf("%-8s multicast: %-24s %d replies, master cb %s, %.1f us\n", stage,
+           dpvs_strerror(err), err == EDPVS_OK && mcq ? count_replies(mcq) : 0,
+           master_calls > calls ? "ran" : "skipped",
+           (rte_get_timer_cycles() - start) * 1e6 / g_cycles_per_sec);
+    msg_destroy(&msg);
+
+    RTE_LCORE_FOREACH_SLAVE(cid) {
+        start = rte_get_timer_cycles();
+        msg = msg_make(SIM_UC_TYPE, 0, DPVS_MSG_UNICAST, rte_lcore_id(), 0, NULL);
+        if (!msg)
+            return;
+        err = msg_send(msg, cid, 0, NULL);
+        printf("%-8s unicast to lcore %u: %-17s %.1f us\n", stage, cid,
+               dpvs_strerror(err),
+               (rte_get_timer_cycles() - start) * 1e6 / g_cycles_per_sec);
+        msg_destroy(&msg);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct dpvs_msg_type mt, uc_mt;
+    unsigned cid;
+    int err;
+
+    err = rte_eal_init(argc, argv);
+    if (err < 0) {
+        fprintf(stderr, "rte_eal_init failed\n");
+        return 1;
+    }
+    if (rte_lcore_count() < 2) {
+        fprintf(stderr, "at least one slave lcore is needed\n");
+        return 1;
+    }
+
+    dpvs_state_set(DPVS_STATE_INIT);
+    global_data_init();
+    control_keyword_value_init();
+    err = ctrl_init();
+    if (err != EDPVS_OK) {
+        fprintf(stderr, "ctrl_init: %s\n", dpvs_strerror(err));
+        return 1;
+    }
+
+    memset(&mt, 0, sizeof(mt));
+    mt.type = SIM_MC_TYPE;
+    mt.mode = DPVS_MSG_MULTICAST;
+    mt.prio = MSG_PRIO_LOW;
+    mt.unicast_msg_cb = sim_slave_cb;
+    mt.multicast_msg_cb = sim_master_cb;
+    err = msg_type_mc_register(&mt);
+    if (err != EDPVS_OK) {
+        fprintf(stderr, "msg_type_mc_register: %s\n", dpvs_strerror(err));
+        return 1;
+    }
+
+    memset(&uc_mt, 0, sizeof(uc_mt));
+    uc_mt.type = SIM_UC_TYPE;
+    uc_mt.mode = DPVS_MSG_UNICAST;
+    uc_mt.prio = MSG_PRIO_LOW;
+    uc_mt.unicast_msg_cb = sim_slave_cb;
+    RTE_LCORE_FOREACH_SLAVE(cid) {
+        uc_mt.cid = cid;
+        err = msg_type_register(&uc_mt);
+        if (err != EDPVS_OK) {
+            fprintf(stderr, "msg_type_register: %s\n", dpvs_strerror(err));
+            return 1;
+        }
+    }
+    dpvs_state_set(DPVS_STATE_NORMAL);
+
+    rte_eal_mp_remote_launch(slave_loop, NULL, SKIP_MASTER);
+    send_msgs("running");
+
+    /* end: of main.c */
+    slaves_stop = true;
+    rte_eal_mp_wait_lcore();
+
+    send_msgs("former");
+
+    dpvs_state_set(DPVS_STATE_FINISH);
+    send_msgs("finish");
+
+    msg_type_mc_unregister(&mt);
+    RTE_LCORE_FOREACH_SLAVE(cid) {
+        uc_mt.cid = cid;
+        msg_type_unregister(&uc_mt);
+    }
+    err = ctrl_term();
+    printf("ctrl_term: %s\n", dpvs_strerror(err));
+    return 0;
+}
@@ -0,0 +1,60 @@
+#!/bin/sh
+#
+# time loading VIPS x RSES rules into a running dpvs, batched through
+# ipvsadm-restore and replayed one ipvsadm call per line.
+#
+# usage: restore_bench.sh [VIPS] [RSES]
+#
+
+VIPS=${1:-1000}
+RSES=${2:-10}
+IPVSADM=${IPVSADM:-ipvsadm}
+RULES=/tmp/restore_bench.$$
+
+trap 'rm -f $RULES' EXIT
+
+gen_rules()
+{
+    v=0
+    while [ $v -lt $VIPS ]; do
+        vip=10.$((v / 65536 % 256)).$((v / 256 % 256)).$((v % 256))
+        echo "-A -t $vip:80 -s rr"
+        r=0
+        while [ $r -lt $RSES ]; do
+            echo "-a -t $vip:80 -r 192.168.$((r / 256 % 256)).$((r % 256 + 1)):8080 -b"
+            r=$((r + 1))
+        done
+        v=$((v + 1))
+    done
+}
+
+now_ms()
+{
+    echo $(($(date +%s%N) / 1000000))
+}
+
+report()
+{
+    ms=$(($3 - $2))
+    [ $ms -gt 0 ] || ms=1
+    printf "%-10s %8d ops %8d ms %10d ops/s\n" $1 $OPS $ms $((OPS * 1000 / ms))
+}
+
+gen_rules > $RULES
+OPS=$(wc -l < $RULES)
+
+$IPVSADM -C
+t0=$(now_ms)
+$IPVSADM -R < $RULES || exit 1
+t1=$(now_ms)
+report batched $t0 $t1
+
+$IPVSADM -C
+t0=$(now_ms)
+while read line; do
+    $IPVSADM $line || exit 1
+done < $RULES
+t1=$(now_ms)
+report per-line $t0 $t1
+
+$IPVSADM -C
@@ -0,0 +1,340 @@
+/*
+ * replay a flow trace through dpvs schedulers and report how even the
+ * backends are loaded in bytes/s per weight, and what a schedule costs.
+ *
+ * build: make -C .. sched_sim RTE_SDK=...
+ * usage: sched_sim [EAL args] -- [-n dests] [-w w1,w2,...] [-f trace] [sched ...]
+ *   e.g. sched_sim --no-huge -l 0 -- -w 1,1,2,2
+ *
+ * trace lines are "start_ms duration_ms kbps", sorted by start_ms. without
+ * a trace a synthetic one is generated: poisson arrivals, exponential
+ * durations and pareto rates, i.e. few elephants carrying most bytes.
+ * schedulers default to rr wrr wlc sed nq lbw.
+ *
+ * the sim links the schedulers and ip_vs_stats.c, rates are estimated by
+ * dp_vs_estimate() on simulated time instead of the lcore job.
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "dpdk.h"
+#include "scheduler.h"
+#include "ipvs/service.h"
+#include "ipvs/dest.h"
+#include "ipvs/sched.h"
+#include "ipvs/stats.h"
+#include "ipvs/conhash.h"
+
+#define TICK_MS         10
+#define EST_MS          (DP_VS_EST_INTERVAL * 1000)
+#define SAMPLE_MS       1000
+#define MAX_DESTS       64
+
+struct flow {
+    uint64_t            start_ms;
+    uint64_t            end_ms;
+    uint64_t            bytes_per_tick;
+    struct dp_vs_dest   *dest;
+};
+
+static struct flow *flows;
+static int nflows;
+
+static struct dp_vs_service svc;
+static struct dp_vs_dest dests[MAX_DESTS];
+static int ndests = 8;
+static int weights[MAX_DESTS];
+
+/* what the schedulers and ip_vs_stats.c take from the rest of dpvs,
+ * conhash needs libconhash and is left out */
+int dp_vs_conhash_init(void)
+{
+    return EDPVS_OK;
+}
+
+int dp_vs_conhash_term(void)
+{
+    return EDPVS_OK;
+}
+
+int dpvs_lcore_job_register(struct dpvs_lcore_job *lcore_job,
+                            dpvs_lcore_role_t role)
+{
+    return EDPVS_OK;
+}
+
+int dpvs_lcore_job_unregister(struct dpvs_lcore_job *lcore_job,
+                              dpvs_lcore_role_t role)
+{
+    return EDPVS_OK;
+}
+
+int dpvs_log(uint32_t level, uint32_t logtype, const char *func, int line,
+             const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    rte_vlog(level, logtype, format, ap);
+    va_end(ap);
+    return 0;
+}
+
+static int load_trace(const char *file)
+{
+    FILE *fp;
+    unsigned long start, dur, kbps;
+    int cap = 0;
+
+    fp = fopen(file, "r");
+    if (!fp) {
+        perror(file);
+        return -1;
+    }
+
+    while (fscanf(fp, "%lu %lu %lu", &start, &dur, &kbps) == 3) {
+        if (nflows == cap) {
+            cap = cap ? cap * 2 : 4096;
+            flows = realloc(flows, cap * sizeof(*flows));
+            if (!flows)
+                return -1;
+        }
+        flows[nflows].start_ms = start;
+        flows[nflows].end_ms = start + (dur ? dur : 1);
+        flows[nflows].bytes_per_tick = kbps * 1000 / 8 * TICK_MS / 1000;
+        nflows++;
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+/* 60s of 200 new flows/s, 5s mean duration, pareto(1.2) from 64kbps */
+static int gen_trace(void)
+{
+    double t = 0, u;
+    int i;
+
+    nflows = 12000;
+    flows = calloc(nflows, sizeof(*flows));
+    if (!flows)
+        return -1;
+
+    srandom(1);
+    for (i = 0; i < nflows; i++) {
+        u = (random() + 1.0) / ((double)RAND_MAX + 2.0);
+        t += -log(u) * 1000 / 200;
+        flows[i].start_ms = (uint64_t)t;
+
+        u = (random() + 1.0) / ((double)RAND_MAX + 2.0);
+        flows[i].end_ms = flows[i].start_ms + 1 + (uint64_t)(-log(u) * 5000);
+
+        u = (random() + 1.0) / ((double)RAND_MAX + 2.0);
+        flows[i].bytes_per_tick = (uint64_t)(64000 / pow(u, 1 / 1.2))
+                                  / 8 * TICK_MS / 1000;
+    }
+
+    return 0;
+}
+
+static void setup(struct dp_vs_scheduler *sched)
+{
+    int i;
+
+    memset(&svc, 0, sizeof(svc));
+    INIT_LIST_HEAD(&svc.dests);
+    svc.scheduler = sched;
+
+    for (i = 0; i < ndests; i++) {
+        memset(&dests[i], 0, sizeof(dests[i]));
+        dests[i].flags = DPVS_DEST_F_AVAILABLE;
+        rte_atomic16_set(&dests[i].weight, weights[i]);
+        dests[i].act_timestamp_weight = 1;
+        dests[i].inact_timestamp_weight = 1;
+        dests[i].svc = &svc;
+        list_add_tail(&dests[i].n_list, &svc.dests);
+        svc.num_dests++;
+    }
+
+    if (sched->init_service)
+        sched->init_service(&svc);
+}
+
+static void estimate(void)
+{
+    int i;
+
+    for (i = 0; i < ndests; i++)
+        dp_vs_estimate(&dests[i], EST_MS / 1000.0);
+}
+
+static void run(struct dp_vs_scheduler *sched)
+{
+    uint64_t now, sample_bytes[MAX_DESTS] = { 0 };
+    uint64_t cycles = 0, calls = 0, start, total;
+    double load, max, sum, imb, imb_sum = 0, imb_max = 0, wsum = 0;
+    int next = 0, nsamples = 0, active = 0, i, j;
+    struct flow **act;
+
+    act = calloc(nflows, sizeof(*act));
+    if (!act)
+        return;
+
+    setup(sched);
+    for (i = 0; i < ndests; i++)
+        wsum += weights[i];
+
+    for (now = 0; next < nflows || active; now += TICK_MS) {
+        /* arrivals */
+        while (next < nflows && flows[next].start_ms <= now) {
+            start = rte_rdtsc();
+            flows[next].dest = sched->schedule(&svc, NULL);
+            cycles += rte_rdtsc() - start;
+            calls++;
+
+            if (flows[next].dest) {
+                rte_atomic32_inc(&flows[next].dest->actconns);
+                flows[next].dest->stats.conns++;
+                act[active++] = &flows[next];
+            }
+            next++;
+        }
+
+        /* transfer and departures */
+        for (j = 0; j < active; ) {
+            struct dp_vs_dest *d = act[j]->dest;
+
+            if (act[j]->end_ms <= now) {
+                rte_atomic32_dec(&d->actconns);
+                act[j] = act[--active];
+                continue;
+            }
+            d->stats.outbytes += act[j]->bytes_per_tick;
+            d->stats.inbytes += act[j]->bytes_per_tick / 32;
+            j++;
+        }
+
+        if (now && now % EST_MS == 0)
+            estimate();
+
+        /* max / mean of bytes per weight over the last second,
+         * the drain after the last arrival is left out */
+        if (now && now % SAMPLE_MS == 0 && next < nflows) {
+            max = sum = 0;
+            for (i = 0; i < ndests; i++) {
+                load = (double)(dests[i].stats.outbytes - sample_bytes[i])
+                       / weights[i];
+                sample_bytes[i] = dests[i].stats.outbytes;
+                sum += load * weights[i];
+                if (load > max)
+                    max = load;
+            }
+            if (sum > 0) {
+                imb = max / (sum / wsum);
+                imb_sum += imb;
+                if (imb > imb_max)
+                    imb_max = imb;
+                nsamples++;
+            }
+        }
+    }
+
+    total = 0;
+    for (i = 0; i < ndests; i++)
+        total += dests[i].stats.outbytes;
+
+    printf("%-8s %10.3f %10.3f %12.1f  ", sched->name,
+           nsamples ? imb_sum / nsamples : 0, imb_max,
+           calls ? (double)cycles / calls : 0);
+    for (i = 0; i < ndests; i++)
+        printf(" %5.1f", total ? 100.0 * dests[i].stats.outbytes * wsum
+                                 / weights[i] / total : 0);
+    printf("\n");
+
+    if (sched->exit_service)
+        sched->exit_service(&svc);
+    free(act);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *def[] = { "rr", "wrr", "wlc", "sed", "nq", "lbw" };
+    const char *trace = NULL;
+    struct dp_vs_scheduler *sched;
+    char *tok;
+    int opt, i, nw = 0, err;
+
+    err = rte_eal_init(argc, argv);
+    if (err < 0) {
+        fprintf(stderr, "rte_eal_init failed\n");
+        return 1;
+    }
+    argc -= err;
+    argv += err;
+
+    while ((opt = getopt(argc, argv, "n:w:f:")) != -1) {
+        switch (opt) {
+        case 'n':
+            ndests = atoi(optarg);
+            break;
+        case 'w':
+            for (tok = strtok(optarg, ","); tok && nw < MAX_DESTS;
+                 tok = strtok(NULL, ","))
+                weights[nw++] = atoi(tok);
+            break;
+        case 'f':
+            trace = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n dests] [-w w1,w2,...] "
+                    "[-f trace] [sched ...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (ndests <= 0 || ndests > MAX_DESTS) {
+        fprintf(stderr, "1 to %d dests\n", MAX_DESTS);
+        return 1;
+    }
+    for (i = 0; i < ndests; i++) {
+        if (i >= nw)
+            weights[i] = nw ? weights[nw - 1] : 1;
+        if (weights[i] <= 0) {
+            fprintf(stderr, "weights must be positive\n");
+            return 1;
+        }
+    }
+
+    if ((trace ? load_trace(trace) : gen_trace()) != 0 || !nflows) {
+        fprintf(stderr, "no flows\n");
+        return 1;
+    }
+
+    dp_vs_sched_init();
+
+    printf("%d flows, %d dests\n", nflows, ndests);
+    printf("%-8s %10s %10s %12s   %s\n", "sched", "imb-avg", "imb-max",
+           "cycles/call", "bytes per weight, % of fair share");
+
+    if (optind == argc) {
+        argv = (char **)def;
+        argc = sizeof(def) / sizeof(def[0]);
+        optind = 0;
+    }
+
+    for (i = optind; i < argc; i++) {
+        sched = dp_vs_scheduler_get(argv[i]);
+        if (!sched) {
+            fprintf(stderr, "no scheduler %s\n", argv[i]);
+            continue;
+        }
+        run(sched);
+    }
+
+    dp_vs_sched_term();
+    free(flows);
+    return 0;
+}
@@ -0,0 +1,209 @@
+/*
+ * per-packet cost of the stats path, run on every lcore given to EAL at
+ * once: dp_vs_stats_in/out() of ip_vs_stats.c (plain counters, per-lcore
+ * globals on their own cache lines, dpvs_rand_range()) against the former
+ * counters, rebuilt here: rte_atomic64 conn counters, globals packed in
+ * one array and rand() for the dest limit.
+ *
+ * build: make -C .. stats_bench RTE_SDK=...
+ * usage: stats_bench [EAL args] -- [-n million packets per lcore] [-p limit%]
+ *   e.g. stats_bench -l 0-3 -- -n 50
+ *
+ * false sharing of the packed globals only shows with lcores on distinct
+ * cores; with one lcore the gap is the atomics and rand().
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "dpdk.h"
+#include "scheduler.h"
+#include "ipvs/conn.h"
+#include "ipvs/dest.h"
+#include "ipvs/stats.h"
+
+static long npkts = 20 * 1000000;
+static unsigned limit = 100;
+
+/* the former counters */
+struct old_conn_stats {
+    rte_atomic64_t      inpkts;
+    rte_atomic64_t      inbytes;
+    rte_atomic64_t      outpkts;
+    rte_atomic64_t      outbytes;
+};
+
+static struct dp_vs_stats old_stats[DPVS_MAX_LCORE];
+
+struct lcore_res {
+    double              old_ns;
+    double              new_ns;
+} __rte_cache_aligned;
+
+static struct lcore_res res[DPVS_MAX_LCORE];
+
+/* what ip_vs_stats.c takes from the rest of dpvs */
+int dpvs_lcore_job_register(struct dpvs_lcore_job *lcore_job,
+                            dpvs_lcore_role_t role)
+{
+    return EDPVS_OK;
+}
+
+int dpvs_lcore_job_unregister(struct dpvs_lcore_job *lcore_job,
+                              dpvs_lcore_role_t role)
+{
+    return EDPVS_OK;
+}
+
+int dpvs_log(uint32_t level, uint32_t logtype, const char *func, int line,
+             const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    rte_vlog(level, logtype, format, ap);
+    va_end(ap);
+    return 0;
+}
+
+static int old_stats_in(struct old_conn_stats *cs, struct dp_vs_dest *dest,
+                        struct rte_mbuf *mbuf)
+{
+    if (dest && (dest->flags & DPVS_DEST_F_AVAILABLE)) {
+        if ((dest->limit_proportion < 100) &&
+            (dest->limit_proportion > 0)) {
+            return (rand() % 100) > dest->limit_proportion
+                        ? EDPVS_OVERLOAD : EDPVS_OK;
+        }
+
+        dest->stats.inpkts++;
+        dest->stats.inbytes += mbuf->pkt_len;
+    }
+
+    rte_atomic64_inc(&cs->inpkts);
+    rte_atomic64_add(&cs->inbytes, mbuf->pkt_len);
+
+    old_stats[rte_lcore_id()].inpkts++;
+    old_stats[rte_lcore_id()].inbytes += mbuf->pkt_len;
+    return EDPVS_OK;
+}
+
+static int old_stats_out(struct old_conn_stats *cs, struct dp_vs_dest *dest,
+                         struct rte_mbuf *mbuf)
+{
+    if (dest && (dest->flags & DPVS_DEST_F_AVAILABLE)) {
+        if ((dest->limit_proportion < 100) &&
+            (dest->limit_proportion > 0)) {
+            return (rand() % 100) > dest->limit_proportion
+                        ? EDPVS_OVERLOAD : EDPVS_OK;
+        }
+
+        dest->stats.outpkts++;
+        dest->stats.outbytes += mbuf->pkt_len;
+    }
+
+    rte_atomic64_inc(&cs->outpkts);
+    rte_atomic64_add(&cs->outbytes, mbuf->pkt_len);
+
+    old_stats[rte_lcore_id()].outpkts++;
+    old_stats[rte_lcore_id()].outbytes += mbuf->pkt_len;
+    return EDPVS_OK;
+}
+
+/* each lcore has its own dest and conn, as in dpvs */
+static int bench_lcore(void *arg)
+{
+    struct dp_vs_dest *dest;
+    struct dp_vs_conn *conn;
+    struct old_conn_stats *cs;
+    struct rte_mbuf *mbuf;
+    uint64_t start;
+    long i, ok = 0;
+
+    dest = rte_zmalloc(NULL, sizeof(*dest), RTE_CACHE_LINE_SIZE);
+    conn = rte_zmalloc(NULL, sizeof(*conn), RTE_CACHE_LINE_SIZE);
+    cs = rte_zmalloc(NULL, sizeof(*cs), RTE_CACHE_LINE_SIZE);
+    mbuf = rte_zmalloc(NULL, sizeof(*mbuf), RTE_CACHE_LINE_SIZE);
+    if (!dest || !conn || !cs || !mbuf)
+        return -1;
+
+    dest->flags = DPVS_DEST_F_AVAILABLE;
+    dest->limit_proportion = limit;
+    conn->dest = dest;
+    mbuf->pkt_len = 800;
+
+    start = rte_rdtsc();
+    for (i = 0; i < npkts; i++) {
+        ok += old_stats_in(cs, dest, mbuf) == EDPVS_OK;
+        ok += old_stats_out(cs, dest, mbuf) == EDPVS_OK;
+    }
+    res[rte_lcore_id()].old_ns = (double)(rte_rdtsc() - start) * 1e9
+                                 / rte_get_tsc_hz() / (2 * npkts);
+
+    start = rte_rdtsc();
+    for (i = 0; i < npkts; i++) {
+        ok += dp_vs_stats_in(conn, mbuf) == EDPVS_OK;
+        ok += dp_vs_stats_out(conn, mbuf) == EDPVS_OK;
+    }
+    res[rte_lcore_id()].new_ns = (double)(rte_rdtsc() - start) * 1e9
+                                 / rte_get_tsc_hz() / (2 * npkts);
+
+    rte_free(dest);
+    rte_free(conn);
+    rte_free(cs);
+    rte_free(mbuf);
+    return ok > 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    double old_sum = 0, new_sum = 0;
+    unsigned cid, nlcores = 0;
+    int err, opt;
+
+    err = rte_eal_init(argc, argv);
+    if (err < 0) {
+        fprintf(stderr, "rte_eal_init failed\n");
+        return 1;
+    }
+    argc -= err;
+    argv += err;
+
+    while ((opt = getopt(argc, argv, "n:p:")) != -1) {
+        switch (opt) {
+        case 'n':
+            npkts = atol(optarg) * 1000000;
+            break;
+        case 'p':
+            limit = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [EAL args] -- [-n million packets] "
+                    "[-p limit%%]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (npkts <= 0)
+        return 1;
+
+    dp_vs_stats_init();
+
+    rte_eal_mp_remote_launch(bench_lcore, NULL, CALL_MASTER);
+    rte_eal_mp_wait_lcore();
+
+    printf("%-6s %12s %12s\n", "lcore", "former ns", "now ns");
+    RTE_LCORE_FOREACH(cid) {
+        printf("%-6u %12.2f %12.2f\n", cid, res[cid].old_ns, res[cid].new_ns);
+        old_sum += res[cid].old_ns;
+        new_sum += res[cid].new_ns;
+        nlcores++;
+    }
+    printf("%u lcores, limit %u%%: %.2f -> %.2f ns/packet, "
+           "%.1f -> %.1f Mpps per lcore\n", nlcores, limit,
+           old_sum / nlcores, new_sum / nlcores,
+           1e3 * nlcores / old_sum, 1e3 * nlcores / new_sum);
+
+    dp_vs_stats_term();
+    return 0;
+}
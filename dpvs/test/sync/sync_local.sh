@@ -0,0 +1,259 @@
+#!/bin/sh
+#
+# conn sync between two dpvs instances on this host, over net_tap ports.
+# each instance runs in its own net and mount namespace (pidfile, ctrl
+# socket and /etc/dpvs.conf are private) with two ports: dpdk0 for data,
+# dpdk1 for sync. dpdk1 of both are bridged, the sync datagrams go from
+# master's dpdk1.kni through both dpvs to backup's dpdk1.kni. only
+# master's dpdk0 is bridged to the client and RS namespaces, so the VIP
+# and laddr configured on both instances do not clash.
+#
+# for plain and synproxy services, the client opens NCONNS idle
+# connections through master, then backup must list them all ESTABLISHED,
+# and still after WAIT seconds, beyond the established timeout of 20s,
+# thanks to the periodic resync (every 5s here).
+#
+# needs root, rte_kni loaded, 2 cpus, 1G of free hugepages per instance,
+# python3 and nc.
+#
+# usage: sync_local.sh [NCONNS]
+#   DPVS, IPVSADM and DPIP default to the binaries in ../../bin
+#
+
+[ $(id -u) -eq 0 ] || { sed -n '3,21p' $0; exit 2; }
+
+BIN=$(cd $(dirname $0)/../../bin && pwd)
+DPVS=${DPVS:-$BIN/dpvs}
+IPVSADM=${IPVSADM:-$BIN/ipvsadm}
+DPIP=${DPIP:-$BIN/dpip}
+NCONNS=${1:-100}
+WAIT=${WAIT:-30}
+HOLD=$((WAIT + 60))
+TMP=$(mktemp -d /tmp/sync_local.XXXXXX)
+VIP=10.0.0.100
+LIP=10.0.0.101
+CLIENT=10.0.0.2
+RS=10.0.0.3
+PORT=80
+FAILED=0
+
+gen_conf()
+{
+    cat <<EOF
+global_defs {
+    log_level   INFO
+    log_file    $TMP/$1.log
+}
+
+netif_defs {
+    <init> pktpool_size     16383
+    <init> pktpool_cache    256
+
+    <init> device dpdk0 {
+        rx {
+            queue_number        1
+            descriptor_number   512
+        }
+        tx {
+            queue_number        1
+            descriptor_number   512
+        }
+        kni_name                dpdk0.kni
+    }
+
+    <init> device dpdk1 {
+        rx {
+            queue_number        1
+            descriptor_number   512
+        }
+        tx {
+            queue_number        1
+            descriptor_number   512
+        }
+        kni_name                dpdk1.kni
+    }
+}
+
+worker_defs {
+    <init> worker cpu0 {
+        type    master
+        cpu_id  0
+    }
+
+    <init> worker cpu1 {
+        type    slave
+        cpu_id  1
+        port    dpdk0 {
+            rx_queue_ids     0
+            tx_queue_ids     0
+        }
+        port    dpdk1 {
+            rx_queue_ids     0
+            tx_queue_ids     0
+        }
+    }
+}
+
+ipvs_defs {
+    conn {
+        <init> conn_pool_size       65536
+        <init> conn_pool_cache      256
+    }
+
+    tcp {
+        timeout {
+            established 20
+        }
+    }
+
+    sync {
+        resync_interval         5
+    }
+}
+EOF
+}
+
+# start instance $1 (m or b), its pid in $TMP/$1.pid
+start()
+{
+    gen_conf $1 > $TMP/$1.conf
+    # the bind mount needs a file to cover
+    [ -e /etc/dpvs.conf ] || : > /etc/dpvs.conf
+    ip netns add sync_$1 || exit 1
+    ip netns exec sync_$1 sh -c "
+        mount -t tmpfs none /var/run && mount --bind $TMP/$1.conf /etc/dpvs.conf &&
+        exec $DPVS -- -l 0-1 -n 4 --no-pci --file-prefix sync_$1 --socket-mem 1024 \
+            --vdev net_tap0,iface=sd_$1 --vdev net_tap1,iface=ss_$1" \
+        > $TMP/$1.out 2>&1 &
+    echo $! > $TMP/$1.pid
+
+    # the taps are created in the instance's namespace, wait for both
+    for i in $(seq 60); do
+        ip netns exec sync_$1 ip link show ss_$1 >/dev/null 2>&1 &&
+            ip netns exec sync_$1 ip link show dpdk1.kni >/dev/null 2>&1 && break
+        sleep 1
+    done
+    ip netns exec sync_$1 ip link set ss_$1 netns 1 || exit 1
+    ip link set ss_$1 master syncbr up
+    ip netns exec sync_$1 ip link set sd_$1 netns 1 || exit 1
+    [ $1 = m ] && ip link set sd_$1 master databr
+    ip link set sd_$1 up
+}
+
+# run in the namespaces of instance $1
+on()
+{
+    inst=$1
+    shift
+    nsenter -t $(cat $TMP/$inst.pid) -m -n "$@"
+}
+
+setup_net()
+{
+    ip link add syncbr type bridge && ip link set syncbr up || exit 1
+    ip link add databr type bridge && ip link set databr up || exit 1
+
+    for ns in c r; do
+        ip netns add sync_$ns
+        ip link add v_$ns type veth peer name eth0 netns sync_$ns
+        ip link set v_$ns master databr up
+        ip netns exec sync_$ns ip link set eth0 up
+        ip netns exec sync_$ns ip link set lo up
+    done
+    ip netns exec sync_c ip addr add $CLIENT/24 dev eth0
+    ip netns exec sync_r ip addr add $RS/24 dev eth0
+
+    start m
+    start b
+
+    n=1
+    for inst in m b; do
+        on $inst $DPIP addr add $VIP/32 dev dpdk0
+        on $inst $DPIP addr add $LIP/32 dev dpdk0 sapool
+        on $inst $DPIP route add 10.0.0.0/24 dev dpdk0
+        on $inst ip link set dpdk1.kni up
+        on $inst ip addr add 192.168.100.$n/24 dev dpdk1.kni
+        n=$((n + 1))
+    done
+
+    ip netns exec sync_r python3 -m http.server $PORT --bind $RS \
+        > /dev/null 2>&1 &
+}
+
+cleanup()
+{
+    ip netns pids sync_c 2>/dev/null | xargs -r kill
+    ip netns pids sync_r 2>/dev/null | xargs -r kill
+    for inst in m b; do
+        [ -f $TMP/$inst.pid ] && kill $(cat $TMP/$inst.pid)
+    done
+    sleep 5
+    for ns in c r m b; do
+        ip netns del sync_$ns 2>/dev/null
+    done
+    ip link del syncbr 2>/dev/null
+    ip link del databr 2>/dev/null
+    echo "logs in $TMP"
+}
+
+setup_svc()
+{
+    for inst in m b; do
+        on $inst $IPVSADM -C
+        on $inst $IPVSADM -A -t $VIP:$PORT -s rr $1 || exit 1
+        on $inst $IPVSADM -a -t $VIP:$PORT -r $RS:$PORT -b || exit 1
+        on $inst $IPVSADM -P -t $VIP:$PORT -z $LIP -F dpdk0 || exit 1
+    done
+    on m $IPVSADM --start-daemon master --mcast-interface dpdk1.kni || exit 1
+    on b $IPVSADM --start-daemon backup --mcast-interface dpdk1.kni || exit 1
+}
+
+stop_svc()
+{
+    ip netns pids sync_c | xargs -r kill
+    on m $IPVSADM --stop-daemon master
+    on b $IPVSADM --stop-daemon backup
+}
+
+established()
+{
+    on $1 $IPVSADM -lnc | grep "$VIP:$PORT" | grep -c ESTABLISHED
+}
+
+check()
+{
+    if [ $2 -ge $NCONNS ]; then
+        echo "PASS $1: $2/$NCONNS"
+    else
+        echo "FAIL $1: $2/$NCONNS"
+        FAILED=1
+    fi
+}
+
+run()
+{
+    name=$1
+    shift
+
+    setup_svc "$@"
+    ip netns exec sync_c sh -c \
+        "for i in \$(seq $NCONNS); do sleep $HOLD | nc $VIP $PORT >/dev/null & done"
+    sleep 3
+
+    check "$name master" $(established m)
+    check "$name backup" $(established b)
+
+    sleep $WAIT
+    check "$name backup after ${WAIT}s" $(established b)
+
+    stop_svc
+}
+
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+setup_net
+run plain
+run synproxy -j enable
+
+exit $FAILED
@@ -0,0 +1,98 @@
+#!/bin/sh
+#
+# conn sync between two dpvs instances, master and backup on two hosts
+# reached by ssh. both must run with the same lcores and laddrs, RS must
+# accept connections on PORT, CLIENT must reach VIP and have nc.
+# sync_local.sh runs the same checks with both instances on one host.
+#
+# for plain and synproxy services, CLIENT opens NCONNS idle connections
+# through master, then backup must list them all ESTABLISHED, and still
+# after WAIT seconds (longer than the established timeout) thanks to the
+# periodic resync.
+#
+# usage: sync_test.sh MASTER BACKUP CLIENT VIP PORT RS [NCONNS] [IFN]
+#
+
+[ $# -ge 6 ] || { sed -n '3,14p' $0; exit 2; }
+
+MASTER=$1
+BACKUP=$2
+CLIENT=$3
+VIP=$4
+PORT=$5
+RS=$6
+NCONNS=${7:-100}
+IFN=${8:-dpdk0.kni}
+WAIT=${WAIT:-120}
+SSH=${SSH:-ssh}
+IPVSADM=${IPVSADM:-ipvsadm}
+HOLD=$((WAIT + 60))
+FAILED=0
+
+on()
+{
+    host=$1
+    shift
+    $SSH $host "$@"
+}
+
+setup()
+{
+    for host in $MASTER $BACKUP; do
+        on $host $IPVSADM -C
+        on $host $IPVSADM -A -t $VIP:$PORT -s rr $1 || exit 1
+        on $host $IPVSADM -a -t $VIP:$PORT -r $RS:$PORT -b || exit 1
+    done
+    on $MASTER $IPVSADM --start-daemon master --mcast-interface $IFN || exit 1
+    on $BACKUP $IPVSADM --start-daemon backup --mcast-interface $IFN || exit 1
+}
+
+cleanup()
+{
+    on $CLIENT "pkill -f 'nc $VIP $PORT'" 2>/dev/null
+    on $MASTER $IPVSADM --stop-daemon master
+    on $BACKUP $IPVSADM --stop-daemon backup
+    for host in $MASTER $BACKUP; do
+        on $host $IPVSADM -C
+    done
+}
+
+established()
+{
+    on $1 $IPVSADM -lnc | grep "$VIP:$PORT" | grep -c ESTABLISHED
+}
+
+check()
+{
+    if [ $2 -ge $NCONNS ]; then
+        echo "PASS $1: $2/$NCONNS"
+    else
+        echo "FAIL $1: $2/$NCONNS"
+        FAILED=1
+    fi
+}
+
+run()
+{
+    name=$1
+    shift
+
+    setup "$@"
+    on $CLIENT "for i in \$(seq $NCONNS); do sleep $HOLD | nc $VIP $PORT >/dev/null & done"
+    sleep 3
+
+    check "$name master" $(established $MASTER)
+    check "$name backup" $(established $BACKUP)
+
+    sleep $WAIT
+    check "$name backup after ${WAIT}s" $(established $BACKUP)
+
+    cleanup
+}
+
+trap cleanup INT TERM
+
+run plain
+run synproxy -j enable
+
+exit $FAILED
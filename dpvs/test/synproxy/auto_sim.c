@@ -0,0 +1,127 @@
+/*
+ * adaptive syn-proxy ("ipvsadm -j auto") under a simulated SYN flood:
+ * lcores count the SYNs and completed handshakes of a service, report
+ * them to master once a second, and master switches syn-proxy with the
+ * detector of dp_vs_synproxy_auto_next() (include/ipvs/synproxy.h).
+ *
+ * the traffic is a steady load of legitimate clients, plus a flood of
+ * spoofed SYNs (no handshake) from second 30 to second 30 + flood length.
+ * the timeline of switches is printed, with the SYNs that got in while
+ * syn-proxy was off (reached the real servers as half-open conns) and
+ * the legitimate SYNs answered by syn-proxy.
+ *
+ * this checks the detector and its thresholds only, offline: packets
+ * never go through dpvs. a flood run over net_ring is not done here,
+ * since a net_ring port can only be fed from inside the dpvs process.
+ *
+ * build: make -C .. auto_sim RTE_SDK=...
+ * usage: auto_sim [-l lcores] [-b legit SYNs/s] [-f flood SYNs/s]
+ *                 [-d flood seconds] [-r syn_rate] [-o half_open]
+ *                 [-c cool_down]
+ *   e.g. auto_sim -f 20000 -r 0     (low rate flood, half-open only)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "ipvs/synproxy.h"
+
+#define FLOOD_START 30
+
+int main(int argc, char *argv[])
+{
+    struct dp_vs_synproxy_auto_conf conf = { 50000, 5000, 60 };
+    struct dp_vs_synproxy_auto master = { 0 }, lc[DPVS_MAX_LCORE] = {{ 0 }};
+    long legit = 2000, flood = 1000000, duration = 60;
+    long t, end, leaked = 0, proxied = 0, detect = -1, release = -1;
+    uint64_t stamp = 0, now;
+    int nlcores = 8, opt, i, ms;
+
+    while ((opt = getopt(argc, argv, "l:b:f:d:r:o:c:")) != -1) {
+        switch (opt) {
+        case 'l':
+            nlcores = atoi(optarg);
+            break;
+        case 'b':
+            legit = atol(optarg);
+            break;
+        case 'f':
+            flood = atol(optarg);
+            break;
+        case 'd':
+            duration = atol(optarg);
+            break;
+        case 'r':
+            conf.syn_rate = atol(optarg);
+            break;
+        case 'o':
+            conf.half_open = atol(optarg);
+            break;
+        case 'c':
+            conf.cool_down = atol(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-l lcores] [-b legit SYNs/s] "
+                    "[-f flood SYNs/s] [-d flood seconds] [-r syn_rate] "
+                    "[-o half_open] [-c cool_down]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (nlcores < 1 || nlcores > DPVS_MAX_LCORE || legit < 0 || flood < 0)
+        return 1;
+
+    printf("%d lcores, %ld legit SYNs/s, flood %ld SYNs/s for %lds; "
+           "syn_rate %u half_open %u cool_down %us\n", nlcores, legit, flood,
+           duration, conf.syn_rate, conf.half_open, conf.cool_down);
+
+    end = FLOOD_START + duration + conf.cool_down + 30;
+    for (t = 0; t < end; t++) {
+        bool flooding = t >= FLOOD_START && t < FLOOD_START + duration;
+
+        /* a second of traffic spread by RSS, in 10ms steps so that the
+         * lcores report at slightly different times, as they would */
+        for (ms = 0; ms < 1000; ms += 10) {
+            now = t * 1000 + ms;
+            for (i = 0; i < nlcores; i++) {
+                struct dp_vs_synproxy_auto *sa = &lc[i];
+                long syns = legit / 100 / nlcores;
+                long bad = flooding ? flood / 100 / nlcores : 0;
+
+                sa->syns += syns + bad;
+                sa->acks += syns;
+                if (master.active)
+                    proxied += syns;
+                else
+                    leaked += bad;
+
+                /* dp_vs_synproxy_auto_count(), the report is per lcore */
+                if (now - sa->stamp < 1000 + i)
+                    continue;
+                sa->stamp = now;
+
+                /* synproxy_auto_report_msg_cb() */
+                master.sum_syns += sa->syns;
+                master.sum_acks += sa->acks;
+                sa->syns = sa->acks = 0;
+                if (now - stamp < 1000)
+                    continue;
+                if (dp_vs_synproxy_auto_next(&conf, &master, now - stamp)) {
+                    printf("%6.2fs  syn-proxy %s\n", now / 1000.0,
+                           master.active ? "on" : "off");
+                    if (master.active && detect < 0)
+                        detect = now - FLOOD_START * 1000;
+                    if (!master.active && release < 0)
+                        release = now - (FLOOD_START + duration) * 1000;
+                }
+                stamp = now;
+            }
+        }
+    }
+
+    printf("switched on after %ldms of flood, off %ldms after it; "
+           "%u switch(es)\n", detect, release, master.switches);
+    printf("%ld flood SYNs got in while syn-proxy was off, "
+           "%ld legit SYNs answered by syn-proxy\n", leaked, proxied);
+    return master.active;
+}
@@ -0,0 +1,104 @@
+#!/bin/sh
+#
+# a retransmitted TCP Fast Open SYN to a syn-proxy service. dpvs must run
+# with tfo in its synproxy config, reached by ssh as DPVS; CLIENT must
+# reach VIP, run as root and have python3 with scapy.
+#
+# CLIENT gets a TFO cookie, then sends the same SYN with the cookie and
+# data twice. both SYN-ACKs must ack the data with the same seq, and dpvs
+# must list exactly one conn of the client's port. the kernel of CLIENT
+# is kept from resetting the raw connection meanwhile.
+#
+# usage: tfo_retrans_test.sh DPVS CLIENT VIP PORT RS
+#
+
+[ $# -ge 5 ] || { sed -n '3,13p' $0; exit 2; }
+
+DPVS=$1
+CLIENT=$2
+VIP=$3
+PORT=$4
+RS=$5
+SSH=${SSH:-ssh}
+IPVSADM=${IPVSADM:-ipvsadm}
+RSTRULE="OUTPUT -p tcp -d $VIP --dport $PORT --tcp-flags RST RST -j DROP"
+FAILED=0
+
+on()
+{
+    host=$1
+    shift
+    $SSH $host "$@"
+}
+
+cleanup()
+{
+    on $CLIENT iptables -D $RSTRULE 2>/dev/null
+    on $DPVS $IPVSADM -C
+}
+
+trap cleanup INT TERM
+
+on $DPVS $IPVSADM -C
+on $DPVS $IPVSADM -A -t $VIP:$PORT -s rr -j enable || exit 1
+on $DPVS $IPVSADM -a -t $VIP:$PORT -r $RS:$PORT -b || exit 1
+on $CLIENT iptables -I $RSTRULE || exit 1
+
+# prints "client:port" and exits 1 if the SYN-ACKs differ
+OUT=$(on $CLIENT python3 - $VIP $PORT <<'PY'
+import random, struct, sys
+from scapy.all import IP, TCP, Raw, sr1, conf
+
+conf.verb = 0
+vip, port = sys.argv[1], int(sys.argv[2])
+data = b"GET / HTTP/1.0\r\n\r\n"
+
+def tfo_cookie(pkt):
+    for kind, val in pkt[TCP].options:
+        if kind in ("TFO", 34):
+            return struct.pack("!II", *val) if isinstance(val, tuple) else val
+    return None
+
+def syn(sport, seq, cookie, payload=b""):
+    return IP(dst=vip) / TCP(sport=sport, dport=port, flags="S", seq=seq,
+                             options=[("MSS", 1460), (34, cookie)]) / payload
+
+req = sr1(syn(random.randint(20000, 40000), random.getrandbits(32), b""),
+          timeout=2)
+cookie = req and tfo_cookie(req)
+if not cookie:
+    print("no TFO cookie from %s:%d" % (vip, port))
+    sys.exit(1)
+
+sport, seq = random.randint(40001, 60000), random.getrandbits(32)
+acks = [sr1(syn(sport, seq, cookie, data), timeout=2) for i in range(2)]
+if not all(a and a[TCP].flags == "SA" for a in acks):
+    print("no SYN-ACK to the TFO SYN")
+    sys.exit(1)
+for a in acks:
+    if a[TCP].ack != (seq + 1 + len(data)) & 0xffffffff:
+        print("SYN-ACK does not ack the data: %d" % a[TCP].ack)
+        sys.exit(1)
+if acks[0][TCP].seq != acks[1][TCP].seq:
+    print("SYN-ACKs differ in seq: %d %d" % (acks[0][TCP].seq,
+                                             acks[1][TCP].seq))
+    sys.exit(1)
+print("%s:%d" % (acks[0][IP].dst, sport))
+PY
+)
+if [ $? -ne 0 ]; then
+    echo "FAIL handshake: $OUT"
+    FAILED=1
+else
+    sleep 1
+    NCONNS=$(on $DPVS $IPVSADM -lnc | grep -c " $OUT ")
+    if [ "$NCONNS" -eq 1 ]; then
+        echo "PASS one conn of $OUT"
+    else
+        echo "FAIL $NCONNS conns of $OUT"
+        FAILED=1
+    fi
+fi
+
+cleanup
+exit $FAILED
@@ -0,0 +1,114 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * flood.c - show the per-VIP ICMP/UDP flood budgets and their drops.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "conf/common.h"
+#include "dpip.h"
+#include "conf/flood.h"
+#include "sockopt.h"
+
+static const char *flood_type_names[DP_VS_FLOOD_MAX] = {
+    [DP_VS_FLOOD_ICMP_ECHO]     = "icmp_echo",
+    [DP_VS_FLOOD_ICMP_ERROR]    = "icmp_error",
+    [DP_VS_FLOOD_UDP_NEW]       = "udp_new",
+};
+
+static void flood_help(void)
+{
+    fprintf(stderr,
+            "Usage:\n"
+            "    dpip flood show\n"
+            "Rates and bursts are per VIP on every lcore, 0 rate for no limit;\n"
+            "counters are summed over lcores, packets of no limit uncounted.\n"
+            "VIPs hash to budget buckets, the buckets dropping the most are\n"
+            "listed by type with the VIP of their last drop.\n"
+           );
+}
+
+static void flood_vip_dump(const struct dp_vs_flood_vip *vip)
+{
+    char vaddr[64];
+
+    printf("%-12s %-40s %16lu\n",
+           vip->type < DP_VS_FLOOD_MAX ? flood_type_names[vip->type] : "unknown",
+           inet_ntop(vip->af, &vip->vaddr, vaddr, sizeof(vaddr)) ? vaddr : "::",
+           (unsigned long)vip->dropped);
+}
+
+static int flood_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
+                        struct dpip_conf *conf)
+{
+    struct dp_vs_flood_stats *stats;
+    size_t size;
+    uint32_t i;
+    int t, err;
+
+    if (conf->cmd != DPIP_CMD_SHOW)
+        return EDPVS_NOTSUPP;
+
+    err = dpvs_getsockopt(SOCKOPT_GET_FLOOD_STATS, NULL, 0,
+                          (void **)&stats, &size);
+    if (err != 0)
+        return err;
+
+    if (size < sizeof(*stats)
+            || size != sizeof(*stats) + \
+                       stats->nvips * sizeof(struct dp_vs_flood_vip)) {
+        fprintf(stderr, "corrupted response.\n");
+        dpvs_sockopt_msg_free(stats);
+        return EDPVS_INVAL;
+    }
+
+    printf("%-12s %10s %10s %16s %16s\n", "type", "rate", "burst",
+           "passed", "dropped");
+    for (t = 0; t < DP_VS_FLOOD_MAX; t++)
+        printf("%-12s %10u %10u %16lu %16lu\n", flood_type_names[t],
+               stats->rate[t], stats->burst[t],
+               (unsigned long)stats->passed[t],
+               (unsigned long)stats->dropped[t]);
+
+    if (stats->nvips) {
+        printf("\n%-12s %-40s %16s\n", "type", "vip", "dropped");
+        for (i = 0; i < stats->nvips; i++)
+            flood_vip_dump(&stats->vips[i]);
+    }
+
+    dpvs_sockopt_msg_free(stats);
+    return EDPVS_OK;
+}
+
+struct dpip_obj dpip_flood = {
+    .name   = "flood",
+    .help   = flood_help,
+    .do_cmd = flood_do_cmd,
+};
+
+static void __init flood_init(void)
+{
+    dpip_register_obj(&dpip_flood);
+}
+
+static void __exit flood_exit(void)
+{
+    dpip_unregister_obj(&dpip_flood);
+}
@@ -0,0 +1,116 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * hwdrop.c - show and flush the NIC drop rules of attack sources.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "conf/common.h"
+#include "dpip.h"
+#include "conf/hwdrop.h"
+#include "sockopt.h"
+
+static void hwdrop_help(void)
+{
+    fprintf(stderr,
+            "Usage:\n"
+            "    dpip hwdrop show\n"
+            "    dpip hwdrop flush\n"
+            "Sources with rules have the ports and the seconds left (TTL),\n"
+            "the others are candidates below the rate.\n"
+           );
+}
+
+static void hwdrop_entry_dump(const struct dp_vs_hwdrop_entry *ent)
+{
+    char addr[64], vaddr[64];
+
+    printf("%-40s %-40s %12u %6u %6u\n",
+           inet_ntop(ent->af, &ent->addr, addr, sizeof(addr)) ? addr : "::",
+           inet_ntop(ent->af, &ent->vaddr, vaddr, sizeof(vaddr)) ? vaddr : "::",
+           ent->rate, ent->nports, ent->ttl);
+}
+
+static int hwdrop_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
+                         struct dpip_conf *conf)
+{
+    struct dp_vs_hwdrop_show *show;
+    size_t size;
+    uint32_t i;
+    int err;
+
+    switch (conf->cmd) {
+    case DPIP_CMD_FLUSH:
+        return dpvs_setsockopt(SOCKOPT_SET_HWDROP_FLUSH, NULL, 0);
+    case DPIP_CMD_SHOW:
+        break;
+    default:
+        return EDPVS_NOTSUPP;
+    }
+
+    err = dpvs_getsockopt(SOCKOPT_GET_HWDROP_SHOW, NULL, 0,
+                          (void **)&show, &size);
+    if (err != 0)
+        return err;
+
+    if (size < sizeof(*show)
+            || size != sizeof(*show) + \
+                       show->nentries * sizeof(struct dp_vs_hwdrop_entry)) {
+        fprintf(stderr, "corrupted response.\n");
+        dpvs_sockopt_msg_free(show);
+        return EDPVS_INVAL;
+    }
+
+    if (show->rate)
+        printf("rate %u pkts/s ttl %us max_flows %u\n",
+               show->rate, show->ttl, show->max_flows);
+    else
+        printf("off (rate 0)\n");
+    printf("ports %u (%u without rte_flow) flows %u\n",
+           show->nports, show->nports_nosupp, show->nflows);
+    printf("installs %lu evicts %lu expires %lu fails %lu\n",
+           (unsigned long)show->installs, (unsigned long)show->evicts,
+           (unsigned long)show->expires, (unsigned long)show->fails);
+
+    if (show->nentries)
+        printf("%-40s %-40s %12s %6s %6s\n", "source", "vip", "pkts/s",
+               "ports", "ttl");
+    for (i = 0; i < show->nentries; i++)
+        hwdrop_entry_dump(&show->entries[i]);
+
+    dpvs_sockopt_msg_free(show);
+    return EDPVS_OK;
+}
+
+struct dpip_obj dpip_hwdrop = {
+    .name   = "hwdrop",
+    .help   = hwdrop_help,
+    .do_cmd = hwdrop_do_cmd,
+};
+
+static void __init hwdrop_init(void)
+{
+    dpip_register_obj(&dpip_hwdrop);
+}
+
+static void __exit hwdrop_exit(void)
+{
+    dpip_unregister_obj(&dpip_hwdrop);
+}
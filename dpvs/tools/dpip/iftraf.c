@@ -31,7 +31,14 @@ static void iftraf_help(void)
     fprintf(stderr,
             "Usage:\n"
             "    dpip iftraf [enable | disable]\n"
-            "    dpip iftraf show\n"
+            "    dpip iftraf show [dev IFNAME] [view VIEW] [sort METRIC] [top N]\n"
+            "Parameters:\n"
+            "    VIEW    := { flow | src | vip }, default src with dev, else flow\n"
+            "    METRIC  := { bytes | pkts }, default bytes\n"
+            "    N       := 1-%d, default %d\n"
+            "Counters are estimated over the last %d to %d seconds.\n",
+            IFTRAF_TOPN_MAX, IFTRAF_TOPN_DEF,
+            IFTRAF_WINDOW_SEC, 2 * IFTRAF_WINDOW_SEC
            );
 }
 
@@ -40,8 +47,10 @@ static void iftraf_dump(const struct iftraf_param *param)
     if (AF_INET == param->af) {
         printf("%s, [%s, %u -> ",
             param->ifname, inet_ntoa(param->saddr.in), ntohs(param->sport));
-        printf("%s, %u | %u], [%u, %u]",            
-            inet_ntoa(param->daddr.in), ntohs(param->dport), param->proto, param->total_recv, param->total_sent); 
+        printf("%s, %u | %u], [%lu, %lu], [%lu, %lu]",
+            inet_ntoa(param->daddr.in), ntohs(param->dport), param->proto,
+            (unsigned long)param->total_recv, (unsigned long)param->total_sent,
+            (unsigned long)param->pkts_recv, (unsigned long)param->pkts_sent);
 
     } else if (AF_INET6 == param->af) {
         char src_addr[INET6_ADDRSTRLEN];
@@ -50,8 +59,10 @@ static void iftraf_dump(const struct iftraf_param *param)
         inet_ntop(AF_INET6, &param->saddr.in6, src_addr, INET6_ADDRSTRLEN);
         inet_ntop(AF_INET6, &param->daddr.in6, dst_addr, INET6_ADDRSTRLEN);
 
-        printf("%s, [%s, %u -> %s, %u | %u], [%u, %u]",
-            param->ifname, src_addr, ntohs(param->sport), dst_addr, ntohs(param->dport), param->proto, param->total_recv, param->total_sent);
+        printf("%s, [%s, %u -> %s, %u | %u], [%lu, %lu], [%lu, %lu]",
+            param->ifname, src_addr, ntohs(param->sport), dst_addr, ntohs(param->dport), param->proto,
+            (unsigned long)param->total_recv, (unsigned long)param->total_sent,
+            (unsigned long)param->pkts_recv, (unsigned long)param->pkts_sent);
 
     } else {
         printf("unsupported");
@@ -64,16 +75,56 @@ static void iftraf_dump(const struct iftraf_param *param)
 static int iftraf_parse_args(struct dpip_conf *conf,
                             struct dp_vs_iftraf_conf *iftraf_conf)
 {
+    int topn;
+    bool has_view = false;
+
     memset(iftraf_conf, 0, sizeof(*iftraf_conf));
+    iftraf_conf->sort = IFTRAF_SORT_BYTES;
+    iftraf_conf->topn = IFTRAF_TOPN_DEF;
 
     while (conf->argc > 0) {
         if (strcmp(conf->argv[0], "dev") == 0) {
             NEXTARG_CHECK(conf, "dev");
             snprintf(iftraf_conf->ifname, sizeof(iftraf_conf->ifname), "%s", conf->argv[0]);
-        } 
+        } else if (strcmp(conf->argv[0], "view") == 0) {
+            NEXTARG_CHECK(conf, "view");
+            if (strcmp(conf->argv[0], "flow") == 0)
+                iftraf_conf->view = IFTRAF_VIEW_FLOW;
+            else if (strcmp(conf->argv[0], "src") == 0)
+                iftraf_conf->view = IFTRAF_VIEW_SRC;
+            else if (strcmp(conf->argv[0], "vip") == 0)
+                iftraf_conf->view = IFTRAF_VIEW_VIP;
+            else {
+                fprintf(stderr, "invalid view: %s\n", conf->argv[0]);
+                return -1;
+            }
+            has_view = true;
+        } else if (strcmp(conf->argv[0], "sort") == 0) {
+            NEXTARG_CHECK(conf, "sort");
+            if (strcmp(conf->argv[0], "bytes") == 0)
+                iftraf_conf->sort = IFTRAF_SORT_BYTES;
+            else if (strcmp(conf->argv[0], "pkts") == 0)
+                iftraf_conf->sort = IFTRAF_SORT_PKTS;
+            else {
+                fprintf(stderr, "invalid sort: %s\n", conf->argv[0]);
+                return -1;
+            }
+        } else if (strcmp(conf->argv[0], "top") == 0) {
+            NEXTARG_CHECK(conf, "top");
+            topn = atoi(conf->argv[0]);
+            if (topn <= 0 || topn > IFTRAF_TOPN_MAX) {
+                fprintf(stderr, "invalid top: %s\n", conf->argv[0]);
+                return -1;
+            }
+            iftraf_conf->topn = topn;
+        }
         NEXTARG(conf);
     }
 
+    if (!has_view && strlen(iftraf_conf->ifname) &&
+            strcmp(iftraf_conf->ifname, "all"))
+        iftraf_conf->view = IFTRAF_VIEW_SRC;
+
     if (conf->argc > 0) {
         fprintf(stderr, "too many arguments\n");
         return -1;
@@ -111,7 +162,7 @@ static int iftraf_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
 
         }
 
-        if (size <= sizeof(*iftraf_array)
+        if (size < sizeof(*iftraf_array)
                 || size != sizeof(*iftraf_array) + \
                            iftraf_array->ntrafs * sizeof(struct iftraf_param)) {
             fprintf(stderr, "response nstats : %d.\n", iftraf_array->ntrafs);
@@ -119,17 +170,10 @@ static int iftraf_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
             return EDPVS_NOTEXIST;
         }
 
-        //printf("-------------top10 iftraf[in the last 20s]----------\n");
-        if (strcmp(iftraf_conf.ifname, "all") == 0) {
-            for (i = 0; i < iftraf_array->ntrafs; i++) {
-                printf("top%d: ", i + 1);
-                iftraf_dump(&iftraf_array->iftraf[i]);
-            }
-        } else {
-            for (i = iftraf_array->ntrafs - 1; i >= 0; i--) {
-                printf("top%d: ", iftraf_array->ntrafs - i);
-                iftraf_dump(&iftraf_array->iftraf[i]);
-            }
+        /* ifname, [client, cport -> vip, vport | proto], [bytes in, out], [pkts in, out] */
+        for (i = 0; i < iftraf_array->ntrafs; i++) {
+            printf("top%d: ", i + 1);
+            iftraf_dump(&iftraf_array->iftraf[i]);
         }
         dpvs_sockopt_msg_free(iftraf_array);
         return EDPVS_OK;
@@ -0,0 +1,136 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * msg.c - show inter-lcore msg latency.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "conf/common.h"
+#include "dpip.h"
+#include "conf/msg.h"
+#include "sockopt.h"
+
+static void msg_help(void)
+{
+    fprintf(stderr,
+            "Usage:\n"
+            "    dpip [-s] msg show\n"
+            "Latencies are in us, percentiles are bucket upper bounds;\n"
+            "-s also prints the histogram buckets.\n"
+           );
+}
+
+/* upper bound (us) of the bucket holding the q-quantile */
+static uint64_t msg_lat_quantile(const struct dp_vs_msg_lat *lat, double q)
+{
+    uint64_t want, seen = 0;
+    int i;
+
+    want = (uint64_t)(lat->count * q);
+    if (want < 1)
+        want = 1;
+
+    for (i = 0; i < DPVS_MSG_LAT_BUCKETS; i++) {
+        seen += lat->hist[i];
+        if (seen >= want)
+            break;
+    }
+    if (i >= DPVS_MSG_LAT_BUCKETS - 1)
+        return lat->max_us;
+
+    return 1UL << i;
+}
+
+static void msg_lat_dump(const struct dp_vs_msg_lat *lat, bool stats)
+{
+    int i;
+
+    printf("%-6u %12lu %8u %10.1f %8lu %8lu %8lu %10lu\n",
+           lat->type, (unsigned long)lat->count, lat->timeouts,
+           lat->count ? (double)lat->sum_us / lat->count : 0.0,
+           (unsigned long)msg_lat_quantile(lat, 0.5),
+           (unsigned long)msg_lat_quantile(lat, 0.99),
+           (unsigned long)msg_lat_quantile(lat, 0.999),
+           (unsigned long)lat->max_us);
+
+    if (!stats)
+        return;
+
+    for (i = 0; i < DPVS_MSG_LAT_BUCKETS; i++) {
+        if (!lat->hist[i])
+            continue;
+        if (i == 0)
+            printf("    %10s %-8s %12lu\n", "", "<1", (unsigned long)lat->hist[i]);
+        else if (i == DPVS_MSG_LAT_BUCKETS - 1)
+            printf("    %10lu %-8s %12lu\n", 1UL << (i - 1), "-",
+                   (unsigned long)lat->hist[i]);
+        else
+            printf("    %10lu %-8lu %12lu\n", 1UL << (i - 1), 1UL << i,
+                   (unsigned long)lat->hist[i]);
+    }
+}
+
+static int msg_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
+                      struct dpip_conf *conf)
+{
+    struct dp_vs_msg_stats *stats;
+    size_t size;
+    uint32_t i;
+    int err;
+
+    if (conf->cmd != DPIP_CMD_SHOW)
+        return EDPVS_NOTSUPP;
+
+    err = dpvs_getsockopt(SOCKOPT_GET_MSG_STATS, NULL, 0,
+                          (void **)&stats, &size);
+    if (err != 0)
+        return err;
+
+    if (size < sizeof(*stats)
+            || size != sizeof(*stats) + \
+                       stats->ntypes * sizeof(struct dp_vs_msg_lat)) {
+        fprintf(stderr, "corrupted response.\n");
+        dpvs_sockopt_msg_free(stats);
+        return EDPVS_INVAL;
+    }
+
+    printf("%-6s %12s %8s %10s %8s %8s %8s %10s\n", "type", "count",
+           "timeout", "avg", "p50", "p99", "p999", "max");
+    for (i = 0; i < stats->ntypes; i++)
+        msg_lat_dump(&stats->lats[i], conf->stats);
+
+    dpvs_sockopt_msg_free(stats);
+    return EDPVS_OK;
+}
+
+struct dpip_obj dpip_msg = {
+    .name   = "msg",
+    .help   = msg_help,
+    .do_cmd = msg_do_cmd,
+};
+
+static void __init msg_init(void)
+{
+    dpip_register_obj(&dpip_msg);
+}
+
+static void __exit msg_exit(void)
+{
+    dpip_unregister_obj(&dpip_msg);
+}
@@ -0,0 +1,95 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * startup.c - show dpvs startup timeline.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "conf/common.h"
+#include "dpip.h"
+#include "conf/startup.h"
+#include "sockopt.h"
+
+static void startup_help(void)
+{
+    fprintf(stderr,
+            "Usage:\n"
+            "    dpip startup show\n"
+           );
+}
+
+static void startup_dump(const struct dp_vs_startup_stage *stage)
+{
+    printf("%*s%-*s %12.3f %12.3f %12ld%s\n",
+           stage->depth * 2, "", 24 - stage->depth * 2, stage->name,
+           stage->start_us / 1000.0, stage->cost_us / 1000.0,
+           (long)(stage->mem_bytes / 1024),
+           stage->err ? "  (failed)" : "");
+}
+
+static int startup_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
+                          struct dpip_conf *conf)
+{
+    struct dp_vs_startup_timeline *timeline;
+    size_t size;
+    uint32_t i;
+    int err;
+
+    if (conf->cmd != DPIP_CMD_SHOW)
+        return EDPVS_NOTSUPP;
+
+    err = dpvs_getsockopt(SOCKOPT_GET_STARTUP_SHOW, NULL, 0,
+                          (void **)&timeline, &size);
+    if (err != 0)
+        return err;
+
+    if (size < sizeof(*timeline)
+            || size != sizeof(*timeline) + \
+                       timeline->nstages * sizeof(struct dp_vs_startup_stage)) {
+        fprintf(stderr, "corrupted response.\n");
+        dpvs_sockopt_msg_free(timeline);
+        return EDPVS_INVAL;
+    }
+
+    printf("total %.3f ms, %ld KB, %u stages\n",
+           timeline->total_us / 1000.0,
+           (long)(timeline->total_mem_bytes / 1024), timeline->nstages);
+    printf("%-24s %12s %12s %12s\n", "stage", "start(ms)", "cost(ms)", "mem(KB)");
+    for (i = 0; i < timeline->nstages; i++)
+        startup_dump(&timeline->stages[i]);
+
+    dpvs_sockopt_msg_free(timeline);
+    return EDPVS_OK;
+}
+
+struct dpip_obj dpip_startup = {
+    .name   = "startup",
+    .help   = startup_help,
+    .do_cmd = startup_do_cmd,
+};
+
+static void __init startup_init(void)
+{
+    dpip_register_obj(&dpip_startup);
+}
+
+static void __exit startup_exit(void)
+{
+    dpip_unregister_obj(&dpip_startup);
+}
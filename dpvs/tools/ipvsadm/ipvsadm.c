@@ -144,7 +144,8 @@
 #define CMD_ADDBLKLST		(CMD_NONE+18)
 #define CMD_DELBLKLST		(CMD_NONE+19)
 #define CMD_GETBLKLST		(CMD_NONE+20)
-#define CMD_MAX			CMD_GETBLKLST
+#define CMD_SETLIMIT		(CMD_NONE+21)
+#define CMD_MAX			CMD_SETLIMIT
 #define NUMBER_OF_CMD		(CMD_MAX - CMD_NONE)
 
 static const char* cmdnames[] = {
@@ -168,6 +169,7 @@ static const char* cmdnames[] = {
 	"add-blklst",
 	"del-blklst",
 	"get-blklst",
+	"set-limit",
 };
 
 static const char* optnames[] = {
@@ -200,7 +202,8 @@ static const char* optnames[] = {
 	"ifname" ,
 	"sockpair" ,
 	"hash-target",
-	"cpu"
+	"cpu",
+	"conn-state"
 };
 
 /*
@@ -213,47 +216,49 @@ static const char* optnames[] = {
  */
 static const char commands_v_options[NUMBER_OF_CMD][NUMBER_OF_OPT] =
 {
-/* -n   -c   svc  -s   -p   -M   -r   fwd  -w   -x   -y   -mc  tot  dmn  -st  -rt  thr  -pc  srt  sid  -ex  ops  pe   laddr blst syn ifname sockpair hashtag cpu*/
+/* -n   -c   svc  -s   -p   -M   -r   fwd  -w   -x   -y   -mc  tot  dmn  -st  -rt  thr  -pc  srt  sid  -ex  ops  pe   laddr blst syn ifname sockpair hashtag cpu cstate*/
 /*ADD*/
-    {'x', 'x', '+', ' ', ' ', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', ' ', 'x', 'x', 'x',  ' ', 'x' ,'x' ,' ', 'x'},
+    {'x', 'x', '+', ' ', ' ', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', ' ', 'x', 'x', 'x',  ' ', 'x' ,'x' ,' ', 'x', 'x'},
 /*EDIT*/
-    {'x', 'x', '+', ' ', ' ', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', ' ', 'x', 'x', 'x',  ' ', 'x' ,'x' ,' ', 'x'},
+    {'x', 'x', '+', ' ', ' ', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', ' ', 'x', 'x', 'x',  ' ', 'x' ,'x' ,' ', 'x', 'x'},
 /*DEL*/
-    {'x', 'x', '+', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x'},
+    {'x', 'x', '+', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x', 'x'},
 /*FLUSH*/
-    {'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x'},
+    {'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x', 'x'},
 /*LIST*/
-    {' ', '1', '1', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', '1', '1', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'x', 'x', 'x', 'x',  'x', 'x' ,' ' ,'x', ' '},
+    {' ', '1', ' ', 'x', 'x', 'x', ' ', 'x', 'x', 'x', 'x', 'x', '1', '1', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'x', 'x', 'x', 'x',  'x', 'x' ,' ' ,'x', ' ', ' '},
 /*ADDSRV*/
-    {'x', 'x', '+', 'x', 'x', 'x', '+', ' ', ' ', ' ', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x'},
+    {'x', 'x', '+', 'x', 'x', 'x', '+', ' ', ' ', ' ', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x', 'x'},
 /*DELSRV*/
-    {'x', 'x', '+', 'x', 'x', 'x', '+', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x'},
+    {'x', 'x', '+', 'x', 'x', 'x', '+', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x', 'x'},
 /*EDITSRV*/
-    {'x', 'x', '+', 'x', 'x', 'x', '+', ' ', ' ', ' ', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x'},
+    {'x', 'x', '+', 'x', 'x', 'x', '+', ' ', ' ', ' ', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x', 'x'},
 /*TIMEOUT*/
-    {'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x'},
+    {'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x', 'x'},
 /*STARTD*/
-    {'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', ' ', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x'},
+    {'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', ' ', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x', 'x'},
 /*STOPD*/
-    {'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', ' ', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x'},
+    {'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', ' ', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x', 'x'},
 /*RESTORE*/
-    {'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x'},
+    {'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x', 'x'},
 /*SAVE*/
-    {' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x'},
+    {' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x', 'x'},
 /*ZERO*/
-    {'x', 'x', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x'},
+    {'x', 'x', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x', 'x'},
 /*ADDLADDR*/
-    {'x', 'x', '+', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', '+', 'x',  'x', '+' ,'x' ,'x', 'x'},
+    {'x', 'x', '+', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', '+', 'x',  'x', '+' ,'x' ,'x', 'x', 'x'},
 /*DELLADDR*/
-    {'x', 'x', '+', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', '+', 'x',  'x', '+' ,'x' ,'x', 'x'},
+    {'x', 'x', '+', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', '+', 'x',  'x', '+' ,'x' ,'x', 'x', 'x'},
 /*GETLADDR*/
-    {'x', 'x', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', ' '},
+    {'x', 'x', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', ' ', 'x'},
 /*ADDBLKLST*/
-    {'x', 'x', '+', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', '+',  'x', 'x' ,'x' ,'x', 'x'},
+    {'x', 'x', '+', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', '+',  'x', 'x' ,'x' ,'x', 'x', 'x'},
 /*DELBLKLST*/
-    {'x', 'x', '+', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', '+',  'x', 'x' ,'x' ,'x', 'x'},
+    {'x', 'x', '+', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', '+',  'x', 'x' ,'x' ,'x', 'x', 'x'},
 /*GETBLKLST*/
-    {'x', 'x', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x'},
+    {'x', 'x', ' ', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x', 'x'},
+/*SETLIMIT*/
+    {'x', 'x', '+', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',  'x', 'x' ,'x' ,'x', 'x', 'x'},
 };
 
 /* printing format flags */
@@ -266,6 +271,9 @@ static const char commands_v_options[NUMBER_OF_CMD][NUMBER_OF_OPT] =
 #define FMT_PERSISTENTCONN	0x0020
 #define FMT_NOSORT		0x0040
 #define FMT_EXACT		0x0080
+#define FMT_RTT			0x0100
+#define FMT_LIMIT		0x0200
+#define FMT_ATTACK		0x0400
 
 #define SERVICE_NONE		0x0000
 #define SERVICE_ADDR		0x0001
@@ -285,7 +293,9 @@ struct ipvs_command_entry {
 	ipvs_daemon_t		daemon;
 	ipvs_laddr_t		laddr;
 	ipvs_blklst_t		blklst;
+	struct dp_vs_connlimit_conf climit;
 	ipvs_sockpair_t		sockpair;
+	char			conn_state[16];
 	lcoreid_t		cid;
 };
 
@@ -308,6 +318,11 @@ enum {
 	TAG_PERSISTENCE_ENGINE,
 	TAG_SOCKPAIR,
 	TAG_CPU,
+	TAG_CONN_STATE,
+	TAG_RTT,
+	TAG_SET_LIMIT,
+	TAG_LIMIT,
+	TAG_ATTACK,
 };
 
 /* various parsing helpers & parsing functions */
@@ -323,6 +338,8 @@ static char * addrport_to_anyname(int af, const void *addr, unsigned short port,
 				  unsigned short proto, unsigned int format);
 static int parse_service(char *buf, ipvs_service_t *svc);
 static int parse_netmask(char *buf, u_int32_t *addr);
+static int parse_blklst(char *buf, ipvs_blklst_t *blklst);
+static int parse_connlimit(char *buf, struct dp_vs_connlimit_conf *limit);
 static int parse_timeout(char *buf, int min, int max);
 static unsigned int parse_fwmark(char *buf);
 static int parse_sockpair(char *buf, ipvs_sockpair_t *sockpair);
@@ -340,7 +357,8 @@ static void version(FILE *stream);
 static void fail(int err, char *msg, ...);
 
 /* various listing functions */
-static void list_conn(int is_template, unsigned int format);
+static void list_conn(int is_template, const struct ip_vs_conn_filter *filter,
+		unsigned int format);
 static void list_conn_sockpair(int is_template,
 		ipvs_sockpair_t *sockpair, unsigned int format);
 static void list_service(ipvs_service_t *svc, unsigned int format, lcoreid_t cid);
@@ -350,7 +368,8 @@ static void list_daemon(void);
 static int list_laddrs(ipvs_service_t *svc, int with_title, lcoreid_t cid);
 static int list_all_laddrs(lcoreid_t cid);
 static void list_blklsts_print_title(void);
-static int list_blklst(uint32_t addr_v4, uint16_t port, uint16_t protocol);
+static int list_blklst(int af, const union nf_inet_addr *addr, uint16_t port,
+		       uint16_t protocol);
 static int list_all_blklsts(void);
 
 #if 0
@@ -421,6 +440,8 @@ parse_options(int argc, char **argv, struct ipvs_command_entry *ce,
 		{ "add-blklst", 'U', POPT_ARG_NONE, NULL, 'U', NULL, NULL },
 		{ "del-blklst", 'V', POPT_ARG_NONE, NULL, 'V', NULL, NULL },
 		{ "get-blklst", 'B', POPT_ARG_NONE, NULL, 'B', NULL, NULL },
+		{ "set-limit", '\0', POPT_ARG_STRING, &optarg,
+		  TAG_SET_LIMIT, NULL, NULL },
 		{ "tcp-service", 't', POPT_ARG_STRING, &optarg, 't',
 		  NULL, NULL },
 		{ "udp-service", 'u', POPT_ARG_STRING, &optarg, 'u',
@@ -457,6 +478,9 @@ parse_options(int argc, char **argv, struct ipvs_command_entry *ce,
 		{ "daemon", '\0', POPT_ARG_NONE, NULL, TAG_DAEMON, NULL, NULL },
 		{ "stats", '\0', POPT_ARG_NONE, NULL, TAG_STATS, NULL, NULL },
 		{ "rate", '\0', POPT_ARG_NONE, NULL, TAG_RATE, NULL, NULL },
+		{ "rtt", '\0', POPT_ARG_NONE, NULL, TAG_RTT, NULL, NULL },
+		{ "limit", '\0', POPT_ARG_NONE, NULL, TAG_LIMIT, NULL, NULL },
+		{ "attack-stats", '\0', POPT_ARG_NONE, NULL, TAG_ATTACK, NULL, NULL },
 		{ "thresholds", '\0', POPT_ARG_NONE, NULL,
 		   TAG_THRESHOLDS, NULL, NULL },
 		{ "persistent-conn", '\0', POPT_ARG_NONE, NULL,
@@ -478,6 +502,8 @@ parse_options(int argc, char **argv, struct ipvs_command_entry *ce,
 		{ "match", 'H', POPT_ARG_STRING, &optarg, 'H', NULL, NULL },
 		{ "hash-target", 'Y', POPT_ARG_STRING, &optarg, 'Y', NULL, NULL },
 		{ "cpu", '\0', POPT_ARG_STRING, &optarg, TAG_CPU, NULL, NULL },
+		{ "conn-state", '\0', POPT_ARG_STRING, &optarg,
+		  TAG_CONN_STATE, NULL, NULL },
 		{ NULL, 0, 0, NULL, 0, NULL, NULL }
 	};
 
@@ -565,6 +591,11 @@ parse_options(int argc, char **argv, struct ipvs_command_entry *ce,
 	case 'B':
 		set_command(&ce->cmd, CMD_GETBLKLST);
 		break;
+	case TAG_SET_LIMIT:
+		set_command(&ce->cmd, CMD_SETLIMIT);
+		if (parse_connlimit(optarg, &ce->climit) != 0)
+			fail(2, "illegal limit specified");
+		break;
 	default:
 		tryhelp_exit(argv[0], -1);
 	}
@@ -715,6 +746,21 @@ parse_options(int argc, char **argv, struct ipvs_command_entry *ce,
 			set_option(options, OPT_RATE);
 			*format |= FMT_RATE;
 			break;
+		case TAG_RTT:
+			/* a variant of --stats, needs no option bit of its own */
+			set_option(options, OPT_STATS);
+			*format |= FMT_STATS | FMT_RTT;
+			break;
+		case TAG_LIMIT:
+			/* a variant of --stats as --rtt */
+			set_option(options, OPT_STATS);
+			*format |= FMT_STATS | FMT_LIMIT;
+			break;
+		case TAG_ATTACK:
+			/* a variant of --stats as --rtt */
+			set_option(options, OPT_STATS);
+			*format |= FMT_STATS | FMT_ATTACK;
+			break;
 		case TAG_THRESHOLDS:
 			set_option(options, OPT_THRESHOLDS);
 			*format |= FMT_THRESHOLDS;
@@ -771,18 +817,10 @@ parse_options(int argc, char **argv, struct ipvs_command_entry *ce,
 
 			}
 		case 'k':
-			{
-			ipvs_service_t		nsvc;
 			set_option(options,OPT_BLKLST_ADDRESS);
-			parse = parse_service(optarg, &nsvc);
-			if (!(parse & SERVICE_ADDR))
+			if (parse_blklst(optarg, &ce->blklst) != 0)
 				fail(2, "illegal blacklist address");
-			ce->blklst.af = nsvc.af;
-			ce->blklst.addr = nsvc.nf_addr;
-			ce->blklst.__addr_v4 = nsvc.nf_addr.ip;
 			break;
-
-			}
 		case 'F':
 			set_option(options, OPT_IFNAME);
 			snprintf(ce->laddr.ifname, sizeof(ce->laddr.ifname), "%s", optarg);
@@ -792,11 +830,16 @@ parse_options(int argc, char **argv, struct ipvs_command_entry *ce,
 			set_option(options, OPT_SYNPROXY);
 
 			if(!memcmp(optarg , "enable" , strlen("enable")))
-				ce->svc.user.flags = ce->svc.user.flags | IP_VS_CONN_F_SYNPROXY;
+				ce->svc.user.flags = (ce->svc.user.flags | IP_VS_CONN_F_SYNPROXY)
+						     & (~IP_VS_CONN_F_SYNPROXY_AUTO);
 			else if(!memcmp(optarg , "disable" , strlen("disable")))
-				ce->svc.user.flags = ce->svc.user.flags & (~IP_VS_CONN_F_SYNPROXY);
+				ce->svc.user.flags = ce->svc.user.flags
+						     & (~(IP_VS_CONN_F_SYNPROXY | IP_VS_CONN_F_SYNPROXY_AUTO));
+			else if(!strcmp(optarg , "auto"))
+				ce->svc.user.flags = (ce->svc.user.flags | IP_VS_CONN_F_SYNPROXY_AUTO)
+						     & (~IP_VS_CONN_F_SYNPROXY);
 			else
-				fail(2 , "synproxy switch must be enable or disable\n");
+				fail(2 , "synproxy switch must be enable, disable or auto\n");
 
 			break;
 			}
@@ -825,6 +868,12 @@ parse_options(int argc, char **argv, struct ipvs_command_entry *ce,
 			ce->cid = atoi(optarg);
 			break;
 			}
+		case TAG_CONN_STATE:
+			set_option(options, OPT_CONNSTATE);
+			if (strlen(optarg) >= sizeof(ce->conn_state))
+				fail(2, "illegal connection state specified");
+			strcpy(ce->conn_state, optarg);
+			break;
 		default:
 			fail(2, "invalid option `%s'",
 			     poptBadOption(context, POPT_BADOPTION_NOALIAS));
@@ -868,13 +917,17 @@ parse_options(int argc, char **argv, struct ipvs_command_entry *ce,
 
 static int restore_table(int argc, char **argv, int reading_stdin)
 {
-	int result = 0;
+	int result = 0, err, failed;
 	dynamic_array_t *a;
 
 	/* avoid infinite loop */
 	if (reading_stdin != 0)
 		tryhelp_exit(argv[0], -1);
 
+	/* service and dest rules go to dpvs in batches, not one per line */
+	if (ipvs_batch_begin(0))
+		fprintf(stderr, "%s: batching disabled\n", argv[0]);
+
 	while ((a = config_stream_read(stdin, argv[0])) != NULL) {
 		int i;
 		if ((i = (int)dynamic_array_get_count(a)) > 1) {
@@ -883,6 +936,13 @@ static int restore_table(int argc, char **argv, int reading_stdin)
 		}
 		dynamic_array_destroy(a, DESTROY_STR);
 	}
+
+	if ((err = ipvs_batch_commit(&failed))) {
+		/* not idempotent, dpvs only says which chunk failed */
+		fprintf(stderr, "%s: batched restore failed at or after op %d: %s\n",
+			argv[0], failed, dpvs_strerror(err));
+		result = -1;
+	}
 	return result;
 }
 
@@ -952,12 +1012,44 @@ static int process_options(int argc, char **argv, int reading_stdin)
 		     options & OPT_PERSISTENTCONN))
 			fail(2, "options conflicts in the list command");
 
+		if (options & OPT_SERVICE &&
+		    options & (OPT_TIMEOUT|OPT_DAEMON))
+			fail(2, "options conflicts in the list command");
+
+		if (options & (OPT_SERVER|OPT_CONNSTATE) &&
+		    !(options & OPT_CONNECTION))
+			fail(2, "'%s' and '%s' options filter connections only, "
+			     "use them with '-c'", optnames[6], optnames[30]);
+
 		if (options & OPT_CONNECTION)
             if (options & OPT_SOCKPAIR)
                 list_conn_sockpair(options & OPT_PERSISTENTCONN,
 						&ce.sockpair, format);
-            else
-                list_conn(options & OPT_PERSISTENTCONN, format);
+            else {
+                struct ip_vs_conn_filter filter;
+
+                if (ce.svc.user.fwmark || ce.svc.user.flags & IP_VS_SVC_F_MATCH)
+                    fail(2, "connections can only be filtered by service-address");
+                memset(&filter, 0, sizeof(filter));
+                if (options & OPT_SERVICE) {
+                    filter.flags |= GET_IPVS_CONN_FILTER_VADDR;
+                    filter.proto = ce.svc.user.protocol;
+                    filter.af = ce.svc.af;
+                    memcpy(&filter.vaddr, &ce.svc.nf_addr, sizeof(filter.vaddr));
+                    filter.vport = ce.svc.user.port;
+                }
+                if (options & OPT_SERVER) {
+                    filter.flags |= GET_IPVS_CONN_FILTER_DADDR;
+                    filter.daf = ce.dest.af;
+                    memcpy(&filter.daddr, &ce.dest.nf_addr, sizeof(filter.daddr));
+                    filter.dport = ce.dest.user.port;
+                }
+                if (options & OPT_CONNSTATE) {
+                    filter.flags |= GET_IPVS_CONN_FILTER_STATE;
+                    strcpy(filter.state, ce.conn_state);
+                }
+                list_conn(options & OPT_PERSISTENTCONN, &filter, format);
+            }
 		else if (options & OPT_SERVICE)
 			list_service(&ce.svc, format, ce.cid);
 		else if (options & OPT_TIMEOUT)
@@ -1046,11 +1138,16 @@ static int process_options(int argc, char **argv, int reading_stdin)
 	case CMD_GETBLKLST:
 		if(options & OPT_SERVICE) {
 			list_blklsts_print_title();
-			result = list_blklst(ce.svc.nf_addr.ip, ce.svc.user.port, ce.svc.user.protocol);
+			result = list_blklst(ce.svc.af, &ce.svc.nf_addr, ce.svc.user.port,
+					     ce.svc.user.protocol);
 		}
 		else
 			result = list_all_blklsts();
 		break;
+
+	case CMD_SETLIMIT:
+		result = ipvs_set_connlimit(&ce.svc, &ce.climit);
+		break;
 	}
 	if (result)
 		fprintf(stderr, "%s\n", ipvs_strerror(errno));
@@ -1134,6 +1231,134 @@ static int parse_netmask(char *buf, u_int32_t *addr)
 }
 
 
+/* TCP flags from FIN up, as letters */
+static const char tcp_flag_letters[] = "FSRPAUEC";
+
+/*
+ * Get TCP flags from the argument, FLAGS[/MASK] as letters of
+ * FSRPAUEC, the mask defaults to FLAGS ("S/SA": SYN without ACK).
+ * Return 0 on success.
+ */
+static int
+parse_tcp_flags(const char *buf, uint8_t *flags, uint8_t *mask)
+{
+	uint8_t *f = flags;
+	const char *c;
+
+	*flags = *mask = 0;
+	for (; *buf; buf++) {
+		if (*buf == '/' && f == flags) {
+			f = mask;
+			continue;
+		}
+		if (!(c = strchr(tcp_flag_letters, toupper(*buf))))
+			return -1;
+		*f |= 1 << (c - tcp_flag_letters);
+	}
+	if (f == flags)
+		*mask = *flags;
+
+	return (*mask && !(*flags & ~*mask)) ? 0 : -1;
+}
+
+/*
+ * Get blacklist address from the argument,
+ * ADDR[/PLEN][,allow|,deny][,flags=FLAGS[/MASK]].
+ * Return 0 on success.
+ */
+static int
+parse_blklst(char *buf, ipvs_blklst_t *blklst)
+{
+	ipvs_service_t nsvc;
+	char *p;
+	long plen = 0;
+
+	memset(blklst, 0, sizeof(*blklst));
+	memset(&nsvc, 0, sizeof(nsvc));
+
+	while ((p = strrchr(buf, ',')) != NULL) {
+		*p++ = '\0';
+		if (!strcmp(p, "allow"))
+			blklst->action = DPVS_BLKLST_ALLOW;
+		else if (!strncmp(p, "flags=", 6)) {
+			if (parse_tcp_flags(p + 6, &blklst->tcp_flags,
+					    &blklst->tcp_flags_mask))
+				return -1;
+		} else if (strcmp(p, "deny"))
+			return -1;
+	}
+
+	if ((p = strchr(buf, '/')) != NULL) {
+		*p++ = '\0';
+		if ((plen = string_to_number(p, 1, 128)) == -1)
+			return -1;
+	}
+
+	if (!(parse_service(buf, &nsvc) & SERVICE_ADDR))
+		return -1;
+	if (nsvc.af == AF_INET && plen > 32)
+		return -1;
+
+	blklst->af = nsvc.af;
+	blklst->addr = nsvc.nf_addr;
+	blklst->__addr_v4 = nsvc.nf_addr.ip;
+	blklst->plen = plen;
+	return 0;
+}
+
+/*
+ * Get per-client limits from the argument,
+ * rate=N[,burst=N][,prefix=N][,conns=N[,policy=drop|rst|synproxy]],
+ * limits left out or set to 0 are removed.
+ * Return 0 on success.
+ */
+static int
+parse_connlimit(char *buf, struct dp_vs_connlimit_conf *limit)
+{
+	char *tok, *val, *save = NULL;
+	int n;
+
+	memset(limit, 0, sizeof(*limit));
+
+	for (tok = strtok_r(buf, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		if (!(val = strchr(tok, '=')))
+			return -1;
+		*val++ = '\0';
+
+		if (!strcmp(tok, "prefix")) {
+			if ((n = string_to_number(val, 0, 128)) == -1)
+				return -1;
+			limit->plen = n;
+			continue;
+		}
+		if (!strcmp(tok, "policy")) {
+			if (!strcmp(val, "drop"))
+				limit->policy = DPVS_CONNLIMIT_DROP;
+			else if (!strcmp(val, "rst"))
+				limit->policy = DPVS_CONNLIMIT_RST;
+			else if (!strcmp(val, "synproxy"))
+				limit->policy = DPVS_CONNLIMIT_SYNPROXY;
+			else
+				return -1;
+			continue;
+		}
+
+		if ((n = string_to_number(val, 0, 4000000)) == -1)
+			return -1;
+		if (!strcmp(tok, "rate"))
+			limit->rate = n;
+		else if (!strcmp(tok, "burst"))
+			limit->burst = n;
+		else if (!strcmp(tok, "conns"))
+			limit->conns = n;
+		else
+			return -1;
+	}
+
+	return 0;
+}
+
 /*
  * Get IP address and port from the argument.
  * Result is a logical or of
@@ -1454,6 +1679,7 @@ static void usage_exit(const char *program, const int exit_status)
 		"  %s -P|Q -t|u|q|f service-address -z local-address\n"
 		"  %s -G -t|u|q|f service-address \n"
 		"  %s -U|V -t|u|q|f service-address -k blacklist-address\n"
+		"  %s --set-limit rate=N[,burst=N][,prefix=N][,conns=N[,policy=P]] -t|u|q|f service-address\n"
 		"  %s -a|e -t|u|q|f service-address -r server-address [options]\n"
 		"  %s -d -t|u|q|f service-address -r server-address\n"
 		"  %s -L|l [options]\n"
@@ -1464,7 +1690,7 @@ static void usage_exit(const char *program, const int exit_status)
 		"  %s -h\n\n",
 		program, program, program,
 		program, program, program,
-		program, program, program, program, program,
+		program, program, program, program, program, program,
 		program, program, program, program, program);
 
 	fprintf(stream,
@@ -1481,6 +1707,10 @@ static void usage_exit(const char *program, const int exit_status)
 		"  --add-blklst      -U        add blacklist address\n"
 		"  --del-blklst      -V        del blacklist address\n"
 		"  --get-blklst      -B        get blacklist address\n"
+		"  --set-limit limits          set new connections per second and concurrent\n"
+		"                              connections of one client (prefix) of a service\n"
+		"                              over conns: policy=drop|rst|synproxy, synproxy\n"
+		"                              RSTs once the client completed the handshake\n"
 		"  --save            -S        save rules to stdout\n"
 		"  --add-server      -a        add real server with options\n"
 		"  --edit-server     -e        edit real server with options\n"
@@ -1523,16 +1753,23 @@ static void usage_exit(const char *program, const int exit_status)
 		"  --daemon                            output of daemon information\n"
 		"  --stats                             output of statistics information\n"
 		"  --rate                              output of rate information\n"
+		"  --rtt                               output of backend RTT percentiles (us), with --stats\n"
+		"  --limit                             output of per-client limits and their drops\n"
+		"  --attack-stats                      output of SYN/ACK/RST anomaly counters per service\n"
 		"  --exact                             expand numbers (display exact values)\n"
 		"  --thresholds                        output of thresholds information\n"
 		"  --persistent-conn                   output of persistent connection info\n"
-		"  --sockpair                          output connection info of specified socket pair (proto:sip:sport:tip:tport)"
+		"  --sockpair                          output connection info of specified socket pair (proto:sip:sport:tip:tport)\n"
+		"  --conn-state   state                output connections in state only, e.g. TCP_EST, SYN_RECV\n"
 		"  --nosort                            disable sorting output of service/server entries\n"
 		"  --sort                              does nothing, for backwards compatibility\n"
 		"  --ops          -o                   one-packet scheduling\n"
 		"  --numeric      -n                   numeric output of addresses and ports\n"
 		"  --ifname       -F                   nic interface for laddrs\n"
-		"  --synproxy     -j                   TCP syn proxy\n"
+		"  --blklst       -k addr[/plen][,allow][,flags=S/SA]\n"
+		"                                      blacklist entry, allow makes it a whitelist,\n"
+		"                                      flags of TCP as letters of FSRPAUEC[/mask]\n"
+		"  --synproxy     -j enable|disable|auto  TCP syn proxy, auto under SYN flood only\n"
 		"  --match        -H MATCH             select service by MATCH 'af,proto,srange,drange,iif,oif', af should be defined if no range defined\n"
 		"  --hash-target  -Y hashtag           choose target for conhash (support sip or qid for quic)\n"
 		"  --cpu            cid                choose cid to show\n",
@@ -1624,25 +1861,31 @@ exit:
 		free(dname);
 }
 
-static void list_conn(int is_template, unsigned int format)
+static void list_conn(int is_template, const struct ip_vs_conn_filter *filter,
+		unsigned int format)
 {
     struct ip_vs_conn_array *conn_array;
     struct ip_vs_conn_req req;
-    int i, more = 0;
+    int i, nconns, more = 0;
 
     memset(&req, 0, sizeof(struct ip_vs_conn_req));
     if (is_template)
         req.flag |= GET_IPVS_CONN_FLAG_TEMPLATE;
     req.flag |= GET_IPVS_CONN_FLAG_ALL;
+    req.filter = *filter;
 
     while((conn_array = ip_vs_get_conns(&req)) != NULL) {
 		for (i = 0; i < conn_array->nconns; i++)
 			print_conn_entry(&conn_array->array[i], format);
         req.whence = conn_array->curcid;
         more = conn_array->resl & GET_IPVS_CONN_FLAG_MORE;
+        nconns = conn_array->nconns;
         free(conn_array);
         if (!more)
             break;
+        /* workers dump their tables in slices, give them time to catch up */
+        if (!nconns)
+            usleep(1000);
         req.flag |= GET_IPVS_CONN_FLAG_MORE;
     }
 
@@ -1753,9 +1996,149 @@ static void print_largenum(unsigned long long i, unsigned int format)
 }
 
 
+/* upper bound (us) of the bucket holding the q-quantile */
+static uint64_t rtt_quantile(const struct dp_vs_rtt_hist *h, double q)
+{
+	uint64_t want, seen = 0;
+	int i;
+
+	if (!h->count)
+		return 0;
+
+	want = (uint64_t)(h->count * q);
+	if (want < 1)
+		want = 1;
+
+	for (i = 0; i < DP_VS_RTT_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen >= want)
+			break;
+	}
+	if (i >= DP_VS_RTT_BUCKETS - 1 || dp_vs_rtt_bucket_max(i) > h->max_us)
+		return h->max_us;
+
+	return dp_vs_rtt_bucket_max(i);
+}
+
+static void print_rtt(const struct dp_vs_rtt_hist *h, unsigned int format)
+{
+	print_largenum(h->count, format);
+	print_largenum(h->count ? h->sum_us / h->count : 0, format);
+	print_largenum(rtt_quantile(h, 0.5), format);
+	print_largenum(rtt_quantile(h, 0.9), format);
+	print_largenum(rtt_quantile(h, 0.99), format);
+	print_largenum(rtt_quantile(h, 0.999), format);
+	print_largenum(h->max_us, format);
+}
+
+static const struct dp_vs_rtt_hist *
+find_dest_rtt(const struct dp_vs_get_rtt *rtt, const ipvs_dest_entry_t *e)
+{
+	unsigned int i;
+
+	for (i = 0; i < rtt->num_dests; i++) {
+		const struct dp_vs_rtt_entry *r = &rtt->entrytable[i];
+
+		if (r->af == e->af && r->port == e->user.port &&
+		    !memcmp(&r->addr, &e->nf_addr, e->af == AF_INET6 ?
+			    sizeof(struct in6_addr) : sizeof(struct in_addr)))
+			return &r->rtt;
+	}
+
+	return NULL;
+}
+
+/* rates (per second) of a kind of packet from which on it makes a pattern */
+#define ATTACK_MIN_RATE		1000
+
+/* sum (or max if @max) of the @n complete seconds before the current one */
+static void attack_history(const struct dp_vs_attack_stats *st, int n,
+			   bool max, uint64_t *out)
+{
+	uint32_t s;
+	int i, k;
+
+	memset(out, 0, sizeof(uint64_t) * DP_VS_ATTACK_MAX);
+	for (i = 1; i <= n && i < DP_VS_ATTACK_HIST; i++) {
+		s = (st->sec - i) % DP_VS_ATTACK_HIST;
+		for (k = 0; k < DP_VS_ATTACK_MAX; k++) {
+			if (!max)
+				out[k] += st->hist[s][k];
+			else if (st->hist[s][k] > out[k])
+				out[k] = st->hist[s][k];
+		}
+	}
+}
+
+static void print_attack(const uint64_t *cnt, unsigned int format)
+{
+	int k;
+
+	for (k = 0; k < DP_VS_ATTACK_MAX; k++)
+		print_largenum(cnt[k], format);
+}
+
+/* what the service is attacked with, by the rates of the last 10s */
+static void print_attack_pattern(const struct dp_vs_attack_stats *st)
+{
+	uint64_t r[DP_VS_ATTACK_MAX];
+	uint64_t junk;
+	const char *sep = " ";
+	int k;
+
+	attack_history(st, 10, false, r);
+	for (k = 0; k < DP_VS_ATTACK_MAX; k++)
+		r[k] /= 10;
+
+	/* RSTs of no connection are counted in both */
+	junk = r[DP_VS_ATTACK_BAD_COOKIE] + r[DP_VS_ATTACK_NO_CONN];
+	junk = junk > r[DP_VS_ATTACK_RST] ? junk - r[DP_VS_ATTACK_RST] : 0;
+
+	if (r[DP_VS_ATTACK_SYN] >= ATTACK_MIN_RATE &&
+	    r[DP_VS_ATTACK_ESTAB] * 2 < r[DP_VS_ATTACK_SYN]) {
+		printf("%ssyn-flood", sep);
+		sep = ",";
+	}
+	if (junk >= ATTACK_MIN_RATE) {
+		printf("%sack-flood", sep);
+		sep = ",";
+	}
+	if (r[DP_VS_ATTACK_RST] >= ATTACK_MIN_RATE) {
+		printf("%srst-flood", sep);
+		sep = ",";
+	}
+	if (r[DP_VS_ATTACK_ACK_STORM] >= ATTACK_MIN_RATE) {
+		printf("%sack-storm", sep);
+		sep = ",";
+	}
+	if (r[DP_VS_ATTACK_BLKLST] >= ATTACK_MIN_RATE) {
+		printf("%sblacklisted", sep);
+		sep = ",";
+	}
+	if (sep[0] == ' ')
+		printf(" -");
+}
+
 static void print_title(unsigned int format)
 {
-	if (format & FMT_STATS)
+	if (format & FMT_ATTACK)
+		printf("%-33s %8s %8s %8s %8s %8s %8s %8s Pattern\n"
+		       "  -> Period\n",
+		       "Prot LocalAddress:Port",
+		       "SYN", "Estab", "BadCook", "AckStorm", "RST", "Blklst",
+		       "NoConn");
+	else if (format & FMT_LIMIT)
+		printf("%-33s %8s %8s %6s %8s %-8s %8s %8s %8s\n"
+		       "  -> RemoteAddress:Port\n",
+		       "Prot LocalAddress:Port",
+		       "Rate", "Burst", "Prefix", "Conns", " Policy",
+		       "Passed", "Dropped", "Refused");
+	else if (format & FMT_RTT)
+		printf("%-33s %8s %8s %8s %8s %8s %8s %8s\n"
+		       "  -> RemoteAddress:Port\n",
+		       "Prot LocalAddress:Port",
+		       "Samples", "Avg", "P50", "P90", "P99", "P999", "Max");
+	else if (format & FMT_STATS)
 		printf("%-33s %8s %8s %8s %8s %8s\n"
 		       "  -> RemoteAddress:Port\n",
 		       "Prot LocalAddress:Port",
@@ -1785,6 +2168,9 @@ static void
 print_service_entry(ipvs_service_entry_t *se, unsigned int format, lcoreid_t cid)
 {
 	struct ip_vs_get_dests_app *d;
+	struct dp_vs_get_rtt *rtt = NULL;
+	struct dp_vs_connlimit_conf *limit = NULL;
+	struct dp_vs_get_attack *atk = NULL;
 	char svc_name[256];
 	int i;
 
@@ -1793,6 +2179,21 @@ print_service_entry(ipvs_service_entry_t *se, unsigned int format, lcoreid_t cid
 		exit(1);
 	}
 
+	if ((format & FMT_RTT) && !(rtt = ipvs_get_rtt(se, cid))) {
+		fprintf(stderr, "%s\n", ipvs_strerror(errno));
+		exit(1);
+	}
+
+	if ((format & FMT_LIMIT) && !(limit = ipvs_get_connlimit(se, cid))) {
+		fprintf(stderr, "%s\n", ipvs_strerror(errno));
+		exit(1);
+	}
+
+	if ((format & FMT_ATTACK) && !(atk = ipvs_get_attack(se, cid))) {
+		fprintf(stderr, "%s\n", ipvs_strerror(errno));
+		exit(1);
+	}
+
 	if (se->user.fwmark) {
 		if (format & FMT_RULE)
 			if (se->af == AF_INET6)
@@ -1910,6 +2311,29 @@ print_service_entry(ipvs_service_entry_t *se, unsigned int format, lcoreid_t cid
 			printf(" pe %s", se->pe_name);
 		if (se->user.flags & IP_VS_SVC_F_ONEPACKET)
 			printf(" ops");
+	} else if (format & FMT_ATTACK) {
+		printf("%-33s", svc_name);
+		print_attack(atk->stats.total, format);
+		print_attack_pattern(&atk->stats);
+	} else if (format & FMT_LIMIT) {
+		printf("%-33s", svc_name);
+		print_largenum(limit->rate, format);
+		print_largenum(limit->burst ? limit->burst : limit->rate, format);
+		if (limit->plen)
+			printf("   /%-3u", limit->plen);
+		else
+			printf(" %6s", "-");
+		print_largenum(limit->conns, format);
+		printf(" %-8s", !limit->conns ? "-" :
+		       limit->policy == DPVS_CONNLIMIT_RST ? "rst" :
+		       limit->policy == DPVS_CONNLIMIT_SYNPROXY ? "synproxy" :
+		       "drop");
+		print_largenum(limit->passed, format);
+		print_largenum(limit->rate_drops, format);
+		print_largenum(limit->conn_drops, format);
+	} else if (format & FMT_RTT) {
+		printf("%-33s", svc_name);
+		print_rtt(&rtt->svc, format);
 	} else if (format & FMT_STATS) {
 		printf("%-33s", svc_name);
 		print_largenum(se->stats.conns, format);
@@ -1951,11 +2375,35 @@ print_service_entry(ipvs_service_entry_t *se, unsigned int format, lcoreid_t cid
 		}
 		if (se->user.flags & IP_VS_CONN_F_SYNPROXY)
 			printf(" synproxy");
+		if (se->user.flags & IP_VS_CONN_F_SYNPROXY_AUTO)
+			printf(" synproxy-auto%s",
+			       se->user.flags & IP_VS_SVC_F_SYNPROXY_ON ? " (on)" : "");
         if (se->user.conn_timeout != 0)
             printf(" conn_timeout %u", se->user.conn_timeout);
 	}
 	printf("\n");
 
+	/* counters are per service, its history takes the place of the dests */
+	if (format & FMT_ATTACK) {
+		uint64_t cnt[DP_VS_ATTACK_MAX];
+
+		attack_history(&atk->stats, 1, false, cnt);
+		printf("  -> %-28s", "last 1s");
+		print_attack(cnt, format);
+		printf("\n");
+		attack_history(&atk->stats, 10, false, cnt);
+		printf("  -> %-28s", "last 10s");
+		print_attack(cnt, format);
+		printf("\n");
+		attack_history(&atk->stats, DP_VS_ATTACK_HIST - 1, true, cnt);
+		printf("  -> %-28s", "max 1s of last 1m");
+		print_attack(cnt, format);
+		printf("\n");
+		free(atk);
+		free(d);
+		return;
+	}
+
 	/* print all the destination entries */
 	if (!(format & FMT_NOSORT))
 		ipvs_sort_dests(d, ipvs_cmp_dests);
@@ -1975,6 +2423,16 @@ print_service_entry(ipvs_service_entry_t *se, unsigned int format, lcoreid_t cid
 		if (format & FMT_RULE) {
 			printf("-a %s -r %s %s -w %d\n", svc_name, dname,
 			       fwd_switch(e->user.conn_flags), e->user.weight);
+		} else if (format & FMT_LIMIT) {
+			/* limits are per service */
+			printf("  -> %s\n", dname);
+		} else if (format & FMT_RTT) {
+			const struct dp_vs_rtt_hist *h = find_dest_rtt(rtt, e);
+			static const struct dp_vs_rtt_hist none;
+
+			printf("  -> %-28s", dname);
+			print_rtt(h ? h : &none, format);
+			printf("\n");
 		} else if (format & FMT_STATS) {
 			printf("  -> %-28s", dname);
 			print_largenum(e->stats.conns, format);
@@ -2005,6 +2463,8 @@ print_service_entry(ipvs_service_entry_t *se, unsigned int format, lcoreid_t cid
 			       e->user.weight, e->user.activeconns, e->user.inactconns);
 		free(dname);
 	}
+	free(limit);
+	free(rtt);
 	free(d);
 }
 
@@ -2117,31 +2577,77 @@ static int list_all_laddrs(lcoreid_t cid)
 
 static void list_blklsts_print_title(void)
 {
-	printf("%-20s %-8s %-20s\n" ,
+	printf("%-46s %-8s %-44s %-6s %-17s %s\n" ,
 		"VIP:VPORT" ,
 		"PROTO" ,
-		"BLACKLIST");
+		"BLACKLIST" ,
+		"ACTION" ,
+		"FLAGS" ,
+		"HITS");
+}
+
+static void print_tcp_flags(char *buf, uint8_t flags, uint8_t mask)
+{
+	int i, n = 0;
+
+	if (!mask) {
+		strcpy(buf, "-");
+		return;
+	}
+	for (i = 0; i < 8; i++) {
+		if (flags & (1 << i))
+			buf[n++] = tcp_flag_letters[i];
+	}
+	if (mask != flags) {
+		buf[n++] = '/';
+		for (i = 0; i < 8; i++) {
+			if (mask & (1 << i))
+				buf[n++] = tcp_flag_letters[i];
+		}
+	}
+	buf[n] = '\0';
 }
 
 static void print_service_and_blklsts(struct dp_vs_blklst_conf *blklst)
 {
-	char pbuf_v[32], pbuf_d[32], port[6];
-	sprintf(pbuf_v , "%u.%u.%u.%u" , PRINT_NIP(blklst->vaddr.in.s_addr));
-	sprintf(pbuf_d , "%u.%u.%u.%u" , PRINT_NIP(blklst->blklst.in.s_addr));
-	sprintf(port, "%d", ntohs(blklst->vport));
-	if (blklst->proto ==IPPROTO_TCP)
-		printf("%s:%-8s %-8s %-20s\n" , pbuf_v, port, "TCP", pbuf_d);
-	else if(blklst->proto ==IPPROTO_UDP)
-		printf("%s:%-8s %-8s %-20s\n" , pbuf_v, port, "UDP", pbuf_d);
+	char vip[INET6_ADDRSTRLEN], src[INET6_ADDRSTRLEN];
+	char vbuf[64], sbuf[64], fbuf[18];
+	const char *proto;
+
+	if (blklst->proto == IPPROTO_TCP)
+		proto = "TCP";
+	else if (blklst->proto == IPPROTO_UDP)
+		proto = "UDP";
 	else if (blklst->proto == IPPROTO_ICMP)
-		printf("%s:%-8s %-8s %-20s\n" , pbuf_v, port, "ICMP", pbuf_d);
-	else
+		proto = "ICMP";
+	else {
 		printf("proto not support!");
+		return;
+	}
+
+	inet_ntop(blklst->af, &blklst->vaddr, vip, sizeof(vip));
+	inet_ntop(blklst->af, &blklst->blklst, src, sizeof(src));
+	if (blklst->af == AF_INET6)
+		snprintf(vbuf, sizeof(vbuf), "[%s]:%d", vip, ntohs(blklst->vport));
+	else
+		snprintf(vbuf, sizeof(vbuf), "%s:%d", vip, ntohs(blklst->vport));
+	if (blklst->plen && blklst->plen != (blklst->af == AF_INET6 ? 128 : 32))
+		snprintf(sbuf, sizeof(sbuf), "%s/%u", src, blklst->plen);
+	else
+		snprintf(sbuf, sizeof(sbuf), "%s", src);
+
+	print_tcp_flags(fbuf, blklst->tcp_flags, blklst->tcp_flags_mask);
+
+	printf("%-46s %-8s %-44s %-6s %-17s %llu\n", vbuf, proto, sbuf,
+	       blklst->action == DPVS_BLKLST_ALLOW ? "allow" : "deny", fbuf,
+	       (unsigned long long)blklst->hits);
 }
 
-static int list_blklst(uint32_t addr_v4, uint16_t port, uint16_t protocol)
+static int list_blklst(int af, const union nf_inet_addr *addr, uint16_t port,
+		       uint16_t protocol)
 {
 	struct dp_vs_blklst_conf_array *get;
+	size_t alen = (af == AF_INET6) ? sizeof(struct in6_addr) : sizeof(struct in_addr);
 	int i;
 	if (!(get = ipvs_get_blklsts())) {
 		fprintf(stderr, "%s\n", ipvs_strerror(errno));
@@ -2149,9 +2655,10 @@ static int list_blklst(uint32_t addr_v4, uint16_t port, uint16_t protocol)
 	}
 
 	for (i = 0; i < get->naddr; i++) {
-		if ( addr_v4== get->blklsts[i].vaddr.in.s_addr &&
-		     port == get->blklsts[i].vport&&
-		     protocol == get->blklsts[i].proto) {
+		if (af == get->blklsts[i].af &&
+		    !memcmp(addr, &get->blklsts[i].vaddr, alen) &&
+		    port == get->blklsts[i].vport &&
+		    protocol == get->blklsts[i].proto) {
 			print_service_and_blklsts(&get->blklsts[i]);
 		}
 	}
@@ -2171,7 +2678,8 @@ static int list_all_blklsts(void)
 
 	list_blklsts_print_title();
 	for (i = 0; i < get->user.num_services; i++)
-		list_blklst(get->user.entrytable[i].user.__addr_v4, get->user.entrytable[i].user.port,
+		list_blklst(get->user.entrytable[i].af, &get->user.entrytable[i].nf_addr,
+				get->user.entrytable[i].user.port,
 				get->user.entrytable[i].user.protocol);
 	free(get);
 	return 0;
@@ -60,6 +60,7 @@
 #include "bitops.h"
 #include "keepalived_netlink.h"
 #include "check_print.h"
+#include "libipvs.h"
 #ifdef _WITH_SNMP_CHECKER_
   #include "check_snmp.h"
 #endif
@@ -301,6 +302,8 @@ stop_check(int status)
 static void
 start_check(list old_checkers_queue, data_t *prev_global_data)
 {
+	int ret, failed;
+
 	init_checkers_queue();
 
 	/* Parse configuration file */
@@ -381,6 +384,10 @@ start_check(list old_checkers_queue, data_t *prev_global_data)
 	if (check_data->ssl_required && !init_ssl_ctx())
 		stop_check(KEEPALIVED_EXIT_FATAL);
 
+	/* Queue service/dest changes below and send them in a few batches */
+	if (ipvs_batch_begin(DP_VS_SVC_BATCH_F_IDEMPOTENT))
+		log_message(LOG_INFO, "IPVS: batching disabled, applying changes one by one");
+
 	/* Processing differential configuration parsing */
 	if (reload) {
 		clear_diff_services(old_checkers_queue);
@@ -402,6 +409,10 @@ start_check(list old_checkers_queue, data_t *prev_global_data)
 		if (!init_services())
 			stop_check(KEEPALIVED_EXIT_FATAL);
 	}
+
+	if ((ret = ipvs_batch_commit(&failed)))
+		log_message(LOG_ERR, "IPVS: batched service update failed at op %d (err %d)",
+			    failed, ret);
 	
 	checker_queue_adj();
 
@@ -432,7 +432,8 @@ dump_vs(FILE *fp, const void *data)
 	if (vs->vip_bind_dev)
 		conf_write(fp, "   vip_bind_dev = %s", vs->blklst_addr_gname);
 
-	conf_write(fp, " SYN proxy is %s", vs->syn_proxy ? "ON" : "OFF");
+	conf_write(fp, " SYN proxy is %s", vs->syn_proxy == 2 ? "AUTO" :
+					   vs->syn_proxy ? "ON" : "OFF");
 
         switch (vs->hash_target) {
 	case IP_VS_SVC_F_SIP_HASH:
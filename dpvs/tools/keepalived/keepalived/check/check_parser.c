@@ -51,7 +51,7 @@
 
 /* List of valid schedulers */
 static const char *lvs_schedulers[] =
-	{"rr", "wrr", "lc", "wlc", "lblc", "sh", "mh", "dh", "fo", "ovf", "lblcr", "sed", "nq", NULL};
+	{"rr", "wrr", "lc", "wlc", "lblc", "sh", "mh", "dh", "fo", "ovf", "lblcr", "sed", "nq", "lbw", NULL};
 
 /* SSL handlers */
 static void
@@ -965,7 +965,12 @@ static void
 syn_proxy_handler(const vector_t *strvec)
 {
 	virtual_server_t *vs = LIST_TAIL_DATA(check_data->vs);
-	vs->syn_proxy = 1;
+
+	/* "syn_proxy auto": on under SYN flood only */
+	if (vector_size(strvec) >= 2 && !strcmp(strvec_slot(strvec, 1), "auto"))
+		vs->syn_proxy = 2;
+	else
+		vs->syn_proxy = 1;
 }
 
 static void
@@ -786,7 +786,9 @@ ipvs_set_srule(int cmd, ipvs_service_t *srule, virtual_server_t *vs)
 			srule->user.netmask = vs->persistence_granularity;
 	}
 
-	if (vs->syn_proxy) {
+	if (vs->syn_proxy == 2) {
+		srule->user.flags |= IP_VS_CONN_F_SYNPROXY_AUTO;
+	} else if (vs->syn_proxy) {
 		srule->user.flags |= IP_VS_CONN_F_SYNPROXY;
 	}
 
@@ -268,6 +268,138 @@ typedef struct dp_vs_service_entry_app {
 void ipvs_service_entry_2_user(const ipvs_service_entry_t *entry, ipvs_service_t *user);
 struct ip_vs_getinfo g_ipvs_info;
 
+/* service/dest set ops queued between ipvs_batch_begin and ipvs_batch_commit */
+static struct dp_vs_svc_batch *svc_batch;
+static int svc_batch_err;
+static int svc_batch_failed;	/* index of the first failed op, -1 if none */
+static int svc_batch_base;	/* index of the first op of the pending chunk */
+
+static void ipvs_batch_fail(int idx, int err)
+{
+	if (!svc_batch_err) {
+		svc_batch_err = err;
+		svc_batch_failed = idx;
+	}
+}
+
+/*
+ * dpvs stops a chunk at its first failed op and does not tell which one.
+ * ops are idempotent in DP_VS_SVC_BATCH_F_IDEMPOTENT mode, so the chunk is
+ * replayed one op at a time to find it and to apply the ops after it.
+ * otherwise the ops of the chunk from the failed one on are lost, and
+ * the chunk's first op is reported.
+ */
+static int ipvs_batch_send(void)
+{
+	struct {
+		struct dp_vs_svc_batch hdr;
+		struct dp_vs_svc_batch_op op;
+	} one;
+	size_t len;
+	uint32_t i;
+	int ret, err;
+
+	if (!svc_batch || !svc_batch->nops)
+		return 0;
+
+	len = sizeof(*svc_batch) + svc_batch->nops * sizeof(struct dp_vs_svc_batch_op);
+	ret = dpvs_setsockopt(DPVS_SO_SET_BATCH, svc_batch, len);
+	if (ret) {
+		if (svc_batch->flags & DP_VS_SVC_BATCH_F_IDEMPOTENT) {
+			one.hdr.flags = svc_batch->flags;
+			one.hdr.nops = 1;
+			for (i = 0; i < svc_batch->nops; i++) {
+				memcpy(&one.op, &svc_batch->ops[i], sizeof(one.op));
+				err = dpvs_setsockopt(DPVS_SO_SET_BATCH, &one, sizeof(one));
+				if (err)
+					ipvs_batch_fail(svc_batch_base + i, err);
+			}
+		} else
+			ipvs_batch_fail(svc_batch_base, ret);
+	}
+
+	svc_batch_base += svc_batch->nops;
+	svc_batch->nops = 0;
+
+	return ret;
+}
+
+/* anything but a batchable op sends the pending batch first to keep order */
+static int ipvs_setsockopt(sockoptid_t cmd, const void *in, size_t in_len)
+{
+	struct dp_vs_svc_batch_op *op;
+
+	if (!svc_batch || cmd < DPVS_SO_SET_FLUSH || cmd > DPVS_SO_SET_DELDEST ||
+	    in_len > MAX_ARG_LEN) {
+		ipvs_batch_send();
+		return dpvs_setsockopt(cmd, in, in_len);
+	}
+
+	op = &svc_batch->ops[svc_batch->nops++];
+	op->opt = cmd;
+	op->len = in_len;
+	if (in_len)
+		memcpy(op->arg, in, in_len);
+
+	if (svc_batch->nops == DP_VS_SVC_BATCH_MAX)
+		return ipvs_batch_send();
+
+	return 0;
+}
+
+static int ipvs_getsockopt(sockoptid_t cmd, const void *in, size_t in_len,
+			   void **out, size_t *out_len)
+{
+	ipvs_batch_send();
+	return dpvs_getsockopt(cmd, in, in_len, out, out_len);
+}
+
+int ipvs_batch_begin(unsigned int flags)
+{
+	if (svc_batch)
+		return EINVAL;
+
+	svc_batch = malloc(sizeof(*svc_batch) +
+			   DP_VS_SVC_BATCH_MAX * sizeof(struct dp_vs_svc_batch_op));
+	if (!svc_batch)
+		return ENOMEM;
+
+	svc_batch->flags = flags;
+	svc_batch->nops = 0;
+	svc_batch_err = 0;
+	svc_batch_failed = -1;
+	svc_batch_base = 0;
+
+	return 0;
+}
+
+/*
+ * returns the first error of the transaction and sets @failed to the index
+ * (counted from ipvs_batch_begin) of the op that caused it, -1 if none.
+ */
+int ipvs_batch_commit(int *failed)
+{
+	int ret;
+
+	if (failed)
+		*failed = -1;
+	if (!svc_batch)
+		return 0;
+
+	ipvs_batch_send();
+	ret = svc_batch_err;
+	if (failed)
+		*failed = svc_batch_failed;
+
+	free(svc_batch);
+	svc_batch = NULL;
+	svc_batch_err = 0;
+	svc_batch_failed = -1;
+	svc_batch_base = 0;
+
+	return ret;
+}
+
 int ipvs_init(lcoreid_t cid)
 {
 	//socklen_t len, len_rcv;
@@ -284,7 +416,7 @@ int ipvs_init(lcoreid_t cid)
 #endif
 	len_rcv = len = sizeof(g_ipvs_info);
 
-	if (dpvs_getsockopt(DPVS_SO_GET_INFO, (const void*)&g_ipvs_info, len, (void **)&ipvs_info_rcv, &len_rcv)) {
+	if (ipvs_getsockopt(DPVS_SO_GET_INFO, (const void*)&g_ipvs_info, len, (void **)&ipvs_info_rcv, &len_rcv)) {
 		return -1;
 	}
 
@@ -297,7 +429,7 @@ int ipvs_init(lcoreid_t cid)
 
 int ipvs_flush(void)
 {
-	return dpvs_setsockopt(DPVS_SO_SET_FLUSH, NULL, 0);
+	return ipvs_setsockopt(DPVS_SO_SET_FLUSH, NULL, 0);
 }
 
 int ipvs_add_service(ipvs_service_t *svc)
@@ -308,7 +440,7 @@ int ipvs_add_service(ipvs_service_t *svc)
 
 	IPVS_2_DPVS((&dpvs_svc), svc);
 
-	return dpvs_setsockopt(DPVS_SO_SET_ADD, &dpvs_svc, sizeof(dpvs_svc));
+	return ipvs_setsockopt(DPVS_SO_SET_ADD, &dpvs_svc, sizeof(dpvs_svc));
 }
 
 
@@ -320,7 +452,7 @@ int ipvs_update_service(ipvs_service_t *svc)
 
 	IPVS_2_DPVS((&dpvs_svc), svc);
 
-	return dpvs_setsockopt(DPVS_SO_SET_ADD, &dpvs_svc, sizeof(dpvs_svc));
+	return ipvs_setsockopt(DPVS_SO_SET_ADD, &dpvs_svc, sizeof(dpvs_svc));
 }
 
 int ipvs_update_service_by_options(ipvs_service_t *svc, unsigned int options)
@@ -355,11 +487,9 @@ int ipvs_update_service_by_options(ipvs_service_t *svc, unsigned int options)
 	}
 
 	if( options & OPT_SYNPROXY ) {
-		if( svc->user.flags & IP_VS_CONN_F_SYNPROXY ) {
-			app.user.flags |= IP_VS_CONN_F_SYNPROXY;
-		} else {
-			app.user.flags &= ~IP_VS_CONN_F_SYNPROXY;
-		}
+		app.user.flags &= ~(IP_VS_CONN_F_SYNPROXY | IP_VS_CONN_F_SYNPROXY_AUTO);
+		app.user.flags |= svc->user.flags &
+				  (IP_VS_CONN_F_SYNPROXY | IP_VS_CONN_F_SYNPROXY_AUTO);
 	}
 
 	if( options & OPT_ONEPACKET ) {
@@ -411,7 +541,7 @@ int ipvs_del_service(ipvs_service_t *svc)
 
 	IPVS_2_DPVS((&dpvs_svc), svc);
 
-	return dpvs_setsockopt(DPVS_SO_SET_DEL, &dpvs_svc, sizeof(dpvs_svc));
+	return ipvs_setsockopt(DPVS_SO_SET_DEL, &dpvs_svc, sizeof(dpvs_svc));
 }
 
 
@@ -423,7 +553,7 @@ int ipvs_zero_service(ipvs_service_t *svc)
 
 	IPVS_2_DPVS((&dpvs_svc), svc);
 
-	return dpvs_setsockopt(DPVS_SO_SET_ZERO, &dpvs_svc, sizeof(dpvs_svc));
+	return ipvs_setsockopt(DPVS_SO_SET_ZERO, &dpvs_svc, sizeof(dpvs_svc));
 }
 
 int ipvs_add_dest(ipvs_service_t *svc, ipvs_dest_t *dest)
@@ -437,7 +567,7 @@ int ipvs_add_dest(ipvs_service_t *svc, ipvs_dest_t *dest)
 	IPVS_2_DPVS(dpvs_svc_ptr, svc);
 	IPRS_2_DPRS(dpvs_dest_ptr, dest);
 
-	return dpvs_setsockopt(DPVS_SO_SET_ADDDEST, &svcdest, sizeof(svcdest));
+	return ipvs_setsockopt(DPVS_SO_SET_ADDDEST, &svcdest, sizeof(svcdest));
 }
 
 
@@ -452,7 +582,7 @@ int ipvs_update_dest(ipvs_service_t *svc, ipvs_dest_t *dest)
 	IPVS_2_DPVS(dpvs_svc_ptr, svc);
 	IPRS_2_DPRS(dpvs_dest_ptr, dest);
 
-	return dpvs_setsockopt(DPVS_SO_SET_EDITDEST, &svcdest, sizeof(svcdest));
+	return ipvs_setsockopt(DPVS_SO_SET_EDITDEST, &svcdest, sizeof(svcdest));
 }
 
 
@@ -467,7 +597,7 @@ int ipvs_del_dest(ipvs_service_t *svc, ipvs_dest_t *dest)
 	IPVS_2_DPVS(dpvs_svc_ptr, svc);
 	IPRS_2_DPRS(dpvs_dest_ptr, dest);
 
-	return dpvs_setsockopt(DPVS_SO_SET_DELDEST, &svcdest, sizeof(svcdest));
+	return ipvs_setsockopt(DPVS_SO_SET_DELDEST, &svcdest, sizeof(svcdest));
 }
 
 static void ipvs_fill_laddr_conf(ipvs_service_t *svc, ipvs_laddr_t *laddr, 
@@ -527,7 +657,7 @@ int ipvs_add_laddr(ipvs_service_t *svc, ipvs_laddr_t * laddr)
 	ipvs_fill_ipaddr_conf(1, 0, laddr, &param);
 	ipvs_set_ipaddr(&param, 1);
 
-	return dpvs_setsockopt(SOCKOPT_SET_LADDR_ADD, &conf, sizeof(conf));
+	return ipvs_setsockopt(SOCKOPT_SET_LADDR_ADD, &conf, sizeof(conf));
 }
 
 int ipvs_del_laddr(ipvs_service_t *svc, ipvs_laddr_t * laddr)
@@ -539,7 +669,7 @@ int ipvs_del_laddr(ipvs_service_t *svc, ipvs_laddr_t * laddr)
 	ipvs_fill_ipaddr_conf(0, 0, laddr, &param);
 	ipvs_set_ipaddr(&param, 0);
 
-	return dpvs_setsockopt(SOCKOPT_SET_LADDR_DEL, &conf, sizeof(conf));
+	return ipvs_setsockopt(SOCKOPT_SET_LADDR_DEL, &conf, sizeof(conf));
 }
 
 /*for black list*/
@@ -551,6 +681,10 @@ static void ipvs_fill_blklst_conf(ipvs_service_t *svc, ipvs_blklst_t *blklst,
 	conf->proto     = svc->user.protocol;
 	conf->vport     = svc->user.port;
 	conf->fwmark    = svc->user.fwmark;
+	conf->plen      = blklst->plen;
+	conf->action    = blklst->action;
+	conf->tcp_flags = blklst->tcp_flags;
+	conf->tcp_flags_mask = blklst->tcp_flags_mask;
 	if (svc->af == AF_INET) {
 		conf->vaddr.in = svc->nf_addr.in;
 		conf->blklst.in = blklst->addr.in;
@@ -568,7 +702,7 @@ int ipvs_add_blklst(ipvs_service_t *svc, ipvs_blklst_t *blklst)
 
 	ipvs_fill_blklst_conf(svc, blklst, &conf);
 
-	return dpvs_setsockopt(SOCKOPT_SET_BLKLST_ADD, &conf, sizeof(conf));
+	return ipvs_setsockopt(SOCKOPT_SET_BLKLST_ADD, &conf, sizeof(conf));
 }
 
 int ipvs_del_blklst(ipvs_service_t *svc, ipvs_blklst_t * blklst)
@@ -577,7 +711,7 @@ int ipvs_del_blklst(ipvs_service_t *svc, ipvs_blklst_t * blklst)
 
 	ipvs_fill_blklst_conf(svc, blklst, &conf);
 
-	return dpvs_setsockopt(SOCKOPT_SET_BLKLST_DEL, &conf, sizeof(conf));
+	return ipvs_setsockopt(SOCKOPT_SET_BLKLST_DEL, &conf, sizeof(conf));
 }
 
 /* for tunnel entry */
@@ -599,7 +733,7 @@ int ipvs_add_tunnel(ipvs_tunnel_t* tunnel_entry)
 	struct ip_tunnel_param conf;
 	ipvs_fill_tunnel_conf(tunnel_entry, &conf);
 	ipvs_func = ipvs_add_tunnel;
-	return dpvs_setsockopt(SOCKOPT_TUNNEL_ADD, &conf, sizeof(conf));
+	return ipvs_setsockopt(SOCKOPT_TUNNEL_ADD, &conf, sizeof(conf));
 }
 
 int ipvs_del_tunnel(ipvs_tunnel_t* tunnel_entry)
@@ -607,7 +741,7 @@ int ipvs_del_tunnel(ipvs_tunnel_t* tunnel_entry)
 	struct ip_tunnel_param conf;
 	ipvs_fill_tunnel_conf(tunnel_entry, &conf);
 	ipvs_func = ipvs_del_tunnel;
-	return dpvs_setsockopt(SOCKOPT_TUNNEL_DEL, &conf, sizeof(conf));
+	return ipvs_setsockopt(SOCKOPT_TUNNEL_DEL, &conf, sizeof(conf));
 }
 
 int ipvs_set_timeout(ipvs_timeout_t *to)
@@ -619,21 +753,32 @@ int ipvs_set_timeout(ipvs_timeout_t *to)
 }
 
 
+static void ipvs_fill_sync_conf(const ipvs_daemon_t *dm,
+				struct dp_vs_sync_daemon_conf *conf)
+{
+	memset(conf, 0, sizeof(*conf));
+	conf->state = dm->state;
+	strncpy(conf->mcast_ifn, dm->mcast_ifn, sizeof(conf->mcast_ifn) - 1);
+	conf->syncid = dm->syncid;
+}
+
 int ipvs_start_daemon(ipvs_daemon_t *dm)
 {
-	ipvs_func = ipvs_start_daemon;
+	struct dp_vs_sync_daemon_conf conf;
 
-	return setsockopt(sockfd, IPPROTO_IP, IP_VS_SO_SET_STARTDAEMON,
-			  (char *)&dm, sizeof(dm));
+	ipvs_fill_sync_conf(dm, &conf);
+	ipvs_func = ipvs_start_daemon;
+	return ipvs_setsockopt(SOCKOPT_SET_SYNC_START, &conf, sizeof(conf));
 }
 
 
 int ipvs_stop_daemon(ipvs_daemon_t *dm)
 {
-	ipvs_func = ipvs_stop_daemon;
+	struct dp_vs_sync_daemon_conf conf;
 
-	return setsockopt(sockfd, IPPROTO_IP, IP_VS_SO_SET_STOPDAEMON,
-			  (char *)&dm, sizeof(dm));
+	ipvs_fill_sync_conf(dm, &conf);
+	ipvs_func = ipvs_stop_daemon;
+	return ipvs_setsockopt(SOCKOPT_SET_SYNC_STOP, &conf, sizeof(conf));
 }
 
 static inline sockoptid_t  cpu2opt_svc(lcoreid_t cid, sockoptid_t old_opt)
@@ -668,7 +813,7 @@ struct ip_vs_get_services_app *ipvs_get_services(lcoreid_t cid)
 	}
 	dpvs_get->num_services = g_ipvs_info.num_services;
 	dpvs_get->cid = cid;
-	if (dpvs_getsockopt(cpu2opt_svc(cid, DPVS_SO_GET_SERVICES), dpvs_get, len, (void **)&dpvs_get_rcv, &len_rcv)) {
+	if (ipvs_getsockopt(cpu2opt_svc(cid, DPVS_SO_GET_SERVICES), dpvs_get, len, (void **)&dpvs_get_rcv, &len_rcv)) {
 		free(get);
 		free(dpvs_get);
 		return NULL;
@@ -726,7 +871,7 @@ struct ip_vs_get_dests_app *ipvs_get_dests(ipvs_service_entry_t *svc, lcoreid_t
 	snprintf(dpvs_dests->iifname, sizeof(dpvs_dests->iifname), "%s", svc->user.iifname);
 	snprintf(dpvs_dests->oifname, sizeof(dpvs_dests->oifname), "%s", svc->user.oifname);
 
-	if (dpvs_getsockopt(cpu2opt_svc(cid, DPVS_SO_GET_DESTS), dpvs_dests, len, (void **)&dpvs_dests_rcv, &len_rcv) < 0) {
+	if (ipvs_getsockopt(cpu2opt_svc(cid, DPVS_SO_GET_DESTS), dpvs_dests, len, (void **)&dpvs_dests_rcv, &len_rcv) < 0) {
 		free(d);
 		free(dpvs_dests);
 		return NULL;
@@ -758,6 +903,144 @@ struct ip_vs_get_dests_app *ipvs_get_dests(ipvs_service_entry_t *svc, lcoreid_t
 }
 
 
+/* RTT histograms of a service and its dests, free() the result */
+struct dp_vs_get_rtt *ipvs_get_rtt(ipvs_service_entry_t *svc, lcoreid_t cid)
+{
+	struct dp_vs_get_rtt get, *rtt, *rtt_rcv;
+	size_t len_rcv = 0;
+
+	ipvs_func = ipvs_get_rtt;
+
+	memset(&get, 0, sizeof(get));
+	get.af = svc->af;
+	get.fwmark = svc->user.fwmark;
+	get.proto = svc->user.protocol;
+	memcpy(&get.addr, &svc->nf_addr, sizeof(svc->nf_addr));
+	get.port = svc->user.port;
+	get.num_dests = svc->user.num_dests;
+	get.cid = cid;
+	snprintf(get.srange, sizeof(get.srange), "%s", svc->user.srange);
+	snprintf(get.drange, sizeof(get.drange), "%s", svc->user.drange);
+	snprintf(get.iifname, sizeof(get.iifname), "%s", svc->user.iifname);
+	snprintf(get.oifname, sizeof(get.oifname), "%s", svc->user.oifname);
+
+	if (ipvs_getsockopt(SOCKOPT_GET_SVC_RTT, &get, sizeof(get),
+			    (void **)&rtt_rcv, &len_rcv))
+		return NULL;
+
+	if (len_rcv < sizeof(*rtt_rcv)
+		|| len_rcv != sizeof(*rtt_rcv) + \
+		rtt_rcv->num_dests * sizeof(struct dp_vs_rtt_entry)) {
+		dpvs_sockopt_msg_free(rtt_rcv);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!(rtt = malloc(len_rcv))) {
+		dpvs_sockopt_msg_free(rtt_rcv);
+		return NULL;
+	}
+	memcpy(rtt, rtt_rcv, len_rcv);
+	dpvs_sockopt_msg_free(rtt_rcv);
+	return rtt;
+}
+
+int ipvs_set_connlimit(ipvs_service_t *svc, struct dp_vs_connlimit_conf *conf)
+{
+	ipvs_func = ipvs_set_connlimit;
+
+	conf->af = svc->af;
+	conf->proto = svc->user.protocol;
+	memcpy(&conf->addr, &svc->nf_addr, sizeof(svc->nf_addr));
+	conf->port = svc->user.port;
+	conf->fwmark = svc->user.fwmark;
+	snprintf(conf->srange, sizeof(conf->srange), "%s", svc->user.srange);
+	snprintf(conf->drange, sizeof(conf->drange), "%s", svc->user.drange);
+	snprintf(conf->iifname, sizeof(conf->iifname), "%s", svc->user.iifname);
+	snprintf(conf->oifname, sizeof(conf->oifname), "%s", svc->user.oifname);
+
+	return ipvs_setsockopt(SOCKOPT_SET_CONNLIMIT, conf, sizeof(*conf));
+}
+
+struct dp_vs_connlimit_conf *ipvs_get_connlimit(ipvs_service_entry_t *svc,
+						 lcoreid_t cid)
+{
+	struct dp_vs_connlimit_conf get, *limit, *limit_rcv;
+	size_t len_rcv = 0;
+
+	ipvs_func = ipvs_get_connlimit;
+
+	memset(&get, 0, sizeof(get));
+	get.af = svc->af;
+	get.fwmark = svc->user.fwmark;
+	get.proto = svc->user.protocol;
+	memcpy(&get.addr, &svc->nf_addr, sizeof(svc->nf_addr));
+	get.port = svc->user.port;
+	get.cid = cid;
+	snprintf(get.srange, sizeof(get.srange), "%s", svc->user.srange);
+	snprintf(get.drange, sizeof(get.drange), "%s", svc->user.drange);
+	snprintf(get.iifname, sizeof(get.iifname), "%s", svc->user.iifname);
+	snprintf(get.oifname, sizeof(get.oifname), "%s", svc->user.oifname);
+
+	if (ipvs_getsockopt(SOCKOPT_GET_CONNLIMIT, &get, sizeof(get),
+			    (void **)&limit_rcv, &len_rcv))
+		return NULL;
+
+	if (len_rcv != sizeof(*limit_rcv)) {
+		dpvs_sockopt_msg_free(limit_rcv);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!(limit = malloc(len_rcv))) {
+		dpvs_sockopt_msg_free(limit_rcv);
+		return NULL;
+	}
+	memcpy(limit, limit_rcv, len_rcv);
+	dpvs_sockopt_msg_free(limit_rcv);
+	return limit;
+}
+
+/* anomaly counters and their history of a service, free() the result */
+struct dp_vs_get_attack *ipvs_get_attack(ipvs_service_entry_t *svc,
+					 lcoreid_t cid)
+{
+	struct dp_vs_get_attack get, *atk, *atk_rcv;
+	size_t len_rcv = 0;
+
+	ipvs_func = ipvs_get_attack;
+
+	memset(&get, 0, sizeof(get));
+	get.af = svc->af;
+	get.fwmark = svc->user.fwmark;
+	get.proto = svc->user.protocol;
+	memcpy(&get.addr, &svc->nf_addr, sizeof(svc->nf_addr));
+	get.port = svc->user.port;
+	get.cid = cid;
+	snprintf(get.srange, sizeof(get.srange), "%s", svc->user.srange);
+	snprintf(get.drange, sizeof(get.drange), "%s", svc->user.drange);
+	snprintf(get.iifname, sizeof(get.iifname), "%s", svc->user.iifname);
+	snprintf(get.oifname, sizeof(get.oifname), "%s", svc->user.oifname);
+
+	if (ipvs_getsockopt(SOCKOPT_GET_SVC_ATTACK, &get, sizeof(get),
+			    (void **)&atk_rcv, &len_rcv))
+		return NULL;
+
+	if (len_rcv != sizeof(*atk_rcv)) {
+		dpvs_sockopt_msg_free(atk_rcv);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!(atk = malloc(len_rcv))) {
+		dpvs_sockopt_msg_free(atk_rcv);
+		return NULL;
+	}
+	memcpy(atk, atk_rcv, len_rcv);
+	dpvs_sockopt_msg_free(atk_rcv);
+	return atk;
+}
+
 ipvs_service_entry_t *
 ipvs_get_service(ipvs_service_t *hint, lcoreid_t cid)
 {
@@ -784,7 +1067,7 @@ ipvs_get_service(ipvs_service_t *hint, lcoreid_t cid)
 	memcpy(&dpvs_svc, dpvs_app_ptr, sizeof(dpvs_app));
 	dpvs_svc.user.cid = cid;
 
-	if (dpvs_getsockopt(cpu2opt_svc(cid, DPVS_SO_GET_SERVICE), 
+	if (ipvs_getsockopt(cpu2opt_svc(cid, DPVS_SO_GET_SERVICE), 
 		&dpvs_svc, 
 		len, 
 		(void **)&dpvs_svc_rcv, 
@@ -867,11 +1150,11 @@ int ipvs_set_route(struct dp_vs_route_conf* rt, int cmd)
 {
     int err = -1;
     if (cmd == IPROUTE_DEL){
-        err = dpvs_setsockopt(SOCKOPT_SET_ROUTE_DEL, rt, sizeof(struct dp_vs_route_conf));
+        err = ipvs_setsockopt(SOCKOPT_SET_ROUTE_DEL, rt, sizeof(struct dp_vs_route_conf));
         free(rt);
     }
     else if (cmd == IPROUTE_ADD){
-        err = dpvs_setsockopt(SOCKOPT_SET_ROUTE_ADD, rt, sizeof(struct dp_vs_route_conf));
+        err = ipvs_setsockopt(SOCKOPT_SET_ROUTE_ADD, rt, sizeof(struct dp_vs_route_conf));
         free(rt);
     }
     return err;
@@ -882,11 +1165,11 @@ int ipvs_set_route6(struct dp_vs_route6_conf *rt6_cfg, int cmd)
     int err = -1;
     if (cmd == IPROUTE_DEL) {
         rt6_cfg->ops = RT6_OPS_DEL;
-        err = dpvs_setsockopt(SOCKOPT_SET_ROUTE6_ADD_DEL, rt6_cfg, 
+        err = ipvs_setsockopt(SOCKOPT_SET_ROUTE6_ADD_DEL, rt6_cfg, 
                               sizeof(struct dp_vs_route6_conf));
     } else if (cmd == IPROUTE_ADD) {
         rt6_cfg->ops = RT6_OPS_ADD;
-        err = dpvs_setsockopt(SOCKOPT_SET_ROUTE6_ADD_DEL, rt6_cfg,
+        err = ipvs_setsockopt(SOCKOPT_SET_ROUTE6_ADD_DEL, rt6_cfg,
                               sizeof(struct dp_vs_route6_conf));
     }
     return err;
@@ -896,15 +1179,15 @@ int ipvs_set_ipaddr(struct inet_addr_param *param, int cmd)
 {
    int err = -1;
    if (cmd == IPADDRESS_DEL)
-       err = dpvs_setsockopt(SOCKOPT_SET_IFADDR_DEL, param, sizeof(struct inet_addr_param)); 
+       err = ipvs_setsockopt(SOCKOPT_SET_IFADDR_DEL, param, sizeof(struct inet_addr_param)); 
    else if (cmd == IPADDRESS_ADD)
-       err = dpvs_setsockopt(SOCKOPT_SET_IFADDR_ADD, param, sizeof(struct inet_addr_param));
+       err = ipvs_setsockopt(SOCKOPT_SET_IFADDR_ADD, param, sizeof(struct inet_addr_param));
    return err;
 }
 
 int ipvs_send_gratuitous_arp(struct in_addr *in)
 {
-    return dpvs_setsockopt(DPVS_SO_SET_GRATARP, in, sizeof(in));
+    return ipvs_setsockopt(DPVS_SO_SET_GRATARP, in, sizeof(in));
 }
 
 ipvs_timeout_t *ipvs_get_timeout(void)
@@ -929,21 +1212,29 @@ ipvs_timeout_t *ipvs_get_timeout(void)
 ipvs_daemon_t *ipvs_get_daemon(void)
 {
 	ipvs_daemon_t *u;
-	socklen_t len;
+	struct dp_vs_sync_daemon_conf *dms;
+	size_t len;
+	int i;
 
 	/* note that we need to get the info about two possible
 	   daemons, master and backup. */
-	len = sizeof(*u) * 2;
-	if (!(u = malloc(len)))
+	ipvs_func = ipvs_get_daemon;
+	if (ipvs_getsockopt(SOCKOPT_GET_SYNC_DAEMON, NULL, 0, (void **)&dms, &len))
 		return NULL;
 
-	ipvs_func = ipvs_get_daemon;
-	if (getsockopt(sockfd, IPPROTO_IP, IP_VS_SO_GET_DAEMON, (char *)u, &len)) {
-		free(u);
+	if (len < 2 * sizeof(*dms) || !(u = calloc(2, sizeof(*u)))) {
+		dpvs_sockopt_msg_free(dms);
 		return NULL;
 	}
 
-	return NULL;
+	for (i = 0; i < 2; i++) {
+		u[i].state = dms[i].state;
+		strncpy(u[i].mcast_ifn, dms[i].mcast_ifn, IP_VS_IFNAME_MAXLEN - 1);
+		u[i].syncid = dms[i].syncid;
+	}
+
+	dpvs_sockopt_msg_free(dms);
+	return u;
 }
 void ipvs_close(void)
 {
@@ -960,11 +1251,11 @@ struct ip_vs_conn_array* ip_vs_get_conns(const struct ip_vs_conn_req *req)
     struct ip_vs_conn_array *conn_arr, *arr_rcv;
 
     if (req->flag & GET_IPVS_CONN_FLAG_SPECIFIED)
-        res = dpvs_getsockopt(SOCKOPT_GET_CONN_SPECIFIED, req,
+        res = ipvs_getsockopt(SOCKOPT_GET_CONN_SPECIFIED, req,
                 sizeof(struct ip_vs_conn_req),
                 (void **)&arr_rcv, &rcvlen);
     else
-        res = dpvs_getsockopt(SOCKOPT_GET_CONN_ALL, req,
+        res = ipvs_getsockopt(SOCKOPT_GET_CONN_ALL, req,
                 sizeof(struct ip_vs_conn_req),
                 (void **)&arr_rcv, &rcvlen);
 
@@ -1020,7 +1311,7 @@ struct ip_vs_get_laddrs *ipvs_get_laddrs(ipvs_service_entry_t *svc, lcoreid_t ci
 	snprintf(conf.iifname, sizeof(conf.iifname), "%s", svc->user.iifname);
 	snprintf(conf.iifname, sizeof(conf.oifname), "%s", svc->user.oifname);
 
-	if (dpvs_getsockopt(cpu2opt_laddr(cid, SOCKOPT_GET_LADDR_GETALL), &conf, sizeof(conf),
+	if (ipvs_getsockopt(cpu2opt_laddr(cid, SOCKOPT_GET_LADDR_GETALL), &conf, sizeof(conf),
 				(void **)&result, &res_size) != 0)
 		return NULL;
 
@@ -1062,7 +1353,7 @@ struct dp_vs_blklst_conf_array *ipvs_get_blklsts(void)
 	size_t size;
 	int i, err;
 
-	err = dpvs_getsockopt(SOCKOPT_GET_BLKLST_GETALL, NULL, 0, 
+	err = ipvs_getsockopt(SOCKOPT_GET_BLKLST_GETALL, NULL, 0, 
 				(void **)&result, &size);
 	if (err != 0)
 		return NULL;
@@ -1122,6 +1413,10 @@ const char *ipvs_strerror(int err)
 		{ ipvs_del_blklst, ENOENT, "No such deny address" },
 		{ ipvs_get_blklsts, ESRCH, "Service not defined" },
 		{ ipvs_get_dests, ESRCH, "No such service" },
+		{ ipvs_get_rtt, ESRCH, "No such service" },
+		{ ipvs_set_connlimit, ESRCH, "No such service" },
+		{ ipvs_get_connlimit, ESRCH, "No such service" },
+		{ ipvs_get_attack, ESRCH, "No such service" },
 		{ ipvs_get_service, ESRCH, "No such service" },
 #ifdef _WITH_SNMP_CHECKER_
 #endif
@@ -4,10 +4,19 @@
 #include <malloc.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <poll.h>
 #include "../include/conf/common.h"
 
 #define UNIX_DOMAIN "/var/run/dpvs_ctrl"
 
+/*
+ * dpvs keeps control connections open, so one connection is reused for all
+ * requests of a process instead of connecting per request.
+ */
+static int sockopt_fd = -1;
+static pid_t sockopt_pid;
+static pthread_mutex_t sockopt_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /* send "n" bytes to a descriptor */
 ssize_t send_n(int fd, const void *vptr, size_t n, int flags)
 {
@@ -156,76 +165,118 @@ static inline int sockopt_msg_recv(int clt_fd, struct dpvs_sock_msg_reply *reply
     return ESOCKOPT_OK;
 }
 
-int dpvs_setsockopt(sockoptid_t cmd, const void *in, size_t in_len)
+static void sockopt_disconnect(void)
+{
+    if (sockopt_fd >= 0)
+        close(sockopt_fd);
+    sockopt_fd = -1;
+}
+
+/* an idle connection is readable only if dpvs closed it */
+static inline int sockopt_conn_stale(void)
+{
+    struct pollfd pfd = { .fd = sockopt_fd, .events = POLLIN };
+
+    return poll(&pfd, 1, 0) != 0;
+}
+
+static int sockopt_connect(int *reused)
 {
-    struct dpvs_sock_msg *msg;
-    struct dpvs_sock_msg_reply reply_hdr;
     struct sockaddr_un clt_addr;
     int clt_fd;
-    int res;
-    size_t msg_len;
+
+    /* never share the connection with a forked child */
+    if (sockopt_fd >= 0 && (sockopt_pid != getpid() || sockopt_conn_stale()))
+        sockopt_disconnect();
+
+    *reused = (sockopt_fd >= 0);
+    if (sockopt_fd >= 0)
+        return sockopt_fd;
 
     memset(&clt_addr, 0, sizeof(struct sockaddr_un));
     clt_addr.sun_family = AF_UNIX;
     strncpy(clt_addr.sun_path, UNIX_DOMAIN, sizeof(clt_addr.sun_path) - 1);
 
-    msg_len = sizeof(struct dpvs_sock_msg);
-    msg = malloc(msg_len);
-    if (NULL == msg) {
-        fprintf(stderr, "[%s] no memory\n", __func__);
-        return -ESOCKOPT_INVAL;
+    clt_fd = socket(PF_UNIX, SOCK_STREAM, 0);
+    if (clt_fd < 0) {
+        fprintf(stderr, "[%s] scoket msg connection error: %s\n",
+                __func__, strerror(errno));
+        return -ESOCKOPT_IO;
     }
 
-    clt_fd = socket(PF_UNIX, SOCK_STREAM, 0);
-    res = connect(clt_fd, (struct sockaddr *)&clt_addr, sizeof(clt_addr));
-    if (-1 == res) {
+    if (-1 == connect(clt_fd, (struct sockaddr *)&clt_addr, sizeof(clt_addr))) {
         fprintf(stderr, "[%s] scoket msg connection error: %s\n",
                 __func__, strerror(errno));
-        free(msg);
+        close(clt_fd);
         return -ESOCKOPT_IO;
     }
 
-    memset(msg, 0, msg_len);
-    msg->version = SOCKOPT_VERSION;
-    msg->id = cmd;
-    msg->type = SOCKOPT_SET;
-    msg->len = in_len;
-    res = sockopt_msg_send(clt_fd, msg, in, in_len);
+    sockopt_fd = clt_fd;
+    sockopt_pid = getpid();
+    return sockopt_fd;
+}
 
-    free(msg);
-    msg = NULL;
+static int sockopt_request(enum sockopt_type type, sockoptid_t cmd,
+        const void *in, size_t in_len, void **out, size_t *out_len)
+{
+    struct dpvs_sock_msg msg;
+    struct dpvs_sock_msg_reply reply_hdr;
+    int clt_fd, reused, res;
 
-    if (res) {
-        close(clt_fd);
-        return res;
+    memset(&msg, 0, sizeof(msg));
+    msg.version = SOCKOPT_VERSION;
+    msg.id = cmd;
+    msg.type = type;
+    msg.len = in_len;
+
+    pthread_mutex_lock(&sockopt_lock);
+
+    clt_fd = sockopt_connect(&reused);
+    if (clt_fd < 0) {
+        pthread_mutex_unlock(&sockopt_lock);
+        return clt_fd;
     }
 
-    res = sockopt_msg_recv(clt_fd, &reply_hdr, NULL, NULL);
+    res = sockopt_msg_send(clt_fd, &msg, in, in_len);
+    if (res && reused) {
+        /* dpvs dropped the idle connection, the request never reached it */
+        sockopt_disconnect();
+        clt_fd = sockopt_connect(&reused);
+        if (clt_fd < 0) {
+            pthread_mutex_unlock(&sockopt_lock);
+            return clt_fd;
+        }
+        res = sockopt_msg_send(clt_fd, &msg, in, in_len);
+    }
     if (res) {
-        close(clt_fd);
+        sockopt_disconnect();
+        pthread_mutex_unlock(&sockopt_lock);
         return res;
     }
 
+    res = sockopt_msg_recv(clt_fd, &reply_hdr, out, out_len);
+    if (res == -ESOCKOPT_IO || res == -ESOCKOPT_NOMEM)
+        sockopt_disconnect(); /* out of sync with the stream */
+    pthread_mutex_unlock(&sockopt_lock);
+    if (res)
+        return res;
+
     if (reply_hdr.errcode) {
         fprintf(stderr, "[%s] Server error: %s\n", __func__, reply_hdr.errstr);
-        close(clt_fd);
         return reply_hdr.errcode;
     }
 
-    close(clt_fd);
     return ESOCKOPT_OK;
 }
 
+int dpvs_setsockopt(sockoptid_t cmd, const void *in, size_t in_len)
+{
+    return sockopt_request(SOCKOPT_SET, cmd, in, in_len, NULL, NULL);
+}
+
 int dpvs_getsockopt(sockoptid_t cmd, const void *in, size_t in_len,
         void **out, size_t *out_len)
 {
-    struct dpvs_sock_msg *msg;
-    struct dpvs_sock_msg_reply reply_hdr;
-    struct sockaddr_un clt_addr;
-    int clt_fd;
-    int res;
-    size_t msg_len;
-
     if (NULL == out || NULL == out_len) {
         fprintf(stderr, "[%s] no pointer for info return\n", __func__);
         return -1;
@@ -233,53 +284,5 @@ int dpvs_getsockopt(sockoptid_t cmd, const void *in, size_t in_len,
     *out = NULL; // struct ip_vs_getinfo *ipvs_info_rcv ; out = &ipvs_info_rcv; *out = ipvs_info_rcv = NULL;
     *out_len = 0;
 
-    memset(&clt_addr, 0, sizeof(struct sockaddr_un));
-    clt_addr.sun_family = AF_UNIX;
-    strncpy(clt_addr.sun_path, UNIX_DOMAIN, sizeof(clt_addr.sun_path) - 1);
-
-    msg_len = sizeof(struct dpvs_sock_msg);
-    msg = malloc(msg_len);
-    if (NULL == msg) {
-        fprintf(stderr, "[%s] no memory\n", __func__);
-        return -ESOCKOPT_NOMEM;
-    }
-
-    clt_fd = socket(PF_UNIX, SOCK_STREAM, 0);
-    res = connect(clt_fd, (struct sockaddr*)&clt_addr, sizeof(clt_addr));
-    if (-1 == res) {
-        fprintf(stderr, "[%s] scoket msg connection error: %s\n",
-                __func__, strerror(errno));
-        free(msg);
-        return -ESOCKOPT_IO;
-    }
-
-    memset(msg, 0, msg_len);
-    msg->version = SOCKOPT_VERSION;
-    msg->id = cmd;
-    msg->type = SOCKOPT_GET;
-    msg->len = in_len;
-    res = sockopt_msg_send(clt_fd, msg, in, in_len);
-
-    free(msg);
-    msg = NULL;
-
-    if (res) {
-        close(clt_fd);
-        return res;
-    }
-
-    res = sockopt_msg_recv(clt_fd, &reply_hdr, out, out_len);
-    if (res) {
-        close(clt_fd);
-        return res;
-    }
-
-    if (reply_hdr.errcode) {
-        fprintf(stderr, "[%s] Server error: %s\n", __func__, reply_hdr.errstr);
-        close(clt_fd);
-        return reply_hdr.errcode;
-    }
-
-    close(clt_fd);
-    return ESOCKOPT_OK;
+    return sockopt_request(SOCKOPT_GET, cmd, in, in_len, out, out_len);
 }
@@ -0,0 +1,75 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * per-service anomaly counters: totals and a per-second history of the
+ * packets that tell what a service is attacked with.
+ */
+#ifndef __DPVS_ATTACK_CONF_H__
+#define __DPVS_ATTACK_CONF_H__
+
+#include <stdint.h>
+#include "conf/service.h"
+
+enum {
+    /* get */
+    SOCKOPT_GET_SVC_ATTACK = 7000,
+};
+
+enum {
+    DP_VS_ATTACK_SYN = 0,       /* SYNs */
+    DP_VS_ATTACK_ESTAB,         /* handshakes completed */
+    DP_VS_ATTACK_BAD_COOKIE,    /* ACKs failing the syn cookie check */
+    DP_VS_ATTACK_ACK_STORM,     /* duplicate ACKs stopped on syn-proxy conns */
+    DP_VS_ATTACK_RST,           /* RSTs from clients */
+    DP_VS_ATTACK_BLKLST,        /* packets of blacklisted clients */
+    DP_VS_ATTACK_NO_CONN,       /* TCP packets of no connection, but SYNs */
+    DP_VS_ATTACK_MAX,
+};
+
+/* seconds of history, the current second included */
+#define DP_VS_ATTACK_HIST       60
+
+struct dp_vs_attack_stats {
+    uint64_t    total[DP_VS_ATTACK_MAX];
+
+    /* counts of second s are in hist[s % DP_VS_ATTACK_HIST], @sec is the
+     * current second (of the TSC, alike on all lcores) */
+    uint32_t    sec;
+    uint32_t    hist[DP_VS_ATTACK_HIST][DP_VS_ATTACK_MAX];
+};
+
+struct dp_vs_get_attack {
+    /* which service, as for dp_vs_get_dests */
+    int              af;
+    uint16_t         proto;
+    union inet_addr  addr;
+    uint16_t         port;
+    uint32_t         fwmark;
+    char             srange[256];
+    char             drange[256];
+    char             iifname[IFNAMSIZ];
+    char             oifname[IFNAMSIZ];
+
+    /* lcore index as ipvsadm --cpu, 0 sums up all lcores */
+    lcoreid_t        cid;
+
+    /* filled in by dpvs */
+    struct dp_vs_attack_stats stats;
+};
+
+#endif /* __DPVS_ATTACK_CONF_H__ */
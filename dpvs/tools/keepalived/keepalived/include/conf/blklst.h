@@ -32,6 +32,13 @@ enum {
     SOCKOPT_GET_BLKLST_GETALL,
 };
 
+/* action of a rule, the longest matching source prefix wins */
+enum {
+    DPVS_BLKLST_DENY        = 0,
+    DPVS_BLKLST_ALLOW,      /* any allow rule of a service denies the
+                               sources matching none of its rules */
+};
+
 struct dp_vs_blklst_entry {
     union inet_addr addr;
 };
@@ -46,6 +53,14 @@ struct dp_vs_blklst_conf {
 
     /* for set */
     union inet_addr     blklst;
+    uint8_t             plen;       /* source prefix, 0 for a single host */
+    uint8_t             action;     /* DPVS_BLKLST_DENY/ALLOW */
+    /* TCP only, packets match if (flags & tcp_flags_mask) == tcp_flags */
+    uint8_t             tcp_flags;
+    uint8_t             tcp_flags_mask;
+
+    /* for get */
+    uint64_t            hits;       /* packets denied by the rule */
 };
 
 struct dp_vs_blklst_conf_array {
@@ -76,10 +76,30 @@ struct ip_vs_conn_entry {
 };
 typedef struct ip_vs_conn_entry ipvs_conn_entry_t;
 
+/* server-side filter for GET_IPVS_CONN_FLAG_ALL, zero fields match any */
+enum conn_filter_flags {
+    GET_IPVS_CONN_FILTER_VADDR      = 1,
+    GET_IPVS_CONN_FILTER_DADDR      = 2,
+    GET_IPVS_CONN_FILTER_STATE      = 4,
+};
+
+struct ip_vs_conn_filter {
+    uint32_t            flags;
+    uint16_t            proto;
+    uint16_t            af;         /* of vaddr */
+    uint16_t            daf;        /* of daddr */
+    __be16              vport;
+    __be16              dport;
+    union inet_addr     vaddr;
+    union inet_addr     daddr;
+    char                state[16];
+};
+
 struct ip_vs_conn_req {
     uint32_t flag;
     uint32_t whence;
     ipvs_sockpair_t sockpair;
+    struct ip_vs_conn_filter filter;
 };
 
 struct ip_vs_conn_array {
@@ -0,0 +1,106 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * backend RTT histograms of services and real servers, measured from
+ * the TCP timestamps dpvs puts on FNAT connections.
+ */
+#ifndef __DPVS_RTT_CONF_H__
+#define __DPVS_RTT_CONF_H__
+
+#include <stdint.h>
+#include "conf/service.h"
+
+/*
+ * log-linear buckets: values below DP_VS_RTT_SUB are exact, every power
+ * of 2 above is split into DP_VS_RTT_SUB buckets (12.5% resolution).
+ * samples of 2^DP_VS_RTT_MAX_BITS us (~16.7s) and above go to the last.
+ */
+#define DP_VS_RTT_SUB_BITS      3
+#define DP_VS_RTT_SUB           (1 << DP_VS_RTT_SUB_BITS)
+#define DP_VS_RTT_MAX_BITS      24
+#define DP_VS_RTT_BUCKETS       \
+    ((DP_VS_RTT_MAX_BITS - DP_VS_RTT_SUB_BITS + 1) * DP_VS_RTT_SUB)
+
+enum {
+    /* get */
+    SOCKOPT_GET_SVC_RTT = 6800,
+};
+
+struct dp_vs_rtt_hist {
+    uint64_t    count;
+    uint64_t    sum_us;
+    uint64_t    max_us;
+    uint64_t    buckets[DP_VS_RTT_BUCKETS];
+};
+
+struct dp_vs_rtt_entry {
+    int             af;
+    union inet_addr addr;       /* real server */
+    uint16_t        port;
+    struct dp_vs_rtt_hist rtt;
+};
+
+struct dp_vs_get_rtt {
+    /* which service: user fills in these, as for dp_vs_get_dests */
+    int              af;
+    uint16_t         proto;
+    union inet_addr  addr;
+    uint16_t         port;
+    uint32_t         fwmark;
+    char             srange[256];
+    char             drange[256];
+    char             iifname[IFNAMSIZ];
+    char             oifname[IFNAMSIZ];
+
+    /* lcore index as ipvsadm --cpu, 0 sums up all lcores */
+    lcoreid_t        cid;
+
+    /* filled in by dpvs */
+    unsigned int     num_dests;
+    struct dp_vs_rtt_hist svc;
+    struct dp_vs_rtt_entry entrytable[0];
+};
+
+static inline int dp_vs_rtt_bucket(uint32_t us)
+{
+    int msb;
+
+    if (us < DP_VS_RTT_SUB)
+        return us;
+    if (us >= 1U << DP_VS_RTT_MAX_BITS)
+        us = (1U << DP_VS_RTT_MAX_BITS) - 1;
+
+    msb = 31 - __builtin_clz(us);
+    return (msb - DP_VS_RTT_SUB_BITS + 1) * DP_VS_RTT_SUB
+           + ((us >> (msb - DP_VS_RTT_SUB_BITS)) & (DP_VS_RTT_SUB - 1));
+}
+
+/* largest value (us) falling into bucket @idx */
+static inline uint32_t dp_vs_rtt_bucket_max(int idx)
+{
+    int shift;
+
+    if (idx < DP_VS_RTT_SUB)
+        return idx;
+
+    shift = idx / DP_VS_RTT_SUB - 1;
+    return ((uint32_t)(DP_VS_RTT_SUB + idx % DP_VS_RTT_SUB) << shift)
+           + (1U << shift) - 1;
+}
+
+#endif /* __DPVS_RTT_CONF_H__ */
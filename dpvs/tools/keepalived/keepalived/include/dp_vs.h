@@ -29,5 +29,10 @@
 #include "conf/ip_tunnel.h"
 #include "conf/service.h"
 #include "conf/dest.h"
+#include "conf/svc_batch.h"
+#include "conf/sync.h"
+#include "conf/rtt.h"
+#include "conf/connlimit.h"
+#include "conf/attack.h"
 
 #endif
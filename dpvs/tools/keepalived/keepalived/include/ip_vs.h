@@ -34,6 +34,8 @@
 #define IP_VS_SVC_F_HASHED	0x0002		/* hashed entry */
 #define IP_VS_SVC_F_ONEPACKET	0x0004		/* one-packet scheduling */
 #define IP_VS_CONN_F_SYNPROXY	0x8000		/* synproxy switch flag*/
+#define IP_VS_CONN_F_SYNPROXY_AUTO	0x4000	/* synproxy under SYN flood only */
+#define IP_VS_SVC_F_SYNPROXY_ON	0x0800		/* get only, auto synproxy is on */
 #define IP_VS_SVC_F_SCHED1	0x0008		/* scheduler flag 1 */
 #define IP_VS_SVC_F_SCHED2	0x0010		/* scheduler flag 2 */
 #define IP_VS_SVC_F_SCHED3	0x0020		/* scheduler flag 3 */
@@ -213,6 +215,10 @@ struct ip_vs_blklst_user {
 	__be32 			__addr_v4;
 	u_int16_t 		af;
 	union nf_inet_addr 	addr;
+	u_int8_t		plen;	/* source prefix, 0 for a single host */
+	u_int8_t		action;	/* DPVS_BLKLST_DENY/ALLOW */
+	u_int8_t		tcp_flags;	/* TCP flags under tcp_flags_mask */
+	u_int8_t		tcp_flags_mask;
 };
 
 struct ip_vs_tunnel_user {
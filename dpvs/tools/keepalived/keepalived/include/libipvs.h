@@ -41,7 +41,8 @@
 #define OPT_IFNAME		0x4000000
 #define OPT_SOCKPAIR		0x8000000
 #define OPT_HASHTAG		0x10000000
-#define NUMBER_OF_OPT		30 //opt cid is not defined above
+#define OPT_CONNSTATE		0x40000000 /* 0x20000000 is taken by cid */
+#define NUMBER_OF_OPT		31
 
 #define MINIMUM_IPVS_VERSION_MAJOR      1
 #define MINIMUM_IPVS_VERSION_MINOR      1
@@ -84,6 +85,13 @@ extern int ipvs_set_timeout(ipvs_timeout_t *to);
 /* flush all the rules */
 extern int ipvs_flush(void);
 
+/* queue service/dest changes until commit, flags are DP_VS_SVC_BATCH_F_* */
+extern int ipvs_batch_begin(unsigned int flags);
+
+/* send the queued changes, return the first error seen since begin and
+ * the index of the op that failed in @failed (-1 if none) */
+extern int ipvs_batch_commit(int *failed);
+
 /* add a virtual service */
 extern int ipvs_add_service(ipvs_service_t *svc);
 
@@ -137,6 +145,20 @@ extern struct ip_vs_get_services_app *ipvs_get_services(lcoreid_t);
 /* get the destination array of the specified service */
 extern struct ip_vs_get_dests_app *ipvs_get_dests(ipvs_service_entry_t *svc, lcoreid_t cid);
 
+/* get the RTT histograms of the specified service and its dests */
+extern struct dp_vs_get_rtt *ipvs_get_rtt(ipvs_service_entry_t *svc, lcoreid_t cid);
+
+/* set the per-client limits of a service */
+extern int ipvs_set_connlimit(ipvs_service_t *svc, struct dp_vs_connlimit_conf *conf);
+
+/* get the per-client limits and their counters of a service */
+extern struct dp_vs_connlimit_conf *ipvs_get_connlimit(ipvs_service_entry_t *svc,
+							lcoreid_t cid);
+
+/* get the anomaly counters of a service */
+extern struct dp_vs_get_attack *ipvs_get_attack(ipvs_service_entry_t *svc,
+						lcoreid_t cid);
+
 /* get an ipvs service entry */
 extern ipvs_service_entry_t *ipvs_get_service(struct ip_vs_service_app *hint, lcoreid_t cid);
 